@@ -0,0 +1,284 @@
+#ifndef RAYTRACER_AOV_H
+#define RAYTRACER_AOV_H
+
+#include <cstdint>
+#include <fstream>
+#include <initializer_list>
+#include <string>
+#include <unordered_map>
+
+#include "raytracer/Denoiser.h"
+
+// Arbitrary output variables: per-pixel data besides the beauty image, taken
+// from the same camera samples that shade it so compositing needs no extra
+// render.
+//
+// Every enabled channel is stored planar: one row-major float plane per
+// component, row 0 at the top, so a consumer reads one plane without
+// touching the others. Depth, normal and albedo are the pixel averages of the
+// first hits (HitFeatures via PixelAccumulator); where every sample escaped,
+// depth is infinity and the normal zero. Material and primitive IDs
+// belong to the first sample that hit anything and are -1 where none did;
+// floats hold them exactly up to 2^24. Sample count and the variance of the
+// mean luminance come from the accumulator as well.
+//
+// export_aovs() writes all enabled channels at once, one PFM per channel.
+
+enum class AovChannel { Depth, Normal, Albedo, MaterialId, PrimitiveId, SampleCount, Variance };
+
+constexpr int kAovChannelCount = 7;
+
+// Components per pixel: 3 for normal and albedo, 1 otherwise.
+int aov_components(AovChannel channel);
+// Lower-case name, also the file suffix used by export_aovs().
+const char* aov_name(AovChannel channel);
+// Inverse of aov_name(); throws std::invalid_argument on unknown names.
+AovChannel aov_channel(const std::string& name);
+
+// Set of channels.
+class AovSet {
+public:
+    AovSet() {}
+    AovSet(std::initializer_list<AovChannel> channels);
+
+    static AovSet all();
+
+    AovSet& add(AovChannel channel);
+    bool contains(AovChannel channel) const { return (bits & bit(channel)) != 0; }
+    bool empty() const { return bits == 0; }
+
+private:
+    static uint32_t bit(AovChannel channel) { return 1u << static_cast<int>(channel); }
+
+    uint32_t bits = 0;
+};
+
+// Integer IDs for the top-level primitives of a scene: the primitive's index
+// in the list, and its material's index in order of first use.
+class AovIds {
+public:
+    AovIds() {}
+    explicit AovIds(const HitableList& objects);
+
+    // -1 for objects that are not in the list.
+    int primitive(const Hitable* object) const;
+    // -1 for unknown objects and objects without a single material.
+    int material(const Hitable* object) const;
+
+private:
+    struct Entry {
+        int primitive;
+        int material;
+    };
+    std::unordered_map<const Hitable*, Entry> entries;
+};
+
+class AovBuffers {
+public:
+    AovBuffers() {}
+    AovBuffers(int width, int height, const AovSet& channels);
+
+    int width() const { return image_width; }
+    int height() const { return image_height; }
+    size_t size() const { return static_cast<size_t>(image_width) * static_cast<size_t>(image_height); }
+    const AovSet& channels() const { return enabled; }
+
+    // Plane `component` of `channel`; throws std::invalid_argument if the
+    // channel is not enabled or the component is out of range.
+    float* plane(AovChannel channel, int component = 0);
+    const float* plane(AovChannel channel, int component = 0) const;
+
+    // Writes the enabled channels of the pixel at `index` (row-major).
+    void resolve(size_t index, const PixelAccumulator& pixel, const AovIds& ids);
+
+private:
+    int image_width = 0;
+    int image_height = 0;
+    AovSet enabled;
+    // Planes of one channel back to back.
+    std::vector<float> storage[kAovChannelCount];
+};
+
+// Writes `<prefix>.<name>.pfm` for every enabled channel, little-endian, and
+// returns the paths written. Throws std::runtime_error if a file cannot be
+// written.
+std::vector<std::string> export_aovs(const AovBuffers& buffers, const std::string& prefix);
+
+inline int aov_components(AovChannel channel) {
+    return channel == AovChannel::Normal || channel == AovChannel::Albedo ? 3 : 1;
+}
+
+inline const char* aov_name(AovChannel channel) {
+    switch (channel) {
+    case AovChannel::Depth:
+        return "depth";
+    case AovChannel::Normal:
+        return "normal";
+    case AovChannel::Albedo:
+        return "albedo";
+    case AovChannel::MaterialId:
+        return "material_id";
+    case AovChannel::PrimitiveId:
+        return "primitive_id";
+    case AovChannel::SampleCount:
+        return "sample_count";
+    case AovChannel::Variance:
+        return "variance";
+    }
+    return "unknown";
+}
+
+inline AovChannel aov_channel(const std::string& name) {
+    for (int i = 0; i < kAovChannelCount; ++i) {
+        const AovChannel channel = static_cast<AovChannel>(i);
+        if (name == aov_name(channel)) {
+            return channel;
+        }
+    }
+    throw std::invalid_argument("Unknown AOV channel: " + name);
+}
+
+inline AovSet::AovSet(std::initializer_list<AovChannel> channels) {
+    for (AovChannel channel : channels) {
+        add(channel);
+    }
+}
+
+inline AovSet AovSet::all() {
+    AovSet set;
+    for (int i = 0; i < kAovChannelCount; ++i) {
+        set.add(static_cast<AovChannel>(i));
+    }
+    return set;
+}
+
+inline AovSet& AovSet::add(AovChannel channel) {
+    bits |= bit(channel);
+    return *this;
+}
+
+inline AovIds::AovIds(const HitableList& objects) {
+    std::unordered_map<const Material*, int> material_ids;
+    for (size_t i = 0; i < objects.objects.size(); ++i) {
+        const Hitable* object = objects.objects[i].get();
+        const Material* material = object->material();
+        int material_id = -1;
+        if (material) {
+            material_id = material_ids.emplace(material, static_cast<int>(material_ids.size())).first->second;
+        }
+        entries.emplace(object, Entry{static_cast<int>(i), material_id});
+    }
+}
+
+inline int AovIds::primitive(const Hitable* object) const {
+    const auto it = entries.find(object);
+    return it == entries.end() ? -1 : it->second.primitive;
+}
+
+inline int AovIds::material(const Hitable* object) const {
+    const auto it = entries.find(object);
+    return it == entries.end() ? -1 : it->second.material;
+}
+
+inline AovBuffers::AovBuffers(int width, int height, const AovSet& channels)
+    : image_width(width), image_height(height), enabled(channels) {
+    if (width <= 0 || height <= 0) {
+        throw std::invalid_argument("AovBuffers requires a positive size.");
+    }
+    for (int i = 0; i < kAovChannelCount; ++i) {
+        const AovChannel channel = static_cast<AovChannel>(i);
+        if (enabled.contains(channel)) {
+            storage[i].assign(size() * aov_components(channel), 0.0f);
+        }
+    }
+}
+
+inline const float* AovBuffers::plane(AovChannel channel, int component) const {
+    if (!enabled.contains(channel)) {
+        throw std::invalid_argument(std::string("AOV channel not enabled: ") + aov_name(channel));
+    }
+    if (component < 0 || component >= aov_components(channel)) {
+        throw std::invalid_argument(std::string("AOV component out of range for ") + aov_name(channel));
+    }
+    return storage[static_cast<int>(channel)].data() + size() * component;
+}
+
+inline float* AovBuffers::plane(AovChannel channel, int component) {
+    return const_cast<float*>(static_cast<const AovBuffers&>(*this).plane(channel, component));
+}
+
+inline void AovBuffers::resolve(size_t index, const PixelAccumulator& pixel, const AovIds& ids) {
+    const size_t count = size();
+    const auto write = [&](AovChannel channel, float value) {
+        storage[static_cast<int>(channel)][index] = value;
+    };
+    const auto write3 = [&](AovChannel channel, const Vec3& value) {
+        float* data = storage[static_cast<int>(channel)].data();
+        for (int c = 0; c < 3; ++c) {
+            data[count * c + index] = static_cast<float>(value[c]);
+        }
+    };
+    if (enabled.contains(AovChannel::Depth)) {
+        write(AovChannel::Depth, static_cast<float>(pixel.depth()));
+    }
+    if (enabled.contains(AovChannel::Normal)) {
+        write3(AovChannel::Normal, pixel.normal());
+    }
+    if (enabled.contains(AovChannel::Albedo)) {
+        write3(AovChannel::Albedo, pixel.albedo());
+    }
+    if (enabled.contains(AovChannel::MaterialId)) {
+        write(AovChannel::MaterialId, static_cast<float>(ids.material(pixel.object())));
+    }
+    if (enabled.contains(AovChannel::PrimitiveId)) {
+        write(AovChannel::PrimitiveId, static_cast<float>(ids.primitive(pixel.object())));
+    }
+    if (enabled.contains(AovChannel::SampleCount)) {
+        write(AovChannel::SampleCount, static_cast<float>(pixel.samples()));
+    }
+    if (enabled.contains(AovChannel::Variance)) {
+        write(AovChannel::Variance, static_cast<float>(pixel.variance()));
+    }
+}
+
+inline std::vector<std::string> export_aovs(const AovBuffers& buffers, const std::string& prefix) {
+    std::vector<std::string> paths;
+    const int width = buffers.width();
+    const int height = buffers.height();
+    std::vector<float> row;
+    for (int i = 0; i < kAovChannelCount; ++i) {
+        const AovChannel channel = static_cast<AovChannel>(i);
+        if (!buffers.channels().contains(channel)) {
+            continue;
+        }
+        const int components = aov_components(channel);
+        const std::string path = prefix + "." + aov_name(channel) + ".pfm";
+        std::ofstream out(path, std::ios::binary);
+        if (!out) {
+            throw std::runtime_error("Cannot write AOV file: " + path);
+        }
+        // Negative scale marks little-endian samples.
+        out << (components == 3 ? "PF" : "Pf") << "\n"
+            << width << " " << height << "\n"
+            << (environment_detail::host_is_little_endian() ? "-1.0" : "1.0") << "\n";
+
+        // PFM interleaves components and runs bottom to top.
+        row.resize(static_cast<size_t>(width) * components);
+        for (int y = height - 1; y >= 0; --y) {
+            for (int c = 0; c < components; ++c) {
+                const float* source = buffers.plane(channel, c) + static_cast<size_t>(y) * width;
+                for (int x = 0; x < width; ++x) {
+                    row[static_cast<size_t>(x) * components + c] = source[x];
+                }
+            }
+            out.write(reinterpret_cast<const char*>(row.data()), static_cast<std::streamsize>(row.size() * sizeof(float)));
+        }
+        if (!out) {
+            throw std::runtime_error("Cannot write AOV file: " + path);
+        }
+        paths.push_back(path);
+    }
+    return paths;
+}
+
+#endif // RAYTRACER_AOV_H
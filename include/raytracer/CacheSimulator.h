@@ -0,0 +1,87 @@
+#ifndef RAYTRACER_CACHE_SIMULATOR_H
+#define RAYTRACER_CACHE_SIMULATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+// Set-associative LRU model of one cache level.
+//
+// Traversal code feeds it the addresses it reads; misses are counted per line.
+// Hardware counters are neither portable nor free of noise from other
+// processes, so layout comparisons use this model instead. A page-granular
+// instance (line_bytes = 4096) approximates a data TLB.
+class CacheSimulator {
+public:
+    explicit CacheSimulator(size_t capacity_bytes = 256 * 1024, size_t line_bytes = 64, size_t ways = 8);
+
+    // Touches every line overlapped by [address, address + bytes).
+    void access(const void* address, size_t bytes);
+    void reset();
+
+    size_t line_size() const { return line_bytes; }
+    size_t set_count() const { return sets; }
+
+public:
+    uint64_t accesses = 0;
+    uint64_t misses = 0;
+
+private:
+    void touch_line(uint64_t line);
+
+    size_t line_bytes;
+    size_t ways;
+    size_t sets;
+    uint64_t clock = 0;
+    std::vector<uint64_t> tags;       // sets * ways, kEmpty when unused
+    std::vector<uint64_t> last_used;  // LRU timestamps, parallel to tags
+
+    static constexpr uint64_t kEmpty = ~uint64_t{0};
+};
+
+inline CacheSimulator::CacheSimulator(size_t capacity_bytes, size_t line_bytes_, size_t ways_)
+    : line_bytes(line_bytes_), ways(ways_) {
+    if (line_bytes == 0 || ways == 0 || capacity_bytes < line_bytes * ways) {
+        throw std::invalid_argument("CacheSimulator needs at least one set of non-empty lines.");
+    }
+    sets = capacity_bytes / (line_bytes * ways);
+    reset();
+}
+
+inline void CacheSimulator::reset() {
+    accesses = 0;
+    misses = 0;
+    clock = 0;
+    tags.assign(sets * ways, kEmpty);
+    last_used.assign(sets * ways, 0);
+}
+
+inline void CacheSimulator::access(const void* address, size_t bytes) {
+    const uint64_t first = reinterpret_cast<uintptr_t>(address) / line_bytes;
+    const uint64_t last = (reinterpret_cast<uintptr_t>(address) + (bytes > 0 ? bytes - 1 : 0)) / line_bytes;
+    for (uint64_t line = first; line <= last; ++line) {
+        touch_line(line);
+    }
+}
+
+inline void CacheSimulator::touch_line(uint64_t line) {
+    ++accesses;
+    ++clock;
+    const size_t base = static_cast<size_t>(line % sets) * ways;
+    size_t victim = base;
+    for (size_t way = base; way < base + ways; ++way) {
+        if (tags[way] == line) {
+            last_used[way] = clock;
+            return;
+        }
+        if (last_used[way] < last_used[victim]) {
+            victim = way;
+        }
+    }
+    ++misses;
+    tags[victim] = line;
+    last_used[victim] = clock;
+}
+
+#endif // RAYTRACER_CACHE_SIMULATOR_H
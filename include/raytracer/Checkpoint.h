@@ -0,0 +1,531 @@
+#ifndef RAYTRACER_CHECKPOINT_H
+#define RAYTRACER_CHECKPOINT_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "raytracer/Aov.h"
+#include "raytracer/Progressive.h"
+
+// Checkpoints of a progressive film, so long renders survive the process.
+//
+// The file is memory-mapped and holds a header with the settings that
+// reproduce the render (size, depth, sample target, scene and sample seeds)
+// followed by two slots. Each checkpoint goes to the older slot: the pixel
+// sums are written and flushed first, then the slot header (view, passes,
+// checksum, sequence number) and flushed again. A crash mid-write leaves a
+// slot whose checksum fails, and load_checkpoint() falls back to the other.
+//
+// CheckpointWriter copies the film on the caller's thread between passes
+// (a plain copy, no I/O) and writes it on its own thread, so the render never
+// waits for the disk; a snapshot offered while the previous one is still
+// being written is skipped. Samples are seeded per pass and pixel (see
+// Progressive.h), so a resumed film continues bit for bit where the
+// checkpoint stopped.
+
+// Everything besides the film and the view that a resume must match.
+struct CheckpointSettings {
+    int width = 0;
+    int height = 0;
+    int max_depth = 0;
+    int samples = 0;           // passes the frame is rendered to
+    uint64_t scene_seed = 0;   // thread RNG seed the scene was generated with
+    uint64_t sample_seed = 0;  // ProgressiveRenderer::seed()
+};
+
+struct Checkpoint {
+    CheckpointSettings settings;
+    CameraParams view;
+    int passes = 0;
+    uint64_t sequence = 0;
+    std::vector<PixelAccumulator> film;
+};
+
+// Read-write mapping of a whole file.
+class MappedFile {
+public:
+    // Opens `path`, creating it and setting its size to `size` if size > 0;
+    // size 0 maps an existing file as it is. Throws std::runtime_error.
+    MappedFile(const std::string& path, size_t size);
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    unsigned char* data() { return bytes; }
+    const unsigned char* data() const { return bytes; }
+    size_t size() const { return length; }
+    // Writes the range through to the disk before returning.
+    void flush(size_t offset, size_t count);
+
+private:
+    unsigned char* bytes = nullptr;
+    size_t length = 0;
+#if defined(_WIN32)
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#else
+    int fd = -1;
+#endif
+};
+
+// Settings stored in a checkpoint file, without reading the film.
+CheckpointSettings read_checkpoint_settings(const std::string& path);
+// Latest intact checkpoint in `path`; `objects` must be the scene it was
+// rendered from. Throws std::runtime_error if there is none.
+Checkpoint load_checkpoint(const std::string& path, const HitableList& objects);
+
+class CheckpointWriter {
+public:
+    // Maps `path`, keeping the checkpoints of an existing file with the same
+    // settings and starting a new one otherwise. Throws std::runtime_error.
+    CheckpointWriter(const std::string& path, const CheckpointSettings& settings, const HitableList& objects);
+    ~CheckpointWriter();
+    CheckpointWriter(const CheckpointWriter&) = delete;
+    CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+
+    // Snapshots the renderer's film after a completed pass (call from the
+    // thread that drives its passes) and hands it to the writer thread.
+    // Returns false, without copying, while the previous write is pending or
+    // before the first full pass.
+    bool submit(const ProgressiveRenderer& renderer);
+    // Blocks until the pending write, if any, is on disk.
+    void wait();
+    // Checkpoints written so far, and the last write error (empty if none).
+    uint64_t written() const;
+    std::string error() const;
+
+private:
+    void run();
+
+    MappedFile file;
+    AovIds ids;
+    mutable std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    bool pending = false;
+    bool stopping = false;
+    uint64_t sequence = 0;
+    uint64_t completed = 0;
+    std::string last_error;
+    // Snapshot owned by the writer thread while `pending`.
+    CameraParams view;
+    int passes = 0;
+    std::vector<unsigned char> staging;
+    std::thread thread;
+};
+
+namespace checkpoint_detail {
+
+constexpr char kMagic[8] = {'R', 'T', 'C', 'K', 'P', 'T', '0', '1'};
+constexpr size_t kHeaderBytes = 256;
+constexpr size_t kSlotHeaderBytes = 256;
+
+// Fixed-width, little-endian on every supported host.
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t pixel_bytes;
+    int32_t width;
+    int32_t height;
+    int32_t max_depth;
+    int32_t samples;
+    uint64_t scene_seed;
+    uint64_t sample_seed;
+};
+
+struct SlotHeader {
+    uint64_t sequence;  // 0: never written
+    uint64_t checksum;  // over the pixel records
+    int32_t passes;
+    int32_t reserved;
+    double view[12];  // lookfrom, lookat, vup, vfov, aperture, focus_dist
+};
+
+struct PixelRecord {
+    double radiance[3];
+    double albedo[3];
+    double normal[3];
+    double depth;
+    double luminance;
+    double luminance_squares;
+    int32_t count;
+    int32_t hits;
+    int32_t object;  // primitive index, -1 for none
+    int32_t reserved;
+};
+
+static_assert(sizeof(FileHeader) <= kHeaderBytes, "checkpoint header overflows its block");
+static_assert(sizeof(SlotHeader) <= kSlotHeaderBytes, "slot header overflows its block");
+
+inline size_t slot_bytes(const CheckpointSettings& settings) {
+    return kSlotHeaderBytes + static_cast<size_t>(settings.width) * settings.height * sizeof(PixelRecord);
+}
+
+// FNV-1a over 64-bit words; the record stream is a multiple of 8 bytes.
+inline uint64_t checksum(const unsigned char* data, size_t count) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i + 8 <= count; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, data + i, 8);
+        hash = (hash ^ word) * 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+inline FileHeader make_header(const CheckpointSettings& settings) {
+    FileHeader header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = 1;
+    header.pixel_bytes = sizeof(PixelRecord);
+    header.width = settings.width;
+    header.height = settings.height;
+    header.max_depth = settings.max_depth;
+    header.samples = settings.samples;
+    header.scene_seed = settings.scene_seed;
+    header.sample_seed = settings.sample_seed;
+    return header;
+}
+
+inline CheckpointSettings parse_header(const MappedFile& file, const std::string& path) {
+    FileHeader header;
+    if (file.size() < kHeaderBytes) {
+        throw std::runtime_error("Not a checkpoint file: " + path);
+    }
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != 1 ||
+        header.pixel_bytes != sizeof(PixelRecord) || !environment_detail::host_is_little_endian()) {
+        throw std::runtime_error("Not a checkpoint file: " + path);
+    }
+    CheckpointSettings settings;
+    settings.width = header.width;
+    settings.height = header.height;
+    settings.max_depth = header.max_depth;
+    settings.samples = header.samples;
+    settings.scene_seed = header.scene_seed;
+    settings.sample_seed = header.sample_seed;
+    if (settings.width <= 0 || settings.height <= 0 ||
+        file.size() < kHeaderBytes + 2 * slot_bytes(settings)) {
+        throw std::runtime_error("Truncated checkpoint file: " + path);
+    }
+    return settings;
+}
+
+inline void write_view(double* out, const CameraParams& view) {
+    for (int i = 0; i < 3; ++i) {
+        out[i] = view.lookfrom[i];
+        out[3 + i] = view.lookat[i];
+        out[6 + i] = view.vup[i];
+    }
+    out[9] = view.vfov;
+    out[10] = view.aperture;
+    out[11] = view.focus_dist;
+}
+
+inline CameraParams read_view(const double* in) {
+    CameraParams view;
+    view.lookfrom = Point3(in[0], in[1], in[2]);
+    view.lookat = Point3(in[3], in[4], in[5]);
+    view.vup = Vec3(in[6], in[7], in[8]);
+    view.vfov = in[9];
+    view.aperture = in[10];
+    view.focus_dist = in[11];
+    return view;
+}
+
+// Reads the header of `slot`; true if it was written and its records match
+// its checksum.
+inline bool intact_slot(const MappedFile& file, const CheckpointSettings& settings, int slot, SlotHeader& header) {
+    const unsigned char* base = file.data() + kHeaderBytes + static_cast<size_t>(slot) * slot_bytes(settings);
+    std::memcpy(&header, base, sizeof(header));
+    if (header.sequence == 0 || header.sequence % 2 != static_cast<uint64_t>(slot) || header.passes < 1) {
+        return false;
+    }
+    return checksum(base + kSlotHeaderBytes, slot_bytes(settings) - kSlotHeaderBytes) == header.checksum;
+}
+
+}
+
+inline MappedFile::MappedFile(const std::string& path, size_t size) {
+#if defined(_WIN32)
+    file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr,
+                       size > 0 ? OPEN_ALWAYS : OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("Cannot open checkpoint file: " + path);
+    }
+    LARGE_INTEGER file_size;
+    if (size > 0) {
+        file_size.QuadPart = static_cast<LONGLONG>(size);
+        if (!SetFilePointerEx(file, file_size, nullptr, FILE_BEGIN) || !SetEndOfFile(file)) {
+            CloseHandle(file);
+            throw std::runtime_error("Cannot size checkpoint file: " + path);
+        }
+    } else if (!GetFileSizeEx(file, &file_size)) {
+        CloseHandle(file);
+        throw std::runtime_error("Cannot read checkpoint file: " + path);
+    }
+    length = static_cast<size_t>(file_size.QuadPart);
+    mapping = length > 0 ? CreateFileMappingA(file, nullptr, PAGE_READWRITE, 0, 0, nullptr) : nullptr;
+    bytes = mapping ? static_cast<unsigned char*>(MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0)) : nullptr;
+    if (!bytes) {
+        if (mapping) {
+            CloseHandle(mapping);
+        }
+        CloseHandle(file);
+        throw std::runtime_error("Cannot map checkpoint file: " + path);
+    }
+#else
+    fd = ::open(path.c_str(), size > 0 ? O_RDWR | O_CREAT : O_RDWR, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open checkpoint file: " + path);
+    }
+    struct stat info;
+    if ((size > 0 && ::ftruncate(fd, static_cast<off_t>(size)) != 0) || ::fstat(fd, &info) != 0) {
+        ::close(fd);
+        throw std::runtime_error("Cannot size checkpoint file: " + path);
+    }
+    length = static_cast<size_t>(info.st_size);
+    void* view = length > 0 ? ::mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+    if (view == MAP_FAILED) {
+        ::close(fd);
+        throw std::runtime_error("Cannot map checkpoint file: " + path);
+    }
+    bytes = static_cast<unsigned char*>(view);
+#endif
+}
+
+inline MappedFile::~MappedFile() {
+#if defined(_WIN32)
+    UnmapViewOfFile(bytes);
+    CloseHandle(mapping);
+    CloseHandle(file);
+#else
+    ::munmap(bytes, length);
+    ::close(fd);
+#endif
+}
+
+inline void MappedFile::flush(size_t offset, size_t count) {
+#if defined(_WIN32)
+    if (!FlushViewOfFile(bytes + offset, count) || !FlushFileBuffers(file)) {
+        throw std::runtime_error("Cannot flush checkpoint file.");
+    }
+#else
+    // msync() wants a page-aligned start.
+    const size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    const size_t start = offset / page * page;
+    if (::msync(bytes + start, count + (offset - start), MS_SYNC) != 0) {
+        throw std::runtime_error("Cannot flush checkpoint file.");
+    }
+#endif
+}
+
+inline CheckpointSettings read_checkpoint_settings(const std::string& path) {
+    const MappedFile file(path, 0);
+    return checkpoint_detail::parse_header(file, path);
+}
+
+inline Checkpoint load_checkpoint(const std::string& path, const HitableList& objects) {
+    using namespace checkpoint_detail;
+    const MappedFile file(path, 0);
+    Checkpoint checkpoint;
+    checkpoint.settings = parse_header(file, path);
+
+    SlotHeader best{};
+    int best_slot = -1;
+    for (int slot = 0; slot < 2; ++slot) {
+        SlotHeader header;
+        if (intact_slot(file, checkpoint.settings, slot, header) && header.sequence > best.sequence) {
+            best = header;
+            best_slot = slot;
+        }
+    }
+    if (best_slot < 0) {
+        throw std::runtime_error("No intact checkpoint in " + path);
+    }
+
+    checkpoint.view = read_view(best.view);
+    checkpoint.passes = best.passes;
+    checkpoint.sequence = best.sequence;
+    const size_t count = static_cast<size_t>(checkpoint.settings.width) * checkpoint.settings.height;
+    const unsigned char* records = file.data() + kHeaderBytes + best_slot * slot_bytes(checkpoint.settings) +
+                                   kSlotHeaderBytes;
+    checkpoint.film.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        PixelRecord record;
+        std::memcpy(&record, records + i * sizeof(PixelRecord), sizeof(record));
+        PixelAccumulator::Sums sums;
+        sums.radiance = Color(record.radiance[0], record.radiance[1], record.radiance[2]);
+        sums.albedo = Color(record.albedo[0], record.albedo[1], record.albedo[2]);
+        sums.normal = Vec3(record.normal[0], record.normal[1], record.normal[2]);
+        sums.depth = record.depth;
+        sums.luminance = record.luminance;
+        sums.luminance_squares = record.luminance_squares;
+        sums.count = record.count;
+        sums.hits = record.hits;
+        if (record.object >= 0 && static_cast<size_t>(record.object) < objects.objects.size()) {
+            sums.object = objects.objects[static_cast<size_t>(record.object)].get();
+        }
+        checkpoint.film[i] = PixelAccumulator(sums);
+    }
+    return checkpoint;
+}
+
+inline CheckpointWriter::CheckpointWriter(const std::string& path, const CheckpointSettings& settings,
+                                          const HitableList& objects)
+    : file(path, checkpoint_detail::kHeaderBytes + 2 * checkpoint_detail::slot_bytes(settings)), ids(objects) {
+    using namespace checkpoint_detail;
+    if (settings.width <= 0 || settings.height <= 0) {
+        throw std::runtime_error("CheckpointWriter requires a positive image size.");
+    }
+    const FileHeader header = make_header(settings);
+    if (std::memcmp(file.data(), &header, sizeof(header)) == 0) {
+        // Same render: continue after the newest slot, intact or not.
+        for (int slot = 0; slot < 2; ++slot) {
+            SlotHeader existing;
+            std::memcpy(&existing, file.data() + kHeaderBytes + slot * slot_bytes(settings), sizeof(existing));
+            sequence = std::max(sequence, existing.sequence);
+        }
+    } else {
+        std::memset(file.data(), 0, kHeaderBytes);
+        std::memcpy(file.data(), &header, sizeof(header));
+        for (int slot = 0; slot < 2; ++slot) {
+            std::memset(file.data() + kHeaderBytes + slot * slot_bytes(settings), 0, kSlotHeaderBytes);
+        }
+        file.flush(0, file.size());
+    }
+    staging.resize(slot_bytes(settings));
+    thread = std::thread([this]() { run(); });
+}
+
+inline CheckpointWriter::~CheckpointWriter() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    thread.join();
+}
+
+inline bool CheckpointWriter::submit(const ProgressiveRenderer& renderer) {
+    using namespace checkpoint_detail;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (pending || renderer.passes() < 1) {
+            return false;
+        }
+    }
+    const std::vector<PixelAccumulator>& film = renderer.film();
+    if (staging.size() != kSlotHeaderBytes + film.size() * sizeof(PixelRecord)) {
+        throw std::invalid_argument("CheckpointWriter: renderer size does not match the checkpoint.");
+    }
+    // The writer thread is idle, so the staging buffer is ours.
+    unsigned char* records = staging.data() + kSlotHeaderBytes;
+    for (size_t i = 0; i < film.size(); ++i) {
+        const PixelAccumulator::Sums sums = film[i].sums();
+        PixelRecord record{};
+        for (int c = 0; c < 3; ++c) {
+            record.radiance[c] = sums.radiance[c];
+            record.albedo[c] = sums.albedo[c];
+            record.normal[c] = sums.normal[c];
+        }
+        record.depth = sums.depth;
+        record.luminance = sums.luminance;
+        record.luminance_squares = sums.luminance_squares;
+        record.count = sums.count;
+        record.hits = sums.hits;
+        record.object = ids.primitive(sums.object);
+        std::memcpy(records + i * sizeof(PixelRecord), &record, sizeof(record));
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        view = renderer.film_view();
+        passes = renderer.passes();
+        pending = true;
+    }
+    wake.notify_all();
+    return true;
+}
+
+inline void CheckpointWriter::wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [this] { return !pending; });
+}
+
+inline uint64_t CheckpointWriter::written() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return completed;
+}
+
+inline std::string CheckpointWriter::error() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return last_error;
+}
+
+inline void CheckpointWriter::run() {
+    using namespace checkpoint_detail;
+    const size_t bytes = staging.size();
+    for (;;) {
+        uint64_t next = 0;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this] { return pending || stopping; });
+            if (!pending) {
+                return;
+            }
+            next = sequence + 1;
+        }
+
+        // Records first; the header that vouches for them goes last.
+        SlotHeader header{};
+        header.sequence = next;
+        header.passes = passes;
+        header.checksum = checksum(staging.data() + kSlotHeaderBytes, bytes - kSlotHeaderBytes);
+        write_view(header.view, view);
+        std::memcpy(staging.data(), &header, sizeof(header));
+        const size_t offset = kHeaderBytes + static_cast<size_t>(next % 2) * bytes;
+        std::string failure;
+        try {
+            std::memcpy(file.data() + offset + kSlotHeaderBytes, staging.data() + kSlotHeaderBytes,
+                        bytes - kSlotHeaderBytes);
+            file.flush(offset + kSlotHeaderBytes, bytes - kSlotHeaderBytes);
+            std::memcpy(file.data() + offset, staging.data(), sizeof(header));
+            file.flush(offset, sizeof(header));
+        } catch (const std::exception& error) {
+            failure = error.what();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (failure.empty()) {
+                sequence = next;
+                ++completed;
+            }
+            last_error = failure;
+            pending = false;
+        }
+        idle.notify_all();
+    }
+}
+
+#endif // RAYTRACER_CHECKPOINT_H
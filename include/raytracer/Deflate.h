@@ -0,0 +1,457 @@
+#ifndef RAYTRACER_DEFLATE_H
+#define RAYTRACER_DEFLATE_H
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+// zlib streams (RFC 1950 / 1951) without a dependency.
+//
+// The encoder is a small LZ77 with hash chains and the fixed Huffman code,
+// for the PNG and EXR writers of ImageExport.h; its output is somewhat
+// larger than zlib's dynamic codes produce. The decoder reads every block
+// type (stored, fixed and dynamic Huffman), so files from other tools load
+// too; it serves the EXR loader of Environment.h and decodes one bit of a
+// Huffman code at a time, which is plenty for reading a map once.
+
+namespace deflate_detail {
+
+constexpr uint32_t kAdlerBase = 65521;
+
+inline uint32_t adler32(uint32_t adler, const unsigned char* data, size_t count) {
+    uint32_t a = adler & 0xffff;
+    uint32_t b = adler >> 16;
+    while (count > 0) {
+        // The largest run before b can overflow 32 bits.
+        size_t run = std::min<size_t>(count, 5552);
+        count -= run;
+        while (run-- > 0) {
+            a += *data++;
+            b += a;
+        }
+        a %= kAdlerBase;
+        b %= kAdlerBase;
+    }
+    return (b << 16) | a;
+}
+
+// Adler-32 of two buffers back to back, from their checksums and the length
+// of the second (as zlib's adler32_combine).
+inline uint32_t adler32_combine(uint32_t first, uint32_t second, size_t second_length) {
+    const uint32_t rem = static_cast<uint32_t>(second_length % kAdlerBase);
+    uint32_t sum1 = first & 0xffff;
+    uint32_t sum2 = static_cast<uint32_t>((static_cast<uint64_t>(rem) * sum1) % kAdlerBase);
+    sum1 += (second & 0xffff) + kAdlerBase - 1;
+    sum2 += (first >> 16) + (second >> 16) + kAdlerBase - rem;
+    if (sum1 >= kAdlerBase) {
+        sum1 -= kAdlerBase;
+    }
+    if (sum1 >= kAdlerBase) {
+        sum1 -= kAdlerBase;
+    }
+    if (sum2 >= 2 * kAdlerBase) {
+        sum2 -= 2 * kAdlerBase;
+    }
+    if (sum2 >= kAdlerBase) {
+        sum2 -= kAdlerBase;
+    }
+    return sum1 | (sum2 << 16);
+}
+
+// Deflate packs bits from the least significant end.
+class BitWriter {
+public:
+    explicit BitWriter(std::vector<unsigned char>& out) : out(out) {}
+
+    void bits(uint32_t value, int count) {
+        buffer |= static_cast<uint64_t>(value) << filled;
+        filled += count;
+        while (filled >= 8) {
+            out.push_back(static_cast<unsigned char>(buffer));
+            buffer >>= 8;
+            filled -= 8;
+        }
+    }
+
+    // Huffman codes go most significant bit first.
+    void code(uint32_t value, int length) {
+        uint32_t reversed = 0;
+        for (int i = 0; i < length; ++i, value >>= 1) {
+            reversed = (reversed << 1) | (value & 1);
+        }
+        bits(reversed, length);
+    }
+
+    void align() {
+        if (filled > 0) {
+            out.push_back(static_cast<unsigned char>(buffer));
+            buffer = 0;
+            filled = 0;
+        }
+    }
+
+private:
+    std::vector<unsigned char>& out;
+    uint64_t buffer = 0;
+    int filled = 0;
+};
+
+constexpr uint16_t kLengthBase[29] = {3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+                                      31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+constexpr uint8_t kLengthExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                      2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+constexpr uint16_t kDistanceBase[30] = {1,   2,   3,   4,   5,   7,    9,    13,   17,   25,   33,   49,   65,    97,    129,
+                                        193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+constexpr uint8_t kDistanceExtra[30] = {0, 0, 0, 0, 1, 1, 2, 2,  3,  3,  4,  4,  5,  5,  6,
+                                        6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+// Fixed literal/length code (RFC 1951, 3.2.6).
+inline void write_symbol(BitWriter& out, int symbol) {
+    if (symbol < 144) {
+        out.code(0x30 + symbol, 8);
+    } else if (symbol < 256) {
+        out.code(0x190 + symbol - 144, 9);
+    } else if (symbol < 280) {
+        out.code(symbol - 256, 7);
+    } else {
+        out.code(0xc0 + symbol - 280, 8);
+    }
+}
+
+inline void write_match(BitWriter& out, int length, int distance) {
+    int l = 28;
+    while (kLengthBase[l] > length) {
+        --l;
+    }
+    write_symbol(out, 257 + l);
+    out.bits(length - kLengthBase[l], kLengthExtra[l]);
+    int d = 29;
+    while (kDistanceBase[d] > distance) {
+        --d;
+    }
+    out.code(d, 5);
+    out.bits(distance - kDistanceBase[d], kDistanceExtra[d]);
+}
+
+// Appends `data` to a raw deflate stream as one fixed-Huffman block; matches
+// stay inside `data`. A final chunk ends the stream, any other ends in a
+// sync flush (an empty stored block) so the next chunk starts on a byte.
+inline void deflate_chunk(const unsigned char* data, size_t count, bool final, std::vector<unsigned char>& out) {
+    constexpr int kHashBits = 15;
+    constexpr size_t kWindow = 32768;
+    constexpr int kMaxChain = 16;
+    constexpr size_t kMinMatch = 3;
+    constexpr size_t kMaxMatch = 258;
+
+    BitWriter writer(out);
+    writer.bits(final ? 1 : 0, 1);
+    writer.bits(1, 2);  // fixed Huffman codes
+
+    std::vector<int64_t> head(size_t{1} << kHashBits, -1);
+    std::vector<int64_t> previous(kWindow, -1);
+    const auto hash = [&](size_t i) {
+        const uint32_t key = (uint32_t{data[i]} << 16) | (uint32_t{data[i + 1]} << 8) | data[i + 2];
+        return (key * 2654435761u) >> (32 - kHashBits);
+    };
+    const auto insert = [&](size_t i) {
+        if (i + kMinMatch <= count) {
+            const uint32_t h = hash(i);
+            previous[i % kWindow] = head[h];
+            head[h] = static_cast<int64_t>(i);
+        }
+    };
+
+    size_t i = 0;
+    while (i < count) {
+        size_t best_length = 0;
+        size_t best_distance = 0;
+        if (i + kMinMatch <= count) {
+            const size_t limit = std::min(kMaxMatch, count - i);
+            int64_t candidate = head[hash(i)];
+            for (int chain = 0; candidate >= 0 && chain < kMaxChain; ++chain) {
+                const size_t distance = i - static_cast<size_t>(candidate);
+                if (distance > kWindow) {
+                    break;
+                }
+                const unsigned char* match = data + candidate;
+                if (match[best_length] == data[i + best_length]) {
+                    size_t length = 0;
+                    while (length < limit && match[length] == data[i + length]) {
+                        ++length;
+                    }
+                    if (length > best_length) {
+                        best_length = length;
+                        best_distance = distance;
+                        if (length == limit) {
+                            break;
+                        }
+                    }
+                }
+                // A slot reused by a newer position ends the chain.
+                const int64_t next = previous[static_cast<size_t>(candidate) % kWindow];
+                if (next >= candidate) {
+                    break;
+                }
+                candidate = next;
+            }
+        }
+        if (best_length >= kMinMatch) {
+            write_match(writer, static_cast<int>(best_length), static_cast<int>(best_distance));
+            for (size_t k = 0; k < best_length; ++k) {
+                insert(i + k);
+            }
+            i += best_length;
+        } else {
+            write_symbol(writer, data[i]);
+            insert(i);
+            ++i;
+        }
+    }
+    write_symbol(writer, 256);
+    if (final) {
+        writer.align();
+    } else {
+        writer.bits(0, 3);
+        writer.align();
+        const unsigned char sync[4] = {0x00, 0x00, 0xff, 0xff};
+        out.insert(out.end(), sync, sync + 4);
+    }
+}
+
+// A complete zlib stream (RFC 1950) holding `data`.
+inline std::vector<unsigned char> zlib_compress(const unsigned char* data, size_t count) {
+    std::vector<unsigned char> out = {0x78, 0x01};
+    deflate_chunk(data, count, true, out);
+    const uint32_t adler = adler32(1, data, count);
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        out.push_back(static_cast<unsigned char>(adler >> shift));
+    }
+    return out;
+}
+
+// Deflate reads bits from the least significant end.
+class BitReader {
+public:
+    BitReader(const unsigned char* data, size_t count) : data(data), count(count) {}
+
+    uint32_t bits(int wanted) {
+        while (filled < wanted) {
+            if (pos == count) {
+                throw std::runtime_error("Truncated deflate stream");
+            }
+            buffer |= static_cast<uint64_t>(data[pos++]) << filled;
+            filled += 8;
+        }
+        const uint32_t value = static_cast<uint32_t>(buffer & ((uint64_t{1} << wanted) - 1));
+        buffer >>= wanted;
+        filled -= wanted;
+        return value;
+    }
+
+    // Stored blocks start on a byte.
+    void align() {
+        buffer >>= filled % 8;
+        filled -= filled % 8;
+    }
+
+    uint8_t byte() { return static_cast<uint8_t>(bits(8)); }
+
+private:
+    const unsigned char* data;
+    size_t count;
+    size_t pos = 0;
+    uint64_t buffer = 0;
+    int filled = 0;
+};
+
+// Canonical Huffman code from code lengths: how many codes each length has
+// and the symbols in code order.
+class HuffmanDecoder {
+public:
+    HuffmanDecoder(const uint8_t* lengths, int symbols) : symbol(static_cast<size_t>(symbols)) {
+        for (int s = 0; s < symbols; ++s) {
+            ++count[lengths[s]];
+        }
+        count[0] = 0;
+        std::array<uint16_t, 16> offset{};
+        int left = 1;
+        for (int length = 1; length < 16; ++length) {
+            left = 2 * left - count[length];
+            if (left < 0) {
+                throw std::runtime_error("Oversubscribed Huffman code in deflate stream");
+            }
+            offset[length] = static_cast<uint16_t>(offset[length - 1] + count[length - 1]);
+        }
+        for (int s = 0; s < symbols; ++s) {
+            if (lengths[s] != 0) {
+                symbol[offset[lengths[s]]++] = static_cast<uint16_t>(s);
+            }
+        }
+    }
+
+    // Codes are stored most significant bit first.
+    int decode(BitReader& in) const {
+        int code = 0;
+        int first = 0;
+        int index = 0;
+        for (int length = 1; length < 16; ++length) {
+            code |= static_cast<int>(in.bits(1));
+            if (code - first < count[length]) {
+                return symbol[static_cast<size_t>(index + code - first)];
+            }
+            index += count[length];
+            first = (first + count[length]) << 1;
+            code <<= 1;
+        }
+        throw std::runtime_error("Invalid Huffman code in deflate stream");
+    }
+
+private:
+    std::array<uint16_t, 16> count{};
+    std::vector<uint16_t> symbol;
+};
+
+inline void inflate_block(BitReader& in, const HuffmanDecoder& literals, const HuffmanDecoder& distances,
+                          size_t max_size, std::vector<unsigned char>& out) {
+    for (;;) {
+        const int symbol = literals.decode(in);
+        if (symbol < 256) {
+            if (out.size() == max_size) {
+                throw std::runtime_error("Deflate stream longer than expected");
+            }
+            out.push_back(static_cast<unsigned char>(symbol));
+            continue;
+        }
+        if (symbol == 256) {
+            return;
+        }
+        if (symbol > 285) {
+            throw std::runtime_error("Invalid length code in deflate stream");
+        }
+        const size_t length = kLengthBase[symbol - 257] + in.bits(kLengthExtra[symbol - 257]);
+        const int d = distances.decode(in);
+        if (d > 29) {
+            throw std::runtime_error("Invalid distance code in deflate stream");
+        }
+        const size_t distance = kDistanceBase[d] + in.bits(kDistanceExtra[d]);
+        if (distance > out.size()) {
+            throw std::runtime_error("Deflate match reaches before the stream start");
+        }
+        if (length > max_size - out.size()) {
+            throw std::runtime_error("Deflate stream longer than expected");
+        }
+        for (size_t i = 0; i < length; ++i) {
+            out.push_back(out[out.size() - distance]);
+        }
+    }
+}
+
+// Decodes a raw deflate stream of at most `max_size` bytes.
+inline std::vector<unsigned char> inflate(const unsigned char* data, size_t count, size_t max_size) {
+    static const std::array<HuffmanDecoder, 2> fixed = [] {
+        uint8_t lengths[288];
+        std::fill(lengths, lengths + 144, uint8_t{8});
+        std::fill(lengths + 144, lengths + 256, uint8_t{9});
+        std::fill(lengths + 256, lengths + 280, uint8_t{7});
+        std::fill(lengths + 280, lengths + 288, uint8_t{8});
+        uint8_t distance_lengths[30];
+        std::fill(distance_lengths, distance_lengths + 30, uint8_t{5});
+        return std::array<HuffmanDecoder, 2>{HuffmanDecoder(lengths, 288), HuffmanDecoder(distance_lengths, 30)};
+    }();
+    static constexpr uint8_t kCodeLengthOrder[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+    BitReader in(data, count);
+    std::vector<unsigned char> out;
+    bool final = false;
+    while (!final) {
+        final = in.bits(1) != 0;
+        const uint32_t type = in.bits(2);
+        if (type == 0) {
+            in.align();
+            const uint32_t length = in.byte() | (uint32_t{in.byte()} << 8);
+            const uint32_t check = in.byte() | (uint32_t{in.byte()} << 8);
+            if ((length ^ 0xffff) != check) {
+                throw std::runtime_error("Corrupt stored block in deflate stream");
+            }
+            if (length > max_size - out.size()) {
+                throw std::runtime_error("Deflate stream longer than expected");
+            }
+            for (uint32_t i = 0; i < length; ++i) {
+                out.push_back(in.byte());
+            }
+        } else if (type == 1) {
+            inflate_block(in, fixed[0], fixed[1], max_size, out);
+        } else if (type == 2) {
+            const int literal_count = static_cast<int>(in.bits(5)) + 257;
+            const int distance_count = static_cast<int>(in.bits(5)) + 1;
+            const int code_length_count = static_cast<int>(in.bits(4)) + 4;
+            if (literal_count > 286 || distance_count > 30) {
+                throw std::runtime_error("Invalid dynamic Huffman header in deflate stream");
+            }
+            uint8_t code_lengths[19] = {};
+            for (int i = 0; i < code_length_count; ++i) {
+                code_lengths[kCodeLengthOrder[i]] = static_cast<uint8_t>(in.bits(3));
+            }
+            const HuffmanDecoder code_length_code(code_lengths, 19);
+
+            uint8_t lengths[286 + 30] = {};
+            const int total = literal_count + distance_count;
+            for (int i = 0; i < total;) {
+                const int symbol = code_length_code.decode(in);
+                if (symbol < 16) {
+                    lengths[i++] = static_cast<uint8_t>(symbol);
+                    continue;
+                }
+                uint8_t repeated = 0;
+                int times = 0;
+                if (symbol == 16) {
+                    if (i == 0) {
+                        throw std::runtime_error("Deflate code lengths repeat before the first");
+                    }
+                    repeated = lengths[i - 1];
+                    times = 3 + static_cast<int>(in.bits(2));
+                } else if (symbol == 17) {
+                    times = 3 + static_cast<int>(in.bits(3));
+                } else {
+                    times = 11 + static_cast<int>(in.bits(7));
+                }
+                if (i + times > total) {
+                    throw std::runtime_error("Deflate code lengths overrun their count");
+                }
+                std::fill(lengths + i, lengths + i + times, repeated);
+                i += times;
+            }
+            if (lengths[256] == 0) {
+                throw std::runtime_error("Dynamic Huffman block without an end code");
+            }
+            inflate_block(in, HuffmanDecoder(lengths, literal_count),
+                          HuffmanDecoder(lengths + literal_count, distance_count), max_size, out);
+        } else {
+            throw std::runtime_error("Invalid block type in deflate stream");
+        }
+    }
+    return out;
+}
+
+// Decodes a zlib stream of at most `max_size` bytes and checks its header and
+// Adler-32.
+inline std::vector<unsigned char> zlib_decompress(const unsigned char* data, size_t count, size_t max_size) {
+    if (count < 6 || (data[0] & 0x0f) != 8 || (data[0] * 256 + data[1]) % 31 != 0 || (data[1] & 0x20) != 0) {
+        throw std::runtime_error("Not a zlib stream");
+    }
+    std::vector<unsigned char> out = inflate(data + 2, count - 6, max_size);
+    const unsigned char* trailer = data + count - 4;
+    const uint32_t adler = (uint32_t{trailer[0]} << 24) | (uint32_t{trailer[1]} << 16) | (uint32_t{trailer[2]} << 8) |
+                           trailer[3];
+    if (adler32(1, out.data(), out.size()) != adler) {
+        throw std::runtime_error("zlib stream fails its Adler-32 check");
+    }
+    return out;
+}
+
+}
+
+#endif
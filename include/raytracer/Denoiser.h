@@ -0,0 +1,303 @@
+#ifndef RAYTRACER_DENOISER_H
+#define RAYTRACER_DENOISER_H
+
+#include "raytracer/Integrator.h"
+#include "raytracer/ThreadPool.h"
+
+// Edge-avoiding à-trous wavelet denoiser (Dammertz et al. 2010) with the
+// variance-driven luminance weight of SVGF (Schied et al. 2017).
+//
+// The path tracer's first hits supply albedo, normal and depth per pixel
+// (HitFeatures). Radiance is divided by the albedo so that texture detail is
+// not blurred away, filtered by `iterations` passes of a 5x5 B3-spline kernel
+// whose taps are spread 2^i pixels apart, and multiplied back. Each tap is
+// weighted by how well its normal, depth and luminance agree with the centre
+// pixel. The luminance tolerance follows the standard deviation of the
+// pixel's mean, estimated from its samples and filtered alongside the image,
+// so clean regions keep their detail while noisy ones are smoothed hard.
+// Every pass runs over rows on the ThreadPool.
+
+// Per-pixel guides, row-major.
+struct DenoiseFeatures {
+    DenoiseFeatures() {}
+    DenoiseFeatures(int image_width, int image_height);
+
+    size_t size() const { return static_cast<size_t>(width) * static_cast<size_t>(height); }
+
+    int width = 0;
+    int height = 0;
+    std::vector<Color> albedo;
+    std::vector<Vec3> normal;      // zero where every sample escaped
+    std::vector<float> depth;      // infinity where every sample escaped
+    std::vector<float> variance;   // variance of the pixel's mean luminance
+};
+
+// Sums over the samples of one pixel.
+class PixelAccumulator {
+public:
+    // Raw state, for checkpoints.
+    struct Sums {
+        Color radiance = Color(0, 0, 0);
+        Color albedo = Color(0, 0, 0);
+        Vec3 normal = Vec3(0, 0, 0);
+        double depth = 0.0;
+        double luminance = 0.0;
+        double luminance_squares = 0.0;
+        int count = 0;
+        int hits = 0;
+        const Hitable* object = nullptr;
+    };
+
+    PixelAccumulator() {}
+    explicit PixelAccumulator(const Sums& sums);
+
+    void add(const Color& radiance, const HitFeatures& hit);
+    Sums sums() const;
+
+    int samples() const { return count; }
+    Color mean() const { return count > 0 ? radiance_sum / count : Color(0, 0, 0); }
+    Color albedo() const { return count > 0 ? albedo_sum / count : Color(1, 1, 1); }
+    // Unit average of the hit normals; zero when every sample escaped.
+    Vec3 normal() const;
+    // Average over the samples that hit; infinity when none did.
+    double depth() const { return hits > 0 ? depth_sum / hits : infinity; }
+    // Variance of the mean luminance, from the sample variance.
+    double variance() const;
+    // Primitive hit by the first sample that hit anything.
+    const Hitable* object() const { return first_object; }
+    // Writes the pixel's averaged features at `index`.
+    void resolve(DenoiseFeatures& features, size_t index) const;
+
+private:
+    Color radiance_sum = Color(0, 0, 0);
+    Color albedo_sum = Color(0, 0, 0);
+    Vec3 normal_sum = Vec3(0, 0, 0);
+    double depth_sum = 0.0;
+    double luminance_sum = 0.0;
+    double luminance_squares = 0.0;
+    int count = 0;
+    int hits = 0;
+    const Hitable* first_object = nullptr;
+};
+
+struct DenoiseSettings {
+    int iterations = 5;
+    // Luminance differences are tolerated up to about this many standard
+    // deviations of the pixel's noise.
+    double sigma_luminance = 2.0;
+    // Exponent on the cosine between normals.
+    double sigma_normal = 128.0;
+    // Tolerated relative depth change per pixel of tap distance.
+    double sigma_depth = 0.01;
+};
+
+// Filtered copy of `color` (row-major, features.width x features.height).
+std::vector<Color> denoise(const std::vector<Color>& color, const DenoiseFeatures& features,
+                           const DenoiseSettings& settings = DenoiseSettings());
+
+inline DenoiseFeatures::DenoiseFeatures(int image_width, int image_height)
+    : width(image_width), height(image_height) {
+    if (width <= 0 || height <= 0) {
+        throw std::invalid_argument("DenoiseFeatures requires a positive size.");
+    }
+    albedo.assign(size(), Color(1, 1, 1));
+    normal.assign(size(), Vec3(0, 0, 0));
+    depth.assign(size(), std::numeric_limits<float>::infinity());
+    variance.assign(size(), 0.0f);
+}
+
+inline PixelAccumulator::PixelAccumulator(const Sums& sums)
+    : radiance_sum(sums.radiance), albedo_sum(sums.albedo), normal_sum(sums.normal), depth_sum(sums.depth),
+      luminance_sum(sums.luminance), luminance_squares(sums.luminance_squares), count(sums.count), hits(sums.hits),
+      first_object(sums.object) {}
+
+inline PixelAccumulator::Sums PixelAccumulator::sums() const {
+    Sums sums;
+    sums.radiance = radiance_sum;
+    sums.albedo = albedo_sum;
+    sums.normal = normal_sum;
+    sums.depth = depth_sum;
+    sums.luminance = luminance_sum;
+    sums.luminance_squares = luminance_squares;
+    sums.count = count;
+    sums.hits = hits;
+    sums.object = first_object;
+    return sums;
+}
+
+inline void PixelAccumulator::add(const Color& radiance, const HitFeatures& hit) {
+    radiance_sum += radiance;
+    albedo_sum += hit.albedo;
+    const double value = luminance(radiance);
+    luminance_sum += value;
+    luminance_squares += value * value;
+    ++count;
+    if (hit.depth < infinity) {
+        normal_sum += hit.normal;
+        depth_sum += hit.depth;
+        if (hits == 0) {
+            first_object = hit.object;
+        }
+        ++hits;
+    }
+}
+
+inline Vec3 PixelAccumulator::normal() const {
+    const double length = normal_sum.length();
+    return length > 0.0 ? normal_sum / length : Vec3(0, 0, 0);
+}
+
+inline double PixelAccumulator::variance() const {
+    if (count < 2) {
+        return 0.0;
+    }
+    const double mean = luminance_sum / count;
+    const double sample_variance = (luminance_squares - count * mean * mean) / (count - 1);
+    return std::fmax(0.0, sample_variance) / count;
+}
+
+inline void PixelAccumulator::resolve(DenoiseFeatures& features, size_t index) const {
+    if (count == 0) {
+        return;
+    }
+    features.albedo[index] = albedo();
+    features.normal[index] = normal();
+    features.depth[index] = static_cast<float>(depth());
+    features.variance[index] = static_cast<float>(variance());
+}
+
+namespace denoise_detail {
+
+// Albedo below this is treated as black when demodulating.
+constexpr double kMinAlbedo = 1e-3;
+
+inline double demodulate(double value, double albedo) {
+    return albedo > kMinAlbedo ? value / albedo : value;
+}
+
+inline double remodulate(double value, double albedo) {
+    return albedo > kMinAlbedo ? value * albedo : value;
+}
+
+// One à-trous pass with taps `step` pixels apart.
+inline void atrous_pass(const std::vector<Color>& in, const std::vector<float>& in_variance,
+                        std::vector<Color>& out, std::vector<float>& out_variance, const DenoiseFeatures& features,
+                        const DenoiseSettings& settings, int step) {
+    static constexpr double kernel[3] = {3.0 / 8.0, 1.0 / 4.0, 1.0 / 16.0};
+    const int width = features.width;
+    const int height = features.height;
+    parallel_for(static_cast<size_t>(height), 4, [&](size_t row_begin, size_t row_end) {
+        for (int y = static_cast<int>(row_begin); y < static_cast<int>(row_end); ++y) {
+            for (int x = 0; x < width; ++x) {
+                const size_t p = static_cast<size_t>(y) * width + x;
+                const Vec3& normal_p = features.normal[p];
+                const double depth_p = features.depth[p];
+                const bool hit_p = depth_p < infinity;
+                const double luminance_p = luminance(in[p]);
+
+                // SVGF blurs the variance over 3x3 before using it as a tolerance.
+                double blurred_variance = 0.0;
+                double blur_weight = 0.0;
+                for (int dy = -1; dy <= 1; ++dy) {
+                    for (int dx = -1; dx <= 1; ++dx) {
+                        const int qx = x + dx;
+                        const int qy = y + dy;
+                        if (qx < 0 || qx >= width || qy < 0 || qy >= height) {
+                            continue;
+                        }
+                        const double w = (dx == 0 ? 0.5 : 0.25) * (dy == 0 ? 0.5 : 0.25);
+                        blurred_variance += w * in_variance[static_cast<size_t>(qy) * width + qx];
+                        blur_weight += w;
+                    }
+                }
+                const double luminance_scale =
+                    1.0 / (settings.sigma_luminance * std::sqrt(blurred_variance / blur_weight) + 1e-10);
+                const double depth_scale = hit_p ? 1.0 / (settings.sigma_depth * step * depth_p + 1e-10) : 0.0;
+
+                Color sum(0, 0, 0);
+                double variance_sum = 0.0;
+                double weight_sum = 0.0;
+                for (int dy = -2; dy <= 2; ++dy) {
+                    const int qy = y + dy * step;
+                    if (qy < 0 || qy >= height) {
+                        continue;
+                    }
+                    for (int dx = -2; dx <= 2; ++dx) {
+                        const int qx = x + dx * step;
+                        if (qx < 0 || qx >= width) {
+                            continue;
+                        }
+                        const size_t q = static_cast<size_t>(qy) * width + qx;
+                        const double h = kernel[dx < 0 ? -dx : dx] * kernel[dy < 0 ? -dy : dy];
+                        double w = h;
+                        if (q != p) {
+                            const double depth_q = features.depth[q];
+                            if (hit_p != (depth_q < infinity)) {
+                                continue;
+                            }
+                            double exponent = -std::fabs(luminance(in[q]) - luminance_p) * luminance_scale;
+                            if (hit_p) {
+                                const double cosine = dot(normal_p, features.normal[q]);
+                                if (cosine <= 0.0) {
+                                    continue;
+                                }
+                                const double distance = std::sqrt(static_cast<double>(dx * dx + dy * dy));
+                                exponent -= std::fabs(depth_p - depth_q) * depth_scale / distance;
+                                exponent += settings.sigma_normal * std::log(cosine);
+                            }
+                            w *= std::exp(exponent);
+                        }
+                        sum += w * in[q];
+                        variance_sum += w * w * in_variance[q];
+                        weight_sum += w;
+                    }
+                }
+                out[p] = sum / weight_sum;
+                out_variance[p] = static_cast<float>(variance_sum / (weight_sum * weight_sum));
+            }
+        }
+    });
+}
+
+}
+
+inline std::vector<Color> denoise(const std::vector<Color>& color, const DenoiseFeatures& features,
+                                  const DenoiseSettings& settings) {
+    const size_t count = features.size();
+    if (color.size() != count || features.albedo.size() != count || features.normal.size() != count ||
+        features.depth.size() != count || features.variance.size() != count) {
+        throw std::invalid_argument("denoise() requires color and feature buffers of the image size.");
+    }
+    if (settings.iterations < 0) {
+        throw std::invalid_argument("DenoiseSettings::iterations must not be negative.");
+    }
+
+    std::vector<Color> current(count);
+    std::vector<float> variance(count);
+    for (size_t i = 0; i < count; ++i) {
+        const Color& a = features.albedo[i];
+        current[i] = Color(denoise_detail::demodulate(color[i].x(), a.x()),
+                           denoise_detail::demodulate(color[i].y(), a.y()),
+                           denoise_detail::demodulate(color[i].z(), a.z()));
+        const double albedo_luminance = std::fmax(denoise_detail::kMinAlbedo, luminance(a));
+        variance[i] = static_cast<float>(features.variance[i] / (albedo_luminance * albedo_luminance));
+    }
+
+    std::vector<Color> next(count);
+    std::vector<float> next_variance(count);
+    for (int i = 0; i < settings.iterations; ++i) {
+        denoise_detail::atrous_pass(current, variance, next, next_variance, features, settings, 1 << i);
+        current.swap(next);
+        variance.swap(next_variance);
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        const Color& a = features.albedo[i];
+        current[i] = Color(denoise_detail::remodulate(current[i].x(), a.x()),
+                           denoise_detail::remodulate(current[i].y(), a.y()),
+                           denoise_detail::remodulate(current[i].z(), a.z()));
+    }
+    return current;
+}
+
+#endif // RAYTRACER_DENOISER_H
@@ -0,0 +1,1050 @@
+#ifndef RAYTRACER_DISTRIBUTED_H
+#define RAYTRACER_DISTRIBUTED_H
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include "raytracer/LightBVH.h"
+#include "raytracer/TiledImage.h"
+
+// Tile rendering spread over processes.
+//
+// A RenderCoordinator listens on a stream socket and owns the frame; any
+// number of workers (run_render_worker(), usually in other processes or on
+// other machines) connect to it, build the scene the job names from the
+// job's scene seed and trace the tiles they are handed with render_tile(),
+// so the frame is the one render_tiled() would make no matter who traced
+// which tile.
+//
+// Scheduling is pull based: each worker holds a few tiles at a time (its
+// thread count plus one by default) and gets the next as each result comes
+// back, so faster workers take more of the frame. A worker that disconnects
+// or goes silent past the timeout is dropped and its tiles go back to the
+// front of the queue. Once the queue is empty, idle workers are also given
+// tiles another worker still holds; the first result wins, so one slow
+// worker does not hold up the end of the frame.
+//
+// Results travel as float planes split into byte planes, delta coded and
+// run-length packed: the sign and exponent bytes, AOV planes and padding
+// shrink to little, noisy low mantissa bytes pass through.
+//
+// Addresses are "unix:<path>" or "<host>:<port>" (TCP; port 0 lets the
+// coordinator pick one, see address()). Messages are a little-endian type
+// and length followed by the payload; see distributed_detail. POSIX only:
+// elsewhere the classes throw std::runtime_error.
+
+// Everything a worker needs to trace tiles of the frame besides the scene
+// geometry, which it builds itself from `scene` and `scene_seed`.
+struct DistributedJob {
+    // Width, height, tile size, samples, AOVs and sample seed of the frame;
+    // the memory budget does not apply.
+    TiledRenderSettings tiles;
+    CameraParams view;
+    int max_depth = 10;  // the other path tracer settings keep their defaults
+    std::string scene;   // handed to the workers' scene loader
+    uint64_t scene_seed = 0;  // thread RNG seed before the scene is built
+    // HDR environment map (.pfm, .hdr or .exr) each worker loads in place of the
+    // sky; empty: the sky. The path must be readable where the workers run.
+    std::string environment;
+    LightSelection light_selection = LightSelection::Uniform;
+};
+
+struct CoordinatorOptions {
+    // Tiles a worker holds at once; 0: its thread count plus one.
+    int tiles_per_worker = 0;
+    // A worker holding tiles that sends nothing for this long is dropped;
+    // keep it above the time one tile takes.
+    double worker_timeout_seconds = 60.0;
+    // render() throws if no worker is connected for this long while tiles
+    // remain.
+    double connect_timeout_seconds = 30.0;
+    // Hand tiles still held by another worker to idle workers once the
+    // queue is empty.
+    bool duplicate_stragglers = true;
+};
+
+struct DistributedStats {
+    size_t tiles = 0;             // tiles received
+    int workers = 0;              // workers that joined
+    int workers_lost = 0;         // dropped before the frame was done
+    size_t reassigned_tiles = 0;  // tiles requeued from dropped workers
+    size_t duplicated_tiles = 0;  // tiles handed out a second time at the end
+    size_t raw_bytes = 0;         // float data of the tiles received
+    size_t wire_bytes = 0;        // the same tiles as sent over the sockets
+    std::vector<size_t> tiles_per_worker;  // in the order workers joined
+    std::string last_worker_error;         // the last error a worker reported
+};
+
+struct WorkerOptions {
+    int threads = 0;  // 0: std::thread::hardware_concurrency()
+    // Connection attempts are retried until this passes.
+    double connect_timeout_seconds = 10.0;
+};
+
+// Builds the scene named by a job; called once per worker, after the
+// thread RNG has been seeded with the job's scene seed.
+using SceneLoader = std::function<HitableList(const std::string&)>;
+
+class RenderCoordinator {
+public:
+    // Starts listening on `address`. Throws std::invalid_argument for a
+    // malformed address and std::runtime_error if it cannot be bound.
+    explicit RenderCoordinator(const std::string& address);
+    ~RenderCoordinator();
+    RenderCoordinator(const RenderCoordinator&) = delete;
+    RenderCoordinator& operator=(const RenderCoordinator&) = delete;
+
+    // The address workers connect to, with the port actually bound.
+    const std::string& address() const { return bound_address; }
+
+    // Hands the tiles of `job` to the workers that connect until every tile
+    // has come back, calling on_tile(x0, y0, x1, y1, planes) on this thread
+    // for each (planes as in render_tiled()), then tells the workers to
+    // stop. Setting `cancel` stops handing out tiles and returns. Throws
+    // std::invalid_argument for an invalid job and std::runtime_error when
+    // no worker is connected for the connect timeout.
+    DistributedStats render(const DistributedJob& job,
+                            const std::function<void(int, int, int, int, const float*)>& on_tile,
+                            const CoordinatorOptions& options = CoordinatorOptions(),
+                            const std::atomic<bool>* cancel = nullptr);
+
+private:
+    int listen_fd = -1;
+    std::string bound_address;
+    std::string unix_path;  // removed on destruction
+};
+
+// Connects to the coordinator at `address` and traces the tiles it hands
+// out until it says the frame is done or goes away; returns the tiles
+// traced. Throws std::runtime_error if it cannot connect or the scene
+// fails to load (the coordinator is told), and on protocol errors.
+size_t run_render_worker(const std::string& address, const SceneLoader& load_scene,
+                         const WorkerOptions& options = WorkerOptions());
+
+namespace distributed_detail {
+
+enum MessageType : uint32_t {
+    kHello = 1,   // worker: magic, version, threads
+    kJob = 2,     // coordinator: DistributedJob
+    kTile = 3,    // coordinator: tile index
+    kResult = 4,  // worker: tile index, float count, packed floats
+    kDone = 5,    // coordinator: no more tiles
+    kError = 6,   // worker: message, then it disconnects
+};
+
+constexpr uint32_t kMagic = 0x57445452;  // "RTDW"
+constexpr uint32_t kVersion = 3;
+constexpr uint32_t kHeaderBytes = 8;
+constexpr uint32_t kMaxPayload = 1u << 30;
+
+struct Message {
+    uint32_t type = 0;
+    std::vector<unsigned char> payload;
+};
+
+// Appends little-endian fields.
+class Writer {
+public:
+    void u32(uint32_t value) {
+        for (int i = 0; i < 4; ++i) {
+            bytes.push_back(static_cast<unsigned char>(value >> (8 * i)));
+        }
+    }
+    void u64(uint64_t value) {
+        u32(static_cast<uint32_t>(value));
+        u32(static_cast<uint32_t>(value >> 32));
+    }
+    void f64(double value) {
+        uint64_t bits = 0;
+        std::memcpy(&bits, &value, sizeof(bits));
+        u64(bits);
+    }
+    void str(const std::string& value) {
+        u32(static_cast<uint32_t>(value.size()));
+        bytes.insert(bytes.end(), value.begin(), value.end());
+    }
+
+    std::vector<unsigned char> bytes;
+};
+
+// Reads little-endian fields; throws std::runtime_error past the end.
+class Reader {
+public:
+    Reader(const unsigned char* data, size_t size) : pos(data), left(size) {}
+
+    uint32_t u32() {
+        need(4);
+        uint32_t value = 0;
+        for (int i = 0; i < 4; ++i) {
+            value |= static_cast<uint32_t>(pos[i]) << (8 * i);
+        }
+        advance(4);
+        return value;
+    }
+    uint64_t u64() {
+        const uint64_t low = u32();
+        return low | (static_cast<uint64_t>(u32()) << 32);
+    }
+    double f64() {
+        const uint64_t bits = u64();
+        double value = 0.0;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+    std::string str() {
+        const uint32_t size = u32();
+        need(size);
+        std::string value(reinterpret_cast<const char*>(pos), size);
+        advance(size);
+        return value;
+    }
+    const unsigned char* rest() const { return pos; }
+    size_t remaining() const { return left; }
+
+private:
+    void need(size_t count) const {
+        if (left < count) {
+            throw std::runtime_error("Truncated render message.");
+        }
+    }
+    void advance(size_t count) {
+        pos += count;
+        left -= count;
+    }
+
+    const unsigned char* pos;
+    size_t left;
+};
+
+// Appends `count` floats as byte planes (byte k of every float, low byte
+// first), each delta coded, packed as runs: a control byte c < 128 is
+// followed by c + 1 literal bytes, c >= 128 by one byte repeated c - 125
+// times.
+inline void pack_floats(const float* data, size_t count, std::vector<unsigned char>& out) {
+    std::vector<unsigned char> planes(4 * count);
+    for (int k = 0; k < 4; ++k) {
+        unsigned char previous = 0;
+        unsigned char* plane = planes.data() + k * count;
+        for (size_t i = 0; i < count; ++i) {
+            uint32_t bits = 0;
+            std::memcpy(&bits, data + i, sizeof(bits));
+            const unsigned char byte = static_cast<unsigned char>(bits >> (8 * k));
+            plane[i] = static_cast<unsigned char>(byte - previous);
+            previous = byte;
+        }
+    }
+    const size_t size = planes.size();
+    const unsigned char* bytes = planes.data();
+    const auto run_at = [&](size_t i) {
+        return i + 2 < size && bytes[i] == bytes[i + 1] && bytes[i] == bytes[i + 2];
+    };
+    size_t i = 0;
+    while (i < size) {
+        if (run_at(i)) {
+            size_t run = 3;
+            while (run < 130 && i + run < size && bytes[i + run] == bytes[i]) {
+                ++run;
+            }
+            out.push_back(static_cast<unsigned char>(125 + run));
+            out.push_back(bytes[i]);
+            i += run;
+        } else {
+            const size_t start = i;
+            while (i < size && i - start < 128 && !run_at(i)) {
+                ++i;
+            }
+            out.push_back(static_cast<unsigned char>(i - start - 1));
+            out.insert(out.end(), bytes + start, bytes + i);
+        }
+    }
+}
+
+// Inverse of pack_floats(); throws std::runtime_error unless `data` holds
+// exactly `count` floats.
+inline void unpack_floats(const unsigned char* data, size_t size, float* out, size_t count) {
+    std::vector<unsigned char> planes(4 * count);
+    size_t filled = 0;
+    size_t i = 0;
+    while (i < size) {
+        const unsigned char control = data[i++];
+        if (control < 128) {
+            const size_t literal = static_cast<size_t>(control) + 1;
+            if (i + literal > size || filled + literal > planes.size()) {
+                throw std::runtime_error("Malformed tile data.");
+            }
+            std::memcpy(planes.data() + filled, data + i, literal);
+            i += literal;
+            filled += literal;
+        } else {
+            const size_t run = static_cast<size_t>(control) - 125;
+            if (i >= size || filled + run > planes.size()) {
+                throw std::runtime_error("Malformed tile data.");
+            }
+            std::memset(planes.data() + filled, data[i++], run);
+            filled += run;
+        }
+    }
+    if (filled != planes.size()) {
+        throw std::runtime_error("Malformed tile data.");
+    }
+    std::vector<uint32_t> bits(count, 0);
+    for (int k = 0; k < 4; ++k) {
+        unsigned char value = 0;
+        const unsigned char* plane = planes.data() + k * count;
+        for (size_t j = 0; j < count; ++j) {
+            value = static_cast<unsigned char>(value + plane[j]);
+            bits[j] |= static_cast<uint32_t>(value) << (8 * k);
+        }
+    }
+    std::memcpy(out, bits.data(), count * sizeof(float));
+}
+
+inline AovSet aovs_from_mask(uint32_t mask) {
+    AovSet aovs;
+    for (int i = 0; i < kAovChannelCount; ++i) {
+        if (mask & (1u << i)) {
+            aovs.add(static_cast<AovChannel>(i));
+        }
+    }
+    return aovs;
+}
+
+inline std::vector<unsigned char> encode_job(const DistributedJob& job) {
+    Writer out;
+    out.u32(static_cast<uint32_t>(job.tiles.width));
+    out.u32(static_cast<uint32_t>(job.tiles.height));
+    out.u32(static_cast<uint32_t>(job.tiles.tile_size));
+    out.u32(static_cast<uint32_t>(job.tiles.samples));
+    out.u32(tiled_detail::aov_mask(job.tiles.aovs));
+    out.u64(job.tiles.seed);
+    out.u32(static_cast<uint32_t>(job.max_depth));
+    for (const Vec3* v : {&job.view.lookfrom, &job.view.lookat, &job.view.vup}) {
+        for (int c = 0; c < 3; ++c) {
+            out.f64((*v)[c]);
+        }
+    }
+    out.f64(job.view.vfov);
+    out.f64(job.view.aperture);
+    out.f64(job.view.focus_dist);
+    out.str(job.scene);
+    out.u64(job.scene_seed);
+    out.str(job.environment);
+    out.u32(static_cast<uint32_t>(job.light_selection));
+    return out.bytes;
+}
+
+inline DistributedJob decode_job(const std::vector<unsigned char>& payload) {
+    Reader in(payload.data(), payload.size());
+    DistributedJob job;
+    job.tiles.width = static_cast<int>(in.u32());
+    job.tiles.height = static_cast<int>(in.u32());
+    job.tiles.tile_size = static_cast<int>(in.u32());
+    job.tiles.samples = static_cast<int>(in.u32());
+    job.tiles.aovs = aovs_from_mask(in.u32());
+    job.tiles.seed = in.u64();
+    job.max_depth = static_cast<int>(in.u32());
+    for (Vec3* v : {&job.view.lookfrom, &job.view.lookat, &job.view.vup}) {
+        const double x = in.f64();
+        const double y = in.f64();
+        const double z = in.f64();
+        *v = Vec3(x, y, z);
+    }
+    job.view.vfov = in.f64();
+    job.view.aperture = in.f64();
+    job.view.focus_dist = in.f64();
+    job.scene = in.str();
+    job.scene_seed = in.u64();
+    job.environment = in.str();
+    const uint32_t light_selection = in.u32();
+    if (light_selection > static_cast<uint32_t>(LightSelection::Bvh)) {
+        throw std::runtime_error("Invalid light selection in the render job.");
+    }
+    job.light_selection = static_cast<LightSelection>(light_selection);
+    return job;
+}
+
+// Takes the first complete message off the front of `buffer`; false if it
+// holds only part of one. Throws std::runtime_error for an oversized one.
+inline bool take_message(std::vector<unsigned char>& buffer, Message& message) {
+    if (buffer.size() < kHeaderBytes) {
+        return false;
+    }
+    Reader header(buffer.data(), kHeaderBytes);
+    const uint32_t type = header.u32();
+    const uint32_t length = header.u32();
+    if (length > kMaxPayload) {
+        throw std::runtime_error("Render message too large.");
+    }
+    if (buffer.size() < kHeaderBytes + length) {
+        return false;
+    }
+    message.type = type;
+    message.payload.assign(buffer.begin() + kHeaderBytes, buffer.begin() + kHeaderBytes + length);
+    buffer.erase(buffer.begin(), buffer.begin() + kHeaderBytes + length);
+    return true;
+}
+
+struct Address {
+    bool unix_socket = false;
+    std::string host;  // or the socket path
+    std::string port;
+};
+
+inline Address parse_address(const std::string& text) {
+    Address address;
+    if (text.rfind("unix:", 0) == 0) {
+        address.unix_socket = true;
+        address.host = text.substr(5);
+        if (address.host.empty()) {
+            throw std::invalid_argument("Empty socket path in address: " + text);
+        }
+        return address;
+    }
+    const size_t colon = text.rfind(':');
+    if (colon == std::string::npos || colon + 1 == text.size() ||
+        text.find_first_not_of("0123456789", colon + 1) != std::string::npos) {
+        throw std::invalid_argument("Expected unix:<path> or <host>:<port>, got: " + text);
+    }
+    address.host = text.substr(0, colon);
+    address.port = text.substr(colon + 1);
+    if (address.host.size() > 1 && address.host.front() == '[' && address.host.back() == ']') {
+        address.host = address.host.substr(1, address.host.size() - 2);
+    }
+    if (address.host.empty()) {
+        address.host = "0.0.0.0";
+    }
+    return address;
+}
+
+#ifndef _WIN32
+
+inline std::string socket_error(const std::string& what) {
+    return what + ": " + std::strerror(errno);
+}
+
+// Owns a socket descriptor.
+class Socket {
+public:
+    Socket() = default;
+    explicit Socket(int fd) : descriptor(fd) {}
+    ~Socket() { reset(); }
+    Socket(Socket&& other) noexcept : descriptor(other.descriptor) { other.descriptor = -1; }
+    Socket& operator=(Socket&& other) noexcept {
+        if (this != &other) {
+            reset();
+            descriptor = other.descriptor;
+            other.descriptor = -1;
+        }
+        return *this;
+    }
+
+    int fd() const { return descriptor; }
+    int release() {
+        const int fd = descriptor;
+        descriptor = -1;
+        return fd;
+    }
+    void reset() {
+        if (descriptor >= 0) {
+            ::close(descriptor);
+            descriptor = -1;
+        }
+    }
+
+private:
+    int descriptor = -1;
+};
+
+inline void configure_stream(int fd, bool tcp) {
+#ifdef SO_NOSIGPIPE
+    const int on = 1;
+    ::setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+    if (tcp) {
+        const int nodelay = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+    }
+}
+
+inline sockaddr_un unix_address(const std::string& path) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        throw std::invalid_argument("Socket path too long: " + path);
+    }
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    return address;
+}
+
+// Candidate TCP addresses; throws std::runtime_error if `host` does not
+// resolve.
+inline std::unique_ptr<addrinfo, void (*)(addrinfo*)> resolve(const Address& address, bool passive) {
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = passive ? AI_PASSIVE : 0;
+    addrinfo* list = nullptr;
+    const int status = ::getaddrinfo(address.host.c_str(), address.port.c_str(), &hints, &list);
+    if (status != 0) {
+        throw std::runtime_error("Cannot resolve " + address.host + ": " + ::gai_strerror(status));
+    }
+    return {list, ::freeaddrinfo};
+}
+
+// One connection attempt; an invalid Socket if nobody is listening.
+inline Socket connect_socket(const Address& address) {
+    if (address.unix_socket) {
+        const sockaddr_un target = unix_address(address.host);
+        Socket socket(::socket(AF_UNIX, SOCK_STREAM, 0));
+        if (socket.fd() >= 0 &&
+            ::connect(socket.fd(), reinterpret_cast<const sockaddr*>(&target), sizeof(target)) == 0) {
+            configure_stream(socket.fd(), false);
+            return socket;
+        }
+        return Socket();
+    }
+    const auto list = resolve(address, false);
+    for (const addrinfo* candidate = list.get(); candidate; candidate = candidate->ai_next) {
+        Socket socket(::socket(candidate->ai_family, candidate->ai_socktype, candidate->ai_protocol));
+        if (socket.fd() >= 0 && ::connect(socket.fd(), candidate->ai_addr, candidate->ai_addrlen) == 0) {
+            configure_stream(socket.fd(), true);
+            return socket;
+        }
+    }
+    return Socket();
+}
+
+inline void send_all(int fd, const unsigned char* data, size_t size) {
+#ifdef MSG_NOSIGNAL
+    const int flags = MSG_NOSIGNAL;
+#else
+    const int flags = 0;
+#endif
+    while (size > 0) {
+        const ssize_t sent = ::send(fd, data, size, flags);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                pollfd wait{fd, POLLOUT, 0};
+                ::poll(&wait, 1, 1000);
+                continue;
+            }
+            throw std::runtime_error(socket_error("Cannot send render message"));
+        }
+        data += sent;
+        size -= static_cast<size_t>(sent);
+    }
+}
+
+inline void send_message(int fd, uint32_t type, const std::vector<unsigned char>& payload) {
+    Writer frame;
+    frame.u32(type);
+    frame.u32(static_cast<uint32_t>(payload.size()));
+    frame.bytes.insert(frame.bytes.end(), payload.begin(), payload.end());
+    send_all(fd, frame.bytes.data(), frame.bytes.size());
+}
+
+// Blocks for the next message; false once the peer has closed the stream.
+// Throws std::runtime_error on socket errors.
+inline bool read_message(int fd, std::vector<unsigned char>& buffer, Message& message) {
+    unsigned char chunk[1 << 16];
+    while (!take_message(buffer, message)) {
+        const ssize_t received = ::recv(fd, chunk, sizeof(chunk), 0);
+        if (received == 0) {
+            return false;
+        }
+        if (received < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error(socket_error("Cannot receive render message"));
+        }
+        buffer.insert(buffer.end(), chunk, chunk + received);
+    }
+    return true;
+}
+
+#endif
+
+}
+
+#ifndef _WIN32
+
+inline RenderCoordinator::RenderCoordinator(const std::string& address) {
+    using namespace distributed_detail;
+    const Address parsed = parse_address(address);
+    Socket socket;
+    if (parsed.unix_socket) {
+        const sockaddr_un local = unix_address(parsed.host);
+        socket = Socket(::socket(AF_UNIX, SOCK_STREAM, 0));
+        ::unlink(parsed.host.c_str());
+        if (socket.fd() < 0 || ::bind(socket.fd(), reinterpret_cast<const sockaddr*>(&local), sizeof(local)) != 0) {
+            throw std::runtime_error(socket_error("Cannot bind " + address));
+        }
+        unix_path = parsed.host;
+        bound_address = address;
+    } else {
+        const auto list = resolve(parsed, true);
+        for (const addrinfo* candidate = list.get(); candidate && socket.fd() < 0; candidate = candidate->ai_next) {
+            socket = Socket(::socket(candidate->ai_family, candidate->ai_socktype, candidate->ai_protocol));
+            const int reuse = 1;
+            if (socket.fd() >= 0) {
+                ::setsockopt(socket.fd(), SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+            }
+            if (socket.fd() >= 0 && ::bind(socket.fd(), candidate->ai_addr, candidate->ai_addrlen) != 0) {
+                socket.reset();
+            }
+        }
+        if (socket.fd() < 0) {
+            throw std::runtime_error(socket_error("Cannot bind " + address));
+        }
+        sockaddr_storage local{};
+        socklen_t length = sizeof(local);
+        ::getsockname(socket.fd(), reinterpret_cast<sockaddr*>(&local), &length);
+        const uint16_t port = ntohs(local.ss_family == AF_INET6 ? reinterpret_cast<sockaddr_in6&>(local).sin6_port
+                                                                : reinterpret_cast<sockaddr_in&>(local).sin_port);
+        const bool ipv6 = parsed.host.find(':') != std::string::npos;
+        bound_address = (ipv6 ? "[" + parsed.host + "]" : parsed.host) + ":" + std::to_string(port);
+    }
+    if (::listen(socket.fd(), 64) != 0) {
+        throw std::runtime_error(socket_error("Cannot listen on " + address));
+    }
+    ::fcntl(socket.fd(), F_SETFL, ::fcntl(socket.fd(), F_GETFL) | O_NONBLOCK);
+    listen_fd = socket.release();
+}
+
+inline RenderCoordinator::~RenderCoordinator() {
+    if (listen_fd >= 0) {
+        ::close(listen_fd);
+    }
+    if (!unix_path.empty()) {
+        ::unlink(unix_path.c_str());
+    }
+}
+
+inline DistributedStats RenderCoordinator::render(const DistributedJob& job,
+                                                  const std::function<void(int, int, int, int, const float*)>& on_tile,
+                                                  const CoordinatorOptions& options,
+                                                  const std::atomic<bool>* cancel) {
+    using namespace distributed_detail;
+    using Clock = std::chrono::steady_clock;
+    const TiledRenderSettings& settings = job.tiles;
+    if (settings.width <= 0 || settings.height <= 0 || settings.tile_size <= 0 || settings.samples <= 0) {
+        throw std::invalid_argument("Distributed render requires a positive size, tile size and sample count.");
+    }
+    const int tile = settings.tile_size;
+    const int tiles_x = (settings.width + tile - 1) / tile;
+    const size_t total = static_cast<size_t>(tiles_x) * ((settings.height + tile - 1) / tile);
+    const size_t tile_floats = tiled_detail::tile_floats(tile, tiled_planes(settings.aovs));
+    const std::vector<unsigned char> job_payload = encode_job(job);
+
+    struct Worker {
+        Socket socket;
+        std::vector<unsigned char> input;
+        bool joined = false;
+        int capacity = 1;
+        int index = -1;  // in stats.tiles_per_worker
+        std::vector<size_t> held;
+        Clock::time_point heard;
+    };
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::deque<size_t> queue;
+    for (size_t t = 0; t < total; ++t) {
+        queue.push_back(t);
+    }
+    std::vector<char> done(total, 0);
+    std::vector<int> holders(total, 0);
+    size_t finished = 0;
+    DistributedStats stats;
+    std::vector<float> planes(tile_floats);
+    Clock::time_point alone_since = Clock::now();
+    // on_tile's own failures end the render rather than the worker's turn.
+    std::exception_ptr tile_error;
+
+    const auto drop = [&](Worker& worker) {
+        worker.socket.reset();
+        if (worker.joined) {
+            ++stats.workers_lost;
+        }
+        for (const size_t t : worker.held) {
+            if (--holders[t] == 0 && !done[t]) {
+                queue.push_front(t);
+                ++stats.reassigned_tiles;
+            }
+        }
+        worker.held.clear();
+    };
+    const auto hand_out = [&](Worker& worker) {
+        while (static_cast<int>(worker.held.size()) < worker.capacity) {
+            while (!queue.empty() && done[queue.front()]) {
+                queue.pop_front();
+            }
+            size_t t = total;
+            if (!queue.empty()) {
+                t = queue.front();
+                queue.pop_front();
+            } else if (options.duplicate_stragglers) {
+                // A tile only one other worker holds.
+                for (const auto& other : workers) {
+                    if (other.get() == &worker || t != total) {
+                        continue;
+                    }
+                    for (const size_t held : other->held) {
+                        if (!done[held] && holders[held] == 1) {
+                            t = held;
+                            break;
+                        }
+                    }
+                }
+                if (t == total) {
+                    return;
+                }
+                ++stats.duplicated_tiles;
+            } else {
+                return;
+            }
+            if (worker.held.empty()) {
+                worker.heard = Clock::now();
+            }
+            worker.held.push_back(t);
+            ++holders[t];
+            Writer payload;
+            payload.u32(static_cast<uint32_t>(t));
+            send_message(worker.socket.fd(), kTile, payload.bytes);
+        }
+    };
+    const auto handle = [&](Worker& worker, const Message& message) {
+        Reader in(message.payload.data(), message.payload.size());
+        if (!worker.joined) {
+            if (message.type != kHello || in.u32() != kMagic || in.u32() != kVersion) {
+                throw std::runtime_error("Not a render worker.");
+            }
+            const int threads = std::max(1, static_cast<int>(in.u32()));
+            worker.joined = true;
+            worker.capacity = options.tiles_per_worker > 0 ? options.tiles_per_worker : threads + 1;
+            worker.index = stats.workers++;
+            stats.tiles_per_worker.push_back(0);
+            send_message(worker.socket.fd(), kJob, job_payload);
+            return;
+        }
+        if (message.type == kError) {
+            stats.last_worker_error = in.str();
+            throw std::runtime_error(stats.last_worker_error);
+        }
+        if (message.type != kResult) {
+            throw std::runtime_error("Unexpected render message.");
+        }
+        const size_t t = in.u32();
+        const size_t count = in.u32();
+        const auto held = std::find(worker.held.begin(), worker.held.end(), t);
+        if (held == worker.held.end() || count != tile_floats) {
+            throw std::runtime_error("Result for a tile the worker does not hold.");
+        }
+        // Unpacked while the worker still holds the tile, so that malformed
+        // data drops the worker with the tile among those to requeue.
+        const bool first = !done[t];
+        if (first) {
+            unpack_floats(in.rest(), in.remaining(), planes.data(), count);
+        }
+        worker.held.erase(held);
+        --holders[t];
+        if (!first) {
+            return;  // a duplicate came back second
+        }
+        stats.wire_bytes += message.payload.size() + kHeaderBytes;
+        done[t] = 1;
+        ++finished;
+        ++stats.tiles;
+        ++stats.tiles_per_worker[static_cast<size_t>(worker.index)];
+        stats.raw_bytes += count * sizeof(float);
+        const int x0 = static_cast<int>(t % tiles_x) * tile;
+        const int y0 = static_cast<int>(t / tiles_x) * tile;
+        if (on_tile) {
+            try {
+                on_tile(x0, y0, std::min(x0 + tile, settings.width), std::min(y0 + tile, settings.height),
+                        planes.data());
+            } catch (...) {
+                tile_error = std::current_exception();
+            }
+        }
+    };
+
+    std::vector<pollfd> polled;
+    unsigned char chunk[1 << 16];
+    while (finished < total && !(cancel && cancel->load(std::memory_order_relaxed))) {
+        polled.assign(1, pollfd{listen_fd, POLLIN, 0});
+        for (const auto& worker : workers) {
+            polled.push_back(pollfd{worker->socket.fd(), POLLIN, 0});
+        }
+        if (::poll(polled.data(), polled.size(), 50) < 0 && errno != EINTR) {
+            throw std::runtime_error(socket_error("Cannot poll render workers"));
+        }
+        if (polled[0].revents & POLLIN) {
+            for (;;) {
+                const int fd = ::accept(listen_fd, nullptr, nullptr);
+                if (fd < 0) {
+                    break;
+                }
+                auto worker = std::make_unique<Worker>();
+                worker->socket = Socket(fd);
+                configure_stream(fd, unix_path.empty());
+                worker->heard = Clock::now();
+                workers.push_back(std::move(worker));
+            }
+        }
+        for (size_t i = 1; i < polled.size(); ++i) {
+            Worker& worker = *workers[i - 1];
+            if (!(polled[i].revents & (POLLIN | POLLHUP | POLLERR))) {
+                continue;
+            }
+            const ssize_t received = ::recv(worker.socket.fd(), chunk, sizeof(chunk), 0);
+            if (received < 0 && (errno == EINTR || errno == EAGAIN)) {
+                continue;
+            }
+            if (received <= 0) {
+                drop(worker);
+                continue;
+            }
+            worker.input.insert(worker.input.end(), chunk, chunk + received);
+            worker.heard = Clock::now();
+            try {
+                Message message;
+                while (worker.socket.fd() >= 0 && !tile_error && take_message(worker.input, message)) {
+                    handle(worker, message);
+                }
+                if (worker.joined && finished < total) {
+                    hand_out(worker);
+                }
+            } catch (const std::runtime_error&) {
+                drop(worker);
+            }
+            if (tile_error) {
+                std::rethrow_exception(tile_error);
+            }
+        }
+        // Silent workers, then the ones still waiting for tiles.
+        const Clock::time_point now = Clock::now();
+        for (const auto& worker : workers) {
+            const double silent = std::chrono::duration<double>(now - worker->heard).count();
+            if (worker->socket.fd() >= 0 && !worker->held.empty() && silent > options.worker_timeout_seconds) {
+                drop(*worker);
+            }
+        }
+        workers.erase(std::remove_if(workers.begin(), workers.end(),
+                                     [](const std::unique_ptr<Worker>& worker) { return worker->socket.fd() < 0; }),
+                      workers.end());
+        for (const auto& worker : workers) {
+            if (worker->joined && finished < total) {
+                try {
+                    hand_out(*worker);
+                } catch (const std::runtime_error&) {
+                    drop(*worker);
+                }
+            }
+        }
+        if (!workers.empty()) {
+            alone_since = now;
+        } else if (std::chrono::duration<double>(now - alone_since).count() > options.connect_timeout_seconds) {
+            throw std::runtime_error("No render worker connected for " +
+                                     std::to_string(static_cast<int>(options.connect_timeout_seconds)) + " s" +
+                                     (stats.last_worker_error.empty() ? "." : "; last worker error: " +
+                                                                                  stats.last_worker_error));
+        }
+    }
+    for (const auto& worker : workers) {
+        if (worker->joined) {
+            try {
+                send_message(worker->socket.fd(), kDone, {});
+            } catch (const std::runtime_error&) {
+            }
+        }
+    }
+    return stats;
+}
+
+inline size_t run_render_worker(const std::string& address, const SceneLoader& load_scene,
+                                const WorkerOptions& options) {
+    using namespace distributed_detail;
+    const Address parsed = parse_address(address);
+    const auto deadline = std::chrono::steady_clock::now() +
+                          std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                              std::chrono::duration<double>(options.connect_timeout_seconds));
+    Socket socket = connect_socket(parsed);
+    while (socket.fd() < 0) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            throw std::runtime_error(socket_error("Cannot connect to render coordinator at " + address));
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        socket = connect_socket(parsed);
+    }
+    const int threads = options.threads > 0 ? options.threads
+                                            : std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    Writer hello;
+    hello.u32(kMagic);
+    hello.u32(kVersion);
+    hello.u32(static_cast<uint32_t>(threads));
+    send_message(socket.fd(), kHello, hello.bytes);
+
+    std::vector<unsigned char> input;
+    Message message;
+    if (!read_message(socket.fd(), input, message) || message.type == kDone) {
+        return 0;
+    }
+    if (message.type != kJob) {
+        throw std::runtime_error("Expected a render job.");
+    }
+    const DistributedJob job = decode_job(message.payload);
+    const TiledRenderSettings& settings = job.tiles;
+    if (settings.width <= 0 || settings.height <= 0 || settings.tile_size <= 0 || settings.samples <= 0) {
+        throw std::runtime_error("Invalid render job.");
+    }
+    HitableList objects;
+    PathTracerSettings path_settings;
+    path_settings.max_depth = job.max_depth;
+    std::string loading = "scene '" + job.scene + "'";
+    try {
+        seed_thread_rng(job.scene_seed);
+        objects = load_scene(job.scene);
+        if (!job.environment.empty()) {
+            loading = "environment '" + job.environment + "'";
+            path_settings.environment = std::make_shared<EnvironmentMap>(load_hdr_image(job.environment));
+        }
+    } catch (const std::exception& error) {
+        const std::string reason_text = "Cannot load " + loading + ": " + error.what();
+        Writer reason;
+        reason.str(reason_text);
+        send_message(socket.fd(), kError, reason.bytes);
+        throw std::runtime_error(reason_text);
+    }
+    const Scene world(objects);
+    const std::unique_ptr<LightSampler> lights = make_light_sampler(objects, job.light_selection);
+    const AovIds ids = settings.aovs.empty() ? AovIds() : AovIds(objects);
+    const Camera camera = job.view.camera(static_cast<double>(settings.width) / settings.height);
+    const size_t tile_floats = tiled_detail::tile_floats(settings.tile_size, tiled_planes(settings.aovs));
+    const size_t total = static_cast<size_t>((settings.width + settings.tile_size - 1) / settings.tile_size) *
+                         ((settings.height + settings.tile_size - 1) / settings.tile_size);
+
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::deque<size_t> queue;
+    bool stopping = false;
+    std::mutex send_mutex;
+    std::string send_error;
+    std::atomic<size_t> traced{0};
+    std::vector<std::thread> pool;
+    for (int i = 0; i < threads; ++i) {
+        pool.emplace_back([&]() {
+            std::vector<float> planes(tile_floats);
+            for (;;) {
+                size_t t = 0;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    ready.wait(lock, [&] { return !queue.empty() || stopping; });
+                    if (queue.empty()) {
+                        return;
+                    }
+                    t = queue.front();
+                    queue.pop_front();
+                }
+                render_tile(world, *lights, camera, path_settings, settings, ids, t, planes.data());
+                Writer result;
+                result.u32(static_cast<uint32_t>(t));
+                result.u32(static_cast<uint32_t>(tile_floats));
+                pack_floats(planes.data(), planes.size(), result.bytes);
+                std::lock_guard<std::mutex> lock(send_mutex);
+                try {
+                    if (send_error.empty()) {
+                        send_message(socket.fd(), kResult, result.bytes);
+                        ++traced;
+                    }
+                } catch (const std::exception& error) {
+                    // The coordinator is gone; the reader sees the stream close.
+                    send_error = error.what();
+                    ::shutdown(socket.fd(), SHUT_RDWR);
+                }
+            }
+        });
+    }
+    const auto stop = [&]() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+            queue.clear();
+        }
+        ready.notify_all();
+        for (std::thread& thread : pool) {
+            thread.join();
+        }
+    };
+    try {
+        while (read_message(socket.fd(), input, message) && message.type != kDone) {
+            if (message.type != kTile) {
+                throw std::runtime_error("Unexpected render message.");
+            }
+            Reader in(message.payload.data(), message.payload.size());
+            const size_t t = in.u32();
+            if (t >= total) {
+                throw std::runtime_error("Tile index out of range.");
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                queue.push_back(t);
+            }
+            ready.notify_one();
+        }
+    } catch (...) {
+        stop();
+        throw;
+    }
+    stop();
+    return traced.load();
+}
+
+#else
+
+inline RenderCoordinator::RenderCoordinator(const std::string&) {
+    throw std::runtime_error("Distributed rendering needs POSIX sockets.");
+}
+
+inline RenderCoordinator::~RenderCoordinator() = default;
+
+inline DistributedStats RenderCoordinator::render(const DistributedJob&,
+                                                  const std::function<void(int, int, int, int, const float*)>&,
+                                                  const CoordinatorOptions&, const std::atomic<bool>*) {
+    throw std::runtime_error("Distributed rendering needs POSIX sockets.");
+}
+
+inline size_t run_render_worker(const std::string&, const SceneLoader&, const WorkerOptions&) {
+    throw std::runtime_error("Distributed rendering needs POSIX sockets.");
+}
+
+#endif
+
+#endif // RAYTRACER_DISTRIBUTED_H
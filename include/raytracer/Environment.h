@@ -0,0 +1,702 @@
+#ifndef RAYTRACER_ENVIRONMENT_H
+#define RAYTRACER_ENVIRONMENT_H
+
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+
+#include "raytracer/Deflate.h"
+#include "raytracer/RayTracer.h"
+
+// HDR environment lighting.
+//
+// An equirectangular (latitude-longitude) radiance map, y up, row 0 at the
+// zenith. Directions map to texels in O(1) with nearest lookup. Texels are
+// stored as 32-bit or 16-bit (half) floats.
+//
+// For importance sampling every texel is weighted by its luminance times
+// sin(theta), which is the solid angle it covers. The weights go into Walker
+// alias tables: one over rows (marginal) and one per row (conditional). A
+// sample then costs two table lookups regardless of the map size, and the
+// density of any direction is one stored pmf read. Bright, small features
+// such as the sun are found directly instead of waiting for BSDF samples to
+// hit them.
+
+struct HdrImage {
+    int width = 0;
+    int height = 0;
+    std::vector<Color> pixels;  // row-major, row 0 at the top
+
+    const Color& at(int x, int y) const { return pixels[static_cast<size_t>(y) * width + x]; }
+};
+
+// Portable float map (.pfm, colour "PF" or greyscale "Pf").
+HdrImage load_pfm(const std::string& path);
+// Radiance RGBE (.hdr / .pic), flat or run-length encoded scanlines.
+HdrImage load_rgbe(const std::string& path);
+// Single-part scanline OpenEXR (.exr), uncompressed, ZIPS or ZIP, with HALF,
+// FLOAT or UINT channels R, G and B (or Y alone). Other compressions, tiled
+// and multi-part files are rejected.
+HdrImage load_exr(const std::string& path);
+// Dispatches on the file extension.
+HdrImage load_hdr_image(const std::string& path);
+
+// IEEE 754 binary16; values beyond the half range are clamped to +-65504.
+uint16_t float_to_half(float value);
+float half_to_float(uint16_t half);
+
+// Discrete distribution sampled in O(1) (Vose's construction of Walker's
+// alias method). All-zero weights fall back to a uniform distribution.
+class AliasTable {
+public:
+    AliasTable() {}
+    explicit AliasTable(const std::vector<double>& weights);
+
+    size_t size() const { return bins.size(); }
+    double pmf(size_t index) const { return bins[index].pmf; }
+    // Maps one uniform number in [0, 1) to an index.
+    size_t sample(double u) const;
+
+private:
+    struct Bin {
+        float threshold = 1.0f;
+        uint32_t alias = 0;
+        float pmf = 0.0f;
+    };
+    std::vector<Bin> bins;
+};
+
+enum class TexelFormat { Float32, Float16 };
+
+class EnvironmentMap {
+public:
+    // `scale` multiplies every texel before storage.
+    explicit EnvironmentMap(const HdrImage& image, TexelFormat format = TexelFormat::Float32, double scale = 1.0);
+
+    int width() const { return map_width; }
+    int height() const { return map_height; }
+    TexelFormat format() const { return texel_format; }
+    // Bytes held by texels and sampling tables.
+    size_t memory_bytes() const;
+
+    Color texel(int x, int y) const;
+    // Radiance arriving from `direction` (pointing away from the receiver).
+    Color eval(const Vec3& direction) const;
+    // Unit direction drawn proportionally to the map's luminance; `pdf` is the
+    // solid-angle density.
+    Vec3 sample(double& pdf) const;
+    double pdf(const Vec3& direction) const;
+
+    static Vec3 direction_of(double u, double v);
+    static void uv_of(const Vec3& direction, double& u, double& v);
+
+private:
+    void texel_of(const Vec3& direction, int& x, int& y, double& sin_theta) const;
+
+    int map_width = 0;
+    int map_height = 0;
+    TexelFormat texel_format = TexelFormat::Float32;
+    std::vector<float> texels32;
+    std::vector<uint16_t> texels16;
+    AliasTable rows;
+    std::vector<AliasTable> columns;
+};
+
+inline uint16_t float_to_half(float value) {
+    uint32_t bits = 0;
+    std::memcpy(&bits, &value, sizeof(bits));
+    const uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000u);
+    const uint32_t magnitude = bits & 0x7fffffffu;
+
+    if (magnitude > 0x7f800000u) {
+        return static_cast<uint16_t>(sign | 0x7e00u);  // NaN
+    }
+    if (magnitude >= 0x477ff000u) {
+        return static_cast<uint16_t>(sign | 0x7bffu);  // clamp to 65504
+    }
+    if (magnitude < 0x33000000u) {
+        return sign;  // below half the smallest subnormal
+    }
+
+    const int exponent = static_cast<int>(magnitude >> 23) - 127;
+    uint32_t mantissa = (magnitude & 0x7fffffu) | 0x800000u;
+    // Normal halves keep 10 of the 23 fraction bits; subnormals fewer.
+    const int shift = exponent < -14 ? 13 + (-14 - exponent) : 13;
+    const uint32_t rounded = mantissa >> shift;
+    const uint32_t remainder = mantissa & ((1u << shift) - 1u);
+    const uint32_t halfway = 1u << (shift - 1);
+    mantissa = rounded + ((remainder > halfway || (remainder == halfway && (rounded & 1u))) ? 1u : 0u);
+
+    if (exponent < -14) {
+        return static_cast<uint16_t>(sign | mantissa);
+    }
+    // The implicit bit carries into the exponent field, which also handles
+    // mantissa overflow from rounding.
+    return static_cast<uint16_t>(sign | ((static_cast<uint32_t>(exponent + 14) << 10) + mantissa));
+}
+
+inline float half_to_float(uint16_t half) {
+    const uint32_t sign = static_cast<uint32_t>(half & 0x8000u) << 16;
+    const uint32_t exponent = (half >> 10) & 0x1fu;
+    const uint32_t mantissa = half & 0x3ffu;
+    uint32_t bits = 0;
+    if (exponent == 0) {
+        if (mantissa == 0) {
+            bits = sign;
+        } else {
+            const float value = std::ldexp(static_cast<float>(mantissa), -24);
+            return sign ? -value : value;
+        }
+    } else if (exponent == 31) {
+        bits = sign | 0x7f800000u | (mantissa << 13);
+    } else {
+        bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    }
+    float value = 0.0f;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+namespace environment_detail {
+
+// Tested on the bits: under -ffast-math the compiler may assume no NaN or
+// infinity reaches a comparison and fold !(value >= 0.0) or std::isinf().
+inline bool finite_non_negative(double value) {
+    uint64_t bits = 0;
+    std::memcpy(&bits, &value, sizeof(bits));
+    const bool finite = ((bits >> 52) & 0x7ffu) != 0x7ffu;
+    const bool negative = (bits >> 63) != 0 && (bits << 1) != 0;  // -0.0 is fine
+    return finite && !negative;
+}
+
+}
+
+inline AliasTable::AliasTable(const std::vector<double>& weights) {
+    const size_t n = weights.size();
+    if (n == 0) {
+        throw std::invalid_argument("AliasTable requires at least one weight.");
+    }
+    if (n >= 0xffffffffu) {
+        throw std::invalid_argument("AliasTable supports at most 2^32 - 1 weights.");
+    }
+    double total = 0.0;
+    for (double w : weights) {
+        if (!environment_detail::finite_non_negative(w)) {
+            throw std::invalid_argument("AliasTable weights must be finite and non-negative.");
+        }
+        total += w;
+    }
+
+    bins.resize(n);
+    std::vector<double> scaled(n);
+    for (size_t i = 0; i < n; ++i) {
+        const double p = total > 0.0 ? weights[i] / total : 1.0 / static_cast<double>(n);
+        bins[i].pmf = static_cast<float>(p);
+        scaled[i] = p * static_cast<double>(n);
+    }
+
+    std::vector<uint32_t> small;
+    std::vector<uint32_t> large;
+    for (size_t i = 0; i < n; ++i) {
+        (scaled[i] < 1.0 ? small : large).push_back(static_cast<uint32_t>(i));
+    }
+    while (!small.empty() && !large.empty()) {
+        const uint32_t s = small.back();
+        small.pop_back();
+        const uint32_t l = large.back();
+        bins[s].threshold = static_cast<float>(scaled[s]);
+        bins[s].alias = l;
+        scaled[l] -= 1.0 - scaled[s];
+        if (scaled[l] < 1.0) {
+            large.pop_back();
+            small.push_back(l);
+        }
+    }
+    // Leftovers are 1 up to rounding.
+    for (uint32_t i : small) {
+        bins[i].threshold = 1.0f;
+        bins[i].alias = i;
+    }
+    for (uint32_t i : large) {
+        bins[i].threshold = 1.0f;
+        bins[i].alias = i;
+    }
+}
+
+inline size_t AliasTable::sample(double u) const {
+    const double scaled = u * static_cast<double>(bins.size());
+    const size_t index = std::min(bins.size() - 1, static_cast<size_t>(scaled));
+    const double fraction = scaled - static_cast<double>(index);
+    return fraction < bins[index].threshold ? index : bins[index].alias;
+}
+
+inline EnvironmentMap::EnvironmentMap(const HdrImage& image, TexelFormat format, double scale)
+    : map_width(image.width), map_height(image.height), texel_format(format) {
+    if (image.width <= 0 || image.height <= 0 ||
+        image.pixels.size() != static_cast<size_t>(image.width) * static_cast<size_t>(image.height)) {
+        throw std::invalid_argument("EnvironmentMap requires a non-empty image with width * height pixels.");
+    }
+
+    const size_t count = image.pixels.size();
+    if (format == TexelFormat::Float16) {
+        texels16.resize(3 * count);
+    } else {
+        texels32.resize(3 * count);
+    }
+    for (size_t i = 0; i < count; ++i) {
+        for (int c = 0; c < 3; ++c) {
+            const float value = static_cast<float>(std::fmax(0.0, scale * image.pixels[i][c]));
+            if (format == TexelFormat::Float16) {
+                texels16[3 * i + c] = float_to_half(value);
+            } else {
+                texels32[3 * i + c] = value;
+            }
+        }
+    }
+
+    // Weights from the stored texels, so eval() and pdf() agree after rounding.
+    std::vector<double> row_weights(map_height);
+    std::vector<double> weights(map_width);
+    columns.reserve(map_height);
+    for (int y = 0; y < map_height; ++y) {
+        const double sin_theta = std::sin(pi * (y + 0.5) / map_height);
+        double row_total = 0.0;
+        for (int x = 0; x < map_width; ++x) {
+            weights[x] = luminance(texel(x, y)) * sin_theta;
+            row_total += weights[x];
+        }
+        row_weights[y] = row_total;
+        columns.emplace_back(weights);
+    }
+    rows = AliasTable(row_weights);
+}
+
+inline size_t EnvironmentMap::memory_bytes() const {
+    return texels32.size() * sizeof(float) + texels16.size() * sizeof(uint16_t) +
+           (static_cast<size_t>(map_width) + 1) * static_cast<size_t>(map_height) * 3 * sizeof(uint32_t);
+}
+
+inline Color EnvironmentMap::texel(int x, int y) const {
+    const size_t i = 3 * (static_cast<size_t>(y) * map_width + x);
+    if (texel_format == TexelFormat::Float16) {
+        return Color(half_to_float(texels16[i]), half_to_float(texels16[i + 1]), half_to_float(texels16[i + 2]));
+    }
+    return Color(texels32[i], texels32[i + 1], texels32[i + 2]);
+}
+
+inline Vec3 EnvironmentMap::direction_of(double u, double v) {
+    const double phi = 2.0 * pi * u;
+    const double theta = pi * v;
+    const double sin_theta = std::sin(theta);
+    return Vec3(sin_theta * std::cos(phi), std::cos(theta), sin_theta * std::sin(phi));
+}
+
+inline void EnvironmentMap::uv_of(const Vec3& direction, double& u, double& v) {
+    const Vec3 d = unit_vector(direction);
+    double phi = std::atan2(d.z(), d.x());
+    if (phi < 0.0) {
+        phi += 2.0 * pi;
+    }
+    u = phi / (2.0 * pi);
+    v = std::acos(clamp(d.y(), -1.0, 1.0)) / pi;
+}
+
+inline void EnvironmentMap::texel_of(const Vec3& direction, int& x, int& y, double& sin_theta) const {
+    double u = 0.0;
+    double v = 0.0;
+    uv_of(direction, u, v);
+    x = std::min(map_width - 1, static_cast<int>(u * map_width));
+    y = std::min(map_height - 1, static_cast<int>(v * map_height));
+    sin_theta = std::sin(pi * v);
+}
+
+inline Color EnvironmentMap::eval(const Vec3& direction) const {
+    int x = 0;
+    int y = 0;
+    double sin_theta = 0.0;
+    texel_of(direction, x, y, sin_theta);
+    return texel(x, y);
+}
+
+inline Vec3 EnvironmentMap::sample(double& pdf_out) const {
+    const size_t y = rows.sample(random_double());
+    const size_t x = columns[y].sample(random_double());
+    const double u = (static_cast<double>(x) + random_double()) / map_width;
+    const double v = (static_cast<double>(y) + random_double()) / map_height;
+    const double sin_theta = std::sin(pi * v);
+    const double pmf = rows.pmf(y) * columns[y].pmf(x);
+    // Texels are uniform in (u, v), which spans 2 pi x pi radians.
+    pdf_out = sin_theta > 0.0 ? pmf * map_width * map_height / (2.0 * pi * pi * sin_theta) : 0.0;
+    return direction_of(u, v);
+}
+
+inline double EnvironmentMap::pdf(const Vec3& direction) const {
+    int x = 0;
+    int y = 0;
+    double sin_theta = 0.0;
+    texel_of(direction, x, y, sin_theta);
+    if (!(sin_theta > 0.0)) {
+        return 0.0;
+    }
+    const double pmf = rows.pmf(static_cast<size_t>(y)) * columns[static_cast<size_t>(y)].pmf(static_cast<size_t>(x));
+    return pmf * map_width * map_height / (2.0 * pi * pi * sin_theta);
+}
+
+namespace environment_detail {
+
+inline std::ifstream open_binary(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        throw std::runtime_error("Cannot open image file: " + path);
+    }
+    return in;
+}
+
+inline bool host_is_little_endian() {
+    const uint16_t probe = 1;
+    uint8_t first = 0;
+    std::memcpy(&first, &probe, 1);
+    return first == 1;
+}
+
+inline Color rgbe_to_color(const uint8_t* rgbe) {
+    if (rgbe[3] == 0) {
+        return Color(0, 0, 0);
+    }
+    const double f = std::ldexp(1.0, static_cast<int>(rgbe[3]) - (128 + 8));
+    return Color((rgbe[0] + 0.5) * f, (rgbe[1] + 0.5) * f, (rgbe[2] + 0.5) * f);
+}
+
+// One scanline of new-style RLE (four planar channels), or of flat RGBE when
+// the line does not start with the RLE marker.
+inline void read_rgbe_scanline(std::istream& in, int width, std::vector<uint8_t>& line) {
+    line.assign(static_cast<size_t>(width) * 4, 0);
+    uint8_t head[4];
+    if (!in.read(reinterpret_cast<char*>(head), 4)) {
+        throw std::runtime_error("Truncated RGBE scanline.");
+    }
+    const bool rle = width >= 8 && width < 32768 && head[0] == 2 && head[1] == 2 && (head[2] & 0x80) == 0;
+    if (!rle) {
+        std::memcpy(line.data(), head, 4);
+        if (width > 1 && !in.read(reinterpret_cast<char*>(line.data() + 4), static_cast<std::streamsize>(width - 1) * 4)) {
+            throw std::runtime_error("Truncated RGBE scanline.");
+        }
+        return;
+    }
+    if (((head[2] << 8) | head[3]) != width) {
+        throw std::runtime_error("RGBE scanline width mismatch.");
+    }
+
+    for (int channel = 0; channel < 4; ++channel) {
+        int x = 0;
+        while (x < width) {
+            const int count = in.get();
+            if (count == EOF) {
+                throw std::runtime_error("Truncated RGBE scanline.");
+            }
+            if (count > 128) {
+                const int run = count - 128;
+                const int value = in.get();
+                if (value == EOF || x + run > width) {
+                    throw std::runtime_error("Corrupt RGBE run.");
+                }
+                for (int i = 0; i < run; ++i, ++x) {
+                    line[static_cast<size_t>(x) * 4 + channel] = static_cast<uint8_t>(value);
+                }
+            } else {
+                if (count == 0 || x + count > width) {
+                    throw std::runtime_error("Corrupt RGBE run.");
+                }
+                for (int i = 0; i < count; ++i, ++x) {
+                    const int value = in.get();
+                    if (value == EOF) {
+                        throw std::runtime_error("Truncated RGBE scanline.");
+                    }
+                    line[static_cast<size_t>(x) * 4 + channel] = static_cast<uint8_t>(value);
+                }
+            }
+        }
+    }
+}
+
+inline uint32_t read_le32(const uint8_t* bytes) {
+    return uint32_t{bytes[0]} | (uint32_t{bytes[1]} << 8) | (uint32_t{bytes[2]} << 16) | (uint32_t{bytes[3]} << 24);
+}
+
+struct ExrChannel {
+    std::string name;
+    uint32_t type = 0;  // 0 UINT, 1 HALF, 2 FLOAT
+    size_t offset = 0;  // of the channel's samples within one scanline
+};
+
+inline float exr_sample(const uint8_t* bytes, uint32_t type) {
+    if (type == 1) {
+        return half_to_float(static_cast<uint16_t>(bytes[0] | (bytes[1] << 8)));
+    }
+    const uint32_t bits = read_le32(bytes);
+    if (type == 0) {
+        return static_cast<float>(bits);
+    }
+    float value = 0.0f;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// Undoes the ZIP predictor (byte deltas) and the split of every sample into
+// a first half of even and a second half of odd bytes.
+inline void exr_unpredict(std::vector<uint8_t>& block) {
+    for (size_t i = 1; i < block.size(); ++i) {
+        block[i] = static_cast<uint8_t>(block[i - 1] + block[i] - 128);
+    }
+    const std::vector<uint8_t> split = block;
+    const size_t half = (split.size() + 1) / 2;
+    for (size_t i = 0; i < split.size(); ++i) {
+        block[i] = split[(i % 2 == 0) ? i / 2 : half + i / 2];
+    }
+}
+
+}
+
+inline HdrImage load_pfm(const std::string& path) {
+    std::ifstream in = environment_detail::open_binary(path);
+    std::string magic;
+    HdrImage image;
+    double scale = 0.0;
+    in >> magic >> image.width >> image.height >> scale;
+    if (!in || (magic != "PF" && magic != "Pf") || image.width <= 0 || image.height <= 0 || scale == 0.0) {
+        throw std::runtime_error("Not a valid PFM file: " + path);
+    }
+    in.get();  // single whitespace before the raster
+
+    const int channels = magic == "PF" ? 3 : 1;
+    const size_t count = static_cast<size_t>(image.width) * static_cast<size_t>(image.height);
+    std::vector<float> raster(count * channels);
+    if (!in.read(reinterpret_cast<char*>(raster.data()), static_cast<std::streamsize>(raster.size() * sizeof(float)))) {
+        throw std::runtime_error("Truncated PFM file: " + path);
+    }
+    // Negative scale: little-endian samples.
+    if ((scale < 0.0) != environment_detail::host_is_little_endian()) {
+        for (float& value : raster) {
+            uint32_t bits = 0;
+            std::memcpy(&bits, &value, sizeof(bits));
+            bits = (bits >> 24) | ((bits >> 8) & 0xff00u) | ((bits << 8) & 0xff0000u) | (bits << 24);
+            std::memcpy(&value, &bits, sizeof(bits));
+        }
+    }
+
+    // PFM rows run bottom to top.
+    image.pixels.resize(count);
+    for (int y = 0; y < image.height; ++y) {
+        const size_t source_row = static_cast<size_t>(image.height - 1 - y) * image.width;
+        for (int x = 0; x < image.width; ++x) {
+            const float* p = &raster[(source_row + x) * channels];
+            image.pixels[static_cast<size_t>(y) * image.width + x] =
+                channels == 3 ? Color(p[0], p[1], p[2]) : Color(p[0], p[0], p[0]);
+        }
+    }
+    return image;
+}
+
+inline HdrImage load_rgbe(const std::string& path) {
+    std::ifstream in = environment_detail::open_binary(path);
+    std::string line;
+    if (!std::getline(in, line) || line.rfind("#?", 0) != 0) {
+        throw std::runtime_error("Not a Radiance HDR file: " + path);
+    }
+    while (std::getline(in, line) && !line.empty()) {
+        if (line.rfind("FORMAT=", 0) == 0 && line != "FORMAT=32-bit_rle_rgbe") {
+            throw std::runtime_error("Unsupported Radiance HDR format (" + line + "): " + path);
+        }
+    }
+
+    HdrImage image;
+    std::string y_axis;
+    std::string x_axis;
+    if (!std::getline(in, line)) {
+        throw std::runtime_error("Missing Radiance HDR resolution: " + path);
+    }
+    std::istringstream resolution(line);
+    resolution >> y_axis >> image.height >> x_axis >> image.width;
+    if (!resolution || y_axis != "-Y" || x_axis != "+X" || image.width <= 0 || image.height <= 0) {
+        throw std::runtime_error("Unsupported Radiance HDR orientation (expected -Y h +X w): " + path);
+    }
+
+    image.pixels.resize(static_cast<size_t>(image.width) * static_cast<size_t>(image.height));
+    std::vector<uint8_t> scanline;
+    for (int y = 0; y < image.height; ++y) {
+        environment_detail::read_rgbe_scanline(in, image.width, scanline);
+        for (int x = 0; x < image.width; ++x) {
+            image.pixels[static_cast<size_t>(y) * image.width + x] =
+                environment_detail::rgbe_to_color(&scanline[static_cast<size_t>(x) * 4]);
+        }
+    }
+    return image;
+}
+
+inline HdrImage load_exr(const std::string& path) {
+    using namespace environment_detail;
+    std::ifstream in = open_binary(path);
+    const std::vector<uint8_t> file((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    const auto fail = [&](const std::string& reason) { return std::runtime_error(reason + ": " + path); };
+    if (file.size() < 8 || read_le32(file.data()) != 20000630u) {
+        throw fail("Not an OpenEXR file");
+    }
+    // Version 2; the flags mark tiled (0x200), deep (0x800) and multi-part
+    // (0x1000) files.
+    const uint32_t version = read_le32(&file[4]);
+    if ((version & 0xff) != 2 || (version & 0x1a00) != 0) {
+        throw fail("Only single-part scanline OpenEXR files are supported");
+    }
+
+    size_t pos = 8;
+    const auto text = [&]() {
+        const auto end = std::find(file.begin() + static_cast<std::ptrdiff_t>(pos), file.end(), uint8_t{0});
+        if (end == file.end()) {
+            throw fail("Truncated OpenEXR header");
+        }
+        std::string value(file.begin() + static_cast<std::ptrdiff_t>(pos), end);
+        pos += value.size() + 1;
+        return value;
+    };
+    std::vector<ExrChannel> channels;
+    int compression = -1;
+    int32_t window[4] = {};
+    bool has_window = false;
+    while (pos < file.size() && file[pos] != 0) {
+        const std::string name = text();
+        text();  // attribute type
+        if (pos + 4 > file.size() || read_le32(&file[pos]) > file.size() - pos - 4) {
+            throw fail("Truncated OpenEXR header");
+        }
+        const size_t size = read_le32(&file[pos]);
+        const uint8_t* value = &file[pos + 4];
+        if (name == "channels") {
+            for (size_t c = 0; c < size && value[c] != 0;) {
+                ExrChannel channel;
+                while (c < size && value[c] != 0) {
+                    channel.name.push_back(static_cast<char>(value[c++]));
+                }
+                if (c + 17 > size) {
+                    throw fail("Corrupt OpenEXR channel list");
+                }
+                channel.type = read_le32(value + c + 1);
+                if (channel.type > 2 || read_le32(value + c + 9) != 1 || read_le32(value + c + 13) != 1) {
+                    throw fail("Unsupported OpenEXR channel '" + channel.name + "'");
+                }
+                channels.push_back(channel);
+                c += 17;
+            }
+        } else if (name == "compression" && size >= 1) {
+            compression = value[0];
+        } else if (name == "dataWindow" && size >= 16) {
+            for (int i = 0; i < 4; ++i) {
+                window[i] = static_cast<int32_t>(read_le32(value + 4 * i));
+            }
+            has_window = true;
+        }
+        pos += 4 + size;
+    }
+    ++pos;
+
+    // 0 NONE, 2 ZIPS (one line per block), 3 ZIP (16 lines).
+    if (compression != 0 && compression != 2 && compression != 3) {
+        throw fail("Unsupported OpenEXR compression (only none and ZIP)");
+    }
+    const int64_t width = int64_t{window[2]} - window[0] + 1;
+    const int64_t height = int64_t{window[3]} - window[1] + 1;
+    if (!has_window || width <= 0 || height <= 0 || width > (1 << 24) || height > (1 << 24)) {
+        throw fail("Invalid OpenEXR data window");
+    }
+
+    const auto find_channel = [&](const char* name) {
+        for (const ExrChannel& channel : channels) {
+            if (channel.name == name) {
+                return &channel;
+            }
+        }
+        return static_cast<const ExrChannel*>(nullptr);
+    };
+    size_t row_bytes = 0;
+    for (ExrChannel& channel : channels) {
+        channel.offset = row_bytes;
+        row_bytes += static_cast<size_t>(width) * (channel.type == 1 ? 2 : 4);
+    }
+    const ExrChannel* rgb[3] = {find_channel("R"), find_channel("G"), find_channel("B")};
+    if (!rgb[0] || !rgb[1] || !rgb[2]) {
+        const ExrChannel* luminance = find_channel("Y");
+        if (!luminance) {
+            throw fail("OpenEXR file has no R, G and B (or Y) channels");
+        }
+        rgb[0] = rgb[1] = rgb[2] = luminance;
+    }
+
+    const int lines = compression == 3 ? 16 : 1;
+    const size_t blocks = static_cast<size_t>((height + lines - 1) / lines);
+    if (blocks > (file.size() - std::min(pos, file.size())) / 8) {
+        throw fail("Truncated OpenEXR offset table");
+    }
+    HdrImage image;
+    image.width = static_cast<int>(width);
+    image.height = static_cast<int>(height);
+    image.pixels.assign(static_cast<size_t>(width) * static_cast<size_t>(height), Color(0, 0, 0));
+    std::vector<uint8_t> block;
+    for (size_t b = 0; b < blocks; ++b) {
+        const uint64_t offset = read_le32(&file[pos + 8 * b]) | (uint64_t{read_le32(&file[pos + 8 * b + 4])} << 32);
+        if (offset > file.size() || file.size() - offset < 8) {
+            throw fail("Corrupt OpenEXR offset table");
+        }
+        const int64_t y0 = static_cast<int32_t>(read_le32(&file[offset])) - int64_t{window[1]};
+        const size_t size = read_le32(&file[offset + 4]);
+        if (y0 < 0 || y0 >= height || y0 % lines != 0 || size > file.size() - offset - 8) {
+            throw fail("Corrupt OpenEXR scanline block");
+        }
+        const int rows = static_cast<int>(std::min<int64_t>(lines, height - y0));
+        const size_t raw_bytes = static_cast<size_t>(rows) * row_bytes;
+        const uint8_t* data = &file[offset + 8];
+        // Blocks that do not shrink are stored as they are.
+        if (compression == 0 || size == raw_bytes) {
+            block.assign(data, data + size);
+        } else {
+            block = deflate_detail::zlib_decompress(data, size, raw_bytes);
+            exr_unpredict(block);
+        }
+        if (block.size() != raw_bytes) {
+            throw fail("Corrupt OpenEXR scanline block");
+        }
+        for (int r = 0; r < rows; ++r) {
+            const uint8_t* row = &block[static_cast<size_t>(r) * row_bytes];
+            Color* out = &image.pixels[static_cast<size_t>(y0 + r) * static_cast<size_t>(width)];
+            for (int64_t x = 0; x < width; ++x) {
+                double value[3];
+                for (int c = 0; c < 3; ++c) {
+                    const size_t bytes = rgb[c]->type == 1 ? 2 : 4;
+                    value[c] = exr_sample(row + rgb[c]->offset + static_cast<size_t>(x) * bytes, rgb[c]->type);
+                }
+                out[x] = Color(value[0], value[1], value[2]);
+            }
+        }
+    }
+    return image;
+}
+
+inline HdrImage load_hdr_image(const std::string& path) {
+    const size_t dot_position = path.find_last_of('.');
+    std::string extension = dot_position == std::string::npos ? std::string() : path.substr(dot_position + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    if (extension == "pfm") {
+        return load_pfm(path);
+    }
+    if (extension == "hdr" || extension == "pic") {
+        return load_rgbe(path);
+    }
+    if (extension == "exr") {
+        return load_exr(path);
+    }
+    throw std::runtime_error("Unknown HDR image type: " + path);
+}
+
+#endif // RAYTRACER_ENVIRONMENT_H
@@ -0,0 +1,303 @@
+#ifndef RAYTRACER_FILM_RESOLVE_H
+#define RAYTRACER_FILM_RESOLVE_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define RAYTRACER_FILM_SSE2 1
+#endif
+
+#include "raytracer/RayTracer.h"
+
+// Film resolve: linear radiance to display pixels.
+//
+// Every path that shows or saves an 8-bit image goes through one kernel:
+// exposure (a power of two), a tonemapper, the transfer function and
+// quantisation, run on planar float rows. The kernel is written once
+// against a small lane type, four floats of SSE2 on x86 and one float
+// elsewhere, so the row tail and other targets run the same arithmetic.
+//
+//  - Tonemaps: Clamp (the historic look), Reinhard (x / (1 + x)) and ACES
+//    (Narkowicz's fit of the ACES filmic curve).
+//  - Transfers: Gamma2 (sqrt, what the viewport and the GPU shaders have
+//    always shown) and Srgb (the sRGB OETF, its power curve approximated
+//    from square roots to a quarter of an 8-bit code).
+//  - Quantisation is 256 * min(v, 0.999) truncated, as before.
+//
+// resolve is only called where pixels leave the renderer (tiles emitted to
+// the viewport, a finished frame, PNG export), never inside the sample
+// loop, so its cost scales with what is displayed rather than with passes.
+
+enum class Tonemap { Clamp, Reinhard, Aces };
+
+enum class DisplayTransfer { Gamma2, Srgb };
+
+struct DisplaySettings {
+    Tonemap tonemap = Tonemap::Clamp;
+    float exposure = 0.0f;  // stops
+    DisplayTransfer transfer = DisplayTransfer::Gamma2;
+};
+
+const char* tonemap_name(Tonemap tonemap);
+// Tonemap for a name ("clamp", "reinhard", "aces"); throws
+// std::invalid_argument for anything else.
+Tonemap tonemap_from_name(const std::string& name);
+
+// Reference for one linear component, in [0, 1]; std::pow, no lanes.
+float display_value(float linear, const DisplaySettings& settings);
+
+// `count` pixels from planar r, g, b floats to 0xAARRGGBB with alpha 255.
+void resolve_argb(const float* r, const float* g, const float* b, size_t count, uint32_t* out,
+                  const DisplaySettings& settings = DisplaySettings());
+// The same to interleaved 8-bit RGB.
+void resolve_rgb8(const float* r, const float* g, const float* b, size_t count, unsigned char* out,
+                  const DisplaySettings& settings = DisplaySettings());
+// `count` Colors to 0xAARRGGBB, through the planar kernel in small blocks.
+void resolve_argb(const Color* colors, size_t count, uint32_t* out,
+                  const DisplaySettings& settings = DisplaySettings());
+// One Color to 0xAARRGGBB.
+uint32_t resolve_pixel(const Color& color, const DisplaySettings& settings = DisplaySettings());
+
+namespace film_detail {
+
+#ifdef RAYTRACER_FILM_SSE2
+struct Lanes {
+    static constexpr int kWidth = 4;
+    __m128 v;
+
+    static Lanes load(const float* p) { return {_mm_loadu_ps(p)}; }
+    static Lanes splat(float x) { return {_mm_set1_ps(x)}; }
+    friend Lanes operator+(Lanes a, Lanes b) { return {_mm_add_ps(a.v, b.v)}; }
+    friend Lanes operator-(Lanes a, Lanes b) { return {_mm_sub_ps(a.v, b.v)}; }
+    friend Lanes operator*(Lanes a, Lanes b) { return {_mm_mul_ps(a.v, b.v)}; }
+    friend Lanes operator/(Lanes a, Lanes b) { return {_mm_div_ps(a.v, b.v)}; }
+    // NaN in `a` gives `b`.
+    friend Lanes max(Lanes a, Lanes b) { return {_mm_max_ps(a.v, b.v)}; }
+    friend Lanes min(Lanes a, Lanes b) { return {_mm_min_ps(a.v, b.v)}; }
+    friend Lanes sqrt(Lanes a) { return {_mm_sqrt_ps(a.v)}; }
+    // a < b ? x : y per lane.
+    static Lanes select_less(Lanes a, Lanes b, Lanes x, Lanes y) {
+        const __m128 mask = _mm_cmplt_ps(a.v, b.v);
+        return {_mm_or_ps(_mm_and_ps(mask, x.v), _mm_andnot_ps(mask, y.v))};
+    }
+    // Truncated codes in [0, 256) to 32-bit integers.
+    void store_codes(uint32_t* out) const { _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_cvttps_epi32(v)); }
+    static void store_argb(Lanes r, Lanes g, Lanes b, uint32_t* out) {
+        __m128i pixel = _mm_or_si128(_mm_set1_epi32(static_cast<int>(0xff000000u)), _mm_cvttps_epi32(b.v));
+        pixel = _mm_or_si128(pixel, _mm_slli_epi32(_mm_cvttps_epi32(g.v), 8));
+        pixel = _mm_or_si128(pixel, _mm_slli_epi32(_mm_cvttps_epi32(r.v), 16));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), pixel);
+    }
+};
+#endif
+
+struct ScalarLane {
+    static constexpr int kWidth = 1;
+    float v;
+
+    static ScalarLane load(const float* p) { return {*p}; }
+    static ScalarLane splat(float x) { return {x}; }
+    friend ScalarLane operator+(ScalarLane a, ScalarLane b) { return {a.v + b.v}; }
+    friend ScalarLane operator-(ScalarLane a, ScalarLane b) { return {a.v - b.v}; }
+    friend ScalarLane operator*(ScalarLane a, ScalarLane b) { return {a.v * b.v}; }
+    friend ScalarLane operator/(ScalarLane a, ScalarLane b) { return {a.v / b.v}; }
+    friend ScalarLane max(ScalarLane a, ScalarLane b) { return {a.v > b.v ? a.v : b.v}; }
+    friend ScalarLane min(ScalarLane a, ScalarLane b) { return {a.v < b.v ? a.v : b.v}; }
+    friend ScalarLane sqrt(ScalarLane a) { return {std::sqrt(a.v)}; }
+    static ScalarLane select_less(ScalarLane a, ScalarLane b, ScalarLane x, ScalarLane y) {
+        return a.v < b.v ? x : y;
+    }
+    void store_codes(uint32_t* out) const { *out = static_cast<uint32_t>(static_cast<int>(v)); }
+    static void store_argb(ScalarLane r, ScalarLane g, ScalarLane b, uint32_t* out) {
+        *out = 0xff000000u | (static_cast<uint32_t>(static_cast<int>(r.v)) << 16) |
+               (static_cast<uint32_t>(static_cast<int>(g.v)) << 8) | static_cast<uint32_t>(static_cast<int>(b.v));
+    }
+};
+
+#ifdef RAYTRACER_FILM_SSE2
+using WideLanes = Lanes;
+#else
+using WideLanes = ScalarLane;
+#endif
+
+// Below this the sRGB curve is linear.
+constexpr float kSrgbKnee = 0.0031308f;
+
+// 1.055 x^(1/2.4) - 0.055 on [kSrgbKnee, 1] as a blend of x^(1/2),
+// x^(1/4), x^(1/8) and x, within 1e-3 of the curve (a quarter of an 8-bit
+// code) at a third of the cost of a log2/exp2 pair.
+template <typename L>
+L srgb_curve(L x) {
+    const L s1 = sqrt(x);
+    const L s2 = sqrt(s1);
+    const L s3 = sqrt(s2);
+    return L::splat(0.662002687f) * s1 + L::splat(0.684122060f) * s2 - L::splat(0.323583601f) * s3 -
+           L::splat(0.0225411470f) * x;
+}
+
+// One linear component to the display value scaled to [0, 255.744]. The
+// tonemap and transfer are template arguments so the row loop is free of
+// branches.
+template <typename L, Tonemap kTonemap, DisplayTransfer kTransfer>
+L resolve_lane(L x, L scale) {
+    const L zero = L::splat(0.0f);
+    const L one = L::splat(1.0f);
+    x = max(x * scale, zero);
+    if (kTonemap == Tonemap::Reinhard) {
+        x = x / (one + x);
+    } else if (kTonemap == Tonemap::Aces) {
+        x = (x * (L::splat(2.51f) * x + L::splat(0.03f))) / (x * (L::splat(2.43f) * x + L::splat(0.59f)) + L::splat(0.14f));
+    }
+    x = min(x, one);
+    if (kTransfer == DisplayTransfer::Gamma2) {
+        x = sqrt(x);
+    } else {
+        const L knee = L::splat(kSrgbKnee);
+        x = L::select_less(x, knee, x * L::splat(12.92f), srgb_curve(max(x, knee)));
+    }
+    return L::splat(256.0f) * min(x, L::splat(0.999f));
+}
+
+// Resolves whole lanes of pixels from `begin` and returns where it stopped;
+// `store(r, g, b, i)` writes the codes of pixels [i, i + L::kWidth).
+template <typename L, Tonemap kTonemap, DisplayTransfer kTransfer, typename Store>
+size_t resolve_range(const float* r, const float* g, const float* b, size_t begin, size_t end, float scale,
+                     Store store) {
+    const L gain = L::splat(scale);
+    size_t i = begin;
+    for (; i + L::kWidth <= end; i += L::kWidth) {
+        store(resolve_lane<L, kTonemap, kTransfer>(L::load(r + i), gain),
+              resolve_lane<L, kTonemap, kTransfer>(L::load(g + i), gain),
+              resolve_lane<L, kTonemap, kTransfer>(L::load(b + i), gain), i);
+    }
+    return i;
+}
+
+// The wide lanes, then the scalar tail; `store` is called with both types.
+template <Tonemap kTonemap, DisplayTransfer kTransfer, typename Store>
+void resolve(const float* r, const float* g, const float* b, size_t count, float scale, Store store) {
+    const size_t tail = resolve_range<WideLanes, kTonemap, kTransfer>(r, g, b, 0, count, scale, store);
+    resolve_range<ScalarLane, kTonemap, kTransfer>(r, g, b, tail, count, scale, store);
+}
+
+template <Tonemap kTonemap, typename Store>
+void resolve(const float* r, const float* g, const float* b, size_t count, const DisplaySettings& settings,
+             float scale, Store store) {
+    if (settings.transfer == DisplayTransfer::Srgb) {
+        resolve<kTonemap, DisplayTransfer::Srgb>(r, g, b, count, scale, store);
+    } else {
+        resolve<kTonemap, DisplayTransfer::Gamma2>(r, g, b, count, scale, store);
+    }
+}
+
+template <typename Store>
+void resolve(const float* r, const float* g, const float* b, size_t count, const DisplaySettings& settings,
+             Store store) {
+    const float scale = std::exp2(settings.exposure);
+    switch (settings.tonemap) {
+    case Tonemap::Clamp:
+        resolve<Tonemap::Clamp>(r, g, b, count, settings, scale, store);
+        break;
+    case Tonemap::Reinhard:
+        resolve<Tonemap::Reinhard>(r, g, b, count, settings, scale, store);
+        break;
+    case Tonemap::Aces:
+        resolve<Tonemap::Aces>(r, g, b, count, settings, scale, store);
+        break;
+    }
+}
+
+}
+
+inline const char* tonemap_name(Tonemap tonemap) {
+    switch (tonemap) {
+    case Tonemap::Clamp:
+        return "clamp";
+    case Tonemap::Reinhard:
+        return "reinhard";
+    case Tonemap::Aces:
+        return "aces";
+    }
+    return "unknown";
+}
+
+inline Tonemap tonemap_from_name(const std::string& name) {
+    for (Tonemap tonemap : {Tonemap::Clamp, Tonemap::Reinhard, Tonemap::Aces}) {
+        if (name == tonemap_name(tonemap)) {
+            return tonemap;
+        }
+    }
+    throw std::invalid_argument("Unknown tonemap: " + name);
+}
+
+inline float display_value(float linear, const DisplaySettings& settings) {
+    float x = linear * std::exp2(settings.exposure);
+    x = x > 0.0f ? x : 0.0f;
+    switch (settings.tonemap) {
+    case Tonemap::Clamp:
+        break;
+    case Tonemap::Reinhard:
+        x = x / (1.0f + x);
+        break;
+    case Tonemap::Aces:
+        x = (x * (2.51f * x + 0.03f)) / (x * (2.43f * x + 0.59f) + 0.14f);
+        break;
+    }
+    x = std::min(x, 1.0f);
+    if (settings.transfer == DisplayTransfer::Gamma2) {
+        return std::sqrt(x);
+    }
+    return x < film_detail::kSrgbKnee ? 12.92f * x : 1.055f * std::pow(x, 1.0f / 2.4f) - 0.055f;
+}
+
+inline void resolve_argb(const float* r, const float* g, const float* b, size_t count, uint32_t* out,
+                         const DisplaySettings& settings) {
+    film_detail::resolve(r, g, b, count, settings, [out](auto red, auto green, auto blue, size_t i) {
+        decltype(red)::store_argb(red, green, blue, out + i);
+    });
+}
+
+inline void resolve_rgb8(const float* r, const float* g, const float* b, size_t count, unsigned char* out,
+                         const DisplaySettings& settings) {
+    film_detail::resolve(r, g, b, count, settings, [out](auto red, auto green, auto blue, size_t i) {
+        constexpr int kWidth = decltype(red)::kWidth;
+        uint32_t codes[3][kWidth];
+        red.store_codes(codes[0]);
+        green.store_codes(codes[1]);
+        blue.store_codes(codes[2]);
+        for (int k = 0; k < kWidth; ++k) {
+            for (int c = 0; c < 3; ++c) {
+                out[3 * (i + k) + c] = static_cast<unsigned char>(codes[c][k]);
+            }
+        }
+    });
+}
+
+inline void resolve_argb(const Color* colors, size_t count, uint32_t* out, const DisplaySettings& settings) {
+    constexpr size_t kBlock = 64;
+    float r[kBlock];
+    float g[kBlock];
+    float b[kBlock];
+    for (size_t begin = 0; begin < count; begin += kBlock) {
+        const size_t n = std::min(kBlock, count - begin);
+        for (size_t i = 0; i < n; ++i) {
+            r[i] = static_cast<float>(colors[begin + i].x());
+            g[i] = static_cast<float>(colors[begin + i].y());
+            b[i] = static_cast<float>(colors[begin + i].z());
+        }
+        resolve_argb(r, g, b, n, out + begin, settings);
+    }
+}
+
+inline uint32_t resolve_pixel(const Color& color, const DisplaySettings& settings) {
+    uint32_t pixel = 0;
+    resolve_argb(&color, 1, &pixel, settings);
+    return pixel;
+}
+
+#endif // RAYTRACER_FILM_RESOLVE_H
@@ -0,0 +1,754 @@
+#ifndef RAYTRACER_IMAGE_EXPORT_H
+#define RAYTRACER_IMAGE_EXPORT_H
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cctype>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <initializer_list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "raytracer/Aov.h"
+#include "raytracer/Deflate.h"
+#include "raytracer/FilmResolve.h"
+#include "raytracer/ThreadPool.h"
+
+// Image export off the render thread.
+//
+// An ImageExporter owns the output file and an encoder thread. Producers
+// hand it finished regions of the frame (tiles, bands or the whole image)
+// in the planar layout of TiledImage.h: R, G, B, then the AOV components.
+// Regions are gathered into bands of 16 rows, and every band that is
+// complete is encoded and written in order while rendering goes on, so the
+// file is done shortly after the last region arrives. A region starting
+// max_pending_bands or more bands past the next one to be written waits
+// for the encoder, so memory is bounded by that window plus the regions in
+// flight.
+//
+// Formats, by extension:
+//  - .png: 8-bit RGB beauty through the film resolve of FilmResolve.h
+//    (ExportOptions::display, by default the viewport's look), Sub-filtered
+//    rows.
+//    Every band is deflated on its own and ends in a sync flush, so runs of
+//    ready bands compress in parallel and still form one zlib stream.
+//  - .pfm: float RGB beauty. The format stores rows bottom to top, so each
+//    row is written at its offset.
+//  - .exr: scanline OpenEXR with every plane as a FLOAT channel, stored
+//    uncompressed or ZIP (16-line zlib blocks after the format's byte
+//    predictor), blocks compressed in parallel like PNG bands.
+//
+// The deflate encoder is the small fixed-Huffman one of Deflate.h, so the
+// library stays free of dependencies.
+
+enum class ImageFormat { Png, Pfm, Exr };
+
+enum class ExrCompression { None, Zip };
+
+struct ExportResult {
+    std::string error;     // empty on success
+    size_t bytes = 0;      // file size
+    double tail_ms = 0.0;  // from the last submit() (or close()) to the finished file
+};
+
+struct ExportOptions {
+    ExrCompression exr_compression = ExrCompression::Zip;
+    // Tonemap, exposure and transfer for PNG; float formats stay linear.
+    DisplaySettings display;
+    // Bands of 16 rows buffered past the next one to be written.
+    int max_pending_bands = 16;
+    // Called on the encoder thread once the file is complete.
+    std::function<void(const ExportResult&)> on_done;
+};
+
+// Format for the extension of `path` (.png, .pfm, .exr, any case); throws
+// std::invalid_argument for anything else.
+ImageFormat image_format(const std::string& path);
+
+class ImageExporter {
+public:
+    // Creates `path` for a width x height frame carrying the planes of
+    // `aovs` besides RGB (PNG and PFM write RGB only). Throws
+    // std::invalid_argument or std::runtime_error.
+    ImageExporter(const std::string& path, int width, int height, const AovSet& aovs = AovSet(),
+                  const ExportOptions& options = ExportOptions());
+    ~ImageExporter();
+    ImageExporter(const ImageExporter&) = delete;
+    ImageExporter& operator=(const ImageExporter&) = delete;
+
+    int width() const { return image_width; }
+    int height() const { return image_height; }
+    // Planes submit() expects: 3 plus the AOV components.
+    int planes() const { return plane_count; }
+
+    // Copies the region [x0, x1) x [y0, y1); plane p of pixel (x, y) is at
+    // data[p * plane_stride + (y - y0) * row_stride + (x - x0)]. Every pixel
+    // is submitted once. Thread safe; blocks while the region starts
+    // max_pending_bands or more bands past the next one to be written.
+    void submit(int x0, int y0, int x1, int y1, const float* data, size_t row_stride, size_t plane_stride);
+    // submit() for callers that must not block: returns false without
+    // copying anything when the region starts past that window.
+    bool try_submit(int x0, int y0, int x1, int y1, const float* data, size_t row_stride, size_t plane_stride);
+    // No more regions; pixels never submitted are written as zeros.
+    // Returns at once.
+    void close();
+    // close(), then blocks until the file is complete. Throws
+    // std::runtime_error with the first encoding or write error.
+    ExportResult wait();
+
+private:
+    struct Band {
+        std::vector<float> planes;  // plane-major, 16 rows of `width`
+        size_t filled = 0;
+    };
+
+    int band_rows(int band) const { return std::min(16, image_height - 16 * band); }
+    std::unique_ptr<Band> make_band() const;
+    bool band_complete(int band) const;
+    bool place(int x0, int y0, int x1, int y1, const float* data, size_t row_stride, size_t plane_stride,
+               bool block);
+    void run();
+    void write_header();
+    void write_bands(int begin, int end);
+    void write_trailer();
+
+    std::string file_path;
+    ImageFormat format;
+    int image_width;
+    int image_height;
+    int plane_count;
+    ExportOptions settings;
+    std::vector<std::string> channel_names;
+
+    std::ofstream file;
+    // PNG: running Adler-32 of the raw scanlines.
+    uint32_t adler = 1;
+    // EXR: where the offset table and each chunk start.
+    std::streamoff table_offset = 0;
+    std::vector<uint64_t> chunk_offsets;
+
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::condition_variable space;
+    std::vector<std::unique_ptr<Band>> bands;
+    int next_band = 0;
+    bool closing = false;
+    bool submitted = false;
+    std::chrono::steady_clock::time_point last_submit;
+    ExportResult result;
+    std::thread thread;
+};
+
+// Feeds an ImageExporter from a thread that must never wait on the export
+// window, such as RenderCoordinator's receive loop, which alone could
+// deliver the earlier tiles the window is waiting for. Regions past the
+// window are copied and held, then passed on as the window reaches them.
+// Thread safe.
+class DeferredExport {
+public:
+    explicit DeferredExport(ImageExporter& exporter) : target(exporter) {}
+
+    // As ImageExporter::submit(), without blocking.
+    void submit(int x0, int y0, int x1, int y1, const float* data, size_t row_stride, size_t plane_stride);
+    // Passes on every held region, blocking as submit() does; call once no
+    // more regions will come.
+    void flush();
+
+    // Most float bytes held at once.
+    size_t peak_bytes() const;
+
+private:
+    struct Region {
+        int x0, x1, y1;
+        std::vector<float> planes;  // compact: rows of x1 - x0
+    };
+
+    // Under the lock: passes on held regions in row order until one does
+    // not fit the window.
+    void drain();
+
+    ImageExporter& target;
+    mutable std::mutex mutex;
+    std::multimap<int, Region> held;  // by first row
+    size_t held_bytes = 0;
+    size_t peak = 0;
+};
+
+namespace export_detail {
+
+constexpr int kBandRows = 16;
+
+inline uint32_t crc32(uint32_t crc, const unsigned char* data, size_t count) {
+    static const std::array<uint32_t, 256> table = [] {
+        std::array<uint32_t, 256> entries{};
+        for (uint32_t n = 0; n < 256; ++n) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            }
+            entries[n] = c;
+        }
+        return entries;
+    }();
+    crc = ~crc;
+    for (size_t i = 0; i < count; ++i) {
+        crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+inline void append_be32(std::vector<unsigned char>& out, uint32_t value) {
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        out.push_back(static_cast<unsigned char>(value >> shift));
+    }
+}
+
+inline void append_le32(std::vector<unsigned char>& out, uint32_t value) {
+    for (int shift = 0; shift < 32; shift += 8) {
+        out.push_back(static_cast<unsigned char>(value >> shift));
+    }
+}
+
+// Plane names in plane order: R, G, B, then `<aov>` for one-component AOVs
+// and `<aov>.X/Y/Z` (normal) or `<aov>.R/G/B` (albedo).
+inline std::vector<std::string> plane_names(const AovSet& aovs) {
+    std::vector<std::string> names = {"R", "G", "B"};
+    for (int i = 0; i < kAovChannelCount; ++i) {
+        const AovChannel channel = static_cast<AovChannel>(i);
+        if (!aovs.contains(channel)) {
+            continue;
+        }
+        if (aov_components(channel) == 1) {
+            names.push_back(aov_name(channel));
+            continue;
+        }
+        const char* suffixes = channel == AovChannel::Normal ? "XYZ" : "RGB";
+        for (int c = 0; c < 3; ++c) {
+            names.push_back(std::string(aov_name(channel)) + "." + suffixes[c]);
+        }
+    }
+    return names;
+}
+
+}
+
+inline ImageFormat image_format(const std::string& path) {
+    const size_t dot = path.find_last_of('.');
+    std::string extension = dot == std::string::npos ? std::string() : path.substr(dot + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    if (extension == "png") {
+        return ImageFormat::Png;
+    }
+    if (extension == "pfm") {
+        return ImageFormat::Pfm;
+    }
+    if (extension == "exr") {
+        return ImageFormat::Exr;
+    }
+    throw std::invalid_argument("Unknown image format (use .png, .pfm or .exr): " + path);
+}
+
+inline ImageExporter::ImageExporter(const std::string& path, int width, int height, const AovSet& aovs,
+                                    const ExportOptions& options)
+    : file_path(path),
+      format(image_format(path)),
+      image_width(width),
+      image_height(height),
+      settings(options),
+      channel_names(export_detail::plane_names(aovs)) {
+    if (width <= 0 || height <= 0) {
+        throw std::invalid_argument("ImageExporter requires a positive size.");
+    }
+    if (format != ImageFormat::Png && !environment_detail::host_is_little_endian()) {
+        throw std::runtime_error("Float image export requires a little-endian host.");
+    }
+    plane_count = static_cast<int>(channel_names.size());
+    settings.max_pending_bands = std::max(1, settings.max_pending_bands);
+    bands.resize(static_cast<size_t>((height + export_detail::kBandRows - 1) / export_detail::kBandRows));
+    file.open(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        throw std::runtime_error("Cannot create image file: " + path);
+    }
+    write_header();
+    thread = std::thread([this]() { run(); });
+}
+
+inline ImageExporter::~ImageExporter() {
+    close();
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+inline std::unique_ptr<ImageExporter::Band> ImageExporter::make_band() const {
+    auto band = std::make_unique<Band>();
+    band->planes.assign(static_cast<size_t>(plane_count) * export_detail::kBandRows * image_width, 0.0f);
+    return band;
+}
+
+inline bool ImageExporter::band_complete(int band) const {
+    return bands[band] && bands[band]->filled == static_cast<size_t>(image_width) * band_rows(band);
+}
+
+inline void ImageExporter::submit(int x0, int y0, int x1, int y1, const float* data, size_t row_stride,
+                                  size_t plane_stride) {
+    place(x0, y0, x1, y1, data, row_stride, plane_stride, true);
+}
+
+inline bool ImageExporter::try_submit(int x0, int y0, int x1, int y1, const float* data, size_t row_stride,
+                                      size_t plane_stride) {
+    return place(x0, y0, x1, y1, data, row_stride, plane_stride, false);
+}
+
+inline bool ImageExporter::place(int x0, int y0, int x1, int y1, const float* data, size_t row_stride,
+                                 size_t plane_stride, bool block) {
+    using namespace export_detail;
+    if (x0 < 0 || y0 < 0 || x1 > image_width || y1 > image_height) {
+        throw std::invalid_argument("Region outside the exported image.");
+    }
+    if (x0 >= x1 || y0 >= y1) {
+        return true;
+    }
+    const int first = y0 / kBandRows;
+    const int last = (y1 - 1) / kBandRows;
+    std::vector<Band*> targets;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        const auto admitted = [&] {
+            return first < next_band + settings.max_pending_bands || !result.error.empty() || closing;
+        };
+        if (!block && !admitted()) {
+            return false;
+        }
+        space.wait(lock, admitted);
+        if (!result.error.empty() || closing) {
+            return true;
+        }
+        for (int band = first; band <= last; ++band) {
+            if (!bands[band]) {
+                bands[band] = make_band();
+            }
+            targets.push_back(bands[band].get());
+        }
+    }
+
+    // Bands are only read by the encoder once complete, so the copy runs
+    // without the lock.
+    const size_t band_plane = static_cast<size_t>(kBandRows) * image_width;
+    for (int y = y0; y < y1; ++y) {
+        Band& band = *targets[y / kBandRows - first];
+        for (int p = 0; p < plane_count; ++p) {
+            const float* source = data + p * plane_stride + (y - y0) * row_stride;
+            float* target = band.planes.data() + p * band_plane + static_cast<size_t>(y % kBandRows) * image_width + x0;
+            std::copy(source, source + (x1 - x0), target);
+        }
+    }
+
+    bool completed = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        submitted = true;
+        last_submit = std::chrono::steady_clock::now();
+        for (int band = first; band <= last; ++band) {
+            const int rows = std::min(y1, (band + 1) * kBandRows) - std::max(y0, band * kBandRows);
+            targets[band - first]->filled += static_cast<size_t>(x1 - x0) * rows;
+            completed = completed || band_complete(band);
+        }
+    }
+    if (completed) {
+        ready.notify_one();
+    }
+    return true;
+}
+
+inline void DeferredExport::submit(int x0, int y0, int x1, int y1, const float* data, size_t row_stride,
+                                   size_t plane_stride) {
+    std::lock_guard<std::mutex> lock(mutex);
+    drain();
+    if ((held.empty() || y0 < held.begin()->first) &&
+        target.try_submit(x0, y0, x1, y1, data, row_stride, plane_stride)) {
+        return;
+    }
+    if (x0 < 0 || y0 < 0 || x1 > target.width() || y1 > target.height()) {
+        throw std::invalid_argument("Region outside the exported image.");
+    }
+    if (x0 >= x1 || y0 >= y1) {
+        return;
+    }
+    const size_t width = static_cast<size_t>(x1 - x0);
+    const size_t area = width * static_cast<size_t>(y1 - y0);
+    Region region{x0, x1, y1, std::vector<float>(area * target.planes())};
+    for (int p = 0; p < target.planes(); ++p) {
+        for (int y = y0; y < y1; ++y) {
+            const float* source = data + p * plane_stride + (y - y0) * row_stride;
+            std::copy(source, source + width, region.planes.begin() + p * area + (y - y0) * width);
+        }
+    }
+    held_bytes += region.planes.size() * sizeof(float);
+    peak = std::max(peak, held_bytes);
+    held.emplace(y0, std::move(region));
+}
+
+inline void DeferredExport::drain() {
+    while (!held.empty()) {
+        const auto first = held.begin();
+        const Region& region = first->second;
+        const size_t width = static_cast<size_t>(region.x1 - region.x0);
+        if (!target.try_submit(region.x0, first->first, region.x1, region.y1, region.planes.data(), width,
+                               width * (region.y1 - first->first))) {
+            return;
+        }
+        held_bytes -= region.planes.size() * sizeof(float);
+        held.erase(first);
+    }
+}
+
+inline void DeferredExport::flush() {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto& entry : held) {
+        const Region& region = entry.second;
+        const size_t width = static_cast<size_t>(region.x1 - region.x0);
+        target.submit(region.x0, entry.first, region.x1, region.y1, region.planes.data(), width,
+                      width * (region.y1 - entry.first));
+    }
+    held.clear();
+    held_bytes = 0;
+}
+
+inline size_t DeferredExport::peak_bytes() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return peak;
+}
+
+inline void ImageExporter::close() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!closing && !submitted) {
+            last_submit = std::chrono::steady_clock::now();
+        }
+        closing = true;
+    }
+    ready.notify_one();
+    space.notify_all();
+}
+
+inline ExportResult ImageExporter::wait() {
+    close();
+    if (thread.joinable()) {
+        thread.join();
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!result.error.empty()) {
+        throw std::runtime_error(result.error);
+    }
+    return result;
+}
+
+inline void ImageExporter::run() {
+    const int band_count = static_cast<int>(bands.size());
+    // Enough ready bands per batch to keep the pool busy.
+    const int batch = std::max(1, 2 * static_cast<int>(ThreadPool::global().size()));
+    try {
+        for (;;) {
+            int begin = 0;
+            int end = 0;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                ready.wait(lock, [&] { return next_band == band_count || band_complete(next_band) || closing; });
+                if (next_band == band_count) {
+                    break;
+                }
+                begin = next_band;
+                end = begin;
+                while (end < band_count && end < begin + batch && (closing || band_complete(end))) {
+                    if (!bands[end]) {
+                        bands[end] = make_band();
+                    }
+                    ++end;
+                }
+            }
+            write_bands(begin, end);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                for (int band = begin; band < end; ++band) {
+                    bands[band].reset();
+                }
+                next_band = end;
+            }
+            space.notify_all();
+        }
+        write_trailer();
+        file.seekp(0, std::ios::end);
+        const std::streamoff size = file.tellp();
+        file.close();
+        if (!file) {
+            throw std::runtime_error("Cannot write image file: " + file_path);
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        result.bytes = static_cast<size_t>(size);
+        result.tail_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - last_submit).count();
+    } catch (const std::exception& error) {
+        std::lock_guard<std::mutex> lock(mutex);
+        result.error = error.what();
+        next_band = band_count;
+    }
+    space.notify_all();
+    if (settings.on_done) {
+        ExportResult done;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            done = result;
+        }
+        settings.on_done(done);
+    }
+}
+
+inline void ImageExporter::write_header() {
+    using namespace export_detail;
+    std::vector<unsigned char> out;
+    if (format == ImageFormat::Png) {
+        const unsigned char signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+        out.insert(out.end(), signature, signature + 8);
+        std::vector<unsigned char> chunk = {'I', 'H', 'D', 'R'};
+        append_be32(chunk, static_cast<uint32_t>(image_width));
+        append_be32(chunk, static_cast<uint32_t>(image_height));
+        const unsigned char rgb8[5] = {8, 2, 0, 0, 0};
+        chunk.insert(chunk.end(), rgb8, rgb8 + 5);
+        append_be32(out, static_cast<uint32_t>(chunk.size() - 4));
+        out.insert(out.end(), chunk.begin(), chunk.end());
+        append_be32(out, crc32(0, chunk.data(), chunk.size()));
+    } else if (format == ImageFormat::Pfm) {
+        // Negative scale: little-endian samples.
+        const std::string header = "PF\n" + std::to_string(image_width) + " " + std::to_string(image_height) + "\n-1.0\n";
+        out.assign(header.begin(), header.end());
+    } else {
+        const auto append_string = [&](const std::string& text) { out.insert(out.end(), text.c_str(), text.c_str() + text.size() + 1); };
+        const auto attribute = [&](const char* name, const char* type, const std::vector<unsigned char>& value) {
+            append_string(name);
+            append_string(type);
+            append_le32(out, static_cast<uint32_t>(value.size()));
+            out.insert(out.end(), value.begin(), value.end());
+        };
+        const auto le32 = [](std::initializer_list<uint32_t> values) {
+            std::vector<unsigned char> bytes;
+            for (uint32_t value : values) {
+                append_le32(bytes, value);
+            }
+            return bytes;
+        };
+        const auto float_bits = [](float value) {
+            uint32_t bits = 0;
+            std::memcpy(&bits, &value, sizeof(bits));
+            return bits;
+        };
+        out = {0x76, 0x2f, 0x31, 0x01, 2, 0, 0, 0};
+
+        // Channels are listed, and stored, in name order.
+        std::vector<std::string> sorted = channel_names;
+        std::sort(sorted.begin(), sorted.end());
+        std::vector<unsigned char> channels;
+        for (const std::string& name : sorted) {
+            channels.insert(channels.end(), name.c_str(), name.c_str() + name.size() + 1);
+            const std::vector<unsigned char> layout = le32({2, 0, 1, 1});  // FLOAT, linear 0 + reserved, sampling
+            channels.insert(channels.end(), layout.begin(), layout.end());
+        }
+        channels.push_back(0);
+        attribute("channels", "chlist", channels);
+        attribute("compression", "compression",
+                  {static_cast<unsigned char>(settings.exr_compression == ExrCompression::Zip ? 3 : 0)});
+        const uint32_t x_max = static_cast<uint32_t>(image_width - 1);
+        const uint32_t y_max = static_cast<uint32_t>(image_height - 1);
+        attribute("dataWindow", "box2i", le32({0, 0, x_max, y_max}));
+        attribute("displayWindow", "box2i", le32({0, 0, x_max, y_max}));
+        attribute("lineOrder", "lineOrder", {0});
+        attribute("pixelAspectRatio", "float", le32({float_bits(1.0f)}));
+        attribute("screenWindowCenter", "v2f", le32({float_bits(0.0f), float_bits(0.0f)}));
+        attribute("screenWindowWidth", "float", le32({float_bits(1.0f)}));
+        out.push_back(0);
+
+        const int lines = settings.exr_compression == ExrCompression::Zip ? kBandRows : 1;
+        chunk_offsets.assign(static_cast<size_t>((image_height + lines - 1) / lines), 0);
+        table_offset = static_cast<std::streamoff>(out.size());
+        out.resize(out.size() + chunk_offsets.size() * sizeof(uint64_t), 0);
+    }
+    file.write(reinterpret_cast<const char*>(out.data()), static_cast<std::streamsize>(out.size()));
+    if (format == ImageFormat::Pfm) {
+        // Size the file so rows can be written at their offsets.
+        const std::streamoff end = static_cast<std::streamoff>(out.size()) +
+                                   static_cast<std::streamoff>(image_width) * image_height * 3 * sizeof(float);
+        table_offset = static_cast<std::streamoff>(out.size());
+        file.seekp(end - 1);
+        file.put('\0');
+    }
+    if (!file) {
+        throw std::runtime_error("Cannot write image file: " + file_path);
+    }
+}
+
+inline void ImageExporter::write_bands(int begin, int end) {
+    using namespace deflate_detail;
+    using namespace export_detail;
+    const size_t width = static_cast<size_t>(image_width);
+    const size_t band_plane = kBandRows * width;
+    const auto write = [&](const std::vector<unsigned char>& bytes) {
+        file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    };
+
+    if (format == ImageFormat::Pfm) {
+        std::vector<float> row(3 * width);
+        for (int band = begin; band < end; ++band) {
+            const float* planes = bands[band]->planes.data();
+            for (int r = 0; r < band_rows(band); ++r) {
+                for (size_t x = 0; x < width; ++x) {
+                    for (int c = 0; c < 3; ++c) {
+                        row[3 * x + c] = planes[c * band_plane + r * width + x];
+                    }
+                }
+                const int y = band * kBandRows + r;
+                file.seekp(table_offset + static_cast<std::streamoff>(image_height - 1 - y) * row.size() * sizeof(float));
+                file.write(reinterpret_cast<const char*>(row.data()), static_cast<std::streamsize>(row.size() * sizeof(float)));
+            }
+        }
+    } else if (format == ImageFormat::Png) {
+        std::vector<std::vector<unsigned char>> compressed(static_cast<size_t>(end - begin));
+        std::vector<uint32_t> checksums(compressed.size());
+        std::vector<size_t> lengths(compressed.size());
+        parallel_for(compressed.size(), 1, [&](size_t chunk_begin, size_t chunk_end) {
+            std::vector<unsigned char> raw;
+            std::vector<unsigned char> row(3 * width);
+            for (size_t i = chunk_begin; i < chunk_end; ++i) {
+                const int band = begin + static_cast<int>(i);
+                const float* planes = bands[band]->planes.data();
+                raw.clear();
+                for (int r = 0; r < band_rows(band); ++r) {
+                    const float* red = planes + r * width;
+                    resolve_rgb8(red, red + band_plane, red + 2 * band_plane, width, row.data(), settings.display);
+                    raw.push_back(1);  // Sub: each byte minus the one a pixel to the left
+                    for (size_t k = 0; k < 3; ++k) {
+                        raw.push_back(row[k]);
+                    }
+                    for (size_t k = 3; k < row.size(); ++k) {
+                        raw.push_back(static_cast<unsigned char>(row[k] - row[k - 3]));
+                    }
+                }
+                deflate_chunk(raw.data(), raw.size(), band == static_cast<int>(bands.size()) - 1, compressed[i]);
+                checksums[i] = adler32(1, raw.data(), raw.size());
+                lengths[i] = raw.size();
+            }
+        });
+        for (size_t i = 0; i < compressed.size(); ++i) {
+            const int band = begin + static_cast<int>(i);
+            adler = adler32_combine(adler, checksums[i], lengths[i]);
+            std::vector<unsigned char> chunk = {'I', 'D', 'A', 'T'};
+            if (band == 0) {
+                chunk.push_back(0x78);
+                chunk.push_back(0x01);
+            }
+            chunk.insert(chunk.end(), compressed[i].begin(), compressed[i].end());
+            if (band == static_cast<int>(bands.size()) - 1) {
+                append_be32(chunk, adler);
+            }
+            std::vector<unsigned char> framed;
+            append_be32(framed, static_cast<uint32_t>(chunk.size() - 4));
+            framed.insert(framed.end(), chunk.begin(), chunk.end());
+            append_be32(framed, crc32(0, chunk.data(), chunk.size()));
+            write(framed);
+        }
+    } else {
+        // Plane index of each channel in name order.
+        std::vector<int> order(static_cast<size_t>(plane_count));
+        for (int p = 0; p < plane_count; ++p) {
+            order[p] = p;
+        }
+        std::sort(order.begin(), order.end(), [&](int a, int b) { return channel_names[a] < channel_names[b]; });
+        const bool zip = settings.exr_compression == ExrCompression::Zip;
+        const int lines = zip ? kBandRows : 1;
+        const int blocks_per_band = kBandRows / lines;
+        const size_t block_count = static_cast<size_t>(end - begin) * blocks_per_band;
+        std::vector<std::vector<unsigned char>> blocks(block_count);
+        std::vector<int> first_lines(block_count, -1);
+        parallel_for(block_count, 1, [&](size_t block_begin, size_t block_end) {
+            for (size_t b = block_begin; b < block_end; ++b) {
+                const int band = begin + static_cast<int>(b) / blocks_per_band;
+                const int row0 = static_cast<int>(b % blocks_per_band) * lines;
+                const int rows = std::min(lines, band_rows(band) - row0);
+                if (rows <= 0) {
+                    continue;
+                }
+                const float* planes = bands[band]->planes.data();
+                std::vector<unsigned char> raw(static_cast<size_t>(rows) * plane_count * width * sizeof(float));
+                unsigned char* cursor = raw.data();
+                for (int r = row0; r < row0 + rows; ++r) {
+                    for (int p : order) {
+                        std::memcpy(cursor, planes + p * band_plane + r * width, width * sizeof(float));
+                        cursor += width * sizeof(float);
+                    }
+                }
+                std::vector<unsigned char> data;
+                if (zip) {
+                    // Even bytes, then odd ones, then byte-wise deltas.
+                    std::vector<unsigned char> shuffled(raw.size());
+                    const size_t half = (raw.size() + 1) / 2;
+                    for (size_t i = 0; i < raw.size(); ++i) {
+                        shuffled[(i % 2 == 0) ? i / 2 : half + i / 2] = raw[i];
+                    }
+                    for (size_t i = shuffled.size() - 1; i > 0; --i) {
+                        shuffled[i] = static_cast<unsigned char>(shuffled[i] - shuffled[i - 1] + 128);
+                    }
+                    data = zlib_compress(shuffled.data(), shuffled.size());
+                    // Readers take a block no smaller than its raw size as stored.
+                    if (data.size() >= raw.size()) {
+                        data = std::move(raw);
+                    }
+                } else {
+                    data = std::move(raw);
+                }
+                std::vector<unsigned char>& chunk = blocks[b];
+                append_le32(chunk, static_cast<uint32_t>(band * kBandRows + row0));
+                append_le32(chunk, static_cast<uint32_t>(data.size()));
+                chunk.insert(chunk.end(), data.begin(), data.end());
+                first_lines[b] = band * kBandRows + row0;
+            }
+        });
+        for (size_t b = 0; b < block_count; ++b) {
+            if (first_lines[b] < 0) {
+                continue;
+            }
+            chunk_offsets[static_cast<size_t>(first_lines[b] / lines)] = static_cast<uint64_t>(file.tellp());
+            write(blocks[b]);
+        }
+    }
+    if (!file) {
+        throw std::runtime_error("Cannot write image file: " + file_path);
+    }
+}
+
+inline void ImageExporter::write_trailer() {
+    using namespace export_detail;
+    if (format == ImageFormat::Png) {
+        const std::vector<unsigned char> end = {0, 0, 0, 0, 'I', 'E', 'N', 'D', 0xae, 0x42, 0x60, 0x82};
+        file.write(reinterpret_cast<const char*>(end.data()), static_cast<std::streamsize>(end.size()));
+    } else if (format == ImageFormat::Exr) {
+        std::vector<unsigned char> table;
+        for (uint64_t offset : chunk_offsets) {
+            append_le32(table, static_cast<uint32_t>(offset));
+            append_le32(table, static_cast<uint32_t>(offset >> 32));
+        }
+        file.seekp(table_offset);
+        file.write(reinterpret_cast<const char*>(table.data()), static_cast<std::streamsize>(table.size()));
+    }
+}
+
+#endif // RAYTRACER_IMAGE_EXPORT_H
@@ -0,0 +1,308 @@
+#ifndef RAYTRACER_INTEGRATOR_H
+#define RAYTRACER_INTEGRATOR_H
+
+#include <unordered_map>
+
+#include "raytracer/Environment.h"
+#include "raytracer/PathGuiding.h"
+#include "raytracer/RayTracer.h"
+
+// Path tracer with next-event estimation.
+//
+// At every non-specular vertex one light is picked and a shadow ray is sent
+// towards it (Hitable::occluded); the BSDF-sampled continuation may also land
+// on a light. Both estimates of the same light are combined with the power
+// heuristic (Veach 1997), so small bright lights converge quickly without
+// losing glossy reflections of them. An environment map is a second light
+// source of the same kind: one direction drawn from its luminance per vertex,
+// weighted against BSDF samples that escape the scene. Specular vertices
+// (mirrors, glass) only use BSDF sampling.
+//
+// With a trained SDTree (PathGuiding.h) non-specular vertices draw their
+// continuation from a mixture of the BSDF and the guide and weight it by the
+// mixture density; the same density replaces the BSDF pdf in the MIS weights.
+
+// Emissive primitives that can be sampled by direction, and the strategy that
+// picks one of them for a shading point.
+class LightSampler {
+public:
+    virtual ~LightSampler() = default;
+
+    bool empty() const { return lights.empty(); }
+    size_t size() const { return lights.size(); }
+    const Hitable& light(size_t index) const { return *lights[index]; }
+    // Index of `object` among the lights, or size() when it is not one.
+    size_t find(const Hitable* object) const;
+
+    // Picks a light for the shading point `p` with normal `n` (a zero normal
+    // when the receiver is not a surface). Returns false when no light can
+    // contribute; `pmf` receives the probability of the choice.
+    virtual bool pick(const Point3& p, const Vec3& n, size_t& light_index, double& pmf) const = 0;
+    // Probability that pick() chooses `light_index` at (p, n).
+    virtual double pmf(const Point3& p, const Vec3& n, size_t light_index) const = 0;
+
+    // Density of picking light `object` and then `direction` from `p` towards
+    // it; zero when `object` is not a light.
+    double direction_pdf(const Hitable* object, const Point3& p, const Vec3& n, const Vec3& direction) const;
+
+protected:
+    void add_light(std::shared_ptr<Hitable> light);
+
+    std::vector<std::shared_ptr<Hitable>> lights;
+    std::unordered_map<const Hitable*, size_t> index_of;
+};
+
+// Uniform light selection; fine for a handful of lights.
+class LightList : public LightSampler {
+public:
+    LightList() {}
+    explicit LightList(const HitableList& objects);
+
+    void add(std::shared_ptr<Hitable> light) { add_light(std::move(light)); }
+
+    bool pick(const Point3& p, const Vec3& n, size_t& light_index, double& pmf) const override;
+    double pmf(const Point3& p, const Vec3& n, size_t light_index) const override;
+};
+
+struct PathTracerSettings {
+    int max_depth = 50;
+    // false: BSDF sampling only, as ray_color() does.
+    bool sample_lights = true;
+    // Sky gradient of ray_color() for escaped rays; otherwise `background`.
+    bool sky = true;
+    Color background = Color(0, 0, 0);
+    // Replaces sky and background when set; importance sampled when
+    // `sample_lights` is on.
+    std::shared_ptr<const EnvironmentMap> environment;
+    // Mixes guided directions into non-specular vertices once trained; paths
+    // are recorded into it while guide->training() is on.
+    std::shared_ptr<SDTree> guide;
+};
+
+// Attributes of the surface a camera ray hits first; guides for denoising
+// and the source of the AOV channels.
+struct HitFeatures {
+    Color albedo = Color(1, 1, 1);
+    Vec3 normal = Vec3(0, 0, 0);      // zero when the ray escaped
+    double depth = infinity;          // distance along the ray
+    const Hitable* object = nullptr;  // primitive that was hit
+};
+
+inline double power_heuristic(double pdf, double other_pdf) {
+    const double a = pdf * pdf;
+    const double b = other_pdf * other_pdf;
+    return a + b > 0.0 ? a / (a + b) : 0.0;
+}
+
+// Every bounded object of `objects` whose material is emissive.
+inline std::vector<std::shared_ptr<Hitable>> collect_lights(const HitableList& objects) {
+    std::vector<std::shared_ptr<Hitable>> lights;
+    AABB box;
+    for (const auto& object : objects.objects) {
+        const Material* material = object->material();
+        if (material && material->is_emissive() && object->bounding_box(box)) {
+            lights.push_back(object);
+        }
+    }
+    return lights;
+}
+
+inline size_t LightSampler::find(const Hitable* object) const {
+    const auto it = index_of.find(object);
+    return it == index_of.end() ? lights.size() : it->second;
+}
+
+inline double LightSampler::direction_pdf(const Hitable* object, const Point3& p, const Vec3& n,
+                                          const Vec3& direction) const {
+    const size_t index = find(object);
+    if (index == lights.size()) {
+        return 0.0;
+    }
+    const double choice = pmf(p, n, index);
+    return choice > 0.0 ? choice * object->direction_pdf(p, direction) : 0.0;
+}
+
+inline void LightSampler::add_light(std::shared_ptr<Hitable> light) {
+    if (!light) {
+        throw std::invalid_argument("LightSampler requires non-null lights.");
+    }
+    index_of.emplace(light.get(), lights.size());
+    lights.push_back(std::move(light));
+}
+
+inline LightList::LightList(const HitableList& objects) {
+    for (auto& light : collect_lights(objects)) {
+        add(std::move(light));
+    }
+}
+
+inline bool LightList::pick(const Point3&, const Vec3&, size_t& light_index, double& pmf) const {
+    if (lights.empty()) {
+        return false;
+    }
+    light_index = std::min(lights.size() - 1, static_cast<size_t>(random_double() * lights.size()));
+    pmf = 1.0 / static_cast<double>(lights.size());
+    return true;
+}
+
+inline double LightList::pmf(const Point3&, const Vec3&, size_t light_index) const {
+    return light_index < lights.size() ? 1.0 / static_cast<double>(lights.size()) : 0.0;
+}
+
+inline Color background_color(const Ray& r, const PathTracerSettings& settings) {
+    if (settings.environment) {
+        return settings.environment->eval(r.direction());
+    }
+    if (!settings.sky) {
+        return settings.background;
+    }
+    Vec3 unit_direction = unit_vector(r.direction());
+    auto t = 0.5*(unit_direction.y() + 1.0);
+    return (1.0-t)*Color(1.0, 1.0, 1.0) + t*Color(0.5, 0.7, 1.0);
+}
+
+// Radiance arriving along `r`; `first_hit`, when given, receives the
+// attributes of the first surface hit and is left alone when the ray escapes.
+inline Color trace_path(const Ray& r, const Hitable& world, const LightSampler& lights,
+                        const PathTracerSettings& settings = PathTracerSettings(), HitFeatures* first_hit = nullptr) {
+    const bool use_lights = settings.sample_lights && !lights.empty();
+    const EnvironmentMap* environment = settings.sample_lights ? settings.environment.get() : nullptr;
+    Color radiance(0, 0, 0);
+    Color throughput(1, 1, 1);
+    Ray ray = r;
+    // Density with which the previous vertex chose `ray`; 0 after the camera
+    // and specular vertices, where no light sample competes.
+    double bsdf_pdf = 0.0;
+    Vec3 previous_normal;
+
+    // Vertices whose incident radiance is recorded into the guide once the
+    // path is complete.
+    struct GuideVertex {
+        Point3 p;
+        Vec3 direction;
+        double pdf;
+        Color radiance_before;
+        Color throughput_after;
+    };
+    constexpr int kMaxGuideVertices = 32;
+    GuideVertex guide_vertices[kMaxGuideVertices];
+    int guide_vertex_count = 0;
+    SDTree* guide = settings.guide.get();
+
+    for (int depth = 0; depth < settings.max_depth; ++depth) {
+        HitRecord rec;
+        if (!world.hit(ray, 0.001, infinity, rec)) {
+            const double weight =
+                environment && bsdf_pdf > 0.0 ? power_heuristic(bsdf_pdf, environment->pdf(ray.direction())) : 1.0;
+            radiance += weight * throughput * background_color(ray, settings);
+            break;
+        }
+
+        const Material& material = *rec.mat_ptr;
+        if (depth == 0 && first_hit) {
+            first_hit->albedo = material.surface_albedo(rec);
+            first_hit->normal = rec.normal;
+            first_hit->depth = rec.t * ray.direction().length();
+            first_hit->object = rec.object;
+        }
+        const Color emitted = material.emitted(ray, rec);
+        if (emitted.length_squared() > 0.0) {
+            double weight = 1.0;
+            if (use_lights && bsdf_pdf > 0.0) {
+                weight = power_heuristic(
+                    bsdf_pdf, lights.direction_pdf(rec.object, ray.origin(), previous_normal, ray.direction()));
+            }
+            radiance += weight * throughput * emitted;
+        }
+
+        Color attenuation;
+        Ray scattered;
+        double scattered_pdf = 0.0;
+        if (!material.scatter(ray, rec, attenuation, scattered, scattered_pdf)) {
+            break;
+        }
+
+        const bool guided = guide && guide->trained() && !material.is_specular();
+        const double bsdf_fraction = guided ? guide->settings().bsdf_fraction : 1.0;
+        const DirectionalTree* distribution = guided ? &guide->distribution(rec.p) : nullptr;
+        // Density with which this vertex draws `direction` as its continuation.
+        const auto continuation_pdf = [&](const Vec3& direction) {
+            const double pdf = material.scatter_pdf(ray, rec, direction);
+            return guided ? bsdf_fraction * pdf + (1.0 - bsdf_fraction) * distribution->pdf(direction) : pdf;
+        };
+        if (guided) {
+            if (random_double() >= bsdf_fraction) {
+                scattered = Ray(rec.p, distribution->sample());
+            }
+            scattered_pdf = continuation_pdf(scattered.direction());
+            if (!(scattered_pdf > 0.0)) {
+                break;
+            }
+            attenuation = material.eval(ray, rec, scattered.direction()) / scattered_pdf;
+        }
+
+        if ((use_lights || environment) && !material.is_specular()) {
+            size_t light_index = 0;
+            double choice = 0.0;
+            if (use_lights && lights.pick(rec.p, rec.normal, light_index, choice)) {
+                const Hitable& light = lights.light(light_index);
+                const Vec3 direction = light.sample_direction(rec.p);
+                const Ray shadow(rec.p, direction);
+                const double light_pdf = choice * light.direction_pdf(rec.p, direction);
+                const Color f = material.eval(ray, rec, direction);
+                HitRecord light_rec;
+                if (light_pdf > 0.0 && f.length_squared() > 0.0 && light.hit(shadow, 0.001, infinity, light_rec) &&
+                    !world.occluded(shadow, 0.001, light_rec.t * (1.0 - 1e-6))) {
+                    const Color light_emitted = light_rec.mat_ptr->emitted(shadow, light_rec);
+                    const double weight = power_heuristic(light_pdf, continuation_pdf(direction));
+                    radiance += (weight / light_pdf) * throughput * f * light_emitted;
+                }
+            }
+            if (environment) {
+                double environment_pdf = 0.0;
+                const Vec3 direction = environment->sample(environment_pdf);
+                const Color f = environment_pdf > 0.0 ? material.eval(ray, rec, direction) : Color(0, 0, 0);
+                const Ray shadow(rec.p, direction);
+                if (f.length_squared() > 0.0 && !world.occluded(shadow, 0.001, infinity)) {
+                    const double weight = power_heuristic(environment_pdf, continuation_pdf(direction));
+                    radiance += (weight / environment_pdf) * throughput * f * environment->eval(direction);
+                }
+            }
+            bsdf_pdf = scattered_pdf;
+            previous_normal = rec.normal;
+        } else {
+            bsdf_pdf = 0.0;
+        }
+
+        throughput = throughput * attenuation;
+        if (guide && guide->training() && !material.is_specular() && scattered_pdf > 0.0 &&
+            guide_vertex_count < kMaxGuideVertices) {
+            guide_vertices[guide_vertex_count++] =
+                GuideVertex{rec.p, scattered.direction(), scattered_pdf, radiance, throughput};
+        }
+        if (throughput.length_squared() == 0.0) {
+            // A guided direction below the surface.
+            break;
+        }
+        ray = scattered;
+    }
+
+    // Radiance gathered after a vertex, divided by the throughput up to its
+    // continuation, is what arrived there along the sampled direction
+    // (MIS-weighted, as the estimator saw it).
+    for (int i = 0; i < guide_vertex_count; ++i) {
+        const GuideVertex& vertex = guide_vertices[i];
+        const Color gathered = radiance - vertex.radiance_before;
+        Color incident(0, 0, 0);
+        for (int c = 0; c < 3; ++c) {
+            if (vertex.throughput_after[c] > 0.0) {
+                incident.e[c] = gathered[c] / vertex.throughput_after[c];
+            }
+        }
+        guide->record(vertex.p, vertex.direction, luminance(incident) / vertex.pdf);
+    }
+
+    return radiance;
+}
+
+#endif // RAYTRACER_INTEGRATOR_H
@@ -0,0 +1,483 @@
+#ifndef RAYTRACER_LAZY_BVH_H
+#define RAYTRACER_LAZY_BVH_H
+
+#include <atomic>
+#include <deque>
+#include <thread>
+
+#include "raytracer/LinearBVH.h"
+
+// BVH whose subtrees are built the first time a ray enters them.
+//
+// The constructor builds only the top levels. Every frontier node owns an
+// immutable span of primitive indices. The first ray to reach it claims it with
+// a compare-and-swap, copies the span into a private treelet and builds a few
+// more levels there, then publishes the children with a release store. Other
+// rays never see a half-built treelet: they either test the span's primitives
+// directly (small spans) or yield until the treelet is published, so no
+// subtree is ever built twice and no mutex is taken on the traversal path.
+
+struct LazyBVHSettings {
+    size_t max_leaf = 4;
+    // Levels built by the constructor, and per expansion of a frontier node.
+    int eager_levels = 6;
+    int treelet_levels = 6;
+    // Rays that find a frontier node being built by another thread test its
+    // primitives directly up to this span size instead of waiting.
+    uint32_t direct_test_limit = 64;
+};
+
+class LazyBVH : public Hitable {
+public:
+    explicit LazyBVH(std::vector<std::shared_ptr<Hitable>> objects,
+                     const LazyBVHSettings& settings = LazyBVHSettings());
+    ~LazyBVH() override;
+
+    LazyBVH(const LazyBVH&) = delete;
+    LazyBVH& operator=(const LazyBVH&) = delete;
+
+    bool hit(const Ray& r, double t_min, double t_max, HitRecord& rec) const override;
+    bool occluded(const Ray& r, double t_min, double t_max) const override;
+    bool bounding_box(AABB& output_box) const override;
+
+    // Fraction of primitives that already sit in built leaves; 1 once every
+    // subtree has been entered.
+    double built_fraction() const;
+    // Nodes created so far and frontier nodes expanded by traversal.
+    size_t node_count() const { return created_nodes.load(std::memory_order_relaxed); }
+    size_t expansion_count() const { return expansions.load(std::memory_order_relaxed); }
+
+private:
+    enum NodeState : uint8_t { kLeaf, kUnbuilt, kBuilding, kBuilt };
+
+    struct Node {
+        AABB box;
+        const uint32_t* prims = nullptr;  // primitive indices of the whole subtree
+        uint32_t count = 0;
+        uint32_t depth = 0;
+        Node* child[2] = {nullptr, nullptr};
+        std::atomic<uint8_t> state{kUnbuilt};
+    };
+
+    // Scratch copy of a primitive for one expansion: partitioning these keeps
+    // every build pass sequential in memory.
+    struct BuildRef {
+        AABB box;
+        Point3 centroid;
+        uint32_t index;
+    };
+
+    // Storage of one expansion; never moves or changes after publication.
+    struct Treelet {
+        std::vector<uint32_t> indices;
+        std::deque<Node> nodes;
+        Treelet* next = nullptr;
+    };
+
+    Treelet* new_treelet(std::vector<uint32_t> indices) const;
+    void build_treelet(Treelet& treelet, Node& node, uint32_t depth, int levels) const;
+    void build_levels(Treelet& treelet, Node& node, BuildRef* refs, uint32_t* prims, uint32_t count,
+                      const AABB& box, const AABB& centroid_bounds, uint32_t depth, int levels) const;
+    Node* expand(Node& node) const;
+    bool hit_span(const Node& node, const Ray& r, double t_min, double& closest, HitRecord& rec) const;
+    bool occluded_span(const Node& node, const Ray& r, double t_min, double t_max) const;
+
+    std::vector<std::shared_ptr<Hitable>> primitives;
+    std::vector<AABB> boxes;
+    std::vector<Point3> centroids;
+    LazyBVHSettings settings;
+    Node root;
+    mutable std::atomic<Treelet*> treelets{nullptr};
+    mutable std::atomic<size_t> leaf_primitives{0};
+    mutable std::atomic<size_t> created_nodes{1};
+    mutable std::atomic<size_t> expansions{0};
+};
+
+inline LazyBVH::LazyBVH(std::vector<std::shared_ptr<Hitable>> objects, const LazyBVHSettings& lazy_settings)
+    : primitives(std::move(objects)), settings(lazy_settings) {
+    if (primitives.empty()) {
+        throw std::invalid_argument("LazyBVH requires at least one object.");
+    }
+    if (primitives.size() >= LinearBVH::kInvalidIndex) {
+        throw std::invalid_argument("LazyBVH supports at most 2^32 - 1 objects.");
+    }
+    settings.max_leaf = std::clamp<size_t>(settings.max_leaf, 1, 255);
+
+    const size_t n = primitives.size();
+    boxes.resize(n);
+    centroids.resize(n);
+    parallel_for(n, 4096, [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; ++i) {
+            if (!primitives[i]->bounding_box(boxes[i])) {
+                throw std::runtime_error("No bounding box in LazyBVH constructor.");
+            }
+            centroids[i] = boxes[i].centroid();
+        }
+    });
+
+    std::vector<uint32_t> all(n);
+    for (size_t i = 0; i < n; ++i) {
+        all[i] = static_cast<uint32_t>(i);
+    }
+    build_treelet(*new_treelet(std::move(all)), root, 0, settings.eager_levels);
+}
+
+inline LazyBVH::~LazyBVH() {
+    Treelet* treelet = treelets.load(std::memory_order_acquire);
+    while (treelet) {
+        Treelet* next = treelet->next;
+        delete treelet;
+        treelet = next;
+    }
+}
+
+inline LazyBVH::Treelet* LazyBVH::new_treelet(std::vector<uint32_t> indices) const {
+    auto* treelet = new Treelet;
+    treelet->indices = std::move(indices);
+    treelet->next = treelets.load(std::memory_order_relaxed);
+    while (!treelets.compare_exchange_weak(treelet->next, treelet, std::memory_order_release,
+                                           std::memory_order_relaxed)) {
+    }
+    return treelet;
+}
+
+// Builds the top `levels` levels of `treelet`'s primitives into `node`.
+inline void LazyBVH::build_treelet(Treelet& treelet, Node& node, uint32_t depth, int levels) const {
+    const uint32_t count = static_cast<uint32_t>(treelet.indices.size());
+    std::vector<BuildRef> refs(count);
+    AABB box = AABB::empty();
+    AABB centroid_bounds = AABB::empty();
+    for (uint32_t k = 0; k < count; ++k) {
+        const uint32_t prim = treelet.indices[k];
+        refs[k] = BuildRef{boxes[prim], centroids[prim], prim};
+        box.expand(refs[k].box);
+        centroid_bounds.expand(refs[k].centroid);
+    }
+    build_levels(treelet, node, refs.data(), treelet.indices.data(), count, box, centroid_bounds, depth, levels);
+}
+
+// Builds `levels` levels below `node`, partitioning `refs` by binned SAH and
+// writing the final order into `prims` (the treelet's indices). The binning
+// pass also yields both children's bounds, so each level touches every
+// primitive once plus the partition. Nodes left at the last level become
+// frontier nodes; deep nodes fall back to median splits so the traversal stack
+// cannot overflow.
+inline void LazyBVH::build_levels(Treelet& treelet, Node& node, BuildRef* refs, uint32_t* prims,
+                                  uint32_t count, const AABB& box, const AABB& centroid_bounds,
+                                  uint32_t depth, int levels) const {
+    constexpr int kBins = 12;
+    node.box = box;
+    node.prims = prims;
+    node.count = count;
+    node.depth = depth;
+
+    if (count <= settings.max_leaf || levels <= 0) {
+        for (uint32_t k = 0; k < count; ++k) {
+            prims[k] = refs[k].index;
+        }
+    }
+    if (count <= settings.max_leaf) {
+        node.state.store(kLeaf, std::memory_order_relaxed);
+        leaf_primitives.fetch_add(count, std::memory_order_relaxed);
+        return;
+    }
+    if (levels <= 0) {
+        node.state.store(kUnbuilt, std::memory_order_relaxed);
+        return;
+    }
+
+    const int axis = centroid_bounds.longest_axis();
+    const double cmin = centroid_bounds.min()[axis];
+    const double extent = centroid_bounds.max()[axis] - cmin;
+    uint32_t mid = 0;
+    AABB child_box[2];
+    AABB child_centroids[2];
+    if (extent > 0.0 && depth < LinearBVH::kStackSize / 2) {
+        const double scale = kBins / extent;
+        auto bin_of = [&](const BuildRef& ref) {
+            return std::clamp(static_cast<int>((ref.centroid[axis] - cmin) * scale), 0, kBins - 1);
+        };
+        AABB bin_box[kBins];
+        AABB bin_centroids[kBins];
+        uint32_t bin_count[kBins] = {};
+        for (int b = 0; b < kBins; ++b) {
+            bin_box[b] = AABB::empty();
+            bin_centroids[b] = AABB::empty();
+        }
+        for (uint32_t k = 0; k < count; ++k) {
+            const int b = bin_of(refs[k]);
+            bin_box[b].expand(refs[k].box);
+            bin_centroids[b].expand(refs[k].centroid);
+            ++bin_count[b];
+        }
+
+        AABB right_box[kBins];
+        uint32_t right_count[kBins] = {};
+        AABB accum = AABB::empty();
+        uint32_t total = 0;
+        for (int b = kBins - 1; b > 0; --b) {
+            accum.expand(bin_box[b]);
+            total += bin_count[b];
+            right_box[b] = accum;
+            right_count[b] = total;
+        }
+        AABB left_box = AABB::empty();
+        uint32_t left_count = 0;
+        double best_cost = infinity;
+        int best_bin = -1;
+        for (int b = 0; b < kBins - 1; ++b) {
+            left_box.expand(bin_box[b]);
+            left_count += bin_count[b];
+            if (left_count == 0 || right_count[b + 1] == 0) {
+                continue;
+            }
+            const double cost = left_box.surface_area() * left_count +
+                                right_box[b + 1].surface_area() * right_count[b + 1];
+            if (cost < best_cost) {
+                best_cost = cost;
+                best_bin = b;
+            }
+        }
+        if (best_bin >= 0) {
+            BuildRef* middle = std::partition(refs, refs + count,
+                                              [&](const BuildRef& ref) { return bin_of(ref) <= best_bin; });
+            mid = static_cast<uint32_t>(middle - refs);
+            for (int side = 0; side < 2; ++side) {
+                child_box[side] = AABB::empty();
+                child_centroids[side] = AABB::empty();
+            }
+            for (int b = 0; b < kBins; ++b) {
+                const int side = b <= best_bin ? 0 : 1;
+                child_box[side].expand(bin_box[b]);
+                child_centroids[side].expand(bin_centroids[b]);
+            }
+        }
+    }
+    if (mid == 0 || mid == count) {
+        mid = count / 2;
+        std::nth_element(refs, refs + mid, refs + count, [axis](const BuildRef& a, const BuildRef& b) {
+            return a.centroid[axis] < b.centroid[axis];
+        });
+        for (int side = 0; side < 2; ++side) {
+            child_box[side] = AABB::empty();
+            child_centroids[side] = AABB::empty();
+        }
+        for (uint32_t k = 0; k < count; ++k) {
+            const int side = k < mid ? 0 : 1;
+            child_box[side].expand(refs[k].box);
+            child_centroids[side].expand(refs[k].centroid);
+        }
+    }
+
+    Node& left = treelet.nodes.emplace_back();
+    Node& right = treelet.nodes.emplace_back();
+    created_nodes.fetch_add(2, std::memory_order_relaxed);
+    build_levels(treelet, left, refs, prims, mid, child_box[0], child_centroids[0], depth + 1, levels - 1);
+    build_levels(treelet, right, refs + mid, prims + mid, count - mid, child_box[1], child_centroids[1],
+                 depth + 1, levels - 1);
+    node.child[0] = &left;
+    node.child[1] = &right;
+    node.state.store(kBuilt, std::memory_order_relaxed);
+}
+
+// Returns `node` once its children are published, or nullptr when another
+// thread is building it and the caller should test its span directly.
+inline LazyBVH::Node* LazyBVH::expand(Node& node) const {
+    uint8_t state = node.state.load(std::memory_order_acquire);
+    if (state == kUnbuilt &&
+        node.state.compare_exchange_strong(state, kBuilding, std::memory_order_acquire,
+                                           std::memory_order_acquire)) {
+        Node staged;
+        try {
+            Treelet* treelet = new_treelet(std::vector<uint32_t>(node.prims, node.prims + node.count));
+            build_treelet(*treelet, staged, node.depth, settings.treelet_levels);
+        } catch (...) {
+            node.state.store(kUnbuilt, std::memory_order_release);
+            throw;
+        }
+        // The original span stays valid for readers that tested it directly;
+        // only the children (pointing into the treelet) are new.
+        node.child[0] = staged.child[0];
+        node.child[1] = staged.child[1];
+        expansions.fetch_add(1, std::memory_order_relaxed);
+        node.state.store(kBuilt, std::memory_order_release);
+        return &node;
+    }
+
+    while (state == kBuilding) {
+        if (node.count <= settings.direct_test_limit) {
+            return nullptr;
+        }
+        std::this_thread::yield();
+        state = node.state.load(std::memory_order_acquire);
+    }
+    // The builder failed and released the claim; try to claim it ourselves.
+    return state == kUnbuilt ? expand(node) : &node;
+}
+
+inline bool LazyBVH::hit_span(const Node& node, const Ray& r, double t_min, double& closest,
+                              HitRecord& rec) const {
+    bool hit_anything = false;
+    for (uint32_t k = 0; k < node.count; ++k) {
+        if (primitives[node.prims[k]]->hit(r, t_min, closest, rec)) {
+            hit_anything = true;
+            closest = rec.t;
+        }
+    }
+    return hit_anything;
+}
+
+inline bool LazyBVH::hit(const Ray& r, double t_min, double t_max, HitRecord& rec) const {
+    const Point3 origin = r.origin();
+    const Vec3 dir = r.direction();
+    const Vec3 inv_dir(1.0 / dir.x(), 1.0 / dir.y(), 1.0 / dir.z());
+
+    double entry = 0.0;
+    if (!hit_box(root.box, origin, inv_dir, t_min, t_max, entry)) {
+        return false;
+    }
+
+    Node* stack_node[LinearBVH::kStackSize];
+    double stack_entry[LinearBVH::kStackSize];
+    int stack_size = 0;
+    Node* current = const_cast<Node*>(&root);
+    bool hit_anything = false;
+    double closest = t_max;
+
+    while (true) {
+        uint8_t state = current->state.load(std::memory_order_acquire);
+        if (state == kUnbuilt || state == kBuilding) {
+            if (expand(*current)) {
+                state = kBuilt;
+            } else {
+                hit_anything = hit_span(*current, r, t_min, closest, rec) || hit_anything;
+            }
+        }
+
+        if (state == kLeaf) {
+            hit_anything = hit_span(*current, r, t_min, closest, rec) || hit_anything;
+        } else if (state == kBuilt) {
+            Node* first = current->child[0];
+            Node* second = current->child[1];
+            double t_first = 0.0;
+            double t_second = 0.0;
+            const bool hit_first = hit_box(first->box, origin, inv_dir, t_min, closest, t_first);
+            const bool hit_second = hit_box(second->box, origin, inv_dir, t_min, closest, t_second);
+
+            if (hit_first && hit_second) {
+                const bool second_is_near = t_second < t_first;
+                stack_node[stack_size] = second_is_near ? first : second;
+                stack_entry[stack_size] = second_is_near ? t_first : t_second;
+                ++stack_size;
+                current = second_is_near ? second : first;
+                continue;
+            }
+            if (hit_first || hit_second) {
+                current = hit_first ? first : second;
+                continue;
+            }
+        }
+
+        bool found = false;
+        while (stack_size > 0) {
+            --stack_size;
+            if (stack_entry[stack_size] <= closest) {
+                current = stack_node[stack_size];
+                found = true;
+                break;
+            }
+        }
+        if (!found) {
+            break;
+        }
+    }
+
+    return hit_anything;
+}
+
+inline bool LazyBVH::occluded_span(const Node& node, const Ray& r, double t_min, double t_max) const {
+    for (uint32_t k = 0; k < node.count; ++k) {
+        if (primitives[node.prims[k]]->occluded(r, t_min, t_max)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Shadow rays expand frontier nodes like hit() does, so the subtrees they
+// touch are ready for later closest-hit queries.
+inline bool LazyBVH::occluded(const Ray& r, double t_min, double t_max) const {
+    const Point3 origin = r.origin();
+    const Vec3 dir = r.direction();
+    const Vec3 inv_dir(1.0 / dir.x(), 1.0 / dir.y(), 1.0 / dir.z());
+
+    double entry = 0.0;
+    if (!hit_box(root.box, origin, inv_dir, t_min, t_max, entry)) {
+        return false;
+    }
+
+    Node* stack[LinearBVH::kStackSize];
+    int stack_size = 0;
+    Node* current = const_cast<Node*>(&root);
+
+    while (true) {
+        uint8_t state = current->state.load(std::memory_order_acquire);
+        if (state == kUnbuilt || state == kBuilding) {
+            if (expand(*current)) {
+                state = kBuilt;
+            } else if (occluded_span(*current, r, t_min, t_max)) {
+                return true;
+            }
+        }
+
+        if (state == kLeaf) {
+            if (occluded_span(*current, r, t_min, t_max)) {
+                return true;
+            }
+        } else if (state == kBuilt) {
+            Node* first = current->child[0];
+            Node* second = current->child[1];
+            const bool hit_first = hit_box(first->box, origin, inv_dir, t_min, t_max, entry);
+            const bool hit_second = hit_box(second->box, origin, inv_dir, t_min, t_max, entry);
+
+            if (hit_first && hit_second) {
+                stack[stack_size++] = second;
+                current = first;
+                continue;
+            }
+            if (hit_first || hit_second) {
+                current = hit_first ? first : second;
+                continue;
+            }
+        }
+
+        if (stack_size == 0) {
+            return false;
+        }
+        current = stack[--stack_size];
+    }
+}
+
+inline bool LazyBVH::bounding_box(AABB& output_box) const {
+    output_box = root.box;
+    return true;
+}
+
+inline double LazyBVH::built_fraction() const {
+    return static_cast<double>(leaf_primitives.load(std::memory_order_relaxed)) /
+           static_cast<double>(primitives.size());
+}
+
+// Scene whose bounded objects sit in a LazyBVH, for renders that should start
+// tracing before the whole hierarchy exists.
+inline Scene make_lazy_scene(const HitableList& objects, const LazyBVHSettings& settings = LazyBVHSettings()) {
+    std::vector<std::shared_ptr<Hitable>> bounded = objects.objects;
+    HitableList unbounded;
+    split_unbounded(bounded, unbounded);
+    if (bounded.empty()) {
+        return Scene(nullptr, unbounded);
+    }
+    return Scene(std::make_shared<LazyBVH>(std::move(bounded), settings), unbounded);
+}
+
+#endif // RAYTRACER_LAZY_BVH_H
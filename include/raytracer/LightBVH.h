@@ -0,0 +1,396 @@
+#ifndef RAYTRACER_LIGHT_BVH_H
+#define RAYTRACER_LIGHT_BVH_H
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include "raytracer/Integrator.h"
+
+// Light hierarchy for scenes with many emitters (Conty Estevez & Kulla 2018).
+//
+// Every node bounds the position, total power and emission directions of the
+// lights below it. pick() walks from the root to one light, choosing each
+// child with probability proportional to an upper bound of its contribution at
+// the shading point, so a choice costs O(log N) importance evaluations and
+// nearby, bright, facing lights are picked far more often than the rest.
+// pmf() retraces the path of one light for MIS.
+
+// Bounds of one light or a group of lights.
+struct LightBounds {
+    AABB box = AABB::empty();
+    double power = 0.0;
+    // Surface normals lie within theta_o of `axis`; light leaves each surface
+    // point up to theta_e away from its normal (pi/2 for diffuse emitters).
+    Vec3 axis = Vec3(0, 0, 1);
+    double cos_theta_o = -1.0;
+    double cos_theta_e = 0.0;
+
+    // Upper bound of the light arriving at `p` on a surface facing `n`; a zero
+    // `n` bounds the light arriving from all directions.
+    double importance(const Point3& p, const Vec3& n) const;
+};
+
+LightBounds merge_light_bounds(const LightBounds& a, const LightBounds& b);
+
+class LightBVH : public LightSampler {
+public:
+    explicit LightBVH(const HitableList& objects);
+
+    bool pick(const Point3& p, const Vec3& n, size_t& light_index, double& pmf) const override;
+    double pmf(const Point3& p, const Vec3& n, size_t light_index) const override;
+
+    size_t node_count() const { return nodes.size(); }
+    const LightBounds& bounds(size_t node_index) const { return nodes[node_index].bounds; }
+
+private:
+    static constexpr int kBins = 12;
+    static constexpr uint32_t kNoParent = 0xffffffffu;
+
+    struct Node {
+        LightBounds bounds;
+        uint32_t offset = 0;  // interior: first child, leaf: light index
+        bool leaf = false;
+    };
+
+    static LightBounds light_bounds(const Hitable& light);
+    static double orientation_measure(double cos_theta_o, double cos_theta_e);
+    static double split_cost(const LightBounds& bounds, double axis_ratio);
+
+    void build_node(uint32_t node_index, std::vector<uint32_t>& order, size_t begin, size_t end);
+    // Probability of descending from `parent` into child `slot`.
+    double branch_probability(const Node& parent, int slot, const Point3& p, const Vec3& n) const;
+
+    std::vector<LightBounds> light_box;
+    std::vector<Node> nodes;
+    std::vector<uint32_t> parents;
+    std::vector<uint32_t> light_leaf;
+};
+
+// How the path tracer picks the light of a shadow ray: uniformly from a
+// LightList, or by importance through a LightBVH (scenes with many lights).
+enum class LightSelection { Uniform, Bvh };
+
+// "uniform" or "bvh"; throws std::invalid_argument otherwise.
+LightSelection light_selection(const std::string& name);
+const char* light_selection_name(LightSelection selection);
+std::unique_ptr<LightSampler> make_light_sampler(const HitableList& objects, LightSelection selection);
+
+namespace light_bvh_detail {
+
+// cos(max(0, a - b)) and sin(max(0, a - b)) from the sines and cosines of a, b.
+inline double cos_sub_clamped(double sin_a, double cos_a, double sin_b, double cos_b) {
+    return cos_a > cos_b ? 1.0 : cos_a * cos_b + sin_a * sin_b;
+}
+
+inline double sin_sub_clamped(double sin_a, double cos_a, double sin_b, double cos_b) {
+    return cos_a > cos_b ? 0.0 : sin_a * cos_b - cos_a * sin_b;
+}
+
+inline double sin_from_cos(double cosine) {
+    return std::sqrt(std::fmax(0.0, 1.0 - cosine * cosine));
+}
+
+}
+
+inline double LightBounds::importance(const Point3& p, const Vec3& n) const {
+    using namespace light_bvh_detail;
+    if (power <= 0.0) {
+        return 0.0;
+    }
+
+    const Point3 center = box.centroid();
+    const double radius_squared = 0.25 * (box.max() - box.min()).length_squared();
+    const Vec3 to_point = p - center;
+    const double distance_squared = to_point.length_squared();
+
+    // Angle subtended by the bounding sphere of the box; everything when p is inside.
+    double cos_b = -1.0;
+    if (distance_squared > radius_squared) {
+        cos_b = std::sqrt(1.0 - radius_squared / distance_squared);
+    }
+    const double sin_b = sin_from_cos(cos_b);
+    const Vec3 wi = distance_squared > 0.0 ? to_point / std::sqrt(distance_squared) : Vec3(0, 0, 1);
+
+    // Smallest angle between the emission cone and the direction to p.
+    const double cos_w = dot(axis, wi);
+    const double sin_w = sin_from_cos(cos_w);
+    const double sin_o = sin_from_cos(cos_theta_o);
+    const double cos_x = cos_sub_clamped(sin_w, cos_w, sin_o, cos_theta_o);
+    const double sin_x = sin_sub_clamped(sin_w, cos_w, sin_o, cos_theta_o);
+    const double cos_emit = cos_sub_clamped(sin_x, cos_x, sin_b, cos_b);
+    if (cos_emit <= cos_theta_e) {
+        return 0.0;
+    }
+
+    double result = power * cos_emit / std::fmax(distance_squared, radius_squared);
+    const double n_length = n.length();
+    if (n_length > 0.0) {
+        const double cos_i = -dot(wi, n) / n_length;
+        const double cos_receive = cos_sub_clamped(sin_from_cos(cos_i), cos_i, sin_b, cos_b);
+        result *= std::fmax(0.0, cos_receive);
+    }
+    return result;
+}
+
+inline LightBounds merge_light_bounds(const LightBounds& a, const LightBounds& b) {
+    if (a.power <= 0.0 && a.box.is_empty()) {
+        return b;
+    }
+    if (b.power <= 0.0 && b.box.is_empty()) {
+        return a;
+    }
+
+    LightBounds merged;
+    merged.box = surrounding_box(a.box, b.box);
+    merged.power = a.power + b.power;
+    merged.cos_theta_e = std::fmin(a.cos_theta_e, b.cos_theta_e);
+
+    // Smallest cone around both normal cones.
+    const double theta_a = std::acos(clamp(a.cos_theta_o, -1.0, 1.0));
+    const double theta_b = std::acos(clamp(b.cos_theta_o, -1.0, 1.0));
+    const double theta_d = std::acos(clamp(dot(a.axis, b.axis), -1.0, 1.0));
+    if (std::fmin(theta_d + theta_b, pi) <= theta_a) {
+        merged.axis = a.axis;
+        merged.cos_theta_o = a.cos_theta_o;
+        return merged;
+    }
+    if (std::fmin(theta_d + theta_a, pi) <= theta_b) {
+        merged.axis = b.axis;
+        merged.cos_theta_o = b.cos_theta_o;
+        return merged;
+    }
+
+    const double theta_o = 0.5 * (theta_a + theta_d + theta_b);
+    const Vec3 rotation_axis = cross(a.axis, b.axis);
+    if (theta_o >= pi || rotation_axis.length_squared() < 1e-24) {
+        merged.axis = a.axis;
+        merged.cos_theta_o = -1.0;
+        return merged;
+    }
+    // Rotate a's axis towards b's by theta_o - theta_a.
+    const double theta_r = theta_o - theta_a;
+    const Vec3 towards_b = cross(unit_vector(rotation_axis), a.axis);
+    merged.axis = unit_vector(std::cos(theta_r) * a.axis + std::sin(theta_r) * towards_b);
+    merged.cos_theta_o = std::cos(theta_o);
+    return merged;
+}
+
+inline LightBVH::LightBVH(const HitableList& objects) {
+    for (auto& light : collect_lights(objects)) {
+        add_light(std::move(light));
+    }
+    if (lights.size() >= kNoParent) {
+        throw std::invalid_argument("LightBVH supports at most 2^32 - 1 lights.");
+    }
+    if (lights.empty()) {
+        return;
+    }
+
+    light_box.resize(lights.size());
+    std::vector<uint32_t> order(lights.size());
+    for (size_t i = 0; i < lights.size(); ++i) {
+        light_box[i] = light_bounds(*lights[i]);
+        order[i] = static_cast<uint32_t>(i);
+    }
+    light_leaf.resize(lights.size());
+    nodes.reserve(2 * lights.size());
+    parents.reserve(2 * lights.size());
+    nodes.emplace_back();
+    parents.push_back(kNoParent);
+    build_node(0, order, 0, order.size());
+}
+
+// Diffuse emitters: light leaves every point of the surface over the hemisphere
+// around its normal. Normal cones of the primitives are not known, so single
+// lights are bounded as emitting in every direction.
+inline LightBounds LightBVH::light_bounds(const Hitable& light) {
+    LightBounds bounds;
+    light.bounding_box(bounds.box);
+
+    HitRecord front;
+    front.p = bounds.box.centroid();
+    front.normal = Vec3(0, 0, 1);
+    front.front_face = true;
+    const Color radiance = light.material()->emitted(Ray(front.p, front.normal), front);
+    bounds.power = pi * std::fmax(0.0, luminance(radiance)) * light.surface_area();
+    return bounds;
+}
+
+// Solid-angle measure of a normal cone widened by the emission angle.
+inline double LightBVH::orientation_measure(double cos_theta_o, double cos_theta_e) {
+    const double theta_o = std::acos(clamp(cos_theta_o, -1.0, 1.0));
+    const double theta_e = std::acos(clamp(cos_theta_e, -1.0, 1.0));
+    const double theta_w = std::fmin(theta_o + theta_e, pi);
+    const double sin_o = std::sin(theta_o);
+    return 2.0 * pi * (1.0 - cos_theta_o) +
+           0.5 * pi * (2.0 * theta_w * sin_o - std::cos(theta_o - 2.0 * theta_w) - 2.0 * theta_o * sin_o +
+                       cos_theta_o);
+}
+
+// Surface area orientation heuristic; `axis_ratio` penalises splits across
+// the short sides of thin boxes.
+inline double LightBVH::split_cost(const LightBounds& bounds, double axis_ratio) {
+    return bounds.power * orientation_measure(bounds.cos_theta_o, bounds.cos_theta_e) *
+           bounds.box.surface_area() * axis_ratio;
+}
+
+inline void LightBVH::build_node(uint32_t node_index, std::vector<uint32_t>& order, size_t begin, size_t end) {
+    LightBounds bounds;
+    AABB centroid_bounds = AABB::empty();
+    for (size_t i = begin; i < end; ++i) {
+        bounds = merge_light_bounds(bounds, light_box[order[i]]);
+        centroid_bounds.expand(light_box[order[i]].box.centroid());
+    }
+    nodes[node_index].bounds = bounds;
+
+    if (end - begin == 1) {
+        nodes[node_index].leaf = true;
+        nodes[node_index].offset = order[begin];
+        light_leaf[order[begin]] = node_index;
+        return;
+    }
+
+    const Vec3 extent = bounds.box.max() - bounds.box.min();
+    const double max_extent = std::fmax(extent.x(), std::fmax(extent.y(), extent.z()));
+    double best_cost = infinity;
+    int best_axis = -1;
+    int best_bin = 0;
+    for (int axis = 0; axis < 3; ++axis) {
+        const double lo = centroid_bounds.min()[axis];
+        const double span = centroid_bounds.max()[axis] - lo;
+        if (!(span > 0.0)) {
+            continue;
+        }
+        LightBounds bins[kBins];
+        for (size_t i = begin; i < end; ++i) {
+            const LightBounds& light = light_box[order[i]];
+            const int b = std::min(kBins - 1, static_cast<int>(kBins * (light.box.centroid()[axis] - lo) / span));
+            bins[b] = merge_light_bounds(bins[b], light);
+        }
+
+        LightBounds above[kBins];
+        above[kBins - 1] = bins[kBins - 1];
+        for (int b = kBins - 2; b >= 0; --b) {
+            above[b] = merge_light_bounds(bins[b], above[b + 1]);
+        }
+        const double axis_ratio = extent[axis] > 0.0 ? max_extent / extent[axis] : 1.0;
+        LightBounds below;
+        for (int b = 0; b < kBins - 1; ++b) {
+            below = merge_light_bounds(below, bins[b]);
+            if (below.box.is_empty() || above[b + 1].box.is_empty()) {
+                continue;
+            }
+            const double cost = split_cost(below, axis_ratio) + split_cost(above[b + 1], axis_ratio);
+            if (cost < best_cost) {
+                best_cost = cost;
+                best_axis = axis;
+                best_bin = b;
+            }
+        }
+    }
+
+    size_t mid = begin + (end - begin) / 2;
+    if (best_axis >= 0) {
+        const double lo = centroid_bounds.min()[best_axis];
+        const double span = centroid_bounds.max()[best_axis] - lo;
+        const auto middle = std::partition(order.begin() + begin, order.begin() + end, [&](uint32_t light) {
+            const double c = light_box[light].box.centroid()[best_axis];
+            return std::min(kBins - 1, static_cast<int>(kBins * (c - lo) / span)) <= best_bin;
+        });
+        mid = static_cast<size_t>(middle - order.begin());
+    }
+    if (mid == begin || mid == end) {
+        // Coincident centroids: any balanced split is as good as another.
+        mid = begin + (end - begin) / 2;
+    }
+
+    const uint32_t first_child = static_cast<uint32_t>(nodes.size());
+    nodes.emplace_back();
+    nodes.emplace_back();
+    parents.push_back(node_index);
+    parents.push_back(node_index);
+    nodes[node_index].offset = first_child;
+    build_node(first_child, order, begin, mid);
+    build_node(first_child + 1, order, mid, end);
+}
+
+inline double LightBVH::branch_probability(const Node& parent, int slot, const Point3& p, const Vec3& n) const {
+    const double first = nodes[parent.offset].bounds.importance(p, n);
+    const double second = nodes[parent.offset + 1].bounds.importance(p, n);
+    const double total = first + second;
+    if (!(total > 0.0)) {
+        return 0.0;
+    }
+    return (slot == 0 ? first : second) / total;
+}
+
+inline bool LightBVH::pick(const Point3& p, const Vec3& n, size_t& light_index, double& pmf) const {
+    if (nodes.empty()) {
+        return false;
+    }
+    const Node* node = &nodes[0];
+    if (node->leaf && !(node->bounds.importance(p, n) > 0.0)) {
+        return false;
+    }
+
+    pmf = 1.0;
+    while (!node->leaf) {
+        const double first = nodes[node->offset].bounds.importance(p, n);
+        const double second = nodes[node->offset + 1].bounds.importance(p, n);
+        const double total = first + second;
+        if (!(total > 0.0)) {
+            return false;
+        }
+        const int slot = random_double() * total < first ? 0 : 1;
+        pmf *= (slot == 0 ? first : second) / total;
+        node = &nodes[node->offset + static_cast<uint32_t>(slot)];
+    }
+    light_index = node->offset;
+    return pmf > 0.0;
+}
+
+inline double LightBVH::pmf(const Point3& p, const Vec3& n, size_t light_index) const {
+    if (light_index >= lights.size()) {
+        return 0.0;
+    }
+    uint32_t node_index = light_leaf[light_index];
+    if (node_index == 0) {
+        return nodes[0].bounds.importance(p, n) > 0.0 ? 1.0 : 0.0;
+    }
+
+    double probability = 1.0;
+    while (node_index != 0) {
+        const uint32_t parent = parents[node_index];
+        const Node& node = nodes[parent];
+        probability *= branch_probability(node, static_cast<int>(node_index - node.offset), p, n);
+        if (probability == 0.0) {
+            return 0.0;
+        }
+        node_index = parent;
+    }
+    return probability;
+}
+
+inline LightSelection light_selection(const std::string& name) {
+    if (name == "uniform") {
+        return LightSelection::Uniform;
+    }
+    if (name == "bvh") {
+        return LightSelection::Bvh;
+    }
+    throw std::invalid_argument("Unknown light selection: " + name);
+}
+
+inline const char* light_selection_name(LightSelection selection) {
+    return selection == LightSelection::Bvh ? "bvh" : "uniform";
+}
+
+inline std::unique_ptr<LightSampler> make_light_sampler(const HitableList& objects, LightSelection selection) {
+    if (selection == LightSelection::Bvh) {
+        return std::make_unique<LightBVH>(objects);
+    }
+    return std::make_unique<LightList>(objects);
+}
+
+#endif // RAYTRACER_LIGHT_BVH_H
@@ -0,0 +1,1259 @@
+#ifndef RAYTRACER_LINEAR_BVH_H
+#define RAYTRACER_LINEAR_BVH_H
+
+#include <array>
+
+#include "raytracer/CacheSimulator.h"
+#include "raytracer/Morton.h"
+#include "raytracer/RayTracer.h"
+#include "raytracer/ThreadPool.h"
+
+// Flattened bounding volume hierarchy.
+//
+// Nodes live in one contiguous array. Siblings are always stored as a pair
+// (offset, offset + 1) and parents precede their children, so the whole tree
+// can be refit bottom-up with a single reverse sweep and a single primitive can
+// be refit by walking its parent chain.
+
+enum class BVHBuildMethod {
+    SAH,     // binned surface area heuristic, best traversal quality
+    Median,  // object median on the longest centroid axis
+    LBVH,    // Morton-ordered linear BVH (Karras 2012), fastest to build
+    SBVH,    // SAH with spatial splits (Stich et al. 2009); references may be duplicated
+};
+
+// Limits for BVHBuildMethod::SBVH.
+struct SpatialSplitSettings {
+    // Extra primitive references the builder may create, as a fraction of the
+    // primitive count.
+    double duplication_budget = 0.3;
+    // Spatial splits are only evaluated where the children of the best object
+    // split overlap by more than this fraction of the root surface area.
+    double overlap_threshold = 1e-5;
+};
+
+// Order of nodes in memory. Every layout keeps sibling pairs adjacent and
+// parents ahead of their children; only the order of the pairs changes.
+enum class BVHLayout {
+    DepthFirst,   // order produced by the builder
+    Treelet,      // page-sized treelets grown greedily by surface area (Yoon & Manocha 2006)
+    VanEmdeBoas,  // recursive top/bottom split by height; cache-oblivious
+};
+
+// What to do with a BVH over primitives that moved since the last frame.
+enum class BVHUpdate {
+    None,         // nothing moved
+    Refit,        // keep topology, recompute boxes
+    FastRebuild,  // rebuild with BVHBuildMethod::LBVH
+    FullRebuild,  // rebuild with BVHBuildMethod::SAH
+};
+
+struct BVHUpdatePolicy {
+    // Up to this fraction of moved primitives a refit keeps traversal quality acceptable.
+    double max_refit_fraction = 0.02;
+    // From this fraction on most of the tree is stale every frame, so the cheapest
+    // rebuild wins; in between, an SAH rebuild pays for itself over the frame.
+    double min_fast_rebuild_fraction = 0.25;
+};
+
+inline BVHUpdate choose_bvh_update(size_t moved, size_t total,
+                                   const BVHUpdatePolicy& policy = BVHUpdatePolicy()) {
+    if (moved == 0 || total == 0) {
+        return BVHUpdate::None;
+    }
+    const double fraction = static_cast<double>(moved) / static_cast<double>(total);
+    if (fraction <= policy.max_refit_fraction) {
+        return BVHUpdate::Refit;
+    }
+    if (fraction >= policy.min_fast_rebuild_fraction) {
+        return BVHUpdate::FastRebuild;
+    }
+    return BVHUpdate::FullRebuild;
+}
+
+struct LinearBVHNode {
+    AABB box;
+    uint32_t offset = 0;  // interior: first child index; leaf: first entry in refs
+    uint16_t count = 0;   // number of primitive refs in a leaf, 0 for interior nodes
+    uint16_t axis = 0;    // split axis of interior nodes
+};
+
+struct BVHTraversalStats {
+    uint64_t node_visits = 0;
+    uint64_t primitive_tests = 0;
+    uint64_t cache_misses = 0;
+    // Optional cache model fed with every node read; its misses add to cache_misses.
+    CacheSimulator* cache = nullptr;
+
+    template <typename Node>
+    void visit_node(const Node& node) {
+        ++node_visits;
+        if (cache) {
+            const uint64_t before = cache->misses;
+            cache->access(&node, sizeof(node));
+            cache_misses += cache->misses - before;
+        }
+    }
+    void test_primitive() { ++primitive_tests; }
+};
+
+// Stats policy used by the regular hit() path; compiles away entirely.
+struct NoTraversalStats {
+    template <typename Node>
+    void visit_node(const Node&) {}
+    void test_primitive() {}
+};
+
+inline bool hit_box(const AABB& box, const Point3& origin, const Vec3& inv_dir,
+                    double t_min, double t_max, double& t_entry) {
+    for (int axis = 0; axis < 3; ++axis) {
+        double t0 = (box.min()[axis] - origin[axis]) * inv_dir[axis];
+        double t1 = (box.max()[axis] - origin[axis]) * inv_dir[axis];
+        if (inv_dir[axis] < 0.0) {
+            std::swap(t0, t1);
+        }
+        t_min = t0 > t_min ? t0 : t_min;
+        t_max = t1 < t_max ? t1 : t_max;
+        if (t_max < t_min) {
+            return false;
+        }
+    }
+    t_entry = t_min;
+    return true;
+}
+
+class LinearBVH : public Hitable {
+public:
+    static constexpr uint32_t kInvalidIndex = 0xffffffffu;
+    static constexpr int kStackSize = 128;
+
+    LinearBVH() {}
+    explicit LinearBVH(std::vector<std::shared_ptr<Hitable>> objects,
+                       BVHBuildMethod method = BVHBuildMethod::SAH, size_t max_leaf_size = 4,
+                       const SpatialSplitSettings& spatial = SpatialSplitSettings());
+
+    bool hit(const Ray& r, double t_min, double t_max, HitRecord& rec) const override;
+    bool bounding_box(AABB& output_box) const override;
+
+    // Same as hit() but also counts visited nodes and primitive tests.
+    bool hit(const Ray& r, double t_min, double t_max, HitRecord& rec, BVHTraversalStats& stats) const;
+
+    // Same as hit() but also reports which primitive was hit, as an index for
+    // primitive().
+    bool hit(const Ray& r, double t_min, double t_max, HitRecord& rec, uint32_t& primitive_index) const;
+
+    bool occluded(const Ray& r, double t_min, double t_max) const override;
+    bool occluded(const Ray& r, double t_min, double t_max, BVHTraversalStats& stats) const;
+
+    // Recomputes every node box from the current primitive bounds. The topology is
+    // kept, so quality degrades as primitives drift away from where they were built.
+    void refit();
+
+    // Recomputes the leaf holding one primitive and its ancestors only: O(depth).
+    void refit(size_t primitive_index);
+
+    // Rebuilds the topology from the current primitive bounds.
+    void rebuild(BVHBuildMethod method) { build(method); }
+
+    // Applies choose_bvh_update() for `moved` changed primitives.
+    BVHUpdate update(size_t moved, const BVHUpdatePolicy& policy = BVHUpdatePolicy());
+
+    // Reorders the nodes into `layout`; later rebuilds keep using it. Traversal
+    // results are unchanged, only memory locality differs.
+    void set_layout(BVHLayout layout);
+    BVHLayout layout() const { return node_layout; }
+
+    size_t node_count() const { return nodes.size(); }
+    size_t primitive_count() const { return primitives.size(); }
+    // Number of primitive references held by leaves; exceeds primitive_count()
+    // when spatial splits duplicated references.
+    size_t reference_count() const { return refs.size(); }
+    uint32_t reference(size_t index) const { return refs[index]; }
+    // Bytes held by the hierarchy itself (nodes, references and refit links).
+    size_t memory_bytes() const {
+        return nodes.size() * sizeof(LinearBVHNode) +
+               (refs.size() + parents.size() + prim_leaf.size()) * sizeof(uint32_t);
+    }
+    const LinearBVHNode& node(size_t index) const { return nodes[index]; }
+    const std::shared_ptr<Hitable>& primitive(size_t index) const { return primitives[index]; }
+
+private:
+    struct BuildPrimitive {
+        AABB box;
+        Point3 centroid;
+        uint32_t index;
+    };
+
+    // Candidate split of one SBVH node. Object splits partition by centroid bin,
+    // spatial splits cut references at `position`.
+    struct SplitCandidate {
+        double cost = infinity;
+        int axis = -1;
+        int bin = -1;
+        bool spatial = false;
+        double origin = 0.0;
+        double scale = 0.0;
+        double position = 0.0;
+        double overlap = 0.0;
+        size_t duplicates = 0;
+    };
+
+    struct SpatialBuildState {
+        SpatialSplitSettings settings;
+        double root_area = 0.0;
+        double remaining_budget = 0.0;
+    };
+
+    static constexpr uint32_t kDuplicatedLeaf = kInvalidIndex - 1;
+    static constexpr size_t kTreeletBytes = 4096;
+    // Centroid (and spatial) bins per axis for every binned SAH split.
+    static constexpr int kBins = 16;
+
+    void build(BVHBuildMethod method);
+    void build_lbvh(const std::vector<BuildPrimitive>& build_prims);
+    void build_sbvh_node(uint32_t node_index, std::vector<BuildPrimitive>& node_refs, int depth,
+                         SpatialBuildState& state);
+    SplitCandidate find_object_split(const std::vector<BuildPrimitive>& node_refs) const;
+    SplitCandidate find_spatial_split(const std::vector<BuildPrimitive>& node_refs,
+                                      const AABB& bounds) const;
+    void make_leaf(uint32_t node_index, const std::vector<BuildPrimitive>& node_refs, const AABB& bounds);
+    void build_node(uint32_t node_index, std::vector<BuildPrimitive>& build_prims,
+                    size_t begin, size_t end, BVHBuildMethod method, int depth);
+    size_t partition_sah(std::vector<BuildPrimitive>& build_prims, size_t begin, size_t end,
+                         const AABB& bounds, const AABB& centroid_bounds, int& axis) const;
+    AABB leaf_bounds(const LinearBVHNode& leaf) const;
+
+    // Layout pass. Unit 0 is the root node, unit u > 0 the sibling pair at nodes
+    // (2u - 1, 2u); layouts permute units and remap every index.
+    void apply_layout();
+    void order_treelets(const std::vector<std::array<uint32_t, 2>>& children,
+                        std::vector<uint32_t>& order) const;
+    void order_van_emde_boas(uint32_t unit, uint32_t height,
+                             const std::vector<std::array<uint32_t, 2>>& children,
+                             const std::vector<uint32_t>& heights, std::vector<uint32_t>& order) const;
+
+    template <typename Stats>
+    bool traverse(const Ray& r, double t_min, double t_max, HitRecord& rec, Stats& stats,
+                  uint32_t* hit_primitive = nullptr) const;
+    template <typename Stats>
+    bool traverse_any(const Ray& r, double t_min, double t_max, Stats& stats) const;
+
+    std::vector<std::shared_ptr<Hitable>> primitives;
+    std::vector<uint32_t> refs;
+    std::vector<LinearBVHNode> nodes;
+    std::vector<uint32_t> parents;
+    std::vector<uint32_t> prim_leaf;
+    size_t max_leaf = 4;
+    SpatialSplitSettings spatial_settings;
+    BVHLayout node_layout = BVHLayout::DepthFirst;
+};
+
+inline LinearBVH::LinearBVH(std::vector<std::shared_ptr<Hitable>> objects, BVHBuildMethod method,
+                            size_t max_leaf_size, const SpatialSplitSettings& spatial)
+    : primitives(std::move(objects)),
+      max_leaf(std::clamp<size_t>(max_leaf_size, 1, 255)),
+      spatial_settings(spatial) {
+    build(method);
+}
+
+inline void LinearBVH::build(BVHBuildMethod method) {
+    if (primitives.empty()) {
+        throw std::invalid_argument("LinearBVH requires at least one object.");
+    }
+    if (primitives.size() >= kInvalidIndex) {
+        throw std::invalid_argument("LinearBVH supports at most 2^32 - 1 objects.");
+    }
+
+    std::vector<BuildPrimitive> build_prims(primitives.size());
+    parallel_for(primitives.size(), 4096, [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; ++i) {
+            AABB box;
+            if (!primitives[i]->bounding_box(box)) {
+                throw std::runtime_error("No bounding box in LinearBVH constructor.");
+            }
+            build_prims[i] = BuildPrimitive{box, box.centroid(), static_cast<uint32_t>(i)};
+        }
+    });
+
+    nodes.clear();
+    parents.clear();
+    refs.clear();
+    nodes.reserve(2 * primitives.size());
+    parents.reserve(2 * primitives.size());
+    refs.reserve(primitives.size());
+    prim_leaf.assign(primitives.size(), kInvalidIndex);
+
+    nodes.emplace_back();
+    parents.push_back(kInvalidIndex);
+    if (method == BVHBuildMethod::LBVH) {
+        build_lbvh(build_prims);
+    } else if (method == BVHBuildMethod::SBVH) {
+        SpatialBuildState state;
+        state.settings = spatial_settings;
+        AABB root = AABB::empty();
+        for (const BuildPrimitive& prim : build_prims) {
+            root.expand(prim.box);
+        }
+        state.root_area = root.surface_area();
+        state.remaining_budget = spatial_settings.duplication_budget * static_cast<double>(build_prims.size());
+        build_sbvh_node(0, build_prims, 0, state);
+    } else {
+        build_node(0, build_prims, 0, build_prims.size(), method, 0);
+    }
+    if (node_layout != BVHLayout::DepthFirst) {
+        apply_layout();
+    }
+}
+
+// Karras, "Maximizing Parallelism in the Construction of BVHs, Octrees, and k-d
+// Trees" (HPG 2012). Primitives are sorted by the Morton code of their centroid;
+// every internal node of the resulting radix tree finds its key range and split
+// independently, so hierarchy emission is a parallel O(n) pass. The radix tree is
+// then copied into the sibling-pair layout, collapsing small ranges into leaves.
+inline void LinearBVH::build_lbvh(const std::vector<BuildPrimitive>& build_prims) {
+    const size_t n = build_prims.size();
+
+    AABB centroid_bounds = AABB::empty();
+    for (const BuildPrimitive& prim : build_prims) {
+        centroid_bounds.expand(prim.centroid);
+    }
+    const Point3 origin = centroid_bounds.min();
+    const Vec3 extent = centroid_bounds.max() - origin;
+    const Vec3 inv_extent(extent.x() > 0.0 ? 1.0 / extent.x() : 0.0,
+                          extent.y() > 0.0 ? 1.0 / extent.y() : 0.0,
+                          extent.z() > 0.0 ? 1.0 / extent.z() : 0.0);
+
+    // 30-bit codes halve the sort passes; large scenes need 63 bits to keep
+    // neighbouring primitives from collapsing onto the same code.
+    const bool wide_codes = n > (1u << 18);
+    std::vector<uint64_t> keys(n);
+    std::vector<uint32_t> order(n);
+    parallel_for(n, 4096, [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; ++i) {
+            const Vec3 p = (build_prims[i].centroid - origin) * inv_extent;
+            keys[i] = wide_codes ? morton3d_63(p.x(), p.y(), p.z())
+                                 : morton3d_30(p.x(), p.y(), p.z());
+            order[i] = static_cast<uint32_t>(i);
+        }
+    });
+    radix_sort_pairs(keys, order, wide_codes ? 63 : 30);
+    refs = order;
+
+    if (n <= max_leaf) {
+        LinearBVHNode& leaf = nodes[0];
+        leaf.box = AABB::empty();
+        leaf.offset = 0;
+        leaf.count = static_cast<uint16_t>(n);
+        for (uint32_t index : refs) {
+            leaf.box.expand(build_prims[index].box);
+            prim_leaf[index] = 0;
+        }
+        return;
+    }
+
+    // Radix tree: internal node i has children encoded with kLeafBit for leaves
+    // and covers the sorted key range [range_first[i], range_last[i]].
+    constexpr uint32_t kLeafBit = 0x80000000u;
+    const size_t internal_count = n - 1;
+    std::vector<uint32_t> child_left(internal_count);
+    std::vector<uint32_t> child_right(internal_count);
+    std::vector<uint32_t> range_first(internal_count);
+    std::vector<uint32_t> range_last(internal_count);
+
+    const int64_t count = static_cast<int64_t>(n);
+    auto delta = [&](int64_t i, int64_t j) -> int {
+        if (j < 0 || j >= count) {
+            return -1;
+        }
+        const uint64_t a = keys[static_cast<size_t>(i)];
+        const uint64_t b = keys[static_cast<size_t>(j)];
+        if (a == b) {
+            return 64 + count_leading_zeros64(static_cast<uint64_t>(i ^ j));
+        }
+        return count_leading_zeros64(a ^ b);
+    };
+
+    parallel_for(internal_count, 4096, [&](size_t first, size_t last) {
+        for (size_t node = first; node < last; ++node) {
+            const int64_t i = static_cast<int64_t>(node);
+            const int64_t d = delta(i, i + 1) - delta(i, i - 1) >= 0 ? 1 : -1;
+            const int delta_min = delta(i, i - d);
+
+            int64_t l_max = 2;
+            while (delta(i, i + l_max * d) > delta_min) {
+                l_max *= 2;
+            }
+            int64_t l = 0;
+            for (int64_t t = l_max / 2; t >= 1; t /= 2) {
+                if (delta(i, i + (l + t) * d) > delta_min) {
+                    l += t;
+                }
+            }
+            const int64_t j = i + l * d;
+
+            const int delta_node = delta(i, j);
+            int64_t s = 0;
+            for (int64_t divider = 2;; divider *= 2) {
+                const int64_t t = (l + divider - 1) / divider;
+                if (delta(i, i + (s + t) * d) > delta_node) {
+                    s += t;
+                }
+                if (t <= 1) {
+                    break;
+                }
+            }
+            const int64_t gamma = i + s * d + std::min<int64_t>(d, 0);
+            const int64_t lo = std::min(i, j);
+            const int64_t hi = std::max(i, j);
+
+            child_left[node] = static_cast<uint32_t>(gamma) | (lo == gamma ? kLeafBit : 0u);
+            child_right[node] = static_cast<uint32_t>(gamma + 1) | (hi == gamma + 1 ? kLeafBit : 0u);
+            range_first[node] = static_cast<uint32_t>(lo);
+            range_last[node] = static_cast<uint32_t>(hi);
+        }
+    });
+
+    struct Pending {
+        uint32_t code;
+        uint32_t target;
+    };
+    std::vector<Pending> stack;
+    stack.push_back(Pending{0, 0});
+    while (!stack.empty()) {
+        const Pending item = stack.back();
+        stack.pop_back();
+
+        const bool is_leaf = (item.code & kLeafBit) != 0;
+        const uint32_t index = item.code & ~kLeafBit;
+        const uint32_t first = is_leaf ? index : range_first[index];
+        const uint32_t last = is_leaf ? index : range_last[index];
+        const uint32_t span = last - first + 1;
+
+        if (span <= max_leaf) {
+            LinearBVHNode& leaf = nodes[item.target];
+            leaf.box = AABB::empty();
+            leaf.offset = first;
+            leaf.count = static_cast<uint16_t>(span);
+            for (uint32_t k = first; k <= last; ++k) {
+                leaf.box.expand(build_prims[refs[k]].box);
+                prim_leaf[refs[k]] = item.target;
+            }
+            continue;
+        }
+
+        const uint32_t first_child = static_cast<uint32_t>(nodes.size());
+        nodes.emplace_back();
+        nodes.emplace_back();
+        parents.push_back(item.target);
+        parents.push_back(item.target);
+        LinearBVHNode& interior = nodes[item.target];
+        interior.offset = first_child;
+        interior.count = 0;
+        interior.axis = 0;
+
+        stack.push_back(Pending{child_right[index], first_child + 1});
+        stack.push_back(Pending{child_left[index], first_child});
+    }
+
+    for (size_t i = nodes.size(); i-- > 0;) {
+        LinearBVHNode& node = nodes[i];
+        if (node.count == 0) {
+            node.box = surrounding_box(nodes[node.offset].box, nodes[node.offset + 1].box);
+        }
+    }
+}
+
+inline void LinearBVH::build_node(uint32_t node_index, std::vector<BuildPrimitive>& build_prims,
+                                  size_t begin, size_t end, BVHBuildMethod method, int depth) {
+    AABB bounds = AABB::empty();
+    AABB centroid_bounds = AABB::empty();
+    for (size_t i = begin; i < end; ++i) {
+        bounds.expand(build_prims[i].box);
+        centroid_bounds.expand(build_prims[i].centroid);
+    }
+
+    const size_t count = end - begin;
+    int axis = centroid_bounds.longest_axis();
+    size_t mid = begin;
+    bool make_leaf = count == 1;
+
+    if (!make_leaf) {
+        // Past this depth SAH is not allowed to produce lopsided splits, which keeps
+        // the traversal stack bounded for any input.
+        if (method == BVHBuildMethod::SAH && depth < kStackSize / 2) {
+            mid = partition_sah(build_prims, begin, end, bounds, centroid_bounds, axis);
+            make_leaf = (mid == begin || mid == end) && count <= max_leaf;
+        } else {
+            make_leaf = count <= max_leaf;
+        }
+        if (!make_leaf && (mid == begin || mid == end)) {
+            mid = begin + count / 2;
+            std::nth_element(build_prims.begin() + static_cast<std::ptrdiff_t>(begin),
+                             build_prims.begin() + static_cast<std::ptrdiff_t>(mid),
+                             build_prims.begin() + static_cast<std::ptrdiff_t>(end),
+                             [axis](const BuildPrimitive& a, const BuildPrimitive& b) {
+                                 return a.centroid[axis] < b.centroid[axis];
+                             });
+        }
+    }
+
+    if (make_leaf) {
+        LinearBVHNode& leaf = nodes[node_index];
+        leaf.box = bounds;
+        leaf.offset = static_cast<uint32_t>(refs.size());
+        leaf.count = static_cast<uint16_t>(count);
+        for (size_t i = begin; i < end; ++i) {
+            refs.push_back(build_prims[i].index);
+            prim_leaf[build_prims[i].index] = node_index;
+        }
+        return;
+    }
+
+    const uint32_t first_child = static_cast<uint32_t>(nodes.size());
+    nodes.emplace_back();
+    nodes.emplace_back();
+    parents.push_back(node_index);
+    parents.push_back(node_index);
+
+    LinearBVHNode& interior = nodes[node_index];
+    interior.box = bounds;
+    interior.offset = first_child;
+    interior.count = 0;
+    interior.axis = static_cast<uint16_t>(axis);
+
+    build_node(first_child, build_prims, begin, mid, method, depth + 1);
+    build_node(first_child + 1, build_prims, mid, end, method, depth + 1);
+}
+
+// Returns the partition point of the cheapest binned SAH split, or `begin` when
+// keeping the range as a leaf is cheaper (or no split separates the centroids).
+inline size_t LinearBVH::partition_sah(std::vector<BuildPrimitive>& build_prims, size_t begin,
+                                       size_t end, const AABB& bounds, const AABB& centroid_bounds,
+                                       int& axis) const {
+    const size_t count = end - begin;
+    axis = centroid_bounds.longest_axis();
+    const double cmin = centroid_bounds.min()[axis];
+    const double extent = centroid_bounds.max()[axis] - cmin;
+    const double parent_area = bounds.surface_area();
+    if (!(extent > 0.0) || !(parent_area > 0.0)) {
+        return begin;
+    }
+
+    struct Bin {
+        AABB box = AABB::empty();
+        size_t count = 0;
+    };
+    Bin bins[kBins];
+    const double bin_scale = kBins / extent;
+    auto bin_of = [&](const BuildPrimitive& p) {
+        const int b = static_cast<int>((p.centroid[axis] - cmin) * bin_scale);
+        return std::clamp(b, 0, kBins - 1);
+    };
+
+    for (size_t i = begin; i < end; ++i) {
+        Bin& bin = bins[bin_of(build_prims[i])];
+        bin.box.expand(build_prims[i].box);
+        ++bin.count;
+    }
+
+    double right_area[kBins - 1];
+    size_t right_count[kBins - 1];
+    AABB right_box = AABB::empty();
+    size_t right_total = 0;
+    for (int b = kBins - 1; b > 0; --b) {
+        right_box.expand(bins[b].box);
+        right_total += bins[b].count;
+        right_area[b - 1] = right_box.surface_area();
+        right_count[b - 1] = right_total;
+    }
+
+    double best_cost = infinity;
+    int best_split = -1;
+    AABB left_box = AABB::empty();
+    size_t left_total = 0;
+    for (int b = 0; b < kBins - 1; ++b) {
+        left_box.expand(bins[b].box);
+        left_total += bins[b].count;
+        if (left_total == 0 || right_count[b] == 0) {
+            continue;
+        }
+        const double cost = left_box.surface_area() * static_cast<double>(left_total) +
+                            right_area[b] * static_cast<double>(right_count[b]);
+        if (cost < best_cost) {
+            best_cost = cost;
+            best_split = b;
+        }
+    }
+
+    if (best_split < 0) {
+        return begin;
+    }
+
+    const double split_cost = 0.5 + best_cost / parent_area;
+    const double leaf_cost = static_cast<double>(count);
+    if (count <= max_leaf && leaf_cost <= split_cost) {
+        return begin;
+    }
+
+    const auto middle = std::partition(
+        build_prims.begin() + static_cast<std::ptrdiff_t>(begin),
+        build_prims.begin() + static_cast<std::ptrdiff_t>(end),
+        [&](const BuildPrimitive& p) { return bin_of(p) <= best_split; });
+    return static_cast<size_t>(middle - build_prims.begin());
+}
+
+inline void LinearBVH::make_leaf(uint32_t node_index, const std::vector<BuildPrimitive>& node_refs,
+                                 const AABB& bounds) {
+    LinearBVHNode& leaf = nodes[node_index];
+    leaf.box = bounds;
+    leaf.offset = static_cast<uint32_t>(refs.size());
+    leaf.count = static_cast<uint16_t>(node_refs.size());
+    for (const BuildPrimitive& ref : node_refs) {
+        refs.push_back(ref.index);
+        uint32_t& owner = prim_leaf[ref.index];
+        owner = owner == kInvalidIndex ? node_index : kDuplicatedLeaf;
+    }
+}
+
+// Best binned SAH object split over all three axes.
+inline LinearBVH::SplitCandidate LinearBVH::find_object_split(
+    const std::vector<BuildPrimitive>& node_refs) const {
+    AABB centroid_bounds = AABB::empty();
+    for (const BuildPrimitive& ref : node_refs) {
+        centroid_bounds.expand(ref.centroid);
+    }
+
+    SplitCandidate best;
+    for (int axis = 0; axis < 3; ++axis) {
+        const double cmin = centroid_bounds.min()[axis];
+        const double extent = centroid_bounds.max()[axis] - cmin;
+        if (!(extent > 0.0)) {
+            continue;
+        }
+        const double scale = kBins / extent;
+
+        AABB bin_box[kBins];
+        size_t bin_count[kBins] = {};
+        for (int b = 0; b < kBins; ++b) {
+            bin_box[b] = AABB::empty();
+        }
+        for (const BuildPrimitive& ref : node_refs) {
+            const int b = std::clamp(static_cast<int>((ref.centroid[axis] - cmin) * scale), 0, kBins - 1);
+            bin_box[b].expand(ref.box);
+            ++bin_count[b];
+        }
+
+        AABB right_box[kBins];
+        size_t right_count[kBins] = {};
+        AABB accum = AABB::empty();
+        size_t total = 0;
+        for (int b = kBins - 1; b > 0; --b) {
+            accum.expand(bin_box[b]);
+            total += bin_count[b];
+            right_box[b] = accum;
+            right_count[b] = total;
+        }
+
+        AABB left_box = AABB::empty();
+        size_t left_count = 0;
+        for (int b = 0; b < kBins - 1; ++b) {
+            left_box.expand(bin_box[b]);
+            left_count += bin_count[b];
+            if (left_count == 0 || right_count[b + 1] == 0) {
+                continue;
+            }
+            const double cost = left_box.surface_area() * static_cast<double>(left_count) +
+                                right_box[b + 1].surface_area() * static_cast<double>(right_count[b + 1]);
+            if (cost < best.cost) {
+                best.cost = cost;
+                best.axis = axis;
+                best.bin = b;
+                best.spatial = false;
+                best.origin = cmin;
+                best.scale = scale;
+                best.overlap = intersect_boxes(left_box, right_box[b + 1]).surface_area();
+            }
+        }
+    }
+    return best;
+}
+
+// Best binned spatial split: references are clipped into every bin they span,
+// so the children's boxes are tight even where large primitives straddle.
+inline LinearBVH::SplitCandidate LinearBVH::find_spatial_split(
+    const std::vector<BuildPrimitive>& node_refs, const AABB& bounds) const {
+    SplitCandidate best;
+
+    for (int axis = 0; axis < 3; ++axis) {
+        const double lo = bounds.min()[axis];
+        const double extent = bounds.max()[axis] - lo;
+        if (!(extent > 0.0)) {
+            continue;
+        }
+        const double width = extent / kBins;
+        auto bin_of = [&](double x) {
+            return std::clamp(static_cast<int>((x - lo) / width), 0, kBins - 1);
+        };
+
+        AABB bin_box[kBins];
+        size_t entries[kBins] = {};
+        size_t exits[kBins] = {};
+        for (int b = 0; b < kBins; ++b) {
+            bin_box[b] = AABB::empty();
+        }
+
+        for (const BuildPrimitive& ref : node_refs) {
+            const int first = bin_of(ref.box.min()[axis]);
+            const int last = bin_of(ref.box.max()[axis]);
+            ++entries[first];
+            ++exits[last];
+            for (int b = first; b <= last; ++b) {
+                Point3 slab_min = ref.box.min();
+                Point3 slab_max = ref.box.max();
+                slab_min[axis] = std::fmax(slab_min[axis], lo + b * width);
+                slab_max[axis] = std::fmin(slab_max[axis], lo + (b + 1) * width);
+                AABB clipped;
+                if (primitives[ref.index]->clipped_bounding_box(AABB(slab_min, slab_max), clipped)) {
+                    bin_box[b].expand(clipped);
+                }
+            }
+        }
+
+        AABB right_box[kBins];
+        size_t right_count[kBins] = {};
+        AABB accum = AABB::empty();
+        size_t total = 0;
+        for (int b = kBins - 1; b > 0; --b) {
+            accum.expand(bin_box[b]);
+            total += exits[b];
+            right_box[b] = accum;
+            right_count[b] = total;
+        }
+
+        AABB left_box = AABB::empty();
+        size_t left_count = 0;
+        for (int b = 0; b < kBins - 1; ++b) {
+            left_box.expand(bin_box[b]);
+            left_count += entries[b];
+            const size_t right = right_count[b + 1];
+            if (left_count == 0 || right == 0 ||
+                (left_count == node_refs.size() && right == node_refs.size())) {
+                continue;
+            }
+            const double cost = left_box.surface_area() * static_cast<double>(left_count) +
+                                right_box[b + 1].surface_area() * static_cast<double>(right);
+            if (cost < best.cost) {
+                best.cost = cost;
+                best.axis = axis;
+                best.bin = b;
+                best.spatial = true;
+                best.position = lo + (b + 1) * width;
+                best.duplicates = left_count + right - node_refs.size();
+            }
+        }
+    }
+    return best;
+}
+
+inline void LinearBVH::build_sbvh_node(uint32_t node_index, std::vector<BuildPrimitive>& node_refs,
+                                       int depth, SpatialBuildState& state) {
+    AABB bounds = AABB::empty();
+    for (const BuildPrimitive& ref : node_refs) {
+        bounds.expand(ref.box);
+    }
+    const size_t count = node_refs.size();
+    if (count == 1) {
+        make_leaf(node_index, node_refs, bounds);
+        return;
+    }
+
+    std::vector<BuildPrimitive> left_refs;
+    std::vector<BuildPrimitive> right_refs;
+    const double area = bounds.surface_area();
+    int split_axis = -1;
+
+    if (depth < kStackSize / 2 && area > 0.0) {
+        SplitCandidate best = find_object_split(node_refs);
+        if (state.remaining_budget >= 1.0 && best.axis >= 0 &&
+            best.overlap > state.settings.overlap_threshold * state.root_area) {
+            const SplitCandidate spatial = find_spatial_split(node_refs, bounds);
+            if (spatial.cost < best.cost &&
+                static_cast<double>(spatial.duplicates) <= state.remaining_budget) {
+                best = spatial;
+            }
+        } else if (best.axis < 0 && state.remaining_budget >= 1.0) {
+            // All centroids coincide: only a spatial split can separate them.
+            const SplitCandidate spatial = find_spatial_split(node_refs, bounds);
+            if (static_cast<double>(spatial.duplicates) <= state.remaining_budget) {
+                best = spatial;
+            }
+        }
+
+        const double split_cost = 0.5 + best.cost / area;
+        if (count <= max_leaf && static_cast<double>(count) <= split_cost) {
+            make_leaf(node_index, node_refs, bounds);
+            return;
+        }
+
+        split_axis = best.axis;
+        if (best.axis >= 0 && best.spatial) {
+            for (const BuildPrimitive& ref : node_refs) {
+                if (ref.box.max()[best.axis] <= best.position) {
+                    left_refs.push_back(ref);
+                } else if (ref.box.min()[best.axis] >= best.position) {
+                    right_refs.push_back(ref);
+                } else {
+                    Point3 left_max = ref.box.max();
+                    Point3 right_min = ref.box.min();
+                    left_max[best.axis] = best.position;
+                    right_min[best.axis] = best.position;
+                    BuildPrimitive left = ref;
+                    BuildPrimitive right = ref;
+                    const Hitable& prim = *primitives[ref.index];
+                    const bool has_left = prim.clipped_bounding_box(AABB(ref.box.min(), left_max), left.box);
+                    const bool has_right = prim.clipped_bounding_box(AABB(right_min, ref.box.max()), right.box);
+                    if (has_left) {
+                        left.centroid = left.box.centroid();
+                        left_refs.push_back(left);
+                    }
+                    if (has_right) {
+                        right.centroid = right.box.centroid();
+                        right_refs.push_back(right);
+                    }
+                    if (!has_left && !has_right) {
+                        left_refs.push_back(ref);
+                    }
+                }
+            }
+        } else if (best.axis >= 0) {
+            for (const BuildPrimitive& ref : node_refs) {
+                const int b = std::clamp(static_cast<int>((ref.centroid[best.axis] - best.origin) * best.scale),
+                                         0, kBins - 1);
+                (b <= best.bin ? left_refs : right_refs).push_back(ref);
+            }
+        }
+    }
+
+    if (left_refs.empty() || right_refs.empty()) {
+        if (count <= max_leaf) {
+            make_leaf(node_index, node_refs, bounds);
+            return;
+        }
+        const int axis = bounds.longest_axis();
+        split_axis = axis;
+        const size_t mid = count / 2;
+        std::nth_element(node_refs.begin(), node_refs.begin() + static_cast<std::ptrdiff_t>(mid), node_refs.end(),
+                         [axis](const BuildPrimitive& a, const BuildPrimitive& b) {
+                             return a.centroid[axis] < b.centroid[axis];
+                         });
+        left_refs.assign(node_refs.begin(), node_refs.begin() + static_cast<std::ptrdiff_t>(mid));
+        right_refs.assign(node_refs.begin() + static_cast<std::ptrdiff_t>(mid), node_refs.end());
+    }
+
+    const size_t children_refs = left_refs.size() + right_refs.size();
+    if (children_refs > count) {
+        state.remaining_budget -= static_cast<double>(children_refs - count);
+    }
+    std::vector<BuildPrimitive>().swap(node_refs);
+
+    const uint32_t first_child = static_cast<uint32_t>(nodes.size());
+    nodes.emplace_back();
+    nodes.emplace_back();
+    parents.push_back(node_index);
+    parents.push_back(node_index);
+
+    LinearBVHNode& interior = nodes[node_index];
+    interior.box = bounds;
+    interior.offset = first_child;
+    interior.count = 0;
+    interior.axis = static_cast<uint16_t>(split_axis);
+
+    build_sbvh_node(first_child, left_refs, depth + 1, state);
+    build_sbvh_node(first_child + 1, right_refs, depth + 1, state);
+}
+
+inline AABB LinearBVH::leaf_bounds(const LinearBVHNode& leaf) const {
+    AABB bounds = AABB::empty();
+    for (uint32_t k = 0; k < leaf.count; ++k) {
+        AABB box;
+        if (!primitives[refs[leaf.offset + k]]->bounding_box(box)) {
+            throw std::runtime_error("No bounding box in LinearBVH refit.");
+        }
+        bounds.expand(box);
+    }
+    return bounds;
+}
+
+inline void LinearBVH::refit() {
+    for (size_t i = nodes.size(); i-- > 0;) {
+        LinearBVHNode& node = nodes[i];
+        if (node.count > 0) {
+            node.box = leaf_bounds(node);
+        } else {
+            node.box = surrounding_box(nodes[node.offset].box, nodes[node.offset + 1].box);
+        }
+    }
+}
+
+inline void LinearBVH::refit(size_t primitive_index) {
+    uint32_t current = prim_leaf.at(primitive_index);
+    if (current == kInvalidIndex || current == kDuplicatedLeaf) {
+        refit();
+        return;
+    }
+
+    nodes[current].box = leaf_bounds(nodes[current]);
+    current = parents[current];
+    while (current != kInvalidIndex) {
+        LinearBVHNode& node = nodes[current];
+        node.box = surrounding_box(nodes[node.offset].box, nodes[node.offset + 1].box);
+        current = parents[current];
+    }
+}
+
+inline BVHUpdate LinearBVH::update(size_t moved, const BVHUpdatePolicy& policy) {
+    const BVHUpdate action = choose_bvh_update(moved, primitives.size(), policy);
+    switch (action) {
+    case BVHUpdate::None:
+        break;
+    case BVHUpdate::Refit:
+        refit();
+        break;
+    case BVHUpdate::FastRebuild:
+        build(BVHBuildMethod::LBVH);
+        break;
+    case BVHUpdate::FullRebuild:
+        build(BVHBuildMethod::SAH);
+        break;
+    }
+    return action;
+}
+
+inline void LinearBVH::set_layout(BVHLayout layout) {
+    if (layout == node_layout) {
+        return;
+    }
+    node_layout = layout;
+    apply_layout();
+}
+
+inline void LinearBVH::apply_layout() {
+    const size_t unit_count = (nodes.size() + 1) / 2;
+    if (unit_count < 3) {
+        return;
+    }
+
+    auto unit_of = [](uint32_t node) { return (node + 1) / 2; };
+    auto first_node = [](uint32_t unit) { return unit == 0 ? 0u : 2 * unit - 1; };
+
+    std::vector<std::array<uint32_t, 2>> children(unit_count, {kInvalidIndex, kInvalidIndex});
+    for (uint32_t unit = 0; unit < unit_count; ++unit) {
+        const uint32_t slot_count = unit == 0 ? 1 : 2;
+        for (uint32_t slot = 0; slot < slot_count; ++slot) {
+            const LinearBVHNode& node = nodes[first_node(unit) + slot];
+            if (node.count == 0) {
+                children[unit][slot] = unit_of(node.offset);
+            }
+        }
+    }
+
+    std::vector<uint32_t> order;
+    order.reserve(unit_count);
+    if (node_layout == BVHLayout::DepthFirst) {
+        // Rebuild the builder's order: a pair's children pairs follow it depth-first.
+        std::vector<uint32_t> stack = {0};
+        while (!stack.empty()) {
+            const uint32_t unit = stack.back();
+            stack.pop_back();
+            order.push_back(unit);
+            for (int slot = 1; slot >= 0; --slot) {
+                if (children[unit][slot] != kInvalidIndex) {
+                    stack.push_back(children[unit][slot]);
+                }
+            }
+        }
+    } else if (node_layout == BVHLayout::Treelet) {
+        order_treelets(children, order);
+    } else {
+        // Children always follow their parent, so one reverse sweep yields heights.
+        std::vector<uint32_t> heights(unit_count, 1);
+        for (size_t unit = unit_count; unit-- > 0;) {
+            for (uint32_t child : children[unit]) {
+                if (child != kInvalidIndex) {
+                    heights[unit] = std::max(heights[unit], heights[child] + 1);
+                }
+            }
+        }
+        order_van_emde_boas(0, heights[0], children, heights, order);
+    }
+
+    std::vector<uint32_t> new_unit(unit_count);
+    for (uint32_t position = 0; position < unit_count; ++position) {
+        new_unit[order[position]] = position;
+    }
+    auto remap = [&](uint32_t node) {
+        return first_node(new_unit[unit_of(node)]) + (node == 0 ? 0 : (node + 1) % 2);
+    };
+
+    std::vector<LinearBVHNode> reordered(nodes.size());
+    std::vector<uint32_t> reordered_parents(nodes.size());
+    for (uint32_t node = 0; node < nodes.size(); ++node) {
+        const uint32_t target = remap(node);
+        reordered[target] = nodes[node];
+        if (nodes[node].count == 0) {
+            reordered[target].offset = remap(nodes[node].offset);
+        }
+        reordered_parents[target] = parents[node] == kInvalidIndex ? kInvalidIndex : remap(parents[node]);
+    }
+    for (uint32_t& leaf : prim_leaf) {
+        if (leaf < kDuplicatedLeaf) {
+            leaf = remap(leaf);
+        }
+    }
+    nodes.swap(reordered);
+    parents.swap(reordered_parents);
+}
+
+// Grows each treelet from its root by repeatedly adding the unit with the
+// largest surface area, i.e. the one most likely to be visited next, until the
+// treelet fills a page. Units left on the frontier root the following treelets,
+// which are emitted depth-first so neighbouring treelets stay close as well.
+inline void LinearBVH::order_treelets(const std::vector<std::array<uint32_t, 2>>& children,
+                                      std::vector<uint32_t>& order) const {
+    const size_t units_per_treelet = std::max<size_t>(1, kTreeletBytes / (2 * sizeof(LinearBVHNode)));
+    auto unit_area = [&](uint32_t unit) {
+        if (unit == 0) {
+            return nodes[0].box.surface_area();
+        }
+        return surrounding_box(nodes[2 * unit - 1].box, nodes[2 * unit].box).surface_area();
+    };
+
+    std::vector<uint32_t> roots = {0};
+    std::vector<std::pair<double, uint32_t>> frontier;
+    while (!roots.empty()) {
+        frontier.assign(1, {unit_area(roots.back()), roots.back()});
+        roots.pop_back();
+
+        for (size_t emitted = 0; emitted < units_per_treelet && !frontier.empty(); ++emitted) {
+            std::pop_heap(frontier.begin(), frontier.end());
+            const uint32_t unit = frontier.back().second;
+            frontier.pop_back();
+            order.push_back(unit);
+            for (uint32_t child : children[unit]) {
+                if (child != kInvalidIndex) {
+                    frontier.emplace_back(unit_area(child), child);
+                    std::push_heap(frontier.begin(), frontier.end());
+                }
+            }
+        }
+
+        // Largest remaining subtree is laid out next.
+        std::sort(frontier.begin(), frontier.end());
+        for (const auto& entry : frontier) {
+            roots.push_back(entry.second);
+        }
+    }
+}
+
+// Lays out the top `height` levels below `unit`: the upper half of those levels
+// recursively, then each subtree hanging off it, again recursively. Any subtree
+// of height h then spans O(h / log B) blocks for every block size B.
+inline void LinearBVH::order_van_emde_boas(uint32_t unit, uint32_t height,
+                                           const std::vector<std::array<uint32_t, 2>>& children,
+                                           const std::vector<uint32_t>& heights,
+                                           std::vector<uint32_t>& order) const {
+    height = std::min(height, heights[unit]);
+    if (height <= 1) {
+        order.push_back(unit);
+        return;
+    }
+
+    const uint32_t top = height / 2;
+    order_van_emde_boas(unit, top, children, heights, order);
+
+    std::vector<uint32_t> level = {unit};
+    std::vector<uint32_t> next;
+    for (uint32_t depth = 0; depth < top; ++depth) {
+        next.clear();
+        for (uint32_t parent : level) {
+            for (uint32_t child : children[parent]) {
+                if (child != kInvalidIndex) {
+                    next.push_back(child);
+                }
+            }
+        }
+        level.swap(next);
+    }
+    for (uint32_t subtree : level) {
+        order_van_emde_boas(subtree, height - top, children, heights, order);
+    }
+}
+
+template <typename Stats>
+inline bool LinearBVH::traverse(const Ray& r, double t_min, double t_max, HitRecord& rec,
+                                Stats& stats, uint32_t* hit_primitive) const {
+    if (nodes.empty()) {
+        return false;
+    }
+
+    const Point3 origin = r.origin();
+    const Vec3 dir = r.direction();
+    const Vec3 inv_dir(1.0 / dir.x(), 1.0 / dir.y(), 1.0 / dir.z());
+
+    double entry = 0.0;
+    stats.visit_node(nodes[0]);
+    if (!hit_box(nodes[0].box, origin, inv_dir, t_min, t_max, entry)) {
+        return false;
+    }
+
+    uint32_t stack_node[kStackSize];
+    double stack_entry[kStackSize];
+    int stack_size = 0;
+    uint32_t current = 0;
+    bool hit_anything = false;
+    double closest = t_max;
+
+    while (true) {
+        const LinearBVHNode& node = nodes[current];
+        if (node.count > 0) {
+            for (uint32_t k = 0; k < node.count; ++k) {
+                stats.test_primitive();
+                const uint32_t prim = refs[node.offset + k];
+                if (primitives[prim]->hit(r, t_min, closest, rec)) {
+                    hit_anything = true;
+                    closest = rec.t;
+                    if (hit_primitive) {
+                        *hit_primitive = prim;
+                    }
+                }
+            }
+        } else {
+            const uint32_t first = node.offset;
+            double t_first = 0.0;
+            double t_second = 0.0;
+            stats.visit_node(nodes[first]);
+            stats.visit_node(nodes[first + 1]);
+            const bool hit_first = hit_box(nodes[first].box, origin, inv_dir, t_min, closest, t_first);
+            const bool hit_second = hit_box(nodes[first + 1].box, origin, inv_dir, t_min, closest, t_second);
+
+            if (hit_first && hit_second) {
+                const bool second_is_near = t_second < t_first;
+                stack_node[stack_size] = second_is_near ? first : first + 1;
+                stack_entry[stack_size] = second_is_near ? t_first : t_second;
+                ++stack_size;
+                current = second_is_near ? first + 1 : first;
+                continue;
+            }
+            if (hit_first || hit_second) {
+                current = hit_first ? first : first + 1;
+                continue;
+            }
+        }
+
+        bool found = false;
+        while (stack_size > 0) {
+            --stack_size;
+            if (stack_entry[stack_size] <= closest) {
+                current = stack_node[stack_size];
+                found = true;
+                break;
+            }
+        }
+        if (!found) {
+            break;
+        }
+    }
+
+    return hit_anything;
+}
+
+// Any-hit traversal: the interval never shrinks, so children are visited in
+// storage order without computing entry distances or sorting the stack.
+template <typename Stats>
+inline bool LinearBVH::traverse_any(const Ray& r, double t_min, double t_max, Stats& stats) const {
+    if (nodes.empty()) {
+        return false;
+    }
+
+    const Point3 origin = r.origin();
+    const Vec3 dir = r.direction();
+    const Vec3 inv_dir(1.0 / dir.x(), 1.0 / dir.y(), 1.0 / dir.z());
+
+    double entry = 0.0;
+    stats.visit_node(nodes[0]);
+    if (!hit_box(nodes[0].box, origin, inv_dir, t_min, t_max, entry)) {
+        return false;
+    }
+
+    uint32_t stack[kStackSize];
+    int stack_size = 0;
+    uint32_t current = 0;
+
+    while (true) {
+        const LinearBVHNode& node = nodes[current];
+        if (node.count > 0) {
+            for (uint32_t k = 0; k < node.count; ++k) {
+                stats.test_primitive();
+                if (primitives[refs[node.offset + k]]->occluded(r, t_min, t_max)) {
+                    return true;
+                }
+            }
+        } else {
+            const uint32_t first = node.offset;
+            stats.visit_node(nodes[first]);
+            stats.visit_node(nodes[first + 1]);
+            const bool hit_first = hit_box(nodes[first].box, origin, inv_dir, t_min, t_max, entry);
+            const bool hit_second = hit_box(nodes[first + 1].box, origin, inv_dir, t_min, t_max, entry);
+
+            if (hit_first && hit_second) {
+                stack[stack_size++] = first + 1;
+                current = first;
+                continue;
+            }
+            if (hit_first || hit_second) {
+                current = hit_first ? first : first + 1;
+                continue;
+            }
+        }
+
+        if (stack_size == 0) {
+            return false;
+        }
+        current = stack[--stack_size];
+    }
+}
+
+inline bool LinearBVH::hit(const Ray& r, double t_min, double t_max, HitRecord& rec) const {
+    NoTraversalStats stats;
+    return traverse(r, t_min, t_max, rec, stats);
+}
+
+inline bool LinearBVH::hit(const Ray& r, double t_min, double t_max, HitRecord& rec,
+                           BVHTraversalStats& stats) const {
+    return traverse(r, t_min, t_max, rec, stats);
+}
+
+inline bool LinearBVH::hit(const Ray& r, double t_min, double t_max, HitRecord& rec,
+                           uint32_t& primitive_index) const {
+    NoTraversalStats stats;
+    return traverse(r, t_min, t_max, rec, stats, &primitive_index);
+}
+
+inline bool LinearBVH::occluded(const Ray& r, double t_min, double t_max) const {
+    NoTraversalStats stats;
+    return traverse_any(r, t_min, t_max, stats);
+}
+
+inline bool LinearBVH::occluded(const Ray& r, double t_min, double t_max, BVHTraversalStats& stats) const {
+    return traverse_any(r, t_min, t_max, stats);
+}
+
+inline bool LinearBVH::bounding_box(AABB& output_box) const {
+    if (nodes.empty()) {
+        return false;
+    }
+    output_box = nodes[0].box;
+    return true;
+}
+
+#endif // RAYTRACER_LINEAR_BVH_H
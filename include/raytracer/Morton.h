@@ -0,0 +1,156 @@
+#ifndef RAYTRACER_MORTON_H
+#define RAYTRACER_MORTON_H
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "raytracer/ThreadPool.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Morton (Z-order) codes and a parallel LSD radix sort for key/value pairs.
+
+inline int count_leading_zeros64(uint64_t v) {
+    if (v == 0) {
+        return 64;
+    }
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_clzll(v);
+#elif defined(_MSC_VER) && defined(_M_X64)
+    unsigned long index = 0;
+    _BitScanReverse64(&index, v);
+    return 63 - static_cast<int>(index);
+#else
+    int n = 0;
+    while ((v & (1ULL << 63)) == 0) {
+        v <<= 1;
+        ++n;
+    }
+    return n;
+#endif
+}
+
+// Spreads the low 10 bits of v so that two zero bits separate each input bit.
+inline uint32_t expand_bits_10(uint32_t v) {
+    v &= 0x3ffu;
+    v = (v | (v << 16)) & 0x030000ffu;
+    v = (v | (v << 8)) & 0x0300f00fu;
+    v = (v | (v << 4)) & 0x030c30c3u;
+    v = (v | (v << 2)) & 0x09249249u;
+    return v;
+}
+
+// Spreads the low 21 bits of v so that two zero bits separate each input bit.
+inline uint64_t expand_bits_21(uint64_t v) {
+    v &= 0x1fffffULL;
+    v = (v | (v << 32)) & 0x001f00000000ffffULL;
+    v = (v | (v << 16)) & 0x001f0000ff0000ffULL;
+    v = (v | (v << 8)) & 0x100f00f00f00f00fULL;
+    v = (v | (v << 4)) & 0x10c30c30c30c30c3ULL;
+    v = (v | (v << 2)) & 0x1249249249249249ULL;
+    return v;
+}
+
+// Coordinates are expected in [0, 1]; values outside are clamped.
+inline uint32_t morton3d_30(double x, double y, double z) {
+    auto quantize = [](double v) {
+        return static_cast<uint32_t>(std::clamp(v * 1024.0, 0.0, 1023.0));
+    };
+    return (expand_bits_10(quantize(x)) << 2) | (expand_bits_10(quantize(y)) << 1) |
+           expand_bits_10(quantize(z));
+}
+
+inline uint64_t morton3d_63(double x, double y, double z) {
+    auto quantize = [](double v) {
+        return static_cast<uint64_t>(std::clamp(v * 2097152.0, 0.0, 2097151.0));
+    };
+    return (expand_bits_21(quantize(x)) << 2) | (expand_bits_21(quantize(y)) << 1) |
+           expand_bits_21(quantize(z));
+}
+
+// Stable LSD radix sort of `keys` (8 bits per pass over the low `key_bits`
+// bits), permuting `values` alongside. Each pass builds per-block histograms in
+// parallel, prefix-sums them serially (256 x blocks) and scatters in parallel.
+inline void radix_sort_pairs(std::vector<uint64_t>& keys, std::vector<uint32_t>& values,
+                             int key_bits, ThreadPool& pool = ThreadPool::global()) {
+    const size_t n = keys.size();
+    if (n < 2) {
+        return;
+    }
+
+    constexpr size_t kRadix = 256;
+    constexpr size_t kMinBlock = 16384;
+    const size_t blocks = std::max<size_t>(1, std::min<size_t>(pool.size() * 2, n / kMinBlock));
+    const size_t block_size = (n + blocks - 1) / blocks;
+
+    std::vector<uint64_t> key_scratch(n);
+    std::vector<uint32_t> value_scratch(n);
+    std::vector<size_t> histogram(blocks * kRadix);
+
+    uint64_t* src_keys = keys.data();
+    uint32_t* src_values = values.data();
+    uint64_t* dst_keys = key_scratch.data();
+    uint32_t* dst_values = value_scratch.data();
+    bool in_scratch = false;
+
+    for (int shift = 0; shift < key_bits; shift += 8) {
+        std::fill(histogram.begin(), histogram.end(), 0);
+        pool.parallel_for(blocks, 1, [&](size_t first, size_t last) {
+            for (size_t b = first; b < last; ++b) {
+                size_t* h = histogram.data() + b * kRadix;
+                const size_t end = std::min(n, (b + 1) * block_size);
+                for (size_t i = b * block_size; i < end; ++i) {
+                    ++h[(src_keys[i] >> shift) & 0xff];
+                }
+            }
+        });
+
+        // All keys share this digit: the pass would be an identity permutation.
+        bool trivial = false;
+        for (size_t digit = 0; digit < kRadix && !trivial; ++digit) {
+            size_t total = 0;
+            for (size_t b = 0; b < blocks; ++b) {
+                total += histogram[b * kRadix + digit];
+            }
+            trivial = total == n;
+        }
+        if (trivial) {
+            continue;
+        }
+
+        size_t running = 0;
+        for (size_t digit = 0; digit < kRadix; ++digit) {
+            for (size_t b = 0; b < blocks; ++b) {
+                const size_t count = histogram[b * kRadix + digit];
+                histogram[b * kRadix + digit] = running;
+                running += count;
+            }
+        }
+
+        pool.parallel_for(blocks, 1, [&](size_t first, size_t last) {
+            for (size_t b = first; b < last; ++b) {
+                size_t* offsets = histogram.data() + b * kRadix;
+                const size_t end = std::min(n, (b + 1) * block_size);
+                for (size_t i = b * block_size; i < end; ++i) {
+                    const size_t slot = offsets[(src_keys[i] >> shift) & 0xff]++;
+                    dst_keys[slot] = src_keys[i];
+                    dst_values[slot] = src_values[i];
+                }
+            }
+        });
+
+        std::swap(src_keys, dst_keys);
+        std::swap(src_values, dst_values);
+        in_scratch = !in_scratch;
+    }
+
+    if (in_scratch) {
+        keys.swap(key_scratch);
+        values.swap(value_scratch);
+    }
+}
+
+#endif // RAYTRACER_MORTON_H
@@ -0,0 +1,427 @@
+#ifndef RAYTRACER_PATH_GUIDING_H
+#define RAYTRACER_PATH_GUIDING_H
+
+#include <atomic>
+
+#include "raytracer/RayTracer.h"
+
+// Path guiding with a spatial-directional tree (Müller et al. 2017, "Practical
+// Path Guiding for Efficient Light-Transport Simulation").
+//
+// A binary tree splits the scene bounds in space; every leaf owns a quadtree
+// over the sphere of directions (cylindrical equal-area map, cos(theta) and
+// phi on the unit square). Rendering passes record the radiance that reaches
+// each path vertex along its sampled direction into the leaf's "building"
+// quadtree. end_pass() splits spatial leaves that received many records and
+// rebuilds each quadtree so that cells holding more than a fixed fraction of
+// the energy are subdivided; the rebuilt trees become the sampling
+// distribution for the next pass. trace_path() draws directions from the
+// guide or the BSDF and weights them by the mixture density, so guiding never
+// removes BSDF samples, it only adds directions where light was found.
+//
+// Records use relaxed atomic adds, so any number of render threads can train
+// the same tree. end_pass() must not run concurrently with rendering.
+
+struct GuidingSettings {
+    // Probability of sampling the BSDF instead of the guide at a vertex.
+    double bsdf_fraction = 0.5;
+    // A spatial leaf splits once a pass records more than
+    // spatial_threshold * sqrt(2^pass) samples in it; passes are expected to
+    // double their sample count, as in the paper.
+    double spatial_threshold = 4000.0;
+    // Quadtree cells holding more than this fraction of a leaf's energy are
+    // subdivided.
+    double energy_fraction = 0.01;
+    int max_directional_depth = 20;
+    // Spatial splitting stops once the tree holds this many bytes.
+    size_t memory_budget = size_t(64) << 20;
+};
+
+// Quadtree over the unit square of directions.
+class DirectionalTree {
+public:
+    DirectionalTree() : nodes(1) {}
+
+    // Unit direction with density pdf(); uniform until a distribution is built.
+    Vec3 sample() const;
+    // Solid-angle density.
+    double pdf(const Vec3& direction) const;
+    void record(const Vec3& direction, double value);
+
+    // Energy-driven subdivision of this tree's statistics; the result samples
+    // proportionally to them.
+    DirectionalTree refined(double energy_fraction, int max_depth) const;
+    // Keeps the structure and forgets the statistics.
+    void clear();
+    // Halves all statistics; used when a spatial leaf splits in two.
+    void scale(double factor);
+
+    size_t node_count() const { return nodes.size(); }
+    size_t memory_bytes() const { return sizeof(*this) + nodes.capacity() * sizeof(Node); }
+    uint64_t sample_count() const { return samples.load(std::memory_order_relaxed); }
+    double total() const { return nodes[0].sum.load(std::memory_order_relaxed); }
+
+    static Vec3 direction_of(double u, double v);
+    static void square_of(const Vec3& direction, double& u, double& v);
+
+    DirectionalTree(const DirectionalTree& other);
+    DirectionalTree& operator=(const DirectionalTree& other);
+
+private:
+    static constexpr uint32_t kNoSource = 0xffffffffu;
+
+    struct Node {
+        std::atomic<double> sum{0.0};
+        uint32_t first_child = 0;  // 0: leaf; otherwise four consecutive children
+
+        Node() {}
+        Node(const Node& other)
+            : sum(other.sum.load(std::memory_order_relaxed)), first_child(other.first_child) {}
+        Node& operator=(const Node& other) {
+            sum.store(other.sum.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            first_child = other.first_child;
+            return *this;
+        }
+    };
+
+    // Sums of interior nodes from their leaves.
+    double accumulate(uint32_t index);
+    void refine_node(DirectionalTree& out, uint32_t out_index, uint32_t index, double energy, double threshold,
+                     int depth, int max_depth) const;
+
+    std::vector<Node> nodes;
+    std::atomic<uint64_t> samples{0};
+};
+
+class SDTree {
+public:
+    explicit SDTree(const AABB& bounds, const GuidingSettings& settings = GuidingSettings());
+
+    const GuidingSettings& settings() const { return guide_settings; }
+    // False until the first end_pass(); before that there is nothing to guide by.
+    bool trained() const { return completed_passes > 0; }
+    int passes() const { return completed_passes; }
+    // trace_path() records paths while this is on.
+    bool training() const { return is_training; }
+    void set_training(bool enabled) { is_training = enabled; }
+
+    // Sampling distribution of the leaf holding `p`; look it up once per vertex
+    // when both sampling and densities are needed.
+    const DirectionalTree& distribution(const Point3& p) const { return leaves[leaf_of(p)].sampling; }
+    Vec3 sample(const Point3& p) const;
+    double pdf(const Point3& p, const Vec3& direction) const;
+    // Radiance (luminance) arriving at `p` from `direction`, divided by the
+    // density the direction was sampled with.
+    void record(const Point3& p, const Vec3& direction, double radiance_over_pdf);
+
+    // Refines space and directions from the pass just rendered and switches
+    // sampling to the new distributions.
+    void end_pass();
+
+    size_t spatial_leaves() const { return leaves.size(); }
+    size_t directional_nodes() const;
+    size_t memory_bytes() const;
+
+private:
+    struct SpatialNode {
+        uint32_t first_child = 0;  // 0: leaf; otherwise two consecutive children
+        uint32_t leaf = 0;
+        int axis = 0;
+    };
+
+    struct Leaf {
+        DirectionalTree sampling;
+        DirectionalTree building;
+    };
+
+    uint32_t leaf_of(const Point3& p) const;
+    void split(uint32_t node_index, double threshold);
+
+    AABB bounds;
+    GuidingSettings guide_settings;
+    std::vector<SpatialNode> nodes;
+    std::vector<Leaf> leaves;
+    int completed_passes = 0;
+    bool is_training = true;
+};
+
+namespace guiding_detail {
+
+inline void atomic_add(std::atomic<double>& target, double value) {
+    double current = target.load(std::memory_order_relaxed);
+    while (!target.compare_exchange_weak(current, current + value, std::memory_order_relaxed)) {
+    }
+}
+
+}
+
+inline DirectionalTree::DirectionalTree(const DirectionalTree& other)
+    : nodes(other.nodes), samples(other.samples.load(std::memory_order_relaxed)) {}
+
+inline DirectionalTree& DirectionalTree::operator=(const DirectionalTree& other) {
+    nodes = other.nodes;
+    samples.store(other.samples.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    return *this;
+}
+
+// (u, v) = ((cos(theta) + 1) / 2, phi / 2 pi); equal areas on the square are
+// equal solid angles, 4 pi in total.
+inline Vec3 DirectionalTree::direction_of(double u, double v) {
+    const double z = 2.0 * u - 1.0;
+    const double r = std::sqrt(std::fmax(0.0, 1.0 - z * z));
+    double s = 0.0;
+    double c = 0.0;
+    sin_cos_turn(v, s, c);
+    return Vec3(r * c, r * s, z);
+}
+
+inline void DirectionalTree::square_of(const Vec3& direction, double& u, double& v) {
+    const Vec3 d = unit_vector(direction);
+    u = clamp(0.5 * (d.z() + 1.0), 0.0, 1.0);
+    double phi = std::atan2(d.y(), d.x());
+    if (phi < 0.0) {
+        phi += 2.0 * pi;
+    }
+    v = clamp(phi / (2.0 * pi), 0.0, 1.0);
+}
+
+inline Vec3 DirectionalTree::sample() const {
+    double u = 0.0;
+    double v = 0.0;
+    double size = 1.0;
+    uint32_t index = 0;
+    while (nodes[index].first_child != 0) {
+        const uint32_t first = nodes[index].first_child;
+        double sums[4];
+        double total_sum = 0.0;
+        for (int k = 0; k < 4; ++k) {
+            sums[k] = nodes[first + k].sum.load(std::memory_order_relaxed);
+            total_sum += sums[k];
+        }
+        int k = 3;
+        if (total_sum > 0.0) {
+            double pick = random_double() * total_sum;
+            for (int c = 0; c < 3; ++c) {
+                if (pick < sums[c]) {
+                    k = c;
+                    break;
+                }
+                pick -= sums[c];
+            }
+        } else {
+            k = std::min(3, static_cast<int>(4.0 * random_double()));
+        }
+        size *= 0.5;
+        u += (k & 1) ? size : 0.0;
+        v += (k & 2) ? size : 0.0;
+        index = first + static_cast<uint32_t>(k);
+    }
+    return direction_of(u + size * random_double(), v + size * random_double());
+}
+
+inline double DirectionalTree::pdf(const Vec3& direction) const {
+    double u = 0.0;
+    double v = 0.0;
+    square_of(direction, u, v);
+    // Density on the unit square, then divided by its 4 pi steradians.
+    double density = 1.0;
+    uint32_t index = 0;
+    while (nodes[index].first_child != 0) {
+        const uint32_t first = nodes[index].first_child;
+        double total_sum = 0.0;
+        for (int k = 0; k < 4; ++k) {
+            total_sum += nodes[first + k].sum.load(std::memory_order_relaxed);
+        }
+        const int k = (u >= 0.5 ? 1 : 0) | (v >= 0.5 ? 2 : 0);
+        u = 2.0 * u - (k & 1);
+        v = 2.0 * v - ((k & 2) >> 1);
+        if (total_sum > 0.0) {
+            density *= 4.0 * nodes[first + k].sum.load(std::memory_order_relaxed) / total_sum;
+        }
+        index = first + static_cast<uint32_t>(k);
+    }
+    return density / (4.0 * pi);
+}
+
+inline void DirectionalTree::record(const Vec3& direction, double value) {
+    // Dark records still count towards spatial refinement, which follows the
+    // density of path vertices rather than their energy.
+    samples.fetch_add(1, std::memory_order_relaxed);
+    if (!(value > 0.0) || std::isinf(value)) {
+        return;
+    }
+    double u = 0.0;
+    double v = 0.0;
+    square_of(direction, u, v);
+    uint32_t index = 0;
+    while (nodes[index].first_child != 0) {
+        const int k = (u >= 0.5 ? 1 : 0) | (v >= 0.5 ? 2 : 0);
+        u = 2.0 * u - (k & 1);
+        v = 2.0 * v - ((k & 2) >> 1);
+        index = nodes[index].first_child + static_cast<uint32_t>(k);
+    }
+    guiding_detail::atomic_add(nodes[index].sum, value);
+}
+
+inline double DirectionalTree::accumulate(uint32_t index) {
+    Node& node = nodes[index];
+    if (node.first_child == 0) {
+        return node.sum.load(std::memory_order_relaxed);
+    }
+    double total_sum = 0.0;
+    for (uint32_t k = 0; k < 4; ++k) {
+        total_sum += accumulate(node.first_child + k);
+    }
+    node.sum.store(total_sum, std::memory_order_relaxed);
+    return total_sum;
+}
+
+inline DirectionalTree DirectionalTree::refined(double energy_fraction, int max_depth) const {
+    DirectionalTree statistics(*this);
+    const double total_energy = statistics.accumulate(0);
+    DirectionalTree out;
+    out.nodes.reserve(nodes.size());
+    statistics.refine_node(out, 0, 0, total_energy, energy_fraction * total_energy, 0, max_depth);
+    return out;
+}
+
+inline void DirectionalTree::refine_node(DirectionalTree& out, uint32_t out_index, uint32_t index, double energy,
+                                         double threshold, int depth, int max_depth) const {
+    out.nodes[out_index].sum.store(energy, std::memory_order_relaxed);
+    if (depth >= max_depth || !(energy > threshold) || threshold <= 0.0) {
+        return;
+    }
+    const uint32_t first = static_cast<uint32_t>(out.nodes.size());
+    out.nodes.resize(out.nodes.size() + 4);
+    out.nodes[out_index].first_child = first;
+    // Leaves without finer statistics spread their energy evenly.
+    const uint32_t source = index == kNoSource ? kNoSource : nodes[index].first_child;
+    for (uint32_t k = 0; k < 4; ++k) {
+        const bool known = source != kNoSource && source != 0;
+        const double child_energy = known ? nodes[source + k].sum.load(std::memory_order_relaxed) : 0.25 * energy;
+        refine_node(out, first + k, known ? source + k : kNoSource, child_energy, threshold, depth + 1, max_depth);
+    }
+}
+
+inline void DirectionalTree::clear() {
+    for (Node& node : nodes) {
+        node.sum.store(0.0, std::memory_order_relaxed);
+    }
+    samples.store(0, std::memory_order_relaxed);
+}
+
+inline void DirectionalTree::scale(double factor) {
+    for (Node& node : nodes) {
+        node.sum.store(factor * node.sum.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+    samples.store(static_cast<uint64_t>(factor * samples.load(std::memory_order_relaxed)), std::memory_order_relaxed);
+}
+
+inline SDTree::SDTree(const AABB& scene_bounds, const GuidingSettings& settings)
+    : bounds(scene_bounds), guide_settings(settings), nodes(1), leaves(1) {
+    if (bounds.is_empty()) {
+        throw std::invalid_argument("SDTree requires non-empty scene bounds.");
+    }
+    if (!(settings.bsdf_fraction >= 0.0 && settings.bsdf_fraction <= 1.0)) {
+        throw std::invalid_argument("GuidingSettings::bsdf_fraction must lie in [0, 1].");
+    }
+    // Cubic bounds keep the cells of alternating splits close to cubes.
+    const Vec3 extent = bounds.max() - bounds.min();
+    const double side = std::fmax(extent.x(), std::fmax(extent.y(), extent.z()));
+    bounds = AABB(bounds.min(), bounds.min() + Vec3(side, side, side));
+}
+
+inline uint32_t SDTree::leaf_of(const Point3& p) const {
+    Point3 lo = bounds.min();
+    Point3 hi = bounds.max();
+    uint32_t index = 0;
+    while (nodes[index].first_child != 0) {
+        const int axis = nodes[index].axis;
+        const double mid = 0.5 * (lo[axis] + hi[axis]);
+        const bool upper = p[axis] >= mid;
+        Vec3 new_lo = lo;
+        Vec3 new_hi = hi;
+        if (upper) {
+            new_lo.e[axis] = mid;
+        } else {
+            new_hi.e[axis] = mid;
+        }
+        lo = new_lo;
+        hi = new_hi;
+        index = nodes[index].first_child + (upper ? 1u : 0u);
+    }
+    return nodes[index].leaf;
+}
+
+inline Vec3 SDTree::sample(const Point3& p) const {
+    return leaves[leaf_of(p)].sampling.sample();
+}
+
+inline double SDTree::pdf(const Point3& p, const Vec3& direction) const {
+    return leaves[leaf_of(p)].sampling.pdf(direction);
+}
+
+inline void SDTree::record(const Point3& p, const Vec3& direction, double radiance_over_pdf) {
+    leaves[leaf_of(p)].building.record(direction, radiance_over_pdf);
+}
+
+inline void SDTree::split(uint32_t node_index, double threshold) {
+    const uint32_t leaf_index = nodes[node_index].leaf;
+    if (static_cast<double>(leaves[leaf_index].building.sample_count()) <= threshold ||
+        memory_bytes() >= guide_settings.memory_budget) {
+        return;
+    }
+    // The two halves start from the parent's statistics, each with half the weight.
+    leaves[leaf_index].building.scale(0.5);
+    const uint32_t first = static_cast<uint32_t>(nodes.size());
+    const int child_axis = (nodes[node_index].axis + 1) % 3;
+    nodes[node_index].first_child = first;
+    nodes.push_back(SpatialNode{0, leaf_index, child_axis});
+    nodes.push_back(SpatialNode{0, static_cast<uint32_t>(leaves.size()), child_axis});
+    const Leaf copy = leaves[leaf_index];
+    leaves.push_back(copy);
+    split(first, threshold);
+    split(first + 1, threshold);
+}
+
+inline void SDTree::end_pass() {
+    const double threshold =
+        guide_settings.spatial_threshold * std::sqrt(std::ldexp(1.0, std::min(completed_passes, 60)));
+    const size_t existing = nodes.size();
+    for (size_t i = 0; i < existing; ++i) {
+        if (nodes[i].first_child == 0) {
+            split(static_cast<uint32_t>(i), threshold);
+        }
+    }
+    for (Leaf& leaf : leaves) {
+        // Leaves that saw nothing this pass keep their distribution.
+        if (leaf.building.sample_count() > 0) {
+            DirectionalTree next =
+                leaf.building.refined(guide_settings.energy_fraction, guide_settings.max_directional_depth);
+            if (next.total() > 0.0) {
+                leaf.sampling = next;
+            }
+            leaf.building = std::move(next);
+        }
+        leaf.building.clear();
+    }
+    ++completed_passes;
+}
+
+inline size_t SDTree::directional_nodes() const {
+    size_t count = 0;
+    for (const Leaf& leaf : leaves) {
+        count += leaf.sampling.node_count() + leaf.building.node_count();
+    }
+    return count;
+}
+
+inline size_t SDTree::memory_bytes() const {
+    size_t bytes = nodes.capacity() * sizeof(SpatialNode) + (leaves.capacity() - leaves.size()) * sizeof(Leaf);
+    for (const Leaf& leaf : leaves) {
+        bytes += leaf.sampling.memory_bytes() + leaf.building.memory_bytes();
+    }
+    return bytes;
+}
+
+#endif // RAYTRACER_PATH_GUIDING_H
@@ -0,0 +1,328 @@
+#ifndef RAYTRACER_PROGRESSIVE_H
+#define RAYTRACER_PROGRESSIVE_H
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "raytracer/Denoiser.h"
+
+// Progressive rendering with low-latency restarts for interactive cameras.
+//
+// The renderer keeps the scene and its acceleration structure and adds one
+// sample per pixel per pass into a PixelAccumulator per pixel. Passes run
+// tiles on the ThreadPool and report each finished tile, so the display
+// refines over the whole frame instead of finishing tile by tile.
+//
+// set_camera() may be called from any thread. It bumps a generation counter
+// that every sample checks before it is traced, so a pass in flight stops
+// within one path; the next pass clears the film and starts over from the
+// new view. Nothing else is rebuilt. First-hit features are always gathered
+// so the film can feed the denoiser and AOVs.
+//
+// With preview levels, the first passes after a restart are coarse-to-fine
+// stages instead: the first traces one pixel in 2^levels x 2^levels of every
+// tile, each next stage halves that stride, and the last completes 1 spp.
+// A stage only traces the pixels the coarser stages skipped, so the preview
+// costs nothing on top of the first full pass; every traced sample stays in
+// the film. display() upscales the finest traced pixel of each block until
+// its own pixel has a sample.
+//
+// A RenderRegion schedules the frame around a region of interest without
+// restarting it. In Focus mode tiles touching the region run first and on
+// every pass, the others on every outside_interval-th pass, so the region
+// gets that many times the sample budget. Crop mode renders the region's
+// tiles only. Preview stages and the first full pass cover the whole frame
+// in Focus mode so the rest of the image is never left empty.
+//
+// Every sample reseeds its thread's generator from the renderer's seed, the
+// full pass it belongs to and the pixel index, so a film is reproducible
+// regardless of thread count and a resumed film (see Checkpoint.h) continues
+// with exactly the samples the interrupted run would have drawn.
+
+// The user-editable camera, in the terms of Camera's constructor.
+struct CameraParams {
+    Point3 lookfrom = Point3(13, 2, 3);
+    Point3 lookat = Point3(0, 0, 0);
+    Vec3 vup = Vec3(0, 1, 0);
+    double vfov = 20.0;  // vertical, degrees
+    double aperture = 0.1;
+    double focus_dist = 10.0;
+
+    Camera camera(double aspect_ratio) const {
+        return Camera(lookfrom, lookat, vup, vfov, aspect_ratio, aperture, focus_dist);
+    }
+};
+
+enum class RegionMode { Off, Focus, Crop };
+
+// Pixel rectangle (row 0 at the top, end exclusive) and how passes treat it.
+struct RenderRegion {
+    int x0 = 0;
+    int y0 = 0;
+    int x1 = 0;
+    int y1 = 0;
+    RegionMode mode = RegionMode::Off;
+    int outside_interval = 4;  // Focus: passes per sample outside the region
+
+    bool empty() const { return x1 <= x0 || y1 <= y0; }
+    bool overlaps(int tx0, int ty0, int tx1, int ty1) const { return tx0 < x1 && x0 < tx1 && ty0 < y1 && y0 < ty1; }
+};
+
+class ProgressiveRenderer {
+public:
+    ProgressiveRenderer(const Hitable& world, const LightSampler& lights, int width, int height,
+                        const PathTracerSettings& settings = PathTracerSettings(), int tile_size = 16,
+                        int preview_levels = 0);
+
+    int width() const { return image_width; }
+    int height() const { return image_height; }
+    int tile_size() const { return tile; }
+    int preview_levels() const { return levels; }
+
+    // Thread safe; interrupts the pass in flight and restarts accumulation.
+    // Returns the generation whose passes show the new view.
+    uint64_t set_camera(const CameraParams& params);
+    CameraParams camera() const;
+    // Restarts accumulation without changing the view.
+    uint64_t restart();
+    // Seed of the per-sample streams; applies from the next pass.
+    void set_seed(uint64_t value) { sample_seed = value; }
+    uint64_t seed() const { return sample_seed; }
+    // Replaces the film with `film` after `passes` full passes of `view`, as
+    // if this renderer had drawn them. Not thread safe against render_pass().
+    // Throws std::invalid_argument unless passes >= 1 and the film matches
+    // the image size.
+    void resume(const CameraParams& view, int passes, std::vector<PixelAccumulator> film);
+
+    // Thread safe; applies from the next pass and keeps the film. The
+    // rectangle is clipped to the image; an empty one disables the region.
+    // Throws std::invalid_argument if outside_interval < 1.
+    void set_region(const RenderRegion& region);
+    RenderRegion region() const;
+    // Generation of the film being accumulated; compare with set_camera()'s
+    // result to tell stale tiles from new ones.
+    uint64_t film_generation() const { return current_generation.load(std::memory_order_acquire); }
+
+    // Adds one sample to every pixel, or runs the next preview stage,
+    // calling on_tile(x0, y0, x1, y1) from a pool thread as each tile
+    // finishes (rows top to bottom, end exclusive). Returns false when a
+    // restart interrupted the pass; its samples are discarded by the next
+    // pass. Not reentrant: one caller drives passes.
+    template <typename OnTile>
+    bool render_pass(OnTile&& on_tile);
+
+    // View of the film being accumulated (the caller of render_pass() only).
+    const CameraParams& film_view() const { return film_params; }
+    // Completed full passes since the last restart; 1 once the preview is done.
+    int passes() const { return completed_passes; }
+    // Pixel stride of the stage the current or next pass runs: 2^levels down
+    // to 2 while previewing, 1 for full passes. Resets with the film.
+    int stage_stride() const { return stride; }
+    // Display color: the pixel's mean, or that of the finest traced pixel of
+    // its preview block while it has no sample yet.
+    Color display(int x, int y) const;
+    // Accumulators in display order (row 0 at the top). Stable between passes.
+    const PixelAccumulator& pixel(int x, int y) const { return pixels[static_cast<size_t>(y) * image_width + x]; }
+    const std::vector<PixelAccumulator>& film() const { return pixels; }
+
+private:
+    const Hitable& world;
+    const LightSampler& lights;
+    PathTracerSettings settings;
+    int image_width;
+    int image_height;
+    int tile;
+    int levels;
+    uint64_t sample_seed = 0x5eed;
+
+    // Guards the view and region requested by other threads.
+    mutable std::mutex control_mutex;
+    CameraParams params;
+    RenderRegion roi;
+    std::atomic<uint64_t> generation{1};          // latest requested view
+    std::atomic<uint64_t> current_generation{0};  // view the film holds
+
+    // Owned by the thread that calls render_pass().
+    CameraParams film_params;
+    Camera film_camera;
+    std::vector<PixelAccumulator> pixels;
+    int completed_passes = 0;
+    int stride = 1;
+};
+
+inline ProgressiveRenderer::ProgressiveRenderer(const Hitable& world, const LightSampler& lights, int width,
+                                                int height, const PathTracerSettings& settings, int tile_size,
+                                                int preview_levels)
+    : world(world), lights(lights), settings(settings), image_width(width), image_height(height), tile(tile_size),
+      levels(preview_levels), film_camera(params.camera(1.0)) {
+    if (width <= 0 || height <= 0 || tile_size <= 0) {
+        throw std::invalid_argument("ProgressiveRenderer requires a positive size and tile size.");
+    }
+    if (preview_levels < 0 || preview_levels > 8) {
+        throw std::invalid_argument("ProgressiveRenderer preview levels must be in [0, 8].");
+    }
+    pixels.resize(static_cast<size_t>(width) * height);
+}
+
+inline uint64_t ProgressiveRenderer::set_camera(const CameraParams& camera_params) {
+    std::lock_guard<std::mutex> lock(control_mutex);
+    params = camera_params;
+    return generation.fetch_add(1, std::memory_order_release) + 1;
+}
+
+inline CameraParams ProgressiveRenderer::camera() const {
+    std::lock_guard<std::mutex> lock(control_mutex);
+    return params;
+}
+
+inline uint64_t ProgressiveRenderer::restart() {
+    return generation.fetch_add(1, std::memory_order_release) + 1;
+}
+
+inline void ProgressiveRenderer::resume(const CameraParams& view, int passes, std::vector<PixelAccumulator> film) {
+    if (passes < 1 || film.size() != pixels.size()) {
+        throw std::invalid_argument("ProgressiveRenderer::resume needs a film of the image size after a full pass.");
+    }
+    std::lock_guard<std::mutex> lock(control_mutex);
+    params = view;
+    const uint64_t resumed = generation.fetch_add(1, std::memory_order_release) + 1;
+    film_params = view;
+    film_camera = view.camera(static_cast<double>(image_width) / image_height);
+    pixels = std::move(film);
+    completed_passes = passes;
+    stride = 1;
+    current_generation.store(resumed, std::memory_order_release);
+}
+
+inline void ProgressiveRenderer::set_region(const RenderRegion& region) {
+    if (region.outside_interval < 1) {
+        throw std::invalid_argument("RenderRegion outside_interval must be at least 1.");
+    }
+    RenderRegion clipped = region;
+    clipped.x0 = std::max(0, region.x0);
+    clipped.y0 = std::max(0, region.y0);
+    clipped.x1 = std::min(image_width, region.x1);
+    clipped.y1 = std::min(image_height, region.y1);
+    if (clipped.empty()) {
+        clipped.mode = RegionMode::Off;
+    }
+    std::lock_guard<std::mutex> lock(control_mutex);
+    roi = clipped;
+}
+
+inline RenderRegion ProgressiveRenderer::region() const {
+    std::lock_guard<std::mutex> lock(control_mutex);
+    return roi;
+}
+
+template <typename OnTile>
+inline bool ProgressiveRenderer::render_pass(OnTile&& on_tile) {
+    uint64_t pass_generation = 0;
+    RenderRegion pass_region;
+    {
+        std::lock_guard<std::mutex> lock(control_mutex);
+        pass_region = roi;
+        pass_generation = generation.load(std::memory_order_acquire);
+        if (pass_generation != current_generation.load(std::memory_order_relaxed)) {
+            film_params = params;
+            film_camera = params.camera(static_cast<double>(image_width) / image_height);
+            current_generation.store(pass_generation, std::memory_order_release);
+            std::fill(pixels.begin(), pixels.end(), PixelAccumulator());
+            completed_passes = 0;
+            stride = 1 << levels;
+        }
+    }
+
+    // Preview lattices are anchored at tile origins so a tile never waits on
+    // its neighbours; stage `stride` traces the points coarser ones skipped.
+    const int pass_stride = completed_passes == 0 ? stride : 1;
+    const int coarser = 2 * pass_stride;
+    const bool first_full_pass = completed_passes == 0;
+    const auto traced = [&](int dx, int dy) {
+        if (dx % pass_stride != 0 || dy % pass_stride != 0) {
+            return false;
+        }
+        const bool covered = coarser <= (1 << levels) && dx % coarser == 0 && dy % coarser == 0;
+        return !(first_full_pass && levels > 0 && covered);
+    };
+
+    // Tiles of the region first; the pool picks them up roughly in order.
+    const int tiles_x = (image_width + tile - 1) / tile;
+    const int tiles_y = (image_height + tile - 1) / tile;
+    const bool outside_due = pass_region.mode == RegionMode::Focus &&
+                             (completed_passes == 0 || completed_passes % pass_region.outside_interval == 0);
+    std::vector<int> order;
+    order.reserve(static_cast<size_t>(tiles_x) * tiles_y);
+    std::vector<int> outside;
+    for (int t = 0; t < tiles_x * tiles_y; ++t) {
+        const int x0 = (t % tiles_x) * tile;
+        const int y0 = (t / tiles_x) * tile;
+        if (pass_region.mode == RegionMode::Off ||
+            pass_region.overlaps(x0, y0, std::min(x0 + tile, image_width), std::min(y0 + tile, image_height))) {
+            order.push_back(t);
+        } else if (outside_due) {
+            outside.push_back(t);
+        }
+    }
+    order.insert(order.end(), outside.begin(), outside.end());
+
+    const double inv_width = 1.0 / std::max(1, image_width - 1);
+    const double inv_height = 1.0 / std::max(1, image_height - 1);
+    // Preview stages belong to the first full pass.
+    const uint64_t pass_seed = splitmix64(sample_seed + static_cast<uint64_t>(completed_passes));
+    std::atomic<bool> interrupted{false};
+    parallel_for(order.size(), 1, [&](size_t tile_begin, size_t tile_end) {
+        for (size_t i = tile_begin; i < tile_end; ++i) {
+            const int t = order[i];
+            const int x0 = (t % tiles_x) * tile;
+            const int y0 = (t / tiles_x) * tile;
+            const int x1 = std::min(x0 + tile, image_width);
+            const int y1 = std::min(y0 + tile, image_height);
+            for (int y = y0; y < y1; ++y) {
+                const int j = image_height - 1 - y;
+                for (int x = x0; x < x1; ++x) {
+                    if (!traced(x - x0, y - y0)) {
+                        continue;
+                    }
+                    if (generation.load(std::memory_order_relaxed) != pass_generation) {
+                        interrupted.store(true, std::memory_order_relaxed);
+                        return;
+                    }
+                    const size_t index = static_cast<size_t>(y) * image_width + x;
+                    seed_thread_rng(pass_seed ^ splitmix64(index));
+                    const Ray ray = film_camera.get_ray((x + random_double()) * inv_width, (j + random_double()) * inv_height);
+                    HitFeatures hit;
+                    const Color radiance = trace_path(ray, world, lights, settings, &hit);
+                    pixels[index].add(radiance, hit);
+                }
+            }
+            on_tile(x0, y0, x1, y1);
+        }
+    });
+
+    if (interrupted.load(std::memory_order_relaxed) || generation.load(std::memory_order_acquire) != pass_generation) {
+        return false;
+    }
+    if (pass_stride > 1) {
+        stride = pass_stride / 2;
+    } else {
+        ++completed_passes;
+    }
+    return true;
+}
+
+inline Color ProgressiveRenderer::display(int x, int y) const {
+    const int x0 = x - x % tile;
+    const int y0 = y - y % tile;
+    for (int block = 1; block <= (1 << levels); block *= 2) {
+        const PixelAccumulator& anchor = pixel(x0 + (x - x0) / block * block, y0 + (y - y0) / block * block);
+        if (anchor.samples() > 0) {
+            return anchor.mean();
+        }
+    }
+    return Color(0, 0, 0);
+}
+
+#endif // RAYTRACER_PROGRESSIVE_H
@@ -0,0 +1,414 @@
+#ifndef RAYTRACER_QUANTIZED_BVH_H
+#define RAYTRACER_QUANTIZED_BVH_H
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include "raytracer/LinearBVH.h"
+
+// Compressed BVH for traversal-bound scenes whose hierarchy no longer fits in
+// cache.
+//
+// One QuantizedBVHNode describes the two children of a LinearBVH interior node:
+// their boxes are stored as 8-bit offsets on a per-axis power-of-two grid
+// anchored at the parent's minimum corner (the scheme of compressed wide BVHs,
+// Ylitie et al. 2017, applied to sibling pairs). Minimums round down and
+// maximums round up, so decoded boxes always contain the exact ones and
+// traversal returns the same hits as the source hierarchy. A child pair takes
+// 40 bytes instead of 112.
+//
+// The structure is immutable; rebuild it from a refit or rebuilt LinearBVH.
+
+struct QuantizedBVHNode {
+    float origin[3];        // grid origin, <= parent minimum
+    int8_t exponent[3];     // grid spacing 2^exponent per axis
+    uint8_t leaf_mask = 0;  // bit i set: child i is a leaf
+    uint8_t lo[2][3];       // child minimum, in grid steps from origin
+    uint8_t hi[2][3];       // child maximum, in grid steps from origin
+    uint8_t count[2];       // primitives per leaf child
+    uint32_t child[2];      // interior: node index; leaf: first entry in refs
+};
+
+static_assert(sizeof(QuantizedBVHNode) == 40, "QuantizedBVHNode layout changed");
+
+class QuantizedBVH : public Hitable {
+public:
+    QuantizedBVH() {}
+    explicit QuantizedBVH(const LinearBVH& source);
+
+    bool hit(const Ray& r, double t_min, double t_max, HitRecord& rec) const override;
+    bool bounding_box(AABB& output_box) const override;
+
+    // Same as hit() but also counts fetched nodes (one per child pair) and
+    // primitive tests.
+    bool hit(const Ray& r, double t_min, double t_max, HitRecord& rec, BVHTraversalStats& stats) const;
+
+    bool occluded(const Ray& r, double t_min, double t_max) const override;
+    bool occluded(const Ray& r, double t_min, double t_max, BVHTraversalStats& stats) const;
+
+    size_t node_count() const { return nodes.size(); }
+    const QuantizedBVHNode& node(size_t index) const { return nodes[index]; }
+    size_t memory_bytes() const {
+        return nodes.size() * sizeof(QuantizedBVHNode) + refs.size() * sizeof(uint32_t);
+    }
+
+    // Decoded (conservative) box of child `slot` of `node`.
+    static AABB child_box(const QuantizedBVHNode& node, int slot);
+
+private:
+    static double exp2i(int exponent);
+    static QuantizedBVHNode encode(const AABB& parent, const AABB children[2]);
+
+    template <typename Stats>
+    bool traverse(const Ray& r, double t_min, double t_max, HitRecord& rec, Stats& stats) const;
+    template <typename Stats>
+    bool traverse_any(const Ray& r, double t_min, double t_max, Stats& stats) const;
+    template <typename Stats>
+    bool occluded_leaf(uint32_t first, uint32_t count, const Ray& r, double t_min, double t_max,
+                       Stats& stats) const;
+    template <typename Stats>
+    bool hit_leaf(uint32_t first, uint32_t count, const Ray& r, double t_min, double& closest,
+                  HitRecord& rec, Stats& stats) const;
+
+    std::vector<std::shared_ptr<Hitable>> primitives;
+    std::vector<uint32_t> refs;
+    std::vector<QuantizedBVHNode> nodes;
+    AABB root_box;
+    uint32_t root_leaf_count = 0;  // non-zero when the whole tree is one leaf
+};
+
+// 2^exponent for the int8 range, assembled from the IEEE-754 exponent field.
+inline double QuantizedBVH::exp2i(int exponent) {
+    const uint64_t bits = static_cast<uint64_t>(exponent + 1023) << 52;
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+inline AABB QuantizedBVH::child_box(const QuantizedBVHNode& node, int slot) {
+    Point3 lo;
+    Point3 hi;
+    for (int axis = 0; axis < 3; ++axis) {
+        const double scale = exp2i(node.exponent[axis]);
+        lo[axis] = node.origin[axis] + node.lo[slot][axis] * scale;
+        hi[axis] = node.origin[axis] + node.hi[slot][axis] * scale;
+    }
+    return AABB(lo, hi);
+}
+
+inline QuantizedBVHNode QuantizedBVH::encode(const AABB& parent, const AABB children[2]) {
+    QuantizedBVHNode node{};
+    for (int axis = 0; axis < 3; ++axis) {
+        const double min = parent.min()[axis];
+        float origin = static_cast<float>(min);
+        if (origin > min) {
+            origin = std::nextafter(origin, -std::numeric_limits<float>::infinity());
+        }
+        const double extent = parent.max()[axis] - origin;
+
+        int exponent = -126;
+        if (extent > 0.0) {
+            exponent = std::max(-126, std::ilogb(extent / 255.0));
+            while (exp2i(exponent) * 255.0 < extent) {
+                ++exponent;
+            }
+        }
+        if (exponent > 127) {
+            throw std::invalid_argument("QuantizedBVH: scene extent exceeds the quantization range.");
+        }
+        const double scale = exp2i(exponent);
+        node.origin[axis] = origin;
+        node.exponent[axis] = static_cast<int8_t>(exponent);
+
+        for (int slot = 0; slot < 2; ++slot) {
+            const double cmin = children[slot].min()[axis];
+            const double cmax = children[slot].max()[axis];
+            int lo = std::clamp(static_cast<int>(std::floor((cmin - origin) / scale)), 0, 255);
+            int hi = std::clamp(static_cast<int>(std::ceil((cmax - origin) / scale)), 0, 255);
+            // The divisions round; step until the decoded bounds are conservative.
+            while (lo > 0 && origin + lo * scale > cmin) {
+                --lo;
+            }
+            while (hi < 255 && origin + hi * scale < cmax) {
+                ++hi;
+            }
+            node.lo[slot][axis] = static_cast<uint8_t>(lo);
+            node.hi[slot][axis] = static_cast<uint8_t>(hi);
+        }
+    }
+    return node;
+}
+
+inline QuantizedBVH::QuantizedBVH(const LinearBVH& source) {
+    if (source.node_count() == 0) {
+        throw std::invalid_argument("QuantizedBVH requires a built LinearBVH.");
+    }
+    primitives.reserve(source.primitive_count());
+    for (size_t i = 0; i < source.primitive_count(); ++i) {
+        primitives.push_back(source.primitive(i));
+    }
+    refs.resize(source.reference_count());
+    for (size_t i = 0; i < refs.size(); ++i) {
+        refs[i] = source.reference(i);
+    }
+
+    const LinearBVHNode& root = source.node(0);
+    root_box = root.box;
+    if (root.count > 0) {
+        root_leaf_count = root.count;
+        nodes.push_back(QuantizedBVHNode{});
+        nodes[0].child[0] = root.offset;
+        return;
+    }
+
+    // Interior nodes are emitted in depth-first order; `pending` holds pairs of
+    // (source interior node, quantized node slot).
+    nodes.reserve(source.node_count() / 2);
+    nodes.emplace_back();
+    std::vector<std::pair<uint32_t, uint32_t>> pending = {{0u, 0u}};
+    while (!pending.empty()) {
+        const auto [source_index, target] = pending.back();
+        pending.pop_back();
+
+        const LinearBVHNode& parent = source.node(source_index);
+        const AABB children[2] = {source.node(parent.offset).box, source.node(parent.offset + 1).box};
+        QuantizedBVHNode encoded = encode(parent.box, children);
+        for (int slot = 1; slot >= 0; --slot) {
+            const uint32_t child_index = parent.offset + static_cast<uint32_t>(slot);
+            const LinearBVHNode& child = source.node(child_index);
+            if (child.count > 0) {
+                encoded.leaf_mask |= static_cast<uint8_t>(1u << slot);
+                encoded.count[slot] = static_cast<uint8_t>(child.count);
+                encoded.child[slot] = child.offset;
+            } else {
+                encoded.child[slot] = static_cast<uint32_t>(nodes.size());
+                nodes.emplace_back();
+                pending.emplace_back(child_index, encoded.child[slot]);
+            }
+        }
+        nodes[target] = encoded;
+    }
+}
+
+template <typename Stats>
+inline bool QuantizedBVH::hit_leaf(uint32_t first, uint32_t count, const Ray& r, double t_min,
+                                   double& closest, HitRecord& rec, Stats& stats) const {
+    bool hit_anything = false;
+    for (uint32_t k = 0; k < count; ++k) {
+        stats.test_primitive();
+        if (primitives[refs[first + k]]->hit(r, t_min, closest, rec)) {
+            hit_anything = true;
+            closest = rec.t;
+        }
+    }
+    return hit_anything;
+}
+
+template <typename Stats>
+inline bool QuantizedBVH::traverse(const Ray& r, double t_min, double t_max, HitRecord& rec,
+                                   Stats& stats) const {
+    if (nodes.empty()) {
+        return false;
+    }
+
+    const Point3 origin = r.origin();
+    const Vec3 dir = r.direction();
+    const Vec3 inv_dir(1.0 / dir.x(), 1.0 / dir.y(), 1.0 / dir.z());
+
+    double entry = 0.0;
+    if (!hit_box(root_box, origin, inv_dir, t_min, t_max, entry)) {
+        return false;
+    }
+    double closest = t_max;
+    if (root_leaf_count > 0) {
+        return hit_leaf(nodes[0].child[0], root_leaf_count, r, t_min, closest, rec, stats);
+    }
+
+    uint32_t stack_node[LinearBVH::kStackSize];
+    double stack_entry[LinearBVH::kStackSize];
+    int stack_size = 0;
+    uint32_t current = 0;
+    bool hit_anything = false;
+
+    while (true) {
+        const QuantizedBVHNode& node = nodes[current];
+        stats.visit_node(node);
+
+        // Both children are decoded and slab-tested lane by lane; the fixed-size
+        // loops vectorize, and no branch depends on the lane until the end.
+        double lane_near[2];
+        double lane_far[2];
+        for (int slot = 0; slot < 2; ++slot) {
+            lane_near[slot] = t_min;
+            lane_far[slot] = closest;
+        }
+        for (int axis = 0; axis < 3; ++axis) {
+            const double scale = exp2i(node.exponent[axis]);
+            const double base = node.origin[axis] - origin[axis];
+            for (int slot = 0; slot < 2; ++slot) {
+                double t0 = (base + node.lo[slot][axis] * scale) * inv_dir[axis];
+                double t1 = (base + node.hi[slot][axis] * scale) * inv_dir[axis];
+                if (inv_dir[axis] < 0.0) {
+                    std::swap(t0, t1);
+                }
+                lane_near[slot] = t0 > lane_near[slot] ? t0 : lane_near[slot];
+                lane_far[slot] = t1 < lane_far[slot] ? t1 : lane_far[slot];
+            }
+        }
+        bool lane_hit[2] = {lane_near[0] <= lane_far[0], lane_near[1] <= lane_far[1]};
+
+        // Leaves are resolved immediately, nearest first; a hit there can cull
+        // the interior sibling before it is ever pushed.
+        const int near_slot = lane_near[1] < lane_near[0] ? 1 : 0;
+        for (int slot : {near_slot, 1 - near_slot}) {
+            if (lane_hit[slot] && (node.leaf_mask & (1u << slot))) {
+                if (lane_near[slot] <= closest &&
+                    hit_leaf(node.child[slot], node.count[slot], r, t_min, closest, rec, stats)) {
+                    hit_anything = true;
+                }
+                lane_hit[slot] = false;
+            }
+        }
+        for (int slot = 0; slot < 2; ++slot) {
+            lane_hit[slot] = lane_hit[slot] && lane_near[slot] <= closest;
+        }
+
+        if (lane_hit[0] && lane_hit[1]) {
+            stack_node[stack_size] = node.child[1 - near_slot];
+            stack_entry[stack_size] = lane_near[1 - near_slot];
+            ++stack_size;
+            current = node.child[near_slot];
+            continue;
+        }
+        if (lane_hit[0] || lane_hit[1]) {
+            current = node.child[lane_hit[0] ? 0 : 1];
+            continue;
+        }
+
+        bool found = false;
+        while (stack_size > 0) {
+            --stack_size;
+            if (stack_entry[stack_size] <= closest) {
+                current = stack_node[stack_size];
+                found = true;
+                break;
+            }
+        }
+        if (!found) {
+            break;
+        }
+    }
+
+    return hit_anything;
+}
+
+template <typename Stats>
+inline bool QuantizedBVH::occluded_leaf(uint32_t first, uint32_t count, const Ray& r, double t_min,
+                                        double t_max, Stats& stats) const {
+    for (uint32_t k = 0; k < count; ++k) {
+        stats.test_primitive();
+        if (primitives[refs[first + k]]->occluded(r, t_min, t_max)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+template <typename Stats>
+inline bool QuantizedBVH::traverse_any(const Ray& r, double t_min, double t_max, Stats& stats) const {
+    if (nodes.empty()) {
+        return false;
+    }
+
+    const Point3 origin = r.origin();
+    const Vec3 dir = r.direction();
+    const Vec3 inv_dir(1.0 / dir.x(), 1.0 / dir.y(), 1.0 / dir.z());
+
+    double entry = 0.0;
+    if (!hit_box(root_box, origin, inv_dir, t_min, t_max, entry)) {
+        return false;
+    }
+    if (root_leaf_count > 0) {
+        return occluded_leaf(nodes[0].child[0], root_leaf_count, r, t_min, t_max, stats);
+    }
+
+    uint32_t stack[LinearBVH::kStackSize];
+    int stack_size = 0;
+    uint32_t current = 0;
+
+    while (true) {
+        const QuantizedBVHNode& node = nodes[current];
+        stats.visit_node(node);
+
+        double lane_near[2] = {t_min, t_min};
+        double lane_far[2] = {t_max, t_max};
+        for (int axis = 0; axis < 3; ++axis) {
+            const double scale = exp2i(node.exponent[axis]);
+            const double base = node.origin[axis] - origin[axis];
+            for (int slot = 0; slot < 2; ++slot) {
+                double t0 = (base + node.lo[slot][axis] * scale) * inv_dir[axis];
+                double t1 = (base + node.hi[slot][axis] * scale) * inv_dir[axis];
+                if (inv_dir[axis] < 0.0) {
+                    std::swap(t0, t1);
+                }
+                lane_near[slot] = t0 > lane_near[slot] ? t0 : lane_near[slot];
+                lane_far[slot] = t1 < lane_far[slot] ? t1 : lane_far[slot];
+            }
+        }
+        bool lane_hit[2] = {lane_near[0] <= lane_far[0], lane_near[1] <= lane_far[1]};
+
+        for (int slot = 0; slot < 2; ++slot) {
+            if (lane_hit[slot] && (node.leaf_mask & (1u << slot))) {
+                if (occluded_leaf(node.child[slot], node.count[slot], r, t_min, t_max, stats)) {
+                    return true;
+                }
+                lane_hit[slot] = false;
+            }
+        }
+
+        if (lane_hit[0] && lane_hit[1]) {
+            stack[stack_size++] = node.child[1];
+            current = node.child[0];
+            continue;
+        }
+        if (lane_hit[0] || lane_hit[1]) {
+            current = node.child[lane_hit[0] ? 0 : 1];
+            continue;
+        }
+
+        if (stack_size == 0) {
+            return false;
+        }
+        current = stack[--stack_size];
+    }
+}
+
+inline bool QuantizedBVH::hit(const Ray& r, double t_min, double t_max, HitRecord& rec) const {
+    NoTraversalStats stats;
+    return traverse(r, t_min, t_max, rec, stats);
+}
+
+inline bool QuantizedBVH::hit(const Ray& r, double t_min, double t_max, HitRecord& rec,
+                              BVHTraversalStats& stats) const {
+    return traverse(r, t_min, t_max, rec, stats);
+}
+
+inline bool QuantizedBVH::occluded(const Ray& r, double t_min, double t_max) const {
+    NoTraversalStats stats;
+    return traverse_any(r, t_min, t_max, stats);
+}
+
+inline bool QuantizedBVH::occluded(const Ray& r, double t_min, double t_max, BVHTraversalStats& stats) const {
+    return traverse_any(r, t_min, t_max, stats);
+}
+
+inline bool QuantizedBVH::bounding_box(AABB& output_box) const {
+    if (nodes.empty()) {
+        return false;
+    }
+    output_box = root_box;
+    return true;
+}
+
+#endif // RAYTRACER_QUANTIZED_BVH_H
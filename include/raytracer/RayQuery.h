@@ -0,0 +1,207 @@
+#ifndef RAYTRACER_RAY_QUERY_H
+#define RAYTRACER_RAY_QUERY_H
+
+#include "raytracer/LinearBVH.h"
+#include "raytracer/Morton.h"
+
+// Batch ray queries for jobs other than rendering (visibility matrices, sensor
+// simulation) that trace large sets of unrelated rays.
+//
+// Rays come in and results go out as structure-of-arrays buffers. Large batches
+// are first put in a coherent order: rays are keyed by direction octant, then
+// by the Morton code of their origin within the scene bounds, and radix sorted.
+// Neighbouring rays in that order then walk mostly the same nodes. Chunks of
+// the sorted order run on the thread pool, and results are scattered back to
+// the caller's order.
+
+struct RayBatch {
+    std::vector<double> origin_x, origin_y, origin_z;
+    std::vector<double> direction_x, direction_y, direction_z;
+    std::vector<double> t_min, t_max;
+
+    size_t size() const { return origin_x.size(); }
+    void resize(size_t count);
+    void set(size_t index, const Ray& ray, double ray_t_min = 0.0, double ray_t_max = infinity);
+    Ray ray(size_t index) const {
+        return Ray(Point3(origin_x[index], origin_y[index], origin_z[index]),
+                   Vec3(direction_x[index], direction_y[index], direction_z[index]));
+    }
+};
+
+struct HitBatch {
+    std::vector<double> t;                   // infinity on a miss
+    std::vector<uint32_t> primitive_id;      // LinearBVH primitive index, kNoHit on a miss
+    std::vector<uint32_t> material_id;       // index into the RayQuery palette, kNoHit if absent
+    std::vector<double> normal_x, normal_y, normal_z;  // unit normal facing the ray origin
+
+    size_t size() const { return t.size(); }
+    void resize(size_t count);
+};
+
+struct RayQuerySettings {
+    // Batches smaller than this are traced in the given order.
+    size_t sort_threshold = 4096;
+    // Rays per parallel task.
+    size_t grain = 1024;
+};
+
+class RayQuery {
+public:
+    static constexpr uint32_t kNoHit = LinearBVH::kInvalidIndex;
+
+    // `materials` is the palette that material_id indexes; materials not in it
+    // are reported as kNoHit.
+    explicit RayQuery(std::shared_ptr<const LinearBVH> accel,
+                      const std::vector<std::shared_ptr<Material>>& materials = {},
+                      const RayQuerySettings& settings = RayQuerySettings());
+
+    // Closest hit of every ray in `rays`; `hits` is resized to match.
+    void intersect(const RayBatch& rays, HitBatch& hits) const;
+    // Any-hit visibility of every ray; `blocked[i]` is 1 when ray i is occluded.
+    void occluded(const RayBatch& rays, std::vector<uint8_t>& blocked) const;
+
+    // Order in which a batch is traced; identity below the sort threshold.
+    std::vector<uint32_t> trace_order(const RayBatch& rays) const;
+
+private:
+    void validate(const RayBatch& rays) const;
+    uint32_t material_index(const Material* material) const;
+
+    std::shared_ptr<const LinearBVH> bvh;
+    AABB bounds;
+    std::vector<std::pair<const Material*, uint32_t>> palette;  // sorted by pointer
+    RayQuerySettings settings;
+};
+
+inline void RayBatch::resize(size_t count) {
+    for (auto* lane : {&origin_x, &origin_y, &origin_z, &direction_x, &direction_y, &direction_z}) {
+        lane->resize(count);
+    }
+    t_min.resize(count, 0.0);
+    t_max.resize(count, infinity);
+}
+
+inline void RayBatch::set(size_t index, const Ray& r, double ray_t_min, double ray_t_max) {
+    origin_x[index] = r.origin().x();
+    origin_y[index] = r.origin().y();
+    origin_z[index] = r.origin().z();
+    direction_x[index] = r.direction().x();
+    direction_y[index] = r.direction().y();
+    direction_z[index] = r.direction().z();
+    t_min[index] = ray_t_min;
+    t_max[index] = ray_t_max;
+}
+
+inline void HitBatch::resize(size_t count) {
+    t.resize(count);
+    primitive_id.resize(count);
+    material_id.resize(count);
+    normal_x.resize(count);
+    normal_y.resize(count);
+    normal_z.resize(count);
+}
+
+inline RayQuery::RayQuery(std::shared_ptr<const LinearBVH> accel,
+                          const std::vector<std::shared_ptr<Material>>& materials,
+                          const RayQuerySettings& query_settings)
+    : bvh(std::move(accel)), settings(query_settings) {
+    if (!bvh || !bvh->bounding_box(bounds)) {
+        throw std::invalid_argument("RayQuery requires a built LinearBVH.");
+    }
+    palette.reserve(materials.size());
+    for (size_t i = 0; i < materials.size(); ++i) {
+        palette.emplace_back(materials[i].get(), static_cast<uint32_t>(i));
+    }
+    // Stable, so a material listed twice keeps its first index.
+    std::stable_sort(palette.begin(), palette.end(),
+                     [](const auto& a, const auto& b) { return a.first < b.first; });
+}
+
+inline uint32_t RayQuery::material_index(const Material* material) const {
+    const auto it = std::lower_bound(palette.begin(), palette.end(), material,
+                                     [](const auto& entry, const Material* key) { return entry.first < key; });
+    return it != palette.end() && it->first == material ? it->second : kNoHit;
+}
+
+inline void RayQuery::validate(const RayBatch& rays) const {
+    const size_t n = rays.size();
+    for (const auto* lane : {&rays.origin_y, &rays.origin_z, &rays.direction_x, &rays.direction_y,
+                             &rays.direction_z, &rays.t_min, &rays.t_max}) {
+        if (lane->size() != n) {
+            throw std::invalid_argument("RayBatch arrays must all have the same length.");
+        }
+    }
+    if (n >= kNoHit) {
+        throw std::invalid_argument("RayBatch supports at most 2^32 - 1 rays.");
+    }
+}
+
+inline std::vector<uint32_t> RayQuery::trace_order(const RayBatch& rays) const {
+    validate(rays);
+    const size_t n = rays.size();
+    std::vector<uint32_t> order(n);
+    for (size_t i = 0; i < n; ++i) {
+        order[i] = static_cast<uint32_t>(i);
+    }
+    if (n < settings.sort_threshold) {
+        return order;
+    }
+
+    const Point3 lo = bounds.min();
+    const Vec3 extent = bounds.max() - bounds.min();
+    const Vec3 inv_extent(extent.x() > 0.0 ? 1.0 / extent.x() : 0.0, extent.y() > 0.0 ? 1.0 / extent.y() : 0.0,
+                          extent.z() > 0.0 ? 1.0 / extent.z() : 0.0);
+    std::vector<uint64_t> keys(n);
+    parallel_for(n, 4096, [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; ++i) {
+            const uint64_t octant = (rays.direction_x[i] < 0.0 ? 4u : 0u) | (rays.direction_y[i] < 0.0 ? 2u : 0u) |
+                                    (rays.direction_z[i] < 0.0 ? 1u : 0u);
+            const uint32_t code = morton3d_30((rays.origin_x[i] - lo.x()) * inv_extent.x(),
+                                              (rays.origin_y[i] - lo.y()) * inv_extent.y(),
+                                              (rays.origin_z[i] - lo.z()) * inv_extent.z());
+            keys[i] = (octant << 30) | code;
+        }
+    });
+    radix_sort_pairs(keys, order, 33);
+    return order;
+}
+
+inline void RayQuery::intersect(const RayBatch& rays, HitBatch& hits) const {
+    const std::vector<uint32_t> order = trace_order(rays);
+    hits.resize(rays.size());
+    parallel_for(order.size(), settings.grain, [&](size_t first, size_t last) {
+        HitRecord rec;
+        for (size_t k = first; k < last; ++k) {
+            const uint32_t i = order[k];
+            uint32_t prim = kNoHit;
+            if (bvh->hit(rays.ray(i), rays.t_min[i], rays.t_max[i], rec, prim)) {
+                hits.t[i] = rec.t;
+                hits.primitive_id[i] = prim;
+                hits.material_id[i] = material_index(rec.mat_ptr.get());
+                hits.normal_x[i] = rec.normal.x();
+                hits.normal_y[i] = rec.normal.y();
+                hits.normal_z[i] = rec.normal.z();
+            } else {
+                hits.t[i] = infinity;
+                hits.primitive_id[i] = kNoHit;
+                hits.material_id[i] = kNoHit;
+                hits.normal_x[i] = 0.0;
+                hits.normal_y[i] = 0.0;
+                hits.normal_z[i] = 0.0;
+            }
+        }
+    });
+}
+
+inline void RayQuery::occluded(const RayBatch& rays, std::vector<uint8_t>& blocked) const {
+    const std::vector<uint32_t> order = trace_order(rays);
+    blocked.resize(rays.size());
+    parallel_for(order.size(), settings.grain, [&](size_t first, size_t last) {
+        for (size_t k = first; k < last; ++k) {
+            const uint32_t i = order[k];
+            blocked[i] = bvh->occluded(rays.ray(i), rays.t_min[i], rays.t_max[i]) ? 1 : 0;
+        }
+    });
+}
+
+#endif // RAYTRACER_RAY_QUERY_H
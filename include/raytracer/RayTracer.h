@@ -12,6 +12,7 @@
 #include <atomic>
 #include <thread>
 #include <cstdint>
+#include <cstring>
 #include <functional>
 
 // Constants and Utils
@@ -44,9 +45,20 @@ inline uint64_t xorshift64star(uint64_t& state) {
     return state * 0x2545F4914F6CDD1DULL;
 }
 
-inline double random_double() {
+inline uint64_t& thread_rng_state() {
     static thread_local uint64_t state = init_thread_rng_state();
-    const uint64_t r = xorshift64star(state);
+    return state;
+}
+
+// Restarts the calling thread's generator from `seed`, so a caller can give
+// each unit of work its own reproducible stream.
+inline void seed_thread_rng(uint64_t seed) {
+    const uint64_t state = splitmix64(seed);
+    thread_rng_state() = state == 0 ? 0x2545F4914F6CDD1DULL : state;
+}
+
+inline double random_double() {
+    const uint64_t r = xorshift64star(thread_rng_state());
     return static_cast<double>(r >> 11) * (1.0 / 9007199254740992.0);
 }
 
@@ -152,26 +164,138 @@ inline Vec3 unit_vector(Vec3 v) {
     return v / v.length();
 }
 
-inline Vec3 random_in_unit_sphere() {
-    while (true) {
-        auto p = Vec3::random(-1,1);
-        if (p.length_squared() >= 1) continue;
-        return p;
+// Rec. 709 relative luminance of a linear RGB color.
+inline double luminance(const Color& c) {
+    return 0.2126 * c.x() + 0.7152 * c.y() + 0.0722 * c.z();
+}
+
+// Closed-form warps of uniform numbers in [0, 1): every sample costs the same
+// and needs no rejection loop or normalization. The warps only need angles in
+// a quarter turn, where short polynomials are exact to double precision, so
+// they also avoid the general libm sin/cos/cbrt paths.
+
+// sin and cos of |t| <= pi/4; Taylor series through t^16, error below 1e-16.
+// Estrin's scheme keeps the dependency chain short, since each sample
+// usually waits on these results.
+inline void sin_cos_quarter(double t, double& sin_t, double& cos_t) {
+    const double x = t * t;
+    const double x2 = x * x;
+    const double x4 = x2 * x2;
+    const double s01 = 1.0 - x * (1.0 / 6);
+    const double s23 = 1.0 / 120 - x * (1.0 / 5040);
+    const double s45 = 1.0 / 362880 - x * (1.0 / 39916800);
+    const double s67 = 1.0 / 6227020800.0 - x * (1.0 / 1307674368000.0);
+    sin_t = t * ((s01 + x2 * s23) + x4 * (s45 + x2 * s67));
+    const double c01 = 1.0 - x * (1.0 / 2);
+    const double c23 = 1.0 / 24 - x * (1.0 / 720);
+    const double c45 = 1.0 / 40320 - x * (1.0 / 3628800);
+    const double c67 = 1.0 / 479001600 - x * (1.0 / 87178291200.0);
+    cos_t = (c01 + x2 * c23) + x4 * ((c45 + x2 * c67) + x4 * (1.0 / 20922789888000.0));
+}
+
+// sin and cos of 2 pi u for u in [0, 1]. Quadrant fix-ups are arithmetic
+// selects: with random input, branches on the quadrant mispredict half the time.
+inline void sin_cos_turn(double u, double& sin_phi, double& cos_phi) {
+    const double scaled = 4.0 * u;
+    const int whole = static_cast<int>(scaled);
+    const int quadrant = whole & 3;
+    // Angle within the quadrant, centred on its bisector.
+    double s = 0.0;
+    double c = 0.0;
+    sin_cos_quarter((scaled - whole - 0.5) * (pi / 2), s, c);
+    constexpr double half_sqrt2 = 0.70710678118654752440;
+    const double x = (c - s) * half_sqrt2;
+    const double y = (s + c) * half_sqrt2;
+    // Odd quadrants rotate by a further quarter turn, the upper two by a half.
+    const double odd = static_cast<double>(quadrant & 1);
+    const double sign = 1.0 - static_cast<double>(quadrant & 2);
+    cos_phi = sign * ((1.0 - odd) * x - odd * y);
+    sin_phi = sign * ((1.0 - odd) * y + odd * x);
+}
+
+// Cube root of x in [0, 1]: bit-level estimate and two Halley steps, relative
+// error below 1e-14.
+inline double cbrt_unit(double x) {
+    if (x <= 0.0) {
+        return 0.0;
+    }
+    uint64_t bits = 0;
+    std::memcpy(&bits, &x, sizeof(bits));
+    bits = bits / 3 + 0x2a9f7893782da1ceULL;
+    double y = 0.0;
+    std::memcpy(&y, &bits, sizeof(y));
+    for (int i = 0; i < 2; ++i) {
+        const double y3 = y * y * y;
+        y *= (y3 + 2.0 * x) / (2.0 * y3 + x);
     }
+    return y;
 }
 
-inline Vec3 random_in_unit_disk() {
-    while (true) {
-        auto p = Vec3(random_double(-1, 1), random_double(-1, 1), 0);
-        if (p.length_squared() >= 1) continue;
-        return p;
+// Unit disk in the z = 0 plane, concentric mapping (Shirley & Chiu 1997).
+inline Vec3 sample_concentric_disk(double u1, double u2) {
+    const double a = 2.0 * u1 - 1.0;
+    const double b = 2.0 * u2 - 1.0;
+    if (a == 0.0 && b == 0.0) {
+        return Vec3(0, 0, 0);
     }
+    // The angle off the major axis stays within +-pi/4.
+    const double a_major = std::fabs(a) > std::fabs(b) ? 1.0 : 0.0;
+    const double r = a_major * a + (1.0 - a_major) * b;
+    const double minor = a_major * b + (1.0 - a_major) * a;
+    double s = 0.0;
+    double c = 0.0;
+    sin_cos_quarter((pi / 4) * (minor / r), s, c);
+    return Vec3(r * (a_major * c + (1.0 - a_major) * s), r * (a_major * s + (1.0 - a_major) * c), 0);
+}
+
+inline Vec3 sample_uniform_sphere(double u1, double u2) {
+    const double z = 1.0 - 2.0 * u1;
+    const double r = std::sqrt(std::fmax(0.0, 1.0 - z * z));
+    double s = 0.0;
+    double c = 0.0;
+    sin_cos_turn(u2, s, c);
+    return Vec3(r * c, r * s, z);
+}
+
+// Hemisphere around +z with density cos(theta) / pi (Malley's method).
+inline Vec3 sample_cosine_hemisphere(double u1, double u2) {
+    const Vec3 d = sample_concentric_disk(u1, u2);
+    return Vec3(d.x(), d.y(), std::sqrt(std::fmax(0.0, 1.0 - d.length_squared())));
+}
+
+inline double cosine_hemisphere_pdf(double cos_theta) {
+    return cos_theta > 0.0 ? cos_theta / pi : 0.0;
+}
+
+inline Vec3 random_in_unit_sphere() {
+    return cbrt_unit(random_double()) * sample_uniform_sphere(random_double(), random_double());
+}
+
+inline Vec3 random_in_unit_disk() {
+    return sample_concentric_disk(random_double(), random_double());
 }
 
 inline Vec3 random_unit_vector() {
-    return unit_vector(random_in_unit_sphere());
+    return sample_uniform_sphere(random_double(), random_double());
 }
 
+// Orthonormal basis whose w axis is the given unit vector (Duff et al. 2017).
+class ONB {
+public:
+    explicit ONB(const Vec3& n) : w(n) {
+        const double sign = std::copysign(1.0, n.z());
+        const double a = -1.0 / (sign + n.z());
+        const double b = n.x() * n.y() * a;
+        u = Vec3(1.0 + sign * n.x() * n.x() * a, sign * b, -sign * n.x());
+        v = Vec3(b, sign + n.y() * n.y() * a, -n.y());
+    }
+
+    Vec3 local(const Vec3& a) const { return a.x() * u + a.y() * v + a.z() * w; }
+
+public:
+    Vec3 u, v, w;
+};
+
 inline Vec3 reflect(const Vec3& v, const Vec3& n) {
     return v - 2*dot(v,n)*n;
 }
@@ -204,11 +328,13 @@ public:
 
 // Material and Hitable Forward Declarations
 class Material;
+class Hitable;
 
 struct HitRecord {
     Point3 p;
     Vec3 normal;
     std::shared_ptr<Material> mat_ptr;
+    const Hitable* object = nullptr;  // primitive that was hit; identifies lights for MIS
     double t;
     bool front_face;
 
@@ -226,6 +352,45 @@ public:
     const Point3& min() const { return minimum; }
     const Point3& max() const { return maximum; }
 
+    // Inverted box that any expand() call replaces; used as the identity for unions.
+    static AABB empty() {
+        return AABB(Point3(infinity, infinity, infinity), Point3(-infinity, -infinity, -infinity));
+    }
+
+    bool is_empty() const {
+        return maximum.x() < minimum.x() || maximum.y() < minimum.y() || maximum.z() < minimum.z();
+    }
+
+    Point3 centroid() const { return 0.5 * (minimum + maximum); }
+
+    double surface_area() const {
+        if (is_empty()) {
+            return 0.0;
+        }
+        const Vec3 d = maximum - minimum;
+        return 2.0 * (d.x() * d.y() + d.y() * d.z() + d.z() * d.x());
+    }
+
+    int longest_axis() const {
+        const Vec3 d = maximum - minimum;
+        if (d.x() > d.y() && d.x() > d.z()) return 0;
+        return d.y() > d.z() ? 1 : 2;
+    }
+
+    void expand(const Point3& p) {
+        for (int axis = 0; axis < 3; ++axis) {
+            minimum[axis] = std::fmin(minimum[axis], p[axis]);
+            maximum[axis] = std::fmax(maximum[axis], p[axis]);
+        }
+    }
+
+    void expand(const AABB& b) {
+        for (int axis = 0; axis < 3; ++axis) {
+            minimum[axis] = std::fmin(minimum[axis], b.minimum[axis]);
+            maximum[axis] = std::fmax(maximum[axis], b.maximum[axis]);
+        }
+    }
+
     bool hit(const Ray& r, double t_min, double t_max) const {
         for (int axis = 0; axis < 3; ++axis) {
             const double inv_d = 1.0 / r.direction()[axis];
@@ -264,11 +429,59 @@ inline AABB surrounding_box(const AABB& box0, const AABB& box1) {
     return AABB(small, big);
 }
 
+inline AABB intersect_boxes(const AABB& box0, const AABB& box1) {
+    return AABB(
+        Point3(std::fmax(box0.min().x(), box1.min().x()),
+               std::fmax(box0.min().y(), box1.min().y()),
+               std::fmax(box0.min().z(), box1.min().z())),
+        Point3(std::fmin(box0.max().x(), box1.max().x()),
+               std::fmin(box0.max().y(), box1.max().y()),
+               std::fmin(box0.max().z(), box1.max().z())));
+}
+
 class Hitable {
 public:
     virtual bool hit(const Ray& r, double t_min, double t_max, HitRecord& rec) const = 0;
     virtual bool bounding_box(AABB& output_box) const = 0;
     virtual ~Hitable() = default;
+
+    // True when anything blocks the ray within [t_min, t_max]. Shadow and
+    // visibility rays only need that answer, so overrides return on the first
+    // hit found, in any order, without filling a HitRecord. The default falls
+    // back to a closest-hit query.
+    virtual bool occluded(const Ray& r, double t_min, double t_max) const {
+        HitRecord rec;
+        return hit(r, t_min, t_max, rec);
+    }
+
+    // Material of a single-surface primitive; nullptr for aggregates.
+    virtual const Material* material() const { return nullptr; }
+
+    // Light sampling for emissive primitives. sample_direction() picks a
+    // direction from `origin` towards the object, direction_pdf() is the
+    // solid-angle density of picking `direction`. Objects that cannot be
+    // sampled keep the defaults and report a zero density.
+    virtual Vec3 sample_direction(const Point3&) const { return Vec3(0, 1, 0); }
+    virtual double direction_pdf(const Point3&, const Vec3&) const { return 0.0; }
+
+    // Surface area, used to estimate the power of lights. The default is that
+    // of the bounding box, which only keeps ratios between similar shapes.
+    virtual double surface_area() const {
+        AABB box;
+        return bounding_box(box) ? box.surface_area() : 0.0;
+    }
+
+    // Bounds of the part of the object that lies inside `clip`, used by
+    // spatial-split BVH builders. Returns false when nothing is inside. The
+    // default clips the full bounding box, which is conservative.
+    virtual bool clipped_bounding_box(const AABB& clip, AABB& output_box) const {
+        AABB box;
+        if (!bounding_box(box)) {
+            return false;
+        }
+        output_box = intersect_boxes(box, clip);
+        return !output_box.is_empty();
+    }
 };
 
 class Sphere : public Hitable {
@@ -278,7 +491,13 @@ public:
         : center(cen), radius(r), mat_ptr(m) {};
 
     virtual bool hit(const Ray& r, double t_min, double t_max, HitRecord& rec) const override;
+    virtual bool occluded(const Ray& r, double t_min, double t_max) const override;
     virtual bool bounding_box(AABB& output_box) const override;
+    virtual bool clipped_bounding_box(const AABB& clip, AABB& output_box) const override;
+    virtual const Material* material() const override { return mat_ptr.get(); }
+    virtual Vec3 sample_direction(const Point3& origin) const override;
+    virtual double direction_pdf(const Point3& origin, const Vec3& direction) const override;
+    virtual double surface_area() const override { return 4.0 * pi * radius * radius; }
 
 public:
     Point3 center;
@@ -309,10 +528,56 @@ inline bool Sphere::hit(const Ray& r, double t_min, double t_max, HitRecord& rec
     Vec3 outward_normal = (rec.p - center) / radius;
     rec.set_face_normal(r, outward_normal);
     rec.mat_ptr = mat_ptr;
+    rec.object = this;
 
     return true;
 }
 
+inline bool Sphere::occluded(const Ray& r, double t_min, double t_max) const {
+    Vec3 oc = r.origin() - center;
+    auto a = r.direction().length_squared();
+    auto half_b = dot(oc, r.direction());
+    auto c = oc.length_squared() - radius*radius;
+    auto discriminant = half_b*half_b - a*c;
+
+    if (discriminant < 0) return false;
+    auto sqrtd = sqrt(discriminant);
+
+    auto near_root = (-half_b - sqrtd) / a;
+    auto far_root = (-half_b + sqrtd) / a;
+    return (near_root >= t_min && near_root <= t_max) || (far_root >= t_min && far_root <= t_max);
+}
+
+// Uniform over the cone of directions that see the sphere from `origin`.
+// 1 - cos(theta_max) of the cone subtended by a sphere, given sin^2(theta_max);
+// the direct form cancels to 0 for distant spheres and the pdf to infinity.
+inline double sphere_cap_height(double sin2_theta_max) {
+    return sin2_theta_max / (1.0 + std::sqrt(1.0 - sin2_theta_max));
+}
+
+inline Vec3 Sphere::sample_direction(const Point3& origin) const {
+    const Vec3 to_center = center - origin;
+    const double distance_squared = to_center.length_squared();
+    if (distance_squared <= radius * radius) {
+        return random_unit_vector();
+    }
+    const double one_minus_cos_max = sphere_cap_height(radius * radius / distance_squared);
+    const double z = 1.0 - random_double() * one_minus_cos_max;
+    double sin_phi = 0.0;
+    double cos_phi = 0.0;
+    sin_cos_turn(random_double(), sin_phi, cos_phi);
+    const double sin_theta = std::sqrt(std::fmax(0.0, 1.0 - z * z));
+    return ONB(unit_vector(to_center)).local(Vec3(cos_phi * sin_theta, sin_phi * sin_theta, z));
+}
+
+inline double Sphere::direction_pdf(const Point3& origin, const Vec3& direction) const {
+    const double distance_squared = (center - origin).length_squared();
+    if (distance_squared <= radius * radius || !occluded(Ray(origin, direction), 0.0, infinity)) {
+        return 0.0;
+    }
+    return 1.0 / (2.0 * pi * sphere_cap_height(radius * radius / distance_squared));
+}
+
 inline bool Sphere::bounding_box(AABB& output_box) const {
     output_box = AABB(
         center - Vec3(radius, radius, radius),
@@ -321,6 +586,78 @@ inline bool Sphere::bounding_box(AABB& output_box) const {
     return true;
 }
 
+inline bool Sphere::clipped_bounding_box(const AABB& clip, AABB& output_box) const {
+    // Within the slab of `clip` on axis a, the sphere is no wider than the
+    // cross-section closest to its center, of radius sqrt(r^2 - d_a^2).
+    double section[3];
+    for (int axis = 0; axis < 3; ++axis) {
+        double d = 0.0;
+        if (center[axis] < clip.min()[axis]) d = clip.min()[axis] - center[axis];
+        if (center[axis] > clip.max()[axis]) d = center[axis] - clip.max()[axis];
+        if (d > radius) {
+            return false;
+        }
+        section[axis] = std::sqrt(radius * radius - d * d);
+    }
+
+    const Vec3 half(std::fmin(section[1], section[2]),
+                    std::fmin(section[0], section[2]),
+                    std::fmin(section[0], section[1]));
+    output_box = intersect_boxes(AABB(center - half, center + half), clip);
+    return !output_box.is_empty();
+}
+
+// Infinite plane through `point` with unit normal `normal`. It has no bounding
+// box, so it must not be put into a BVH; Scene keeps it outside the hierarchy.
+class Plane : public Hitable {
+public:
+    Plane() {}
+    Plane(Point3 p, const Vec3& n, std::shared_ptr<Material> m)
+        : point(p), normal(unit_vector(n)), mat_ptr(m) {}
+
+    virtual bool hit(const Ray& r, double t_min, double t_max, HitRecord& rec) const override;
+    virtual bool occluded(const Ray& r, double t_min, double t_max) const override;
+    virtual bool bounding_box(AABB& output_box) const override;
+    virtual const Material* material() const override { return mat_ptr.get(); }
+
+public:
+    Point3 point;
+    Vec3 normal;
+    std::shared_ptr<Material> mat_ptr;
+};
+
+inline bool Plane::hit(const Ray& r, double t_min, double t_max, HitRecord& rec) const {
+    const double denom = dot(normal, r.direction());
+    if (std::fabs(denom) < 1e-12) {
+        return false;
+    }
+
+    const double root = dot(point - r.origin(), normal) / denom;
+    if (root < t_min || root > t_max) {
+        return false;
+    }
+
+    rec.t = root;
+    rec.p = r.at(rec.t);
+    rec.set_face_normal(r, normal);
+    rec.mat_ptr = mat_ptr;
+    rec.object = this;
+    return true;
+}
+
+inline bool Plane::occluded(const Ray& r, double t_min, double t_max) const {
+    const double denom = dot(normal, r.direction());
+    if (std::fabs(denom) < 1e-12) {
+        return false;
+    }
+    const double root = dot(point - r.origin(), normal) / denom;
+    return root >= t_min && root <= t_max;
+}
+
+inline bool Plane::bounding_box(AABB&) const {
+    return false;
+}
+
 class HitableList : public Hitable {
 public:
     HitableList() {}
@@ -330,6 +667,7 @@ public:
     void add(std::shared_ptr<Hitable> object) { objects.push_back(object); }
 
     virtual bool hit(const Ray& r, double t_min, double t_max, HitRecord& rec) const override;
+    virtual bool occluded(const Ray& r, double t_min, double t_max) const override;
     virtual bool bounding_box(AABB& output_box) const override;
 
 public:
@@ -352,6 +690,15 @@ inline bool HitableList::hit(const Ray& r, double t_min, double t_max, HitRecord
     return hit_anything;
 }
 
+inline bool HitableList::occluded(const Ray& r, double t_min, double t_max) const {
+    for (const auto& object : objects) {
+        if (object->occluded(r, t_min, t_max)) {
+            return true;
+        }
+    }
+    return false;
+}
+
 inline bool HitableList::bounding_box(AABB& output_box) const {
     if (objects.empty()) {
         return false;
@@ -377,6 +724,7 @@ public:
     BVHNode(std::vector<std::shared_ptr<Hitable>>& src_objects, size_t start, size_t end);
 
     bool hit(const Ray& r, double t_min, double t_max, HitRecord& rec) const override;
+    bool occluded(const Ray& r, double t_min, double t_max) const override;
     bool bounding_box(AABB& output_box) const override;
 
 private:
@@ -438,6 +786,13 @@ inline bool BVHNode::hit(const Ray& r, double t_min, double t_max, HitRecord& re
     return hit_left || hit_right;
 }
 
+inline bool BVHNode::occluded(const Ray& r, double t_min, double t_max) const {
+    if (!box.hit(r, t_min, t_max)) {
+        return false;
+    }
+    return left->occluded(r, t_min, t_max) || (right != left && right->occluded(r, t_min, t_max));
+}
+
 inline bool BVHNode::bounding_box(AABB& output_box) const {
     output_box = box;
     return true;
@@ -464,25 +819,127 @@ inline bool BVHNode::box_z_compare(const std::shared_ptr<Hitable>& a, const std:
     return box_compare(a, b, 2);
 }
 
+// Scene root that keeps unbounded primitives (planes) out of the acceleration
+// structure. They are tested first, so a ground plane hit already shortens
+// t_max before any BVH node is entered, and their infinite extent never
+// inflates the boxes of the bounded hierarchy.
+class Scene : public Hitable {
+public:
+    Scene() {}
+    // Builds a BVHNode over the bounded objects of `objects`.
+    explicit Scene(const HitableList& objects);
+    Scene(std::shared_ptr<Hitable> bounded_accel, HitableList unbounded_objects)
+        : bounded(std::move(bounded_accel)), unbounded(std::move(unbounded_objects)) {}
+
+    bool hit(const Ray& r, double t_min, double t_max, HitRecord& rec) const override;
+    bool occluded(const Ray& r, double t_min, double t_max) const override;
+    bool bounding_box(AABB& output_box) const override;
+
+public:
+    std::shared_ptr<Hitable> bounded;
+    HitableList unbounded;
+};
+
+// Moves every object without a bounding box from `objects` into `unbounded`.
+inline void split_unbounded(std::vector<std::shared_ptr<Hitable>>& objects, HitableList& unbounded) {
+    AABB box;
+    const auto first_unbounded = std::stable_partition(
+        objects.begin(), objects.end(),
+        [&box](const std::shared_ptr<Hitable>& object) { return object->bounding_box(box); });
+    for (auto it = first_unbounded; it != objects.end(); ++it) {
+        unbounded.add(*it);
+    }
+    objects.erase(first_unbounded, objects.end());
+}
+
+inline Scene::Scene(const HitableList& objects) {
+    std::vector<std::shared_ptr<Hitable>> bounded_objects = objects.objects;
+    split_unbounded(bounded_objects, unbounded);
+    if (!bounded_objects.empty()) {
+        bounded = std::make_shared<BVHNode>(bounded_objects, 0, bounded_objects.size());
+    }
+}
+
+inline bool Scene::hit(const Ray& r, double t_min, double t_max, HitRecord& rec) const {
+    bool hit_anything = unbounded.hit(r, t_min, t_max, rec);
+    if (bounded && bounded->hit(r, t_min, hit_anything ? rec.t : t_max, rec)) {
+        hit_anything = true;
+    }
+    return hit_anything;
+}
+
+inline bool Scene::occluded(const Ray& r, double t_min, double t_max) const {
+    return unbounded.occluded(r, t_min, t_max) || (bounded && bounded->occluded(r, t_min, t_max));
+}
+
+inline bool Scene::bounding_box(AABB& output_box) const {
+    return unbounded.objects.empty() && bounded && bounded->bounding_box(output_box);
+}
+
 // Materials
 class Material {
 public:
+    virtual ~Material() = default;
     virtual bool scatter(const Ray& r_in, const HitRecord& rec, Color& attenuation, Ray& scattered) const = 0;
+    // As above, and `pdf` receives the solid-angle density of `scattered`;
+    // 0 for specular choices that no other sampling strategy can produce.
+    virtual bool scatter(const Ray& r_in, const HitRecord& rec, Color& attenuation, Ray& scattered,
+                         double& pdf) const;
+
+    // Radiance leaving the surface towards the ray origin.
+    virtual Color emitted(const Ray&, const HitRecord&) const { return Color(0, 0, 0); }
+    virtual bool is_emissive() const { return false; }
+
+    // Light sampling needs the BSDF in closed form. Materials that can only be
+    // sampled through scatter() (mirrors, glass) stay specular and are skipped
+    // by next-event estimation.
+    virtual bool is_specular() const { return true; }
+    // BSDF times the cosine term for light arriving from `direction`.
+    virtual Color eval(const Ray&, const HitRecord&, const Vec3&) const { return Color(0, 0, 0); }
+    // Solid-angle density with which scatter() picks `direction`.
+    virtual double scatter_pdf(const Ray&, const HitRecord&, const Vec3&) const { return 0.0; }
+    // Fraction of light the surface reflects overall; a denoiser guide.
+    virtual Color surface_albedo(const HitRecord&) const { return Color(1, 1, 1); }
 };
 
+inline bool Material::scatter(const Ray& r_in, const HitRecord& rec, Color& attenuation, Ray& scattered,
+                              double& pdf) const {
+    if (!scatter(r_in, rec, attenuation, scattered)) {
+        return false;
+    }
+    pdf = is_specular() ? 0.0 : scatter_pdf(r_in, rec, scattered.direction());
+    return true;
+}
+
 class Lambertian : public Material {
 public:
     Lambertian(const Color& a) : albedo(a) {}
 
     virtual bool scatter(const Ray& r_in, const HitRecord& rec, Color& attenuation, Ray& scattered) const override {
-        auto scatter_direction = rec.normal + random_unit_vector();
-        if (scatter_direction.length_squared() < 1e-8)
-            scatter_direction = rec.normal;
-        scattered = Ray(rec.p, scatter_direction);
+        double pdf = 0.0;
+        return scatter(r_in, rec, attenuation, scattered, pdf);
+    }
+
+    virtual bool scatter(const Ray&, const HitRecord& rec, Color& attenuation, Ray& scattered,
+                         double& pdf) const override {
+        const Vec3 local = sample_cosine_hemisphere(random_double(), random_double());
+        scattered = Ray(rec.p, ONB(rec.normal).local(local));
         attenuation = albedo;
+        pdf = cosine_hemisphere_pdf(local.z());
         return true;
     }
 
+    // scatter() is cosine-weighted, so attenuation = eval / scatter_pdf = albedo.
+    virtual bool is_specular() const override { return false; }
+    virtual Color eval(const Ray& r_in, const HitRecord& rec, const Vec3& direction) const override {
+        return albedo * scatter_pdf(r_in, rec, direction);
+    }
+    virtual double scatter_pdf(const Ray&, const HitRecord& rec, const Vec3& direction) const override {
+        const double cosine = dot(rec.normal, unit_vector(direction));
+        return cosine > 0.0 ? cosine / pi : 0.0;
+    }
+    virtual Color surface_albedo(const HitRecord&) const override { return albedo; }
+
 public:
     Color albedo;
 };
@@ -491,12 +948,15 @@ class Metal : public Material {
 public:
     Metal(const Color& a, double f) : albedo(a), fuzz(f < 1 ? f : 1) {}
 
+    using Material::scatter;
+
     virtual bool scatter(const Ray& r_in, const HitRecord& rec, Color& attenuation, Ray& scattered) const override {
         Vec3 reflected = reflect(unit_vector(r_in.direction()), rec.normal);
         scattered = Ray(rec.p, reflected + fuzz*random_in_unit_sphere());
         attenuation = albedo;
         return (dot(scattered.direction(), rec.normal) > 0);
     }
+    virtual Color surface_albedo(const HitRecord&) const override { return albedo; }
 
 public:
     Color albedo;
@@ -507,6 +967,8 @@ class Dielectric : public Material {
 public:
     Dielectric(double index_of_refraction) : ir(index_of_refraction) {}
 
+    using Material::scatter;
+
     virtual bool scatter(const Ray& r_in, const HitRecord& rec, Color& attenuation, Ray& scattered) const override {
         attenuation = Color(1.0, 1.0, 1.0);
         double refraction_ratio = rec.front_face ? (1.0/ir) : ir;
@@ -539,6 +1001,25 @@ public:
     double ir; 
 };
 
+// One-sided area light: emits from the front face and absorbs all light.
+class DiffuseLight : public Material {
+public:
+    DiffuseLight(const Color& c) : radiance(c) {}
+
+    using Material::scatter;
+
+    virtual bool scatter(const Ray&, const HitRecord&, Color&, Ray&) const override {
+        return false;
+    }
+    virtual Color emitted(const Ray&, const HitRecord& rec) const override {
+        return rec.front_face ? radiance : Color(0, 0, 0);
+    }
+    virtual bool is_emissive() const override { return true; }
+
+public:
+    Color radiance;
+};
+
 // Camera
 class Camera {
 public:
@@ -585,9 +1066,10 @@ inline Color ray_color(const Ray& r, const Hitable& world, int depth) {
     if (world.hit(r, 0.001, infinity, rec)) {
         Ray scattered;
         Color attenuation;
+        const Color emitted = rec.mat_ptr->emitted(r, rec);
         if (rec.mat_ptr->scatter(r, rec, attenuation, scattered))
-            return attenuation * ray_color(scattered, world, depth-1);
-        return Color(0,0,0);
+            return emitted + attenuation * ray_color(scattered, world, depth-1);
+        return emitted;
     }
 
     Vec3 unit_direction = unit_vector(r.direction());
@@ -600,7 +1082,7 @@ inline HitableList random_scene() {
     HitableList world;
 
     auto ground_material = std::make_shared<Lambertian>(Color(0.5, 0.5, 0.5));
-    world.add(std::make_shared<Sphere>(Point3(0,-1000,0), 1000, ground_material));
+    world.add(std::make_shared<Plane>(Point3(0,0,0), Vec3(0,1,0), ground_material));
 
     for (int a = -11; a < 11; a++) {
         for (int b = -11; b < 11; b++) {
@@ -642,4 +1124,28 @@ inline HitableList random_scene() {
     return world;
 }
 
+// Closed room of five planes (the front stays open) lit by one small spherical
+// light below the ceiling. Camera: lookfrom (278, 278, -800), lookat
+// (278, 278, 0), vfov 40, black background.
+inline HitableList cornell_scene() {
+    HitableList world;
+
+    auto red = std::make_shared<Lambertian>(Color(0.65, 0.05, 0.05));
+    auto white = std::make_shared<Lambertian>(Color(0.73, 0.73, 0.73));
+    auto green = std::make_shared<Lambertian>(Color(0.12, 0.45, 0.15));
+    auto light = std::make_shared<DiffuseLight>(Color(40, 40, 40));
+
+    world.add(std::make_shared<Plane>(Point3(555, 0, 0), Vec3(-1, 0, 0), green));
+    world.add(std::make_shared<Plane>(Point3(0, 0, 0), Vec3(1, 0, 0), red));
+    world.add(std::make_shared<Plane>(Point3(0, 0, 0), Vec3(0, 1, 0), white));
+    world.add(std::make_shared<Plane>(Point3(0, 555, 0), Vec3(0, -1, 0), white));
+    world.add(std::make_shared<Plane>(Point3(0, 0, 555), Vec3(0, 0, -1), white));
+
+    world.add(std::make_shared<Sphere>(Point3(278, 505, 278), 30, light));
+    world.add(std::make_shared<Sphere>(Point3(190, 90, 190), 90, white));
+    world.add(std::make_shared<Sphere>(Point3(380, 90, 370), 90, std::make_shared<Dielectric>(1.5)));
+
+    return world;
+}
+
 #endif // RAYTRACER_H
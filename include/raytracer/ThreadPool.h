@@ -0,0 +1,174 @@
+#ifndef RAYTRACER_THREAD_POOL_H
+#define RAYTRACER_THREAD_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Persistent worker pool for data-parallel loops in builders and post-passes.
+//
+// parallel_for() hands out chunks of an index range through an atomic counter;
+// the calling thread participates and the call blocks until the range is done.
+// Nested calls (from inside a loop body) and calls that race with another
+// caller simply run inline, so the pool can be used from any code path.
+class ThreadPool {
+public:
+    explicit ThreadPool(unsigned worker_threads = default_worker_count());
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Number of threads that execute a parallel_for, including the caller.
+    unsigned size() const { return static_cast<unsigned>(threads.size()) + 1; }
+
+    // Calls fn(chunk_begin, chunk_end) over [0, count) in chunks of `grain`.
+    template <typename Fn>
+    void parallel_for(size_t count, size_t grain, Fn&& fn);
+
+    static ThreadPool& global() {
+        static ThreadPool pool;
+        return pool;
+    }
+
+    static unsigned default_worker_count() {
+        const unsigned hw = std::thread::hardware_concurrency();
+        return hw > 1 ? hw - 1 : 0;
+    }
+
+private:
+    static bool& in_parallel_region() {
+        static thread_local bool inside = false;
+        return inside;
+    }
+
+    void worker_loop();
+
+    std::vector<std::thread> threads;
+    std::mutex submit_mutex;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    std::function<void()> job;
+    uint64_t generation = 0;
+    size_t pending = 0;
+    bool stopping = false;
+};
+
+inline ThreadPool::ThreadPool(unsigned worker_threads) {
+    threads.reserve(worker_threads);
+    for (unsigned i = 0; i < worker_threads; ++i) {
+        threads.emplace_back([this]() { worker_loop(); });
+    }
+}
+
+inline ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
+
+inline void ThreadPool::worker_loop() {
+    in_parallel_region() = true;
+    uint64_t seen = 0;
+    while (true) {
+        std::function<void()> local;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&]() { return stopping || generation != seen; });
+            if (stopping) {
+                return;
+            }
+            seen = generation;
+            local = job;
+        }
+
+        local();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--pending == 0) {
+            done.notify_one();
+        }
+    }
+}
+
+template <typename Fn>
+inline void ThreadPool::parallel_for(size_t count, size_t grain, Fn&& fn) {
+    if (count == 0) {
+        return;
+    }
+    grain = std::max<size_t>(1, grain);
+
+    if (threads.empty() || count <= grain || in_parallel_region()) {
+        fn(size_t{0}, count);
+        return;
+    }
+    std::unique_lock<std::mutex> submit(submit_mutex, std::try_to_lock);
+    if (!submit.owns_lock()) {
+        fn(size_t{0}, count);
+        return;
+    }
+
+    std::atomic<size_t> next{0};
+    std::exception_ptr error;
+    std::mutex error_mutex;
+    auto body = [&]() {
+        while (true) {
+            const size_t begin = next.fetch_add(grain, std::memory_order_relaxed);
+            if (begin >= count) {
+                return;
+            }
+            try {
+                fn(begin, std::min(count, begin + grain));
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+                next.store(count, std::memory_order_relaxed);
+            }
+        }
+    };
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job = body;
+        pending = threads.size();
+        ++generation;
+    }
+    wake.notify_all();
+
+    in_parallel_region() = true;
+    body();
+    in_parallel_region() = false;
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [&]() { return pending == 0; });
+        job = nullptr;
+    }
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+// Convenience wrapper over the process-wide pool.
+template <typename Fn>
+inline void parallel_for(size_t count, size_t grain, Fn&& fn) {
+    ThreadPool::global().parallel_for(count, grain, std::forward<Fn>(fn));
+}
+
+#endif // RAYTRACER_THREAD_POOL_H
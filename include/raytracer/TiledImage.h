@@ -0,0 +1,641 @@
+#ifndef RAYTRACER_TILED_IMAGE_H
+#define RAYTRACER_TILED_IMAGE_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "raytracer/Aov.h"
+#include "raytracer/Progressive.h"
+#include "raytracer/ThreadPool.h"
+
+// Out-of-core rendering for output sizes whose film does not fit in memory.
+//
+// render_tiled() traces the image one tile at a time per thread and keeps
+// only tiles in flight resident: a tile's PixelAccumulators live while its
+// samples are traced, then it is resolved to float planes (beauty RGB and
+// the enabled AOVs) and queued for a writer thread, which stores it in a
+// tiled image file and frees it. A tile holds one slot of the memory budget
+// from the moment it is allocated until it is on disk, so when the disk
+// falls behind, workers wait for a slot instead of growing the queue.
+//
+// The file is a 64-byte header followed by every tile at a fixed offset, so
+// tiles are written in any order and read back one at a time. Edge tiles
+// are padded to the full tile size. Inside a tile each component is a
+// row-major float plane, row 0 at the top: R, G, B, then the AOV components
+// in AovChannel order.
+//
+// Each pixel seeds its thread's generator from the seed and the pixel index,
+// so the file does not depend on the thread count, tile order or budget.
+//
+// Without a path no file is written and tiles only go to the on_tile
+// callback (an ImageExporter, say); they still hold their budget slot until
+// the writer thread has passed them, so the budget bounds the same memory.
+
+struct TiledRenderSettings {
+    int width = 0;
+    int height = 0;
+    int tile_size = 64;
+    int samples = 16;
+    AovSet aovs;
+    size_t memory_budget = size_t{256} << 20;  // bytes of resident tiles
+    uint64_t seed = 0x5eed;
+};
+
+struct TiledRenderStats {
+    size_t tile_bytes = 0;           // one tile while it is traced
+    size_t budget_tiles = 0;         // tiles the budget admits at once
+    size_t peak_resident_bytes = 0;  // tile memory actually allocated at peak
+    size_t tiles = 0;                // tiles finished
+    double write_ms = 0.0;           // writer thread time spent on the file
+};
+
+// Float components per pixel of a tiled image with these AOVs.
+int tiled_planes(const AovSet& aovs);
+
+// Writes tiles to a new tiled image file; not thread safe. Throws
+// std::runtime_error if the file cannot be created or written.
+class TiledImageWriter {
+public:
+    TiledImageWriter(const std::string& path, int width, int height, int tile_size, const AovSet& aovs);
+
+    int tiles_x() const { return (image_width + tile - 1) / tile; }
+    int tiles_y() const { return (image_height + tile - 1) / tile; }
+    // tiled_planes() planes of tile_size^2 floats.
+    void write_tile(int tile_x, int tile_y, const float* data);
+
+private:
+    std::ofstream file;
+    std::string file_path;
+    int image_width;
+    int image_height;
+    int tile;
+    int planes;
+};
+
+// Reads a file written by TiledImageWriter. Throws std::runtime_error.
+class TiledImage {
+public:
+    explicit TiledImage(const std::string& path);
+
+    int width() const { return image_width; }
+    int height() const { return image_height; }
+    int tile_size() const { return tile; }
+    const AovSet& aovs() const { return channels; }
+    int planes() const { return plane_count; }
+
+    std::vector<float> read_tile(int tile_x, int tile_y) const;
+    Color pixel(int x, int y) const;
+
+private:
+    mutable std::ifstream file;
+    std::string file_path;
+    int image_width = 0;
+    int image_height = 0;
+    int tile = 0;
+    int plane_count = 0;
+    AovSet channels;
+};
+
+// Renders `view` into the tiled image at `path` (none if empty) within the
+// memory budget.
+// on_tile(x0, y0, x1, y1, planes) is called from a pool thread with each
+// resolved tile (rows top to bottom, end exclusive; planes as in the file).
+// Setting `cancel` skips the tiles not yet started. Throws
+// std::invalid_argument if the budget cannot hold one tile and
+// std::runtime_error on I/O errors.
+TiledRenderStats render_tiled(const Hitable& world, const LightSampler& lights, const CameraParams& view,
+                              const PathTracerSettings& path_settings, const TiledRenderSettings& settings,
+                              const AovIds& ids, const std::string& path,
+                              const std::function<void(int, int, int, int, const float*)>& on_tile = {},
+                              const std::atomic<bool>* cancel = nullptr);
+
+// Traces tile `tile_index` (row-major over the tile grid) of a frame with
+// `settings` into `data`: tiled_planes() planes of tile_size^2 floats, zero
+// outside the frame. `camera` is the view at the frame's aspect ratio. The
+// values are those render_tiled() produces for the tile, wherever it runs.
+void render_tile(const Hitable& world, const LightSampler& lights, const Camera& camera,
+                 const PathTracerSettings& path_settings, const TiledRenderSettings& settings, const AovIds& ids,
+                 size_t tile_index, float* data);
+
+// Trains path_settings.guide (required) for a render_tiled() frame with
+// `settings`: whole-frame iterations of 1, 2, 4, ... samples per pixel,
+// recorded into the guide and discarded, each followed by end_pass(), while
+// they add up to at most a quarter of settings.samples (at least one pass).
+// Training is switched off afterwards, so the frame itself samples a fixed
+// distribution. Returns the iterations run; `cancel` stops between tiles.
+// Throws std::invalid_argument without a guide.
+int train_guide(const Hitable& world, const LightSampler& lights, const CameraParams& view,
+                const PathTracerSettings& path_settings, const TiledRenderSettings& settings,
+                const std::atomic<bool>* cancel = nullptr);
+
+// Denoises a frame that arrives as tiles (from render_tiled() or distributed
+// workers). The filter's taps reach well past a tile, so the tiles are
+// gathered into whole-frame planes first: unlike render_tiled(), this holds
+// the entire frame in memory. The tiles must carry with_denoise_guides()
+// channels; add_tile() may be called from several threads for distinct
+// tiles. Throws std::invalid_argument if a guide or output channel is
+// missing from the tiles.
+class TiledFrameDenoiser {
+public:
+    TiledFrameDenoiser(int width, int height, int tile_size, const AovSet& aovs);
+
+    // `aovs` plus the channels the denoiser is guided by: depth, normal,
+    // albedo and variance.
+    static AovSet with_denoise_guides(const AovSet& aovs);
+
+    // One tile as render_tiled() passes it to on_tile.
+    void add_tile(int x0, int y0, int x1, int y1, const float* data);
+    // Denoised R, G, B planes followed by the components of `output` (a
+    // subset of the tiles' AOVs), each width x height, row 0 at the top.
+    std::vector<float> finish(const AovSet& output, const DenoiseSettings& denoise_settings = DenoiseSettings()) const;
+
+    size_t memory_bytes() const { return frame.size() * sizeof(float); }
+
+private:
+    // First plane of `channel` in the tiles.
+    size_t plane_of(AovChannel channel) const;
+    const float* plane(size_t index) const { return frame.data() + index * area; }
+
+    int frame_width;
+    int frame_height;
+    int tile;
+    size_t area;
+    AovSet channels;
+    std::vector<float> frame;
+};
+
+namespace tiled_detail {
+
+constexpr char kMagic[8] = {'R', 'T', 'T', 'I', 'L', 'E', '0', '1'};
+constexpr size_t kHeaderBytes = 64;
+
+struct FileHeader {
+    char magic[8];
+    uint32_t width;
+    uint32_t height;
+    uint32_t tile_size;
+    uint32_t planes;
+    uint32_t aov_mask;
+};
+
+inline uint32_t aov_mask(const AovSet& aovs) {
+    uint32_t mask = 0;
+    for (int i = 0; i < kAovChannelCount; ++i) {
+        if (aovs.contains(static_cast<AovChannel>(i))) {
+            mask |= 1u << i;
+        }
+    }
+    return mask;
+}
+
+inline size_t tile_floats(int tile_size, int planes) {
+    return static_cast<size_t>(tile_size) * tile_size * planes;
+}
+
+inline std::streamoff tile_offset(int tile_index, int tile_size, int planes) {
+    return static_cast<std::streamoff>(kHeaderBytes) +
+           static_cast<std::streamoff>(tile_index) * static_cast<std::streamoff>(tile_floats(tile_size, planes) * sizeof(float));
+}
+
+// Slots of the memory budget, one per resident tile.
+class TileBudget {
+public:
+    explicit TileBudget(size_t count) : free_slots(count) {}
+
+    void acquire() {
+        std::unique_lock<std::mutex> lock(mutex);
+        available.wait(lock, [this] { return free_slots > 0; });
+        --free_slots;
+    }
+
+    void release() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ++free_slots;
+        }
+        available.notify_one();
+    }
+
+private:
+    std::mutex mutex;
+    std::condition_variable available;
+    size_t free_slots;
+};
+
+}
+
+inline int tiled_planes(const AovSet& aovs) {
+    int planes = 3;
+    for (int i = 0; i < kAovChannelCount; ++i) {
+        const AovChannel channel = static_cast<AovChannel>(i);
+        if (aovs.contains(channel)) {
+            planes += aov_components(channel);
+        }
+    }
+    return planes;
+}
+
+inline TiledImageWriter::TiledImageWriter(const std::string& path, int width, int height, int tile_size,
+                                          const AovSet& aovs)
+    : file_path(path), image_width(width), image_height(height), tile(tile_size), planes(tiled_planes(aovs)) {
+    using namespace tiled_detail;
+    if (width <= 0 || height <= 0 || tile_size <= 0) {
+        throw std::invalid_argument("TiledImageWriter requires a positive size and tile size.");
+    }
+    file.open(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        throw std::runtime_error("Cannot create tiled image: " + path);
+    }
+    FileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.width = static_cast<uint32_t>(width);
+    header.height = static_cast<uint32_t>(height);
+    header.tile_size = static_cast<uint32_t>(tile_size);
+    header.planes = static_cast<uint32_t>(planes);
+    header.aov_mask = aov_mask(aovs);
+    char bytes[kHeaderBytes] = {};
+    std::memcpy(bytes, &header, sizeof(header));
+    file.write(bytes, sizeof(bytes));
+    // Size the file up front; tiles not yet written read back as zeros.
+    const std::streamoff end = tile_offset(tiles_x() * tiles_y(), tile, planes);
+    file.seekp(end - 1);
+    file.put('\0');
+    if (!file) {
+        throw std::runtime_error("Cannot size tiled image: " + path);
+    }
+}
+
+inline void TiledImageWriter::write_tile(int tile_x, int tile_y, const float* data) {
+    using namespace tiled_detail;
+    file.seekp(tile_offset(tile_y * tiles_x() + tile_x, tile, planes));
+    file.write(reinterpret_cast<const char*>(data),
+               static_cast<std::streamsize>(tile_floats(tile, planes) * sizeof(float)));
+    if (!file) {
+        throw std::runtime_error("Cannot write tiled image: " + file_path);
+    }
+}
+
+inline TiledImage::TiledImage(const std::string& path) : file(path, std::ios::binary), file_path(path) {
+    using namespace tiled_detail;
+    FileHeader header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.width == 0 || header.height == 0 ||
+        header.tile_size == 0) {
+        throw std::runtime_error("Not a tiled image: " + path);
+    }
+    image_width = static_cast<int>(header.width);
+    image_height = static_cast<int>(header.height);
+    tile = static_cast<int>(header.tile_size);
+    for (int i = 0; i < kAovChannelCount; ++i) {
+        if (header.aov_mask & (1u << i)) {
+            channels.add(static_cast<AovChannel>(i));
+        }
+    }
+    plane_count = tiled_planes(channels);
+    if (static_cast<uint32_t>(plane_count) != header.planes) {
+        throw std::runtime_error("Not a tiled image: " + path);
+    }
+}
+
+inline std::vector<float> TiledImage::read_tile(int tile_x, int tile_y) const {
+    using namespace tiled_detail;
+    const int tiles_x = (image_width + tile - 1) / tile;
+    const int tiles_y = (image_height + tile - 1) / tile;
+    if (tile_x < 0 || tile_y < 0 || tile_x >= tiles_x || tile_y >= tiles_y) {
+        throw std::invalid_argument("Tile outside the tiled image.");
+    }
+    std::vector<float> data(tile_floats(tile, plane_count));
+    file.clear();
+    file.seekg(tile_offset(tile_y * tiles_x + tile_x, tile, plane_count));
+    if (!file.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(data.size() * sizeof(float)))) {
+        throw std::runtime_error("Truncated tiled image: " + file_path);
+    }
+    return data;
+}
+
+inline Color TiledImage::pixel(int x, int y) const {
+    const std::vector<float> data = read_tile(x / tile, y / tile);
+    const size_t area = static_cast<size_t>(tile) * tile;
+    const size_t index = static_cast<size_t>(y % tile) * tile + static_cast<size_t>(x % tile);
+    return Color(data[index], data[area + index], data[2 * area + index]);
+}
+
+inline TiledRenderStats render_tiled(const Hitable& world, const LightSampler& lights, const CameraParams& view,
+                                     const PathTracerSettings& path_settings, const TiledRenderSettings& settings,
+                                     const AovIds& ids, const std::string& path,
+                                     const std::function<void(int, int, int, int, const float*)>& on_tile,
+                                     const std::atomic<bool>* cancel) {
+    using namespace tiled_detail;
+    if (settings.width <= 0 || settings.height <= 0 || settings.tile_size <= 0 || settings.samples <= 0) {
+        throw std::invalid_argument("render_tiled requires a positive size, tile size and sample count.");
+    }
+    const int tile = settings.tile_size;
+    const size_t area = static_cast<size_t>(tile) * tile;
+    const int planes = tiled_planes(settings.aovs);
+    // Accumulators and AOV scratch planes while a tile is traced, then the
+    // resolved planes until it is written.
+    const size_t scratch_bytes = area * (sizeof(PixelAccumulator) + (planes - 3) * sizeof(float));
+    const size_t plane_bytes = tile_floats(tile, planes) * sizeof(float);
+
+    TiledRenderStats stats;
+    stats.tile_bytes = scratch_bytes + plane_bytes;
+    stats.budget_tiles = settings.memory_budget / stats.tile_bytes;
+    if (stats.budget_tiles == 0) {
+        throw std::invalid_argument("Memory budget is smaller than one tile (" + std::to_string(stats.tile_bytes) +
+                                    " bytes).");
+    }
+    std::unique_ptr<TiledImageWriter> writer;
+    if (!path.empty()) {
+        writer = std::make_unique<TiledImageWriter>(path, settings.width, settings.height, tile, settings.aovs);
+    }
+    const int tiles_x = (settings.width + tile - 1) / tile;
+    const int tiles_y = (settings.height + tile - 1) / tile;
+
+    TileBudget budget(stats.budget_tiles);
+    std::atomic<size_t> resident{0};
+    std::atomic<size_t> peak{0};
+    const auto allocate = [&](size_t bytes) {
+        const size_t now = resident.fetch_add(bytes) + bytes;
+        size_t seen = peak.load();
+        while (now > seen && !peak.compare_exchange_weak(seen, now)) {
+        }
+    };
+
+    // Finished tiles waiting for the writer thread.
+    struct PendingTile {
+        int index;
+        std::vector<float> data;
+    };
+    std::mutex queue_mutex;
+    std::condition_variable queue_ready;
+    std::deque<PendingTile> queue;
+    bool producing = true;
+    std::string write_error;
+    std::thread writer_thread([&]() {
+        for (;;) {
+            PendingTile pending;
+            {
+                std::unique_lock<std::mutex> lock(queue_mutex);
+                queue_ready.wait(lock, [&] { return !queue.empty() || !producing; });
+                if (queue.empty()) {
+                    return;
+                }
+                pending = std::move(queue.front());
+                queue.pop_front();
+            }
+            const auto start = std::chrono::steady_clock::now();
+            try {
+                if (write_error.empty()) {
+                    if (writer) {
+                        writer->write_tile(pending.index % tiles_x, pending.index / tiles_x, pending.data.data());
+                    }
+                    ++stats.tiles;
+                }
+            } catch (const std::exception& error) {
+                write_error = error.what();
+            }
+            stats.write_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            resident.fetch_sub(pending.data.size() * sizeof(float));
+            pending.data = std::vector<float>();
+            budget.release();
+        }
+    });
+    const auto finish_writing = [&]() {
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            producing = false;
+        }
+        queue_ready.notify_one();
+        writer_thread.join();
+    };
+
+    const Camera camera = view.camera(static_cast<double>(settings.width) / settings.height);
+    const auto render_one = [&](size_t t) {
+        const int x0 = static_cast<int>(t % tiles_x) * tile;
+        const int y0 = static_cast<int>(t / tiles_x) * tile;
+        const int x1 = std::min(x0 + tile, settings.width);
+        const int y1 = std::min(y0 + tile, settings.height);
+        std::vector<float> data(tile_floats(tile, planes));
+        render_tile(world, lights, camera, path_settings, settings, ids, t, data.data());
+        resident.fetch_sub(scratch_bytes);
+        if (on_tile) {
+            on_tile(x0, y0, x1, y1, data.data());
+        }
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            queue.push_back(PendingTile{static_cast<int>(t), std::move(data)});
+        }
+        queue_ready.notify_one();
+    };
+
+    try {
+        parallel_for(static_cast<size_t>(tiles_x) * tiles_y, 1, [&](size_t tile_begin, size_t tile_end) {
+            for (size_t t = tile_begin; t < tile_end; ++t) {
+                if (cancel && cancel->load(std::memory_order_relaxed)) {
+                    return;
+                }
+                budget.acquire();
+                allocate(scratch_bytes + plane_bytes);
+                try {
+                    render_one(t);
+                } catch (...) {
+                    budget.release();
+                    throw;
+                }
+            }
+        });
+    } catch (...) {
+        finish_writing();
+        throw;
+    }
+    finish_writing();
+
+
+    if (!write_error.empty()) {
+        throw std::runtime_error(write_error);
+    }
+    stats.peak_resident_bytes = peak.load();
+    return stats;
+}
+
+inline void render_tile(const Hitable& world, const LightSampler& lights, const Camera& camera,
+                        const PathTracerSettings& path_settings, const TiledRenderSettings& settings, const AovIds& ids,
+                        size_t tile_index, float* data) {
+    const int tile = settings.tile_size;
+    const size_t area = static_cast<size_t>(tile) * tile;
+    const int tiles_x = (settings.width + tile - 1) / tile;
+    const int x0 = static_cast<int>(tile_index % tiles_x) * tile;
+    const int y0 = static_cast<int>(tile_index / tiles_x) * tile;
+    const int x1 = std::min(x0 + tile, settings.width);
+    const int y1 = std::min(y0 + tile, settings.height);
+    const double inv_width = 1.0 / std::max(1, settings.width - 1);
+    const double inv_height = 1.0 / std::max(1, settings.height - 1);
+    std::fill(data, data + tiled_detail::tile_floats(tile, tiled_planes(settings.aovs)), 0.0f);
+
+    std::vector<PixelAccumulator> pixels(area);
+    for (int y = y0; y < y1; ++y) {
+        const int j = settings.height - 1 - y;
+        for (int x = x0; x < x1; ++x) {
+            const size_t index = static_cast<size_t>(y) * settings.width + x;
+            PixelAccumulator& pixel = pixels[static_cast<size_t>(y - y0) * tile + (x - x0)];
+            seed_thread_rng(settings.seed ^ splitmix64(index));
+            for (int s = 0; s < settings.samples; ++s) {
+                const Ray ray = camera.get_ray((x + random_double()) * inv_width, (j + random_double()) * inv_height);
+                HitFeatures hit;
+                pixel.add(trace_path(ray, world, lights, path_settings, &hit), hit);
+            }
+        }
+    }
+    AovBuffers aovs;
+    if (!settings.aovs.empty()) {
+        aovs = AovBuffers(tile, tile, settings.aovs);
+    }
+    for (size_t i = 0; i < area; ++i) {
+        const Color mean = pixels[i].mean();
+        for (int c = 0; c < 3; ++c) {
+            data[area * c + i] = static_cast<float>(mean[c]);
+        }
+        if (!settings.aovs.empty()) {
+            aovs.resolve(i, pixels[i], ids);
+        }
+    }
+    float* out = data + 3 * area;
+    for (int i = 0; i < kAovChannelCount; ++i) {
+        const AovChannel channel = static_cast<AovChannel>(i);
+        if (!settings.aovs.contains(channel)) {
+            continue;
+        }
+        for (int c = 0; c < aov_components(channel); ++c, out += area) {
+            std::copy(aovs.plane(channel, c), aovs.plane(channel, c) + area, out);
+        }
+    }
+}
+
+inline int train_guide(const Hitable& world, const LightSampler& lights, const CameraParams& view,
+                       const PathTracerSettings& path_settings, const TiledRenderSettings& settings,
+                       const std::atomic<bool>* cancel) {
+    SDTree* guide = path_settings.guide.get();
+    if (!guide) {
+        throw std::invalid_argument("train_guide() requires PathTracerSettings::guide.");
+    }
+    TiledRenderSettings pass = settings;
+    pass.aovs = AovSet();
+    const int budget = std::max(1, settings.samples / 4);
+    int iterations = 0;
+    guide->set_training(true);
+    for (int spp = 1, spent = 0; spent + spp <= budget; spent += spp, spp *= 2) {
+        if (cancel && cancel->load(std::memory_order_relaxed)) {
+            break;
+        }
+        // Iterations draw other samples than the frame and each other.
+        pass.samples = spp;
+        pass.seed = splitmix64(settings.seed + static_cast<uint64_t>(iterations) + 1);
+        render_tiled(world, lights, view, path_settings, pass, AovIds(), "", {}, cancel);
+        guide->end_pass();
+        ++iterations;
+    }
+    guide->set_training(false);
+    return iterations;
+}
+
+inline TiledFrameDenoiser::TiledFrameDenoiser(int width, int height, int tile_size, const AovSet& aovs)
+    : frame_width(width),
+      frame_height(height),
+      tile(tile_size),
+      area(static_cast<size_t>(width) * height),
+      channels(aovs) {
+    if (width <= 0 || height <= 0 || tile_size <= 0) {
+        throw std::invalid_argument("TiledFrameDenoiser requires a positive size and tile size.");
+    }
+    for (AovChannel guide : {AovChannel::Depth, AovChannel::Normal, AovChannel::Albedo, AovChannel::Variance}) {
+        if (!aovs.contains(guide)) {
+            throw std::invalid_argument(std::string("Denoising needs the ") + aov_name(guide) + " channel.");
+        }
+    }
+    frame.resize(area * tiled_planes(aovs));
+}
+
+inline AovSet TiledFrameDenoiser::with_denoise_guides(const AovSet& aovs) {
+    AovSet guided = aovs;
+    guided.add(AovChannel::Depth).add(AovChannel::Normal).add(AovChannel::Albedo).add(AovChannel::Variance);
+    return guided;
+}
+
+inline void TiledFrameDenoiser::add_tile(int x0, int y0, int x1, int y1, const float* data) {
+    const size_t tile_area = static_cast<size_t>(tile) * tile;
+    const int planes = tiled_planes(channels);
+    for (int p = 0; p < planes; ++p) {
+        for (int y = y0; y < y1; ++y) {
+            const float* row = data + p * tile_area + static_cast<size_t>(y - y0) * tile;
+            std::copy(row, row + (x1 - x0), frame.data() + p * area + static_cast<size_t>(y) * frame_width + x0);
+        }
+    }
+}
+
+inline size_t TiledFrameDenoiser::plane_of(AovChannel channel) const {
+    size_t index = 3;
+    for (int i = 0; i < static_cast<int>(channel); ++i) {
+        if (channels.contains(static_cast<AovChannel>(i))) {
+            index += aov_components(static_cast<AovChannel>(i));
+        }
+    }
+    return index;
+}
+
+inline std::vector<float> TiledFrameDenoiser::finish(const AovSet& output,
+                                                     const DenoiseSettings& denoise_settings) const {
+    for (int i = 0; i < kAovChannelCount; ++i) {
+        const AovChannel channel = static_cast<AovChannel>(i);
+        if (output.contains(channel) && !channels.contains(channel)) {
+            throw std::invalid_argument(std::string("The tiles have no ") + aov_name(channel) + " channel.");
+        }
+    }
+    std::vector<Color> radiance(area);
+    DenoiseFeatures features(frame_width, frame_height);
+    const float* depth = plane(plane_of(AovChannel::Depth));
+    const float* variance = plane(plane_of(AovChannel::Variance));
+    const size_t normal = plane_of(AovChannel::Normal);
+    const size_t albedo = plane_of(AovChannel::Albedo);
+    for (size_t i = 0; i < area; ++i) {
+        radiance[i] = Color(plane(0)[i], plane(1)[i], plane(2)[i]);
+        features.albedo[i] = Color(plane(albedo)[i], plane(albedo + 1)[i], plane(albedo + 2)[i]);
+        features.normal[i] = Vec3(plane(normal)[i], plane(normal + 1)[i], plane(normal + 2)[i]);
+        features.depth[i] = depth[i];
+        features.variance[i] = variance[i];
+    }
+    const std::vector<Color> filtered = denoise(radiance, features, denoise_settings);
+
+    std::vector<float> planes(area * tiled_planes(output));
+    for (size_t i = 0; i < area; ++i) {
+        for (int c = 0; c < 3; ++c) {
+            planes[c * area + i] = static_cast<float>(filtered[i][c]);
+        }
+    }
+    float* out = planes.data() + 3 * area;
+    for (int i = 0; i < kAovChannelCount; ++i) {
+        const AovChannel channel = static_cast<AovChannel>(i);
+        if (!output.contains(channel)) {
+            continue;
+        }
+        const size_t first = plane_of(channel);
+        for (int c = 0; c < aov_components(channel); ++c, out += area) {
+            std::copy(plane(first + c), plane(first + c) + area, out);
+        }
+    }
+    return planes;
+}
+
+#endif // RAYTRACER_TILED_IMAGE_H
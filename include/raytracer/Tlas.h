@@ -0,0 +1,127 @@
+#ifndef RAYTRACER_TLAS_H
+#define RAYTRACER_TLAS_H
+
+#include "raytracer/LinearBVH.h"
+
+// Two-level acceleration structure.
+//
+// Each Instance places a bottom-level structure (BLAS: any Hitable, usually a
+// LinearBVH over one object's geometry) in the world with a translation. The
+// TLAS is a LinearBVH over instances. Moving an instance only changes its
+// translation and refits the TLAS path above it; BLAS data is never touched.
+
+class Instance : public Hitable {
+public:
+    Instance(std::shared_ptr<Hitable> object, const Vec3& offset = Vec3(0, 0, 0));
+
+    bool hit(const Ray& r, double t_min, double t_max, HitRecord& rec) const override;
+    bool occluded(const Ray& r, double t_min, double t_max) const override;
+    bool bounding_box(AABB& output_box) const override;
+
+    const Vec3& offset() const { return translation; }
+    void set_offset(const Vec3& offset) { translation = offset; }
+
+    // Re-reads the BLAS bounds; only needed if the BLAS itself was modified.
+    void update_bounds();
+
+public:
+    std::shared_ptr<Hitable> blas;
+
+private:
+    Vec3 translation;
+    AABB local_box;
+};
+
+inline Instance::Instance(std::shared_ptr<Hitable> object, const Vec3& offset)
+    : blas(std::move(object)), translation(offset) {
+    update_bounds();
+}
+
+inline void Instance::update_bounds() {
+    if (!blas || !blas->bounding_box(local_box)) {
+        throw std::invalid_argument("Instance requires a bounded BLAS.");
+    }
+}
+
+inline bool Instance::hit(const Ray& r, double t_min, double t_max, HitRecord& rec) const {
+    const Ray local(r.origin() - translation, r.direction());
+    if (!blas->hit(local, t_min, t_max, rec)) {
+        return false;
+    }
+    rec.p += translation;
+    return true;
+}
+
+inline bool Instance::occluded(const Ray& r, double t_min, double t_max) const {
+    return blas->occluded(Ray(r.origin() - translation, r.direction()), t_min, t_max);
+}
+
+inline bool Instance::bounding_box(AABB& output_box) const {
+    output_box = AABB(local_box.min() + translation, local_box.max() + translation);
+    return true;
+}
+
+class TLAS : public Hitable {
+public:
+    TLAS() {}
+    explicit TLAS(std::vector<std::shared_ptr<Instance>> instance_list,
+                  BVHBuildMethod method = BVHBuildMethod::SAH);
+
+    bool hit(const Ray& r, double t_min, double t_max, HitRecord& rec) const override;
+    bool occluded(const Ray& r, double t_min, double t_max) const override;
+    bool bounding_box(AABB& output_box) const override;
+
+    size_t instance_count() const { return instances.size(); }
+    const std::shared_ptr<Instance>& instance(size_t index) const { return instances[index]; }
+
+    // Moves one instance and refits only the TLAS nodes above it.
+    void set_instance_offset(size_t index, const Vec3& offset);
+
+    // Refits the whole TLAS after moving many instances through instance(i).
+    void refit() { bvh.refit(); }
+
+    // Rebuilds the TLAS topology; use when refits have degraded traversal quality.
+    void rebuild();
+
+    // Per-frame update after `moved_instances` were moved through instance(i):
+    // refit, fast LBVH rebuild or SAH rebuild depending on the moved fraction.
+    BVHUpdate update(size_t moved_instances, const BVHUpdatePolicy& policy = BVHUpdatePolicy()) {
+        return bvh.update(moved_instances, policy);
+    }
+
+    const LinearBVH& top_level() const { return bvh; }
+
+private:
+    std::vector<std::shared_ptr<Instance>> instances;
+    LinearBVH bvh;
+    BVHBuildMethod build_method = BVHBuildMethod::SAH;
+};
+
+inline TLAS::TLAS(std::vector<std::shared_ptr<Instance>> instance_list, BVHBuildMethod method)
+    : instances(std::move(instance_list)), build_method(method) {
+    rebuild();
+}
+
+inline void TLAS::rebuild() {
+    std::vector<std::shared_ptr<Hitable>> objects(instances.begin(), instances.end());
+    bvh = LinearBVH(std::move(objects), build_method, 2);
+}
+
+inline void TLAS::set_instance_offset(size_t index, const Vec3& offset) {
+    instances.at(index)->set_offset(offset);
+    bvh.refit(index);
+}
+
+inline bool TLAS::hit(const Ray& r, double t_min, double t_max, HitRecord& rec) const {
+    return bvh.hit(r, t_min, t_max, rec);
+}
+
+inline bool TLAS::occluded(const Ray& r, double t_min, double t_max) const {
+    return bvh.occluded(r, t_min, t_max);
+}
+
+inline bool TLAS::bounding_box(AABB& output_box) const {
+    return bvh.bounding_box(output_box);
+}
+
+#endif // RAYTRACER_TLAS_H
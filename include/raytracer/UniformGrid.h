@@ -0,0 +1,297 @@
+#ifndef RAYTRACER_UNIFORM_GRID_H
+#define RAYTRACER_UNIFORM_GRID_H
+
+#include <array>
+#include <atomic>
+#include <cmath>
+
+#include "raytracer/LinearBVH.h"
+
+// Uniform grid for dense, near-uniform fields of similar-sized primitives.
+//
+// Cells reference every primitive whose box overlaps them, stored compactly as
+// one offset array plus one reference array, so empty cells cost four bytes.
+// Rays walk the cells front to back with a 3D-DDA (Amanatides & Woo 1987) and
+// stop once the closest hit lies inside the current cell. A primitive spanning
+// several cells is tested once per ray thanks to a small per-ray mailbox.
+
+struct GridSettings {
+    // Target cells per primitive; resolution follows Cleary & Wyvill:
+    // cells per unit length = cbrt(density * N / volume).
+    double density = 2.0;
+    // Per-axis resolution limit.
+    int max_resolution = 512;
+};
+
+class UniformGrid : public Hitable {
+public:
+    UniformGrid() {}
+    explicit UniformGrid(std::vector<std::shared_ptr<Hitable>> objects,
+                         const GridSettings& settings = GridSettings());
+
+    bool hit(const Ray& r, double t_min, double t_max, HitRecord& rec) const override;
+    bool bounding_box(AABB& output_box) const override;
+
+    // Same as hit() but also counts visited cells and primitive tests.
+    bool hit(const Ray& r, double t_min, double t_max, HitRecord& rec, BVHTraversalStats& stats) const;
+
+    bool occluded(const Ray& r, double t_min, double t_max) const override;
+    bool occluded(const Ray& r, double t_min, double t_max, BVHTraversalStats& stats) const;
+
+    const std::array<int, 3>& resolution() const { return res; }
+    size_t cell_count() const { return cell_start.size() - 1; }
+    size_t reference_count() const { return cell_refs.size(); }
+    size_t memory_bytes() const { return (cell_start.size() + cell_refs.size()) * sizeof(uint32_t); }
+
+private:
+    static constexpr size_t kMailboxSize = 16;
+
+    void build(const GridSettings& settings);
+    void cell_range(const AABB& box, std::array<int, 3>& lo, std::array<int, 3>& hi) const;
+    size_t cell_index(int x, int y, int z) const {
+        return (static_cast<size_t>(z) * res[1] + static_cast<size_t>(y)) * res[0] + static_cast<size_t>(x);
+    }
+
+    // With AnyHit set, returns at the first occluding primitive and leaves
+    // `rec` untouched.
+    template <bool AnyHit, typename Stats>
+    bool traverse(const Ray& r, double t_min, double t_max, HitRecord& rec, Stats& stats) const;
+
+    std::vector<std::shared_ptr<Hitable>> primitives;
+    AABB bounds;
+    std::array<int, 3> res = {1, 1, 1};
+    Vec3 cell_size;
+    Vec3 inv_cell_size;
+    std::vector<uint32_t> cell_start;  // cell_count() + 1 offsets into cell_refs
+    std::vector<uint32_t> cell_refs;
+};
+
+inline UniformGrid::UniformGrid(std::vector<std::shared_ptr<Hitable>> objects, const GridSettings& settings)
+    : primitives(std::move(objects)) {
+    build(settings);
+}
+
+inline void UniformGrid::cell_range(const AABB& box, std::array<int, 3>& lo, std::array<int, 3>& hi) const {
+    for (int axis = 0; axis < 3; ++axis) {
+        lo[axis] = std::clamp(static_cast<int>((box.min()[axis] - bounds.min()[axis]) * inv_cell_size[axis]),
+                              0, res[axis] - 1);
+        hi[axis] = std::clamp(static_cast<int>((box.max()[axis] - bounds.min()[axis]) * inv_cell_size[axis]),
+                              0, res[axis] - 1);
+    }
+}
+
+inline void UniformGrid::build(const GridSettings& settings) {
+    if (primitives.empty()) {
+        throw std::invalid_argument("UniformGrid requires at least one object.");
+    }
+    if (primitives.size() >= LinearBVH::kInvalidIndex) {
+        throw std::invalid_argument("UniformGrid supports at most 2^32 - 1 objects.");
+    }
+
+    const size_t n = primitives.size();
+    std::vector<AABB> boxes(n);
+    parallel_for(n, 4096, [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; ++i) {
+            if (!primitives[i]->bounding_box(boxes[i])) {
+                throw std::runtime_error("No bounding box in UniformGrid constructor.");
+            }
+        }
+    });
+    bounds = AABB::empty();
+    for (const AABB& box : boxes) {
+        bounds.expand(box);
+    }
+
+    // Flat scenes would have zero volume; give thin axes a sliver of the largest.
+    Vec3 extent = bounds.max() - bounds.min();
+    const double largest = std::fmax(extent.x(), std::fmax(extent.y(), extent.z()));
+    for (int axis = 0; axis < 3; ++axis) {
+        extent[axis] = std::fmax(extent[axis], 1e-3 * largest);
+    }
+    if (!(largest > 0.0)) {
+        extent = Vec3(1.0, 1.0, 1.0);
+    }
+    bounds = AABB(bounds.min(), bounds.min() + extent);
+
+    const double volume = extent.x() * extent.y() * extent.z();
+    const double cells_per_unit = std::cbrt(settings.density * static_cast<double>(n) / volume);
+    for (int axis = 0; axis < 3; ++axis) {
+        res[axis] = std::clamp(static_cast<int>(std::lround(extent[axis] * cells_per_unit)), 1,
+                               std::max(1, settings.max_resolution));
+        cell_size[axis] = extent[axis] / res[axis];
+        inv_cell_size[axis] = res[axis] / extent[axis];
+    }
+
+    // Two passes over the primitives: count references per cell, then scatter
+    // them through per-cell cursors. Both passes run in parallel with atomics;
+    // each cell's list is sorted afterwards so the result is deterministic.
+    const size_t cells = static_cast<size_t>(res[0]) * res[1] * res[2];
+    std::vector<std::atomic<uint32_t>> counts(cells);
+    parallel_for(n, 4096, [&](size_t first, size_t last) {
+        std::array<int, 3> lo;
+        std::array<int, 3> hi;
+        for (size_t i = first; i < last; ++i) {
+            cell_range(boxes[i], lo, hi);
+            for (int z = lo[2]; z <= hi[2]; ++z) {
+                for (int y = lo[1]; y <= hi[1]; ++y) {
+                    for (int x = lo[0]; x <= hi[0]; ++x) {
+                        counts[cell_index(x, y, z)].fetch_add(1, std::memory_order_relaxed);
+                    }
+                }
+            }
+        }
+    });
+
+    cell_start.assign(cells + 1, 0);
+    uint64_t running = 0;
+    for (size_t c = 0; c < cells; ++c) {
+        cell_start[c] = static_cast<uint32_t>(running);
+        running += counts[c].load(std::memory_order_relaxed);
+        counts[c].store(cell_start[c], std::memory_order_relaxed);
+    }
+    if (running >= LinearBVH::kInvalidIndex) {
+        throw std::runtime_error("UniformGrid: too many cell references; lower GridSettings::density.");
+    }
+    cell_start[cells] = static_cast<uint32_t>(running);
+    cell_refs.resize(running);
+
+    parallel_for(n, 4096, [&](size_t first, size_t last) {
+        std::array<int, 3> lo;
+        std::array<int, 3> hi;
+        for (size_t i = first; i < last; ++i) {
+            cell_range(boxes[i], lo, hi);
+            for (int z = lo[2]; z <= hi[2]; ++z) {
+                for (int y = lo[1]; y <= hi[1]; ++y) {
+                    for (int x = lo[0]; x <= hi[0]; ++x) {
+                        const uint32_t slot = counts[cell_index(x, y, z)].fetch_add(1, std::memory_order_relaxed);
+                        cell_refs[slot] = static_cast<uint32_t>(i);
+                    }
+                }
+            }
+        }
+    });
+    parallel_for(cells, 4096, [&](size_t first, size_t last) {
+        for (size_t c = first; c < last; ++c) {
+            std::sort(cell_refs.begin() + cell_start[c], cell_refs.begin() + cell_start[c + 1]);
+        }
+    });
+}
+
+template <bool AnyHit, typename Stats>
+inline bool UniformGrid::traverse(const Ray& r, double t_min, double t_max, HitRecord& rec,
+                                  Stats& stats) const {
+    if (cell_refs.empty()) {
+        return false;
+    }
+
+    const Point3 origin = r.origin();
+    const Vec3 dir = r.direction();
+    const Vec3 inv_dir(1.0 / dir.x(), 1.0 / dir.y(), 1.0 / dir.z());
+    double t_enter = 0.0;
+    if (!hit_box(bounds, origin, inv_dir, t_min, t_max, t_enter)) {
+        return false;
+    }
+
+    // DDA setup: the cell containing the entry point, the ray parameter of the
+    // next boundary on each axis and the parameter step between boundaries.
+    const Point3 entry = origin + t_enter * dir;
+    std::array<int, 3> cell;
+    std::array<int, 3> step;
+    std::array<int, 3> stop;
+    double t_next[3];
+    double t_delta[3];
+    for (int axis = 0; axis < 3; ++axis) {
+        cell[axis] = std::clamp(static_cast<int>((entry[axis] - bounds.min()[axis]) * inv_cell_size[axis]), 0,
+                                res[axis] - 1);
+        if (dir[axis] > 0.0) {
+            step[axis] = 1;
+            stop[axis] = res[axis];
+            t_next[axis] = (bounds.min()[axis] + (cell[axis] + 1) * cell_size[axis] - origin[axis]) * inv_dir[axis];
+            t_delta[axis] = cell_size[axis] * inv_dir[axis];
+        } else if (dir[axis] < 0.0) {
+            step[axis] = -1;
+            stop[axis] = -1;
+            t_next[axis] = (bounds.min()[axis] + cell[axis] * cell_size[axis] - origin[axis]) * inv_dir[axis];
+            t_delta[axis] = -cell_size[axis] * inv_dir[axis];
+        } else {
+            step[axis] = 0;
+            stop[axis] = -1;
+            t_next[axis] = infinity;
+            t_delta[axis] = infinity;
+        }
+    }
+
+    // Direct-mapped mailbox of primitives already tested by this ray. A skipped
+    // primitive either missed or already updated `closest`, so it is safe to
+    // drop repeats; a collision only costs a redundant test.
+    uint32_t mailbox[kMailboxSize];
+    std::fill(mailbox, mailbox + kMailboxSize, LinearBVH::kInvalidIndex);
+
+    bool hit_anything = false;
+    double closest = t_max;
+    while (true) {
+        const size_t index = cell_index(cell[0], cell[1], cell[2]);
+        stats.visit_node(cell_start[index]);
+        for (uint32_t k = cell_start[index]; k < cell_start[index + 1]; ++k) {
+            const uint32_t prim = cell_refs[k];
+            uint32_t& slot = mailbox[prim % kMailboxSize];
+            if (slot == prim) {
+                continue;
+            }
+            slot = prim;
+            stats.test_primitive();
+            if constexpr (AnyHit) {
+                if (primitives[prim]->occluded(r, t_min, t_max)) {
+                    return true;
+                }
+            } else if (primitives[prim]->hit(r, t_min, closest, rec)) {
+                hit_anything = true;
+                closest = rec.t;
+            }
+        }
+
+        const int axis = t_next[0] < t_next[1] ? (t_next[0] < t_next[2] ? 0 : 2) : (t_next[1] < t_next[2] ? 1 : 2);
+        // Hits inside this cell cannot be beaten by anything further along.
+        if (closest <= t_next[axis]) {
+            break;
+        }
+        cell[axis] += step[axis];
+        if (cell[axis] == stop[axis]) {
+            break;
+        }
+        t_next[axis] += t_delta[axis];
+    }
+
+    return hit_anything;
+}
+
+inline bool UniformGrid::hit(const Ray& r, double t_min, double t_max, HitRecord& rec) const {
+    NoTraversalStats stats;
+    return traverse<false>(r, t_min, t_max, rec, stats);
+}
+
+inline bool UniformGrid::hit(const Ray& r, double t_min, double t_max, HitRecord& rec,
+                             BVHTraversalStats& stats) const {
+    return traverse<false>(r, t_min, t_max, rec, stats);
+}
+
+inline bool UniformGrid::occluded(const Ray& r, double t_min, double t_max) const {
+    NoTraversalStats stats;
+    HitRecord unused;
+    return traverse<true>(r, t_min, t_max, unused, stats);
+}
+
+inline bool UniformGrid::occluded(const Ray& r, double t_min, double t_max, BVHTraversalStats& stats) const {
+    HitRecord unused;
+    return traverse<true>(r, t_min, t_max, unused, stats);
+}
+
+inline bool UniformGrid::bounding_box(AABB& output_box) const {
+    if (cell_refs.empty()) {
+        return false;
+    }
+    output_box = bounds;
+    return true;
+}
+
+#endif // RAYTRACER_UNIFORM_GRID_H
@@ -11,6 +11,8 @@ Item {
     property int cfgHeight: 225
     property int cfgSamples: 24
     property int cfgDepth: 10
+    property bool cfgDenoise: denoiseByDefault
+    property string cfgRegion: "off"
     property string aaPreset: "medium"
     property string computeBackendMode: "auto"
     property bool compactLayout: width < 980
@@ -363,6 +365,98 @@ Item {
                         }
                     }
 
+                    Text {
+                        text: "Denoiser"
+                        color: "#667289"
+                        font.family: root.appleFont
+                        font.pixelSize: 13
+                    }
+
+                    Row {
+                        width: parent.width
+                        spacing: 8
+
+                        Repeater {
+                            model: [
+                                { name: "Off", value: false },
+                                { name: "On", value: true }
+                            ]
+
+                            delegate: Rectangle {
+                                required property var modelData
+                                property bool active: root.cfgDenoise === modelData.value
+
+                                width: (parent.width - 8) / 2
+                                height: 30
+                                radius: 15
+                                color: active ? "#e7f1ff" : "#f7f9fd"
+                                border.width: 1
+                                border.color: active ? "#7fb8ff" : "#d5dce8"
+
+                                Text {
+                                    anchors.centerIn: parent
+                                    text: parent.modelData.name
+                                    color: parent.active ? "#0a84ff" : "#5e6b82"
+                                    font.family: root.appleFont
+                                    font.pixelSize: 12
+                                    font.weight: parent.active ? Font.DemiBold : Font.Medium
+                                }
+
+                                MouseArea {
+                                    anchors.fill: parent
+                                    onClicked: root.cfgDenoise = parent.modelData.value
+                                }
+                            }
+                        }
+                    }
+
+                    Text {
+                        text: "Region of interest"
+                        color: "#667289"
+                        font.family: root.appleFont
+                        font.pixelSize: 13
+                    }
+
+                    Row {
+                        width: parent.width
+                        spacing: 8
+
+                        Repeater {
+                            model: [
+                                { name: "Off", value: "off" },
+                                { name: "Focus", value: "focus" },
+                                { name: "Follow", value: "follow" },
+                                { name: "Crop", value: "crop" }
+                            ]
+
+                            delegate: Rectangle {
+                                required property var modelData
+                                property bool active: root.cfgRegion === modelData.value
+
+                                width: (parent.width - 24) / 4
+                                height: 30
+                                radius: 15
+                                color: active ? "#e7f1ff" : "#f7f9fd"
+                                border.width: 1
+                                border.color: active ? "#7fb8ff" : "#d5dce8"
+
+                                Text {
+                                    anchors.centerIn: parent
+                                    text: parent.modelData.name
+                                    color: parent.active ? "#0a84ff" : "#5e6b82"
+                                    font.family: root.appleFont
+                                    font.pixelSize: 12
+                                    font.weight: parent.active ? Font.DemiBold : Font.Medium
+                                }
+
+                                MouseArea {
+                                    anchors.fill: parent
+                                    onClicked: root.cfgRegion = parent.modelData.value
+                                }
+                            }
+                        }
+                    }
+
                     Text { text: "Width"; color: "#667289"; font.family: root.appleFont; font.pixelSize: 13 }
                     Rectangle {
                         id: widthField
@@ -640,6 +734,112 @@ Item {
                 samples: root.cfgSamples
                 maxDepth: root.cfgDepth
                 computeBackend: root.computeBackendMode
+                denoise: root.cfgDenoise
+                guiding: guidingByDefault
+                environment: environmentByDefault
+                lightSelection: lightSelectionByDefault
+                aovChannels: aovChannelsByDefault
+                aovOutput: aovOutputByDefault
+                checkpointPath: checkpointByDefault
+                checkpointInterval: checkpointIntervalByDefault
+                resumePath: resumeByDefault
+                tiledOutput: tiledOutputByDefault
+                tiledSize: tiledSizeByDefault
+                memoryBudget: memoryBudgetByDefault
+                exportPath: exportByDefault
+                tonemap: tonemapByDefault
+                exposure: exposureByDefault
+                srgb: srgbByDefault
+                // A resumed render picks up where it stopped without a click.
+                Component.onCompleted: {
+                    if (resumePath !== "")
+                        startRender()
+                }
+                // Follow is Focus with the region centred on the cursor.
+                regionMode: root.cfgRegion === "follow" ? "focus" : root.cfgRegion
+                focus: true
+
+                // Drag orbits around the target, the wheel dollies, WASD/QE
+                // move the camera; each edit restarts accumulation.
+                Keys.onPressed: function(event) {
+                    var step = 0.25 * (event.modifiers & Qt.ShiftModifier ? 4 : 1)
+                    switch (event.key) {
+                    case Qt.Key_W: rayItem.moveCamera(step, 0, 0); break
+                    case Qt.Key_S: rayItem.moveCamera(-step, 0, 0); break
+                    case Qt.Key_D: rayItem.moveCamera(0, step, 0); break
+                    case Qt.Key_A: rayItem.moveCamera(0, -step, 0); break
+                    case Qt.Key_E: rayItem.moveCamera(0, 0, step); break
+                    case Qt.Key_Q: rayItem.moveCamera(0, 0, -step); break
+                    default: return
+                    }
+                    event.accepted = true
+                }
+
+                // Region outline, in item coordinates.
+                Rectangle {
+                    property rect image: rayItem.imageRect
+                    property rect roi: rayItem.regionOfInterest
+
+                    visible: root.cfgRegion !== "off"
+                    x: image.x + roi.x * image.width
+                    y: image.y + roi.y * image.height
+                    width: roi.width * image.width
+                    height: roi.height * image.height
+                    color: "transparent"
+                    border.width: 2
+                    border.color: "#0a84ff"
+                    opacity: 0.8
+                }
+
+                // Left drag orbits, right drag draws the region of interest.
+                MouseArea {
+                    property real lastX: 0
+                    property real lastY: 0
+                    property real startX: 0
+                    property real startY: 0
+
+                    function toImage(x, y) {
+                        var r = rayItem.imageRect
+                        return Qt.point((x - r.x) / r.width, (y - r.y) / r.height)
+                    }
+
+                    anchors.fill: parent
+                    acceptedButtons: Qt.LeftButton | Qt.RightButton
+                    hoverEnabled: root.cfgRegion === "follow"
+                    onPressed: function(mouse) {
+                        rayItem.forceActiveFocus()
+                        lastX = mouse.x
+                        lastY = mouse.y
+                        startX = mouse.x
+                        startY = mouse.y
+                    }
+                    onPositionChanged: function(mouse) {
+                        if (root.cfgRegion === "follow" && !pressed) {
+                            var roi = rayItem.regionOfInterest
+                            var c = toImage(mouse.x, mouse.y)
+                            // Slide along the edges instead of shrinking.
+                            rayItem.regionOfInterest = Qt.rect(
+                                Math.max(0, Math.min(1 - roi.width, c.x - roi.width / 2)),
+                                Math.max(0, Math.min(1 - roi.height, c.y - roi.height / 2)),
+                                roi.width, roi.height)
+                        } else if (pressedButtons & Qt.RightButton) {
+                            var a = toImage(startX, startY)
+                            var b = toImage(mouse.x, mouse.y)
+                            rayItem.regionOfInterest = Qt.rect(Math.min(a.x, b.x), Math.min(a.y, b.y),
+                                                               Math.abs(b.x - a.x), Math.abs(b.y - a.y))
+                            if (root.cfgRegion === "off") {
+                                root.cfgRegion = "focus"
+                            }
+                        } else if (pressed) {
+                            rayItem.orbit(-0.3 * (mouse.x - lastX), 0.3 * (mouse.y - lastY))
+                        }
+                        lastX = mouse.x
+                        lastY = mouse.y
+                    }
+                    onWheel: function(wheel) {
+                        rayItem.dolly(Math.pow(0.999, wheel.angleDelta.y))
+                    }
+                }
             }
         }
     }
@@ -2,7 +2,13 @@
 #include "backends/CudaPathTracer.h"
 #include "backends/GpuPathTracer.h"
 #include "backends/vulkan/VulkanPathTracer.h"
-#include "raytracer/RayTracer.h"
+#include "raytracer/Aov.h"
+#include "raytracer/Checkpoint.h"
+#include "raytracer/Denoiser.h"
+#include "raytracer/FilmResolve.h"
+#include "raytracer/Integrator.h"
+#include "raytracer/LazyBVH.h"
+#include "raytracer/TiledImage.h"
 
 #include <QMutexLocker>
 #include <QMetaObject>
@@ -11,8 +17,12 @@
 #include <QSGRendererInterface>
 #include <QSGSimpleTextureNode>
 #include <QSGTexture>
+#include <QtMath>
 #include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <cstring>
+#include <random>
 #include <thread>
 
 #if QT_CONFIG(opengl)
@@ -28,119 +38,481 @@ public:
     }
 };
 
+// CPU sessions open with 1/8, 1/4 and 1/2 resolution stages before 1 spp.
+constexpr int kPreviewLevels = 3;
+
+uint64_t randomSeed() {
+    std::random_device entropy;
+    return (static_cast<uint64_t>(entropy()) << 32) | entropy();
+}
+
+QVector3D toQVector3D(const Vec3 &v) {
+    return QVector3D(static_cast<float>(v.x()), static_cast<float>(v.y()), static_cast<float>(v.z()));
+}
+
+// The renderer's display colors of [x0, x1) x [y0, y1) as opaque ARGB32,
+// row by row through the film resolve.
+QVector<unsigned int> packRegion(const ProgressiveRenderer &renderer, int x0, int y0, int x1, int y1,
+                                 const DisplaySettings &display) {
+    const int regionWidth = x1 - x0;
+    QVector<unsigned int> pixels(regionWidth * (y1 - y0));
+    std::vector<Color> row(static_cast<size_t>(regionWidth));
+    for (int y = y0; y < y1; ++y) {
+        for (int x = x0; x < x1; ++x) {
+            row[static_cast<size_t>(x - x0)] = renderer.display(x, y);
+        }
+        resolve_argb(row.data(), row.size(), pixels.data() + (y - y0) * regionWidth, display);
+    }
+    return pixels;
 }
 
-RenderWorker::RenderWorker(int width, int height, int samples, int depth, int tileSize, QObject *parent)
+}
+
+RenderWorker::RenderWorker(const RenderSessionSettings &settings, QObject *parent)
     : QObject(parent),
-      m_width(width),
-      m_height(height),
-      m_samples(samples),
-      m_depth(depth),
-      m_tileSize(std::max(8, tileSize)) {
+      m_settings(settings),
+      m_camera(settings.camera) {
+    m_settings.tileSize = std::max(8, settings.tileSize);
 }
 
 void RenderWorker::stop() {
     m_stop.store(true, std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(m_cameraMutex);
+    if (m_renderer) {
+        m_renderer->restart();
+    }
+    m_wake.notify_all();
+}
+
+void RenderWorker::setCamera(const CameraParams &camera) {
+    std::lock_guard<std::mutex> lock(m_cameraMutex);
+    m_camera = camera;
+    m_cameraChanged = true;
+    m_viewTimer.restart();
+    if (m_renderer) {
+        m_renderer->set_camera(camera);
+    }
+    m_wake.notify_all();
+}
+
+void RenderWorker::setRegion(const RenderRegion &region) {
+    std::lock_guard<std::mutex> lock(m_cameraMutex);
+    m_region = region;
+    m_regionChanged = true;
+    if (m_renderer) {
+        m_renderer->set_region(region);
+    }
+    m_wake.notify_all();
 }
 
 void RenderWorker::render() {
     m_stop.store(false, std::memory_order_relaxed);
 
-    const auto aspectRatio = static_cast<double>(m_width) / static_cast<double>(m_height);
-    Point3 lookfrom(13, 2, 3);
-    Point3 lookat(0, 0, 0);
-    Vec3 vup(0, 1, 0);
-    const auto distToFocus = 10.0;
-    const auto aperture = 0.1;
-
-    Camera cam(lookfrom, lookat, vup, 20, aspectRatio, aperture, distToFocus);
-    HitableList worldList = random_scene();
-    std::vector<std::shared_ptr<Hitable>> worldObjects = worldList.objects;
-    BVHNode world(worldObjects, 0, worldObjects.size());
-
-    const int widthDenom = std::max(1, m_width - 1);
-    const int heightDenom = std::max(1, m_height - 1);
-    const double invWidthDenom = 1.0 / static_cast<double>(widthDenom);
-    const double invHeightDenom = 1.0 / static_cast<double>(heightDenom);
-    const double scale = 1.0 / static_cast<double>(m_samples);
-
-    const int tileSize = m_tileSize;
-    const int tilesX = (m_width + tileSize - 1) / tileSize;
-    const int tilesY = (m_height + tileSize - 1) / tileSize;
+    // The scene and the sample streams come from seeds the checkpoint
+    // records, so a resumed session rebuilds the same scene and continues
+    // the same samples.
+    const std::string checkpointPath = m_settings.checkpoint.path.toStdString();
+    CheckpointSettings checkpointSettings;
+    QString checkpointError;
+    bool resuming = false;
+    const std::string resumePath = m_settings.checkpoint.resumePath.toStdString();
+    if (!resumePath.empty()) {
+        try {
+            checkpointSettings = read_checkpoint_settings(resumePath);
+            resuming = true;
+        } catch (const std::exception &error) {
+            checkpointError = QString::fromStdString(error.what());
+        }
+    }
+    if (!resuming) {
+        checkpointSettings.scene_seed = randomSeed();
+        checkpointSettings.sample_seed = randomSeed();
+    }
+    checkpointSettings.width = m_settings.width;
+    checkpointSettings.height = m_settings.height;
+    checkpointSettings.max_depth = m_settings.maxDepth;
+    checkpointSettings.samples = m_settings.samples;
+    seed_thread_rng(checkpointSettings.scene_seed);
+
+    // Subtrees are built as rays first enter them, so tracing starts after
+    // only the top levels of the hierarchy exist. The scene lives for the
+    // whole session; camera edits only restart accumulation.
+    const HitableList objects = random_scene();
+    const Scene world = make_lazy_scene(objects);
+    const std::unique_ptr<LightSampler> lights = make_light_sampler(objects, m_settings.lightSelection);
+    const AovIds aovIds = m_settings.aovChannels.empty() ? AovIds() : AovIds(objects);
+    PathTracerSettings pathSettings;
+    pathSettings.max_depth = m_settings.maxDepth;
+    if (!m_settings.environment.isEmpty()) {
+        try {
+            auto environment =
+                std::make_shared<EnvironmentMap>(load_hdr_image(m_settings.environment.toStdString()));
+            emit environmentLoaded(environment->width(), environment->height(),
+                                   static_cast<qint64>(environment->memory_bytes()), QString());
+            pathSettings.environment = std::move(environment);
+        } catch (const std::exception &error) {
+            emit environmentLoaded(0, 0, 0, QString::fromStdString(error.what()));
+        }
+    }
+    // The guide is learned in world space, so camera edits keep it.
+    std::shared_ptr<SDTree> guide;
+    if (m_settings.guiding) {
+        AABB bounds;
+        objects.bounding_box(bounds);
+        guide = std::make_shared<SDTree>(bounds);
+        pathSettings.guide = guide;
+    }
+    const auto *lazyBvh = dynamic_cast<const LazyBVH *>(world.bounded.get());
+    if (!m_settings.tiledOutput.path.isEmpty()) {
+        renderTiledOutput(world, *lights, pathSettings, aovIds, checkpointSettings.sample_seed);
+        m_exporter.reset();
+        emit finished();
+        return;
+    }
+
+    ProgressiveRenderer renderer(world, *lights, m_settings.width, m_settings.height, pathSettings, m_settings.tileSize,
+                                 kPreviewLevels);
+    renderer.set_seed(checkpointSettings.sample_seed);
+    const int tilesX = (m_settings.width + m_settings.tileSize - 1) / m_settings.tileSize;
+    const int tilesY = (m_settings.height + m_settings.tileSize - 1) / m_settings.tileSize;
     const int totalTiles = tilesX * tilesY;
+    {
+        std::lock_guard<std::mutex> lock(m_cameraMutex);
+        renderer.set_camera(m_camera);
+        renderer.set_region(m_region);
+        m_viewTimer.start();
+        m_renderer = &renderer;
+    }
+
+    if (resuming) {
+        try {
+            Checkpoint checkpoint = load_checkpoint(resumePath, objects);
+            const CameraParams view = checkpoint.view;
+            {
+                std::lock_guard<std::mutex> lock(m_cameraMutex);
+                renderer.resume(view, checkpoint.passes, std::move(checkpoint.film));
+                m_camera = view;
+            }
+            emit cameraRestored(toQVector3D(view.lookfrom), toQVector3D(view.lookat), view.vfov, view.aperture,
+                                view.focus_dist);
+            emit tileRendered(0, 0, m_settings.width, m_settings.height,
+                              packRegion(renderer, 0, 0, m_settings.width, m_settings.height, m_settings.display));
+        } catch (const std::exception &error) {
+            checkpointError = QString::fromStdString(error.what());
+        }
+    }
+    // Saving to the file being resumed continues its checkpoint sequence;
+    // another file starts a new one.
+    std::unique_ptr<CheckpointWriter> checkpointWriter;
+    if (!checkpointPath.empty()) {
+        try {
+            checkpointWriter = std::make_unique<CheckpointWriter>(checkpointPath, checkpointSettings, objects);
+        } catch (const std::exception &error) {
+            checkpointError = QString::fromStdString(error.what());
+        }
+    }
+    const auto reportCheckpoints = [&]() {
+        if (checkpointWriter && !checkpointWriter->error().empty()) {
+            checkpointError = QString::fromStdString(checkpointWriter->error());
+        }
+        emit checkpointStatus(checkpointWriter ? static_cast<int>(checkpointWriter->written()) : 0,
+                              renderer.passes(), checkpointError);
+    };
+    if (!checkpointError.isEmpty()) {
+        reportCheckpoints();
+    }
+    QElapsedTimer checkpointTimer;
+    checkpointTimer.start();
 
-    std::atomic<int> nextTile(0);
     std::atomic<int> completedTiles(0);
+    std::atomic<qint64> firstTileMs(-1);
+    qint64 previewMs = -1;
+    // Passes at which the current frame started and ends; a region edit after
+    // a finished frame extends it.
+    int frameStart = 0;
+    int frameEnd = m_settings.samples;
+    QElapsedTimer viewTimer;
+    // Guide training iterations end after 1, 3, 7, 15, ... full passes, each
+    // recording twice the samples of the last as SDTree expects, until half
+    // of a frame's samples are done; the passes are part of the image.
+    int guidePasses = 0;
+    int nextGuideUpdate = 1;
+    QElapsedTimer guideTimer;
+    guideTimer.start();
+    const auto onTile = [&](int x0, int y0, int x1, int y1) {
+        emit tileRendered(y0, x0, x1 - x0, y1 - y0, packRegion(renderer, x0, y0, x1, y1, m_settings.display));
+
+        qint64 noTileYet = -1;
+        firstTileMs.compare_exchange_strong(noTileYet, viewTimer.elapsed(), std::memory_order_relaxed);
+
+        if (renderer.stage_stride() > 1) {
+            return;
+        }
+        // Passes that skip tiles outside the region report fewer tiles.
+        const int tilesDone = std::min(totalTiles, completedTiles.fetch_add(1, std::memory_order_relaxed) + 1);
+        const int done = (renderer.passes() - frameStart) * totalTiles + tilesDone;
+        emit progressUpdated(static_cast<int>((100.0 * done) / (static_cast<double>(totalTiles) * (frameEnd - frameStart))));
+    };
+
+    while (!m_stop.load(std::memory_order_relaxed)) {
+        {
+            std::lock_guard<std::mutex> lock(m_cameraMutex);
+            if (m_cameraChanged || !viewTimer.isValid()) {
+                // First tile and preview latency are measured from the edit.
+                viewTimer = m_viewTimer;
+                firstTileMs.store(-1, std::memory_order_relaxed);
+                previewMs = -1;
+                frameStart = 0;
+                frameEnd = m_settings.samples;
+            }
+            m_cameraChanged = false;
+            m_regionChanged = false;
+        }
+        completedTiles.store(0, std::memory_order_relaxed);
+        const int passesBefore = renderer.passes();
+        if (!renderer.render_pass(onTile)) {
+            continue;
+        }
+        if (guide && guide->training() && renderer.passes() > passesBefore && ++guidePasses == nextGuideUpdate) {
+            // No pass is in flight between render_pass() calls.
+            guide->end_pass();
+            nextGuideUpdate = 2 * nextGuideUpdate + 1;
+            guide->set_training(guidePasses < m_settings.samples / 2);
+            emit guidingUpdated(guide->passes(), static_cast<qint64>(guide->memory_bytes()), guideTimer.elapsed(),
+                                guide->training());
+        }
+        if (previewMs < 0) {
+            // The first stage to finish covers the whole frame.
+            previewMs = viewTimer.elapsed();
+            emit previewReady(previewMs);
+        }
+        // Snapshots are taken between passes; the write overlaps the next
+        // ones. submit() declines preview stages and pending writes.
+        if (checkpointWriter && checkpointTimer.elapsed() >= 1000LL * m_settings.checkpoint.intervalSeconds &&
+            checkpointWriter->submit(renderer)) {
+            checkpointTimer.restart();
+        }
+        if (renderer.passes() < frameEnd) {
+            continue;
+        }
 
-    int threadCount = static_cast<int>(std::thread::hardware_concurrency());
-    if (threadCount <= 0) {
-        threadCount = 1;
+        if (checkpointWriter) {
+            // The finished frame is always saved.
+            checkpointWriter->wait();
+            checkpointWriter->submit(renderer);
+            checkpointWriter->wait();
+            checkpointTimer.restart();
+            reportCheckpoints();
+        }
+        finishFrame(renderer, aovIds);
+        emit sceneStatsReady(firstTileMs.load(std::memory_order_relaxed), previewMs,
+                             lazyBvh ? lazyBvh->built_fraction() : 1.0);
+        emit frameCompleted();
+
+        std::unique_lock<std::mutex> lock(m_cameraMutex);
+        m_wake.wait(lock, [this] { return m_stop.load(std::memory_order_relaxed) || m_cameraChanged || m_regionChanged; });
+        if (!m_cameraChanged) {
+            frameStart = renderer.passes();
+            frameEnd = frameStart + m_settings.samples;
+        }
     }
 
-    std::vector<std::thread> workers;
-    workers.reserve(threadCount);
-
-    for (int t = 0; t < threadCount; ++t) {
-        workers.emplace_back([&]() {
-            while (!m_stop.load(std::memory_order_relaxed)) {
-                const int tileIndex = nextTile.fetch_add(1, std::memory_order_relaxed);
-                if (tileIndex >= totalTiles) {
-                    break;
-                }
+    {
+        std::lock_guard<std::mutex> lock(m_cameraMutex);
+        m_renderer = nullptr;
+    }
+    // Let the last export finish before the session reports its end.
+    m_exporter.reset();
+    emit finished();
+}
 
-                const int tileX = tileIndex % tilesX;
-                const int tileY = tileIndex / tilesX;
-                const int xStart = tileX * tileSize;
-                const int yStart = tileY * tileSize;
-                const int xEnd = std::min(xStart + tileSize, m_width);
-                const int yEnd = std::min(yStart + tileSize, m_height);
-                const int tileWidth = xEnd - xStart;
-                const int tileHeight = yEnd - yStart;
-
-                QVector<unsigned int> tileData(tileWidth * tileHeight);
-
-                for (int line = yStart; line < yEnd; ++line) {
-                    const int j = m_height - 1 - line;
-                    const int tileRow = line - yStart;
-
-                    for (int i = xStart; i < xEnd; ++i) {
-                        Color pixelColor(0, 0, 0);
-                        for (int s = 0; s < m_samples; ++s) {
-                            const double u = (static_cast<double>(i) + random_double()) * invWidthDenom;
-                            const double v = (static_cast<double>(j) + random_double()) * invHeightDenom;
-                            Ray r = cam.get_ray(u, v);
-                            pixelColor += ray_color(r, world, m_depth);
-                        }
+void RenderWorker::finishFrame(const ProgressiveRenderer &renderer, const AovIds &aovIds) {
+    const std::vector<PixelAccumulator> &film = renderer.film();
 
-                        const double r = std::sqrt(scale * pixelColor.x());
-                        const double g = std::sqrt(scale * pixelColor.y());
-                        const double b = std::sqrt(scale * pixelColor.z());
+    std::vector<Color> filtered;
+    if (m_settings.denoise) {
+        std::vector<Color> radiance(film.size());
+        DenoiseFeatures features(m_settings.width, m_settings.height);
+        for (size_t index = 0; index < film.size(); ++index) {
+            radiance[index] = film[index].mean();
+            film[index].resolve(features, index);
+        }
+        const auto denoiseStart = std::chrono::steady_clock::now();
+        filtered = denoise(radiance, features);
+        const double denoiseMs =
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - denoiseStart).count();
+
+        QVector<unsigned int> frameData(m_settings.width * m_settings.height);
+        resolve_argb(filtered.data(), filtered.size(), frameData.data(), m_settings.display);
+        emit tileRendered(0, 0, m_settings.width, m_settings.height, frameData);
+        emit denoiseFinished(denoiseMs);
+    }
 
-                        const int ir = static_cast<int>(256 * clamp(r, 0.0, 0.999));
-                        const int ig = static_cast<int>(256 * clamp(g, 0.0, 0.999));
-                        const int ib = static_cast<int>(256 * clamp(b, 0.0, 0.999));
+    if (!m_settings.aovChannels.empty() && !m_settings.aovOutput.isEmpty()) {
+        AovBuffers aovs(m_settings.width, m_settings.height, m_settings.aovChannels);
+        for (size_t index = 0; index < film.size(); ++index) {
+            aovs.resolve(index, film[index], aovIds);
+        }
+        try {
+            const std::vector<std::string> paths = export_aovs(aovs, m_settings.aovOutput.toStdString());
+            emit aovsExported(static_cast<int>(paths.size()), QString());
+        } catch (const std::exception &error) {
+            emit aovsExported(0, QString::fromStdString(error.what()));
+        }
+    }
 
-                        tileData[tileRow * tileWidth + (i - xStart)] =
-                            (255u << 24) |
-                            (static_cast<unsigned int>(ir) << 16) |
-                            (static_cast<unsigned int>(ig) << 8) |
-                            static_cast<unsigned int>(ib);
-                    }
-                }
+    if (!m_settings.exportPath.isEmpty()) {
+        exportFrame(film, filtered, aovIds);
+    }
+}
 
-                emit tileRendered(yStart, xStart, tileWidth, tileHeight, tileData);
+ImageExporter *RenderWorker::startExport(int width, int height) {
+    m_exporter.reset();
+    const QString path = m_settings.exportPath;
+    ExportOptions options;
+    options.display = m_settings.display;
+    options.on_done = [this, path](const ExportResult &result) {
+        emit imageExported(path, static_cast<qint64>(result.bytes), result.tail_ms,
+                           QString::fromStdString(result.error));
+    };
+    try {
+        m_exporter =
+            std::make_unique<ImageExporter>(path.toStdString(), width, height, m_settings.aovChannels, options);
+    } catch (const std::exception &error) {
+        emit imageExported(path, 0, 0.0, QString::fromStdString(error.what()));
+    }
+    return m_exporter.get();
+}
 
-                const int done = completedTiles.fetch_add(1, std::memory_order_relaxed) + 1;
-                emit progressUpdated(static_cast<int>((100.0 * done) / totalTiles));
+void RenderWorker::exportFrame(const std::vector<PixelAccumulator> &film, const std::vector<Color> &filtered,
+                               const AovIds &aovIds) {
+    ImageExporter *exporter = startExport(m_settings.width, m_settings.height);
+    if (!exporter) {
+        return;
+    }
+    // Bands of 16 rows, the exporter's unit, so encoding starts with the
+    // first one while the rest are resolved.
+    const int rows = 16;
+    const size_t plane = static_cast<size_t>(rows) * m_settings.width;
+    std::vector<float> band(static_cast<size_t>(exporter->planes()) * plane);
+    AovBuffers aovs;
+    if (!m_settings.aovChannels.empty()) {
+        aovs = AovBuffers(m_settings.width, rows, m_settings.aovChannels);
+    }
+    for (int y0 = 0; y0 < m_settings.height; y0 += rows) {
+        const int y1 = std::min(m_settings.height, y0 + rows);
+        for (int y = y0; y < y1; ++y) {
+            for (int x = 0; x < m_settings.width; ++x) {
+                const size_t index = static_cast<size_t>(y) * m_settings.width + x;
+                const size_t local = static_cast<size_t>(y - y0) * m_settings.width + x;
+                const Color color = filtered.empty() ? film[index].mean() : filtered[index];
+                for (int c = 0; c < 3; ++c) {
+                    band[c * plane + local] = static_cast<float>(color[c]);
+                }
+                if (!m_settings.aovChannels.empty()) {
+                    aovs.resolve(local, film[index], aovIds);
+                }
             }
-        });
+        }
+        float *out = band.data() + 3 * plane;
+        for (int i = 0; i < kAovChannelCount; ++i) {
+            const AovChannel channel = static_cast<AovChannel>(i);
+            if (!m_settings.aovChannels.contains(channel)) {
+                continue;
+            }
+            for (int c = 0; c < aov_components(channel); ++c, out += plane) {
+                std::copy(aovs.plane(channel, c), aovs.plane(channel, c) + plane, out);
+            }
+        }
+        exporter->submit(0, y0, m_settings.width, y1, band.data(), static_cast<size_t>(m_settings.width), plane);
     }
+    exporter->close();
+}
 
-    for (std::thread &worker : workers) {
-        worker.join();
+void RenderWorker::renderTiledOutput(const Hitable &world, const LightSampler &lights,
+                                     const PathTracerSettings &pathSettings, const AovIds &aovIds, uint64_t seed) {
+    TiledRenderSettings settings;
+    settings.width = m_settings.tiledOutput.size.width();
+    settings.height = m_settings.tiledOutput.size.height();
+    settings.samples = m_settings.samples;
+    settings.aovs = m_settings.aovChannels;
+    settings.memory_budget = static_cast<size_t>(std::max(1, m_settings.tiledOutput.memoryBudgetMiB)) << 20;
+    settings.seed = seed;
+    CameraParams view;
+    {
+        std::lock_guard<std::mutex> lock(m_cameraMutex);
+        view = m_camera;
     }
 
-    emit finished();
+    // Preview pixel p shows output pixel (p + 0.5) * full / preview; a tile
+    // updates the preview pixels whose source lies inside it.
+    const auto source = [](int p, int preview, int full) {
+        return static_cast<int>((p + 0.5) * full / preview);
+    };
+    const auto firstPreview = [&](int edge, int preview, int full) {
+        int p = static_cast<int>(static_cast<long long>(edge) * preview / full);
+        while (p > 0 && source(p - 1, preview, full) >= edge) {
+            --p;
+        }
+        while (p < preview && source(p, preview, full) < edge) {
+            ++p;
+        }
+        return p;
+    };
+    const int tile = settings.tile_size;
+    const size_t tileArea = static_cast<size_t>(tile) * tile;
+    const int totalTiles = std::max(1, ((settings.width + tile - 1) / tile) * ((settings.height + tile - 1) / tile));
+    std::atomic<int> tilesDone(0);
+    if (pathSettings.guide) {
+        QElapsedTimer guideTimer;
+        guideTimer.start();
+        const int iterations = train_guide(world, lights, view, pathSettings, settings, &m_stop);
+        emit guidingUpdated(iterations, static_cast<qint64>(pathSettings.guide->memory_bytes()), guideTimer.elapsed(),
+                            false);
+    }
+    ImageExporter *exporter = m_settings.exportPath.isEmpty() ? nullptr : startExport(settings.width, settings.height);
+    const auto onTile = [&](int x0, int y0, int x1, int y1, const float *planes) {
+        if (exporter) {
+            exporter->submit(x0, y0, x1, y1, planes, static_cast<size_t>(tile), tileArea);
+        }
+        const int px0 = firstPreview(x0, m_settings.width, settings.width);
+        const int px1 = firstPreview(x1, m_settings.width, settings.width);
+        const int py0 = firstPreview(y0, m_settings.height, settings.height);
+        const int py1 = firstPreview(y1, m_settings.height, settings.height);
+        if (px1 > px0 && py1 > py0) {
+            const int previewWidth = px1 - px0;
+            QVector<unsigned int> tileData(previewWidth * (py1 - py0));
+            std::vector<float> row(3 * static_cast<size_t>(previewWidth));
+            for (int py = py0; py < py1; ++py) {
+                const int sy = source(py, m_settings.height, settings.height) - y0;
+                for (int px = px0; px < px1; ++px) {
+                    const size_t index =
+                        static_cast<size_t>(sy) * tile + (source(px, m_settings.width, settings.width) - x0);
+                    for (int c = 0; c < 3; ++c) {
+                        row[c * previewWidth + (px - px0)] = planes[c * tileArea + index];
+                    }
+                }
+                resolve_argb(row.data(), row.data() + previewWidth, row.data() + 2 * previewWidth, previewWidth,
+                             tileData.data() + (py - py0) * previewWidth, m_settings.display);
+            }
+            emit tileRendered(py0, px0, px1 - px0, py1 - py0, tileData);
+        }
+        const int done = tilesDone.fetch_add(1, std::memory_order_relaxed) + 1;
+        emit progressUpdated(static_cast<int>((100.0 * done) / totalTiles));
+    };
+
+    try {
+        const TiledRenderStats stats = render_tiled(world, lights, view, pathSettings, settings, aovIds,
+                                                    m_settings.tiledOutput.path.toStdString(), onTile, &m_stop);
+        emit tiledOutputWritten(static_cast<qint64>(stats.peak_resident_bytes),
+                                static_cast<qint64>(settings.memory_budget), static_cast<int>(stats.tiles), QString());
+    } catch (const std::exception &error) {
+        emit tiledOutputWritten(0, static_cast<qint64>(settings.memory_budget), 0, QString::fromStdString(error.what()));
+    }
+    if (exporter) {
+        exporter->close();
+    }
+    emit frameCompleted();
 }
 
 RayTracerFboItem::RayTracerFboItem(QQuickItem *parent)
@@ -186,12 +558,118 @@ QString RayTracerFboItem::computeBackend() const {
     return m_computeBackend;
 }
 
+bool RayTracerFboItem::denoise() const {
+    return m_denoise;
+}
+
+bool RayTracerFboItem::guiding() const {
+    return m_guiding;
+}
+
+QString RayTracerFboItem::environment() const {
+    return m_environment;
+}
+
+QString RayTracerFboItem::lightSelection() const {
+    return m_lightSelection;
+}
+
+QStringList RayTracerFboItem::aovChannels() const {
+    return m_aovChannels;
+}
+
+QString RayTracerFboItem::aovOutput() const {
+    return m_aovOutput;
+}
+
+QVector3D RayTracerFboItem::cameraPosition() const {
+    return m_cameraPosition;
+}
+
+QVector3D RayTracerFboItem::cameraTarget() const {
+    return m_cameraTarget;
+}
+
+double RayTracerFboItem::fieldOfView() const {
+    return m_fieldOfView;
+}
+
+double RayTracerFboItem::aperture() const {
+    return m_aperture;
+}
+
+double RayTracerFboItem::focusDistance() const {
+    return m_focusDistance;
+}
+
+QRectF RayTracerFboItem::regionOfInterest() const {
+    return m_regionOfInterest;
+}
+
+QString RayTracerFboItem::regionMode() const {
+    return m_regionMode;
+}
+
+QString RayTracerFboItem::checkpointPath() const {
+    return m_checkpointPath;
+}
+
+int RayTracerFboItem::checkpointInterval() const {
+    return m_checkpointInterval;
+}
+
+QString RayTracerFboItem::resumePath() const {
+    return m_resumePath;
+}
+
+QString RayTracerFboItem::tiledOutput() const {
+    return m_tiledOutput;
+}
+
+QSize RayTracerFboItem::tiledSize() const {
+    return m_tiledSize;
+}
+
+int RayTracerFboItem::memoryBudget() const {
+    return m_memoryBudget;
+}
+
+QString RayTracerFboItem::exportPath() const {
+    return m_exportPath;
+}
+
+QString RayTracerFboItem::tonemap() const {
+    return m_tonemap;
+}
+
+double RayTracerFboItem::exposure() const {
+    return m_exposure;
+}
+
+bool RayTracerFboItem::srgb() const {
+    return m_srgb;
+}
+
+QRectF RayTracerFboItem::imageRect() const {
+    const qreal w = width();
+    const qreal h = height();
+    const qreal imgAspect = static_cast<qreal>(m_renderWidth) / std::max<qreal>(1.0, m_renderHeight);
+    const qreal viewAspect = w / std::max<qreal>(1.0, h);
+    if (viewAspect > imgAspect) {
+        const qreal drawW = h * imgAspect;
+        return QRectF((w - drawW) * 0.5, 0.0, drawW, h);
+    }
+    const qreal drawH = w / imgAspect;
+    return QRectF(0.0, (h - drawH) * 0.5, w, drawH);
+}
+
 void RayTracerFboItem::setRenderWidth(int value) {
     if (m_renderWidth == value) {
         return;
     }
     m_renderWidth = std::max(64, value);
     emit renderWidthChanged();
+    emit imageRectChanged();
 }
 
 void RayTracerFboItem::setRenderHeight(int value) {
@@ -200,6 +678,7 @@ void RayTracerFboItem::setRenderHeight(int value) {
     }
     m_renderHeight = std::max(64, value);
     emit renderHeightChanged();
+    emit imageRectChanged();
 }
 
 void RayTracerFboItem::setSamples(int value) {
@@ -227,6 +706,258 @@ void RayTracerFboItem::setComputeBackend(const QString &value) {
     emit computeBackendChanged();
 }
 
+void RayTracerFboItem::setDenoise(bool value) {
+    if (m_denoise == value) {
+        return;
+    }
+    m_denoise = value;
+    emit denoiseChanged();
+}
+
+void RayTracerFboItem::setGuiding(bool value) {
+    if (m_guiding == value) {
+        return;
+    }
+    m_guiding = value;
+    emit guidingChanged();
+}
+
+void RayTracerFboItem::setEnvironment(const QString &value) {
+    if (m_environment == value) {
+        return;
+    }
+    m_environment = value;
+    emit environmentChanged();
+}
+
+void RayTracerFboItem::setLightSelection(const QString &value) {
+    const QString normalized = value.trimmed().toLower();
+    if (normalized == m_lightSelection) {
+        return;
+    }
+    try {
+        light_selection(normalized.toStdString());
+    } catch (const std::invalid_argument &) {
+        return;
+    }
+    m_lightSelection = normalized;
+    emit lightSelectionChanged();
+}
+
+void RayTracerFboItem::setAovChannels(const QStringList &value) {
+    if (m_aovChannels == value) {
+        return;
+    }
+    m_aovChannels = value;
+    emit aovChannelsChanged();
+}
+
+void RayTracerFboItem::setAovOutput(const QString &value) {
+    if (m_aovOutput == value) {
+        return;
+    }
+    m_aovOutput = value;
+    emit aovOutputChanged();
+}
+
+void RayTracerFboItem::setCameraPosition(const QVector3D &value) {
+    // The camera basis is undefined when looking at the eye point.
+    if (m_cameraPosition == value || qFuzzyIsNull((m_cameraTarget - value).lengthSquared())) {
+        return;
+    }
+    m_cameraPosition = value;
+    applyCamera();
+}
+
+void RayTracerFboItem::setCameraTarget(const QVector3D &value) {
+    if (m_cameraTarget == value || qFuzzyIsNull((value - m_cameraPosition).lengthSquared())) {
+        return;
+    }
+    m_cameraTarget = value;
+    applyCamera();
+}
+
+void RayTracerFboItem::setFieldOfView(double value) {
+    value = std::clamp(value, 1.0, 170.0);
+    if (m_fieldOfView == value) {
+        return;
+    }
+    m_fieldOfView = value;
+    applyCamera();
+}
+
+void RayTracerFboItem::setAperture(double value) {
+    value = std::max(0.0, value);
+    if (m_aperture == value) {
+        return;
+    }
+    m_aperture = value;
+    applyCamera();
+}
+
+void RayTracerFboItem::setFocusDistance(double value) {
+    value = std::max(0.01, value);
+    if (m_focusDistance == value) {
+        return;
+    }
+    m_focusDistance = value;
+    applyCamera();
+}
+
+void RayTracerFboItem::setRegionOfInterest(const QRectF &value) {
+    const QRectF clipped = value.normalized() & QRectF(0.0, 0.0, 1.0, 1.0);
+    if (m_regionOfInterest == clipped) {
+        return;
+    }
+    m_regionOfInterest = clipped;
+    emit regionChanged();
+    if (m_worker) {
+        m_worker->setRegion(renderRegion());
+    }
+}
+
+void RayTracerFboItem::setRegionMode(const QString &value) {
+    const QString normalized = value.trimmed().toLower();
+    if (normalized == m_regionMode ||
+        (normalized != QStringLiteral("off") && normalized != QStringLiteral("focus") &&
+         normalized != QStringLiteral("crop"))) {
+        return;
+    }
+    m_regionMode = normalized;
+    emit regionChanged();
+    if (m_worker) {
+        m_worker->setRegion(renderRegion());
+    }
+}
+
+void RayTracerFboItem::setCheckpointPath(const QString &value) {
+    if (m_checkpointPath == value) {
+        return;
+    }
+    m_checkpointPath = value;
+    emit checkpointChanged();
+}
+
+void RayTracerFboItem::setCheckpointInterval(int value) {
+    value = std::max(1, value);
+    if (m_checkpointInterval == value) {
+        return;
+    }
+    m_checkpointInterval = value;
+    emit checkpointChanged();
+}
+
+void RayTracerFboItem::setResumePath(const QString &value) {
+    if (m_resumePath == value) {
+        return;
+    }
+    m_resumePath = value;
+    emit checkpointChanged();
+}
+
+void RayTracerFboItem::setTiledOutput(const QString &value) {
+    if (m_tiledOutput == value) {
+        return;
+    }
+    m_tiledOutput = value;
+    emit tiledOutputChanged();
+}
+
+void RayTracerFboItem::setTiledSize(const QSize &value) {
+    if (m_tiledSize == value || value.width() <= 0 || value.height() <= 0) {
+        return;
+    }
+    m_tiledSize = value;
+    emit tiledOutputChanged();
+}
+
+void RayTracerFboItem::setMemoryBudget(int value) {
+    value = std::max(1, value);
+    if (m_memoryBudget == value) {
+        return;
+    }
+    m_memoryBudget = value;
+    emit tiledOutputChanged();
+}
+
+void RayTracerFboItem::setExportPath(const QString &value) {
+    if (m_exportPath == value) {
+        return;
+    }
+    m_exportPath = value;
+    emit exportPathChanged();
+}
+
+void RayTracerFboItem::setTonemap(const QString &value) {
+    const QString normalized = value.trimmed().toLower();
+    if (normalized == m_tonemap) {
+        return;
+    }
+    try {
+        tonemap_from_name(normalized.toStdString());
+    } catch (const std::invalid_argument &) {
+        return;
+    }
+    m_tonemap = normalized;
+    emit displayChanged();
+}
+
+void RayTracerFboItem::setExposure(double value) {
+    if (m_exposure == value) {
+        return;
+    }
+    m_exposure = value;
+    emit displayChanged();
+}
+
+void RayTracerFboItem::setSrgb(bool value) {
+    if (m_srgb == value) {
+        return;
+    }
+    m_srgb = value;
+    emit displayChanged();
+}
+
+void RayTracerFboItem::orbit(double yawDegrees, double pitchDegrees) {
+    const QVector3D offset = m_cameraPosition - m_cameraTarget;
+    const float radius = offset.length();
+    if (qFuzzyIsNull(radius)) {
+        return;
+    }
+    // Spherical angles around +y; pitch stops short of the poles, where vup
+    // would be parallel to the view direction.
+    const double yaw = std::atan2(offset.x(), offset.z()) + qDegreesToRadians(yawDegrees);
+    const double limit = qDegreesToRadians(89.0);
+    const double pitch =
+        std::clamp(std::asin(std::clamp(offset.y() / radius, -1.0f, 1.0f)) + qDegreesToRadians(pitchDegrees), -limit, limit);
+    m_cameraPosition = m_cameraTarget + radius * QVector3D(static_cast<float>(std::cos(pitch) * std::sin(yaw)),
+                                                           static_cast<float>(std::sin(pitch)),
+                                                           static_cast<float>(std::cos(pitch) * std::cos(yaw)));
+    applyCamera();
+}
+
+void RayTracerFboItem::dolly(double factor) {
+    if (factor <= 0.0) {
+        return;
+    }
+    const QVector3D offset = (m_cameraPosition - m_cameraTarget) * static_cast<float>(factor);
+    if (offset.length() < 0.05f) {
+        return;
+    }
+    m_cameraPosition = m_cameraTarget + offset;
+    applyCamera();
+}
+
+void RayTracerFboItem::moveCamera(double forward, double right, double up) {
+    const QVector3D front = (m_cameraTarget - m_cameraPosition).normalized();
+    const QVector3D side = QVector3D::crossProduct(front, QVector3D(0.0f, 1.0f, 0.0f)).normalized();
+    const QVector3D top = QVector3D::crossProduct(side, front);
+    const QVector3D delta = static_cast<float>(forward) * front + static_cast<float>(right) * side + static_cast<float>(up) * top;
+    m_cameraPosition += delta;
+    m_cameraTarget += delta;
+    applyCamera();
+}
+
 void RayTracerFboItem::startRender() {
     if (m_rendering) {
         return;
@@ -294,6 +1025,19 @@ void RayTracerFboItem::startRender() {
         return;
     }
 
+    // A resumed render takes the size, depth and sample target of the
+    // checkpoint; the worker restores its view and reports a bad file.
+    if (!m_resumePath.isEmpty()) {
+        try {
+            const CheckpointSettings settings = read_checkpoint_settings(m_resumePath.toStdString());
+            setRenderWidth(settings.width);
+            setRenderHeight(settings.height);
+            setSamples(settings.samples);
+            setMaxDepth(settings.max_depth);
+        } catch (const std::exception &) {
+        }
+    }
+
     {
         QMutexLocker lock(&m_mutex);
         m_image = QImage(m_renderWidth, m_renderHeight, QImage::Format_ARGB32);
@@ -317,12 +1061,64 @@ void RayTracerFboItem::startRender() {
     update();
 
     m_thread = new QThread;
-    m_worker = new RenderWorker(m_renderWidth, m_renderHeight, m_samples, m_maxDepth, m_tileSize);
+    m_denoiseMs = -1.0;
+    m_aovStatus.clear();
+    m_checkpointStatus.clear();
+    m_tiledStatus.clear();
+    m_exportStatus.clear();
+    m_guidingStatus.clear();
+    m_environmentStatus.clear();
+    m_frameStatsText.clear();
+    RenderSessionSettings session;
+    session.width = m_renderWidth;
+    session.height = m_renderHeight;
+    session.samples = m_samples;
+    session.maxDepth = m_maxDepth;
+    session.tileSize = m_tileSize;
+    session.denoise = m_denoise;
+    session.guiding = m_guiding;
+    session.environment = m_environment;
+    session.lightSelection = light_selection(m_lightSelection.toStdString());
+    try {
+        for (const QString &name : m_aovChannels) {
+            session.aovChannels.add(aov_channel(name.trimmed().toLower().toStdString()));
+        }
+    } catch (const std::exception &error) {
+        session.aovChannels = AovSet();
+        m_aovStatus = QStringLiteral(" | AOVs off: %1").arg(QString::fromStdString(error.what()));
+    }
+    session.aovOutput = m_aovOutput;
+    session.camera = cameraParams();
+    session.checkpoint.path = m_checkpointPath.isEmpty() ? m_resumePath : m_checkpointPath;
+    session.checkpoint.intervalSeconds = m_checkpointInterval;
+    session.checkpoint.resumePath = m_resumePath;
+    session.tiledOutput.path = m_tiledOutput;
+    session.tiledOutput.size = m_tiledSize;
+    session.tiledOutput.memoryBudgetMiB = m_memoryBudget;
+    session.exportPath = m_exportPath;
+    session.display.tonemap = tonemap_from_name(m_tonemap.toStdString());
+    session.display.exposure = static_cast<float>(m_exposure);
+    session.display.transfer = m_srgb ? DisplayTransfer::Srgb : DisplayTransfer::Gamma2;
+    m_worker = new RenderWorker(session);
+    m_worker->setRegion(renderRegion());
     m_worker->moveToThread(m_thread);
 
     connect(m_thread, &QThread::started, m_worker, &RenderWorker::render);
     connect(m_worker, &RenderWorker::tileRendered, this, &RayTracerFboItem::onTileRendered, Qt::QueuedConnection);
     connect(m_worker, &RenderWorker::progressUpdated, this, &RayTracerFboItem::onWorkerProgressUpdated, Qt::QueuedConnection);
+    connect(m_worker, &RenderWorker::sceneStatsReady, this, &RayTracerFboItem::onWorkerSceneStats, Qt::QueuedConnection);
+    connect(m_worker, &RenderWorker::previewReady, this, &RayTracerFboItem::onWorkerPreviewReady, Qt::QueuedConnection);
+    connect(m_worker, &RenderWorker::denoiseFinished, this, &RayTracerFboItem::onWorkerDenoised, Qt::QueuedConnection);
+    connect(m_worker, &RenderWorker::aovsExported, this, &RayTracerFboItem::onWorkerAovsExported, Qt::QueuedConnection);
+    connect(m_worker, &RenderWorker::cameraRestored, this, &RayTracerFboItem::onWorkerCameraRestored, Qt::QueuedConnection);
+    connect(m_worker, &RenderWorker::checkpointStatus, this, &RayTracerFboItem::onWorkerCheckpointStatus, Qt::QueuedConnection);
+    connect(m_worker, &RenderWorker::tiledOutputWritten, this, &RayTracerFboItem::onWorkerTiledOutputWritten,
+            Qt::QueuedConnection);
+    connect(m_worker, &RenderWorker::imageExported, this, &RayTracerFboItem::onWorkerImageExported, Qt::QueuedConnection);
+    connect(m_worker, &RenderWorker::guidingUpdated, this, &RayTracerFboItem::onWorkerGuidingUpdated, Qt::QueuedConnection);
+    connect(m_worker, &RenderWorker::environmentLoaded, this, &RayTracerFboItem::onWorkerEnvironmentLoaded,
+            Qt::QueuedConnection);
+    connect(m_worker, &RenderWorker::frameCompleted, this, &RayTracerFboItem::onWorkerFrameCompleted, Qt::QueuedConnection);
     connect(m_worker, &RenderWorker::finished, this, &RayTracerFboItem::onWorkerFinished, Qt::QueuedConnection);
     connect(m_worker, &RenderWorker::finished, m_thread, &QThread::quit);
     connect(m_thread, &QThread::finished, m_worker, &RenderWorker::deleteLater);
@@ -394,12 +1190,94 @@ void RayTracerFboItem::onWorkerProgressUpdated(int value) {
     setProgress(value);
 }
 
-void RayTracerFboItem::onWorkerFinished() {
+void RayTracerFboItem::onWorkerSceneStats(qint64 firstTileMs, qint64 previewMs, double bvhBuiltFraction) {
+    m_firstTileMs = firstTileMs;
+    m_previewMs = previewMs;
+    m_bvhBuiltFraction = bvhBuiltFraction;
+}
+
+void RayTracerFboItem::onWorkerPreviewReady(qint64 previewMs) {
+    m_previewMs = previewMs;
+    setStatsText(QStringLiteral("Rendering... | Preview %1 ms").arg(previewMs));
+}
+
+void RayTracerFboItem::onWorkerDenoised(double denoiseMs) {
+    m_denoiseMs = denoiseMs;
+}
+
+void RayTracerFboItem::onWorkerAovsExported(int fileCount, const QString &error) {
+    m_aovStatus = error.isEmpty()
+        ? QStringLiteral(" | AOVs %1 files").arg(fileCount)
+        : QStringLiteral(" | AOV export failed: %1").arg(error);
+}
+
+void RayTracerFboItem::onWorkerCameraRestored(const QVector3D &position, const QVector3D &target, double fieldOfView,
+                                              double aperture, double focusDistance) {
+    // The worker already renders this view; no restart.
+    m_cameraPosition = position;
+    m_cameraTarget = target;
+    m_fieldOfView = fieldOfView;
+    m_aperture = aperture;
+    m_focusDistance = focusDistance;
+    emit cameraChanged();
+}
+
+void RayTracerFboItem::onWorkerCheckpointStatus(int written, int passes, const QString &error) {
+    m_checkpointStatus = error.isEmpty()
+        ? QStringLiteral(" | Checkpoints %1 (%2 spp)").arg(written).arg(passes)
+        : QStringLiteral(" | Checkpoint failed: %1").arg(error);
+}
+
+void RayTracerFboItem::onWorkerTiledOutputWritten(qint64 peakBytes, qint64 budgetBytes, int tiles,
+                                                  const QString &error) {
+    m_tiledStatus = error.isEmpty()
+        ? QStringLiteral(" | Tiled %1x%2: %3 tiles, peak %4 of %5 MiB")
+              .arg(m_tiledSize.width())
+              .arg(m_tiledSize.height())
+              .arg(tiles)
+              .arg(static_cast<double>(peakBytes) / 1048576.0, 0, 'f', 1)
+              .arg(budgetBytes >> 20)
+        : QStringLiteral(" | Tiled output failed: %1").arg(error);
+}
+
+void RayTracerFboItem::onWorkerImageExported(const QString &path, qint64 bytes, double tailMs, const QString &error) {
+    m_exportStatus = error.isEmpty()
+        ? QStringLiteral(" | Exported %1 (%2 MiB) %3 ms after the last pixel")
+              .arg(path)
+              .arg(static_cast<double>(bytes) / 1048576.0, 0, 'f', 1)
+              .arg(tailMs, 0, 'f', 0)
+        : QStringLiteral(" | Export failed: %1").arg(error);
+    // The file usually completes after the frame's statistics are shown.
+    if (!m_frameStatsText.isEmpty()) {
+        refreshStatsText();
+    }
+}
+
+void RayTracerFboItem::onWorkerGuidingUpdated(int iterations, qint64 memoryBytes, qint64 trainingMs, bool training) {
+    m_guidingStatus = QStringLiteral(" | Guide %1 iterations, %2 MiB, trained %3 ms%4")
+                          .arg(iterations)
+                          .arg(static_cast<double>(memoryBytes) / 1048576.0, 0, 'f', 1)
+                          .arg(trainingMs)
+                          .arg(training ? QStringLiteral(" (training)") : QString());
+}
+
+void RayTracerFboItem::onWorkerEnvironmentLoaded(int width, int height, qint64 memoryBytes, const QString &error) {
+    m_environmentStatus = error.isEmpty()
+        ? QStringLiteral(" | Environment %1x%2 (%3 MiB)")
+              .arg(width)
+              .arg(height)
+              .arg(static_cast<double>(memoryBytes) / 1048576.0, 0, 'f', 1)
+        : QStringLiteral(" | Environment failed: %1").arg(error);
+}
+
+void RayTracerFboItem::onWorkerFrameCompleted() {
     const qint64 elapsedMs = std::max<qint64>(1, m_renderTimer.elapsed());
     const double elapsedSec = static_cast<double>(elapsedMs) / 1000.0;
+    // A tiled output render traced the full output size.
+    const QSize frame = m_tiledStatus.isEmpty() ? QSize(m_renderWidth, m_renderHeight) : m_tiledSize;
     const double totalSamples =
-        static_cast<double>(m_renderWidth) *
-        static_cast<double>(m_renderHeight) *
+        static_cast<double>(frame.width()) *
+        static_cast<double>(frame.height()) *
         static_cast<double>(m_samples);
     const double samplesPerSec = totalSamples / elapsedSec;
     const double refreshFps = static_cast<double>(m_repaintRequests) / elapsedSec;
@@ -409,8 +1287,12 @@ void RayTracerFboItem::onWorkerFinished() {
     const double uploadsPerFrame = uploadCalls / uploadFrames;
     const double uploadPixelsPerSec = uploadPixels / elapsedSec;
 
-    setStatsText(QStringLiteral(
-                     "Render %1s | Repaints %2 (%3 FPS) | Throughput %4 Msamples/s | GPU uploads %5/frame | Upload BW %6 MPix/s | Tile %7 | Max uploads/frame %8")
+    const QString denoiseText = m_denoiseMs >= 0.0
+        ? QStringLiteral(" | Denoise %1 ms").arg(m_denoiseMs, 0, 'f', 1)
+        : QString();
+
+    m_frameStatsText = QStringLiteral(
+                     "Render %1s | Repaints %2 (%3 FPS) | Throughput %4 Msamples/s | GPU uploads %5/frame | Upload BW %6 MPix/s | Tile %7 | Max uploads/frame %8 | First tile %9 ms | Preview %10 ms | BVH built %11%%12")
                      .arg(elapsedSec, 0, 'f', 2)
                      .arg(m_repaintRequests)
                      .arg(refreshFps, 0, 'f', 1)
@@ -418,9 +1300,26 @@ void RayTracerFboItem::onWorkerFinished() {
                      .arg(uploadsPerFrame, 0, 'f', 2)
                      .arg(uploadPixelsPerSec / 1e6, 0, 'f', 2)
                      .arg(m_tileSize)
-                     .arg(m_maxUploadsPerFrame));
+                     .arg(m_maxUploadsPerFrame)
+                     .arg(m_firstTileMs)
+                     .arg(m_previewMs)
+                     .arg(100.0 * m_bvhBuiltFraction, 0, 'f', 1)
+                     .arg(denoiseText);
+    refreshStatsText();
 
     setProgress(100);
+}
+
+void RayTracerFboItem::refreshStatsText() {
+    setStatsText(m_frameStatsText + m_environmentStatus + m_guidingStatus + m_aovStatus + m_checkpointStatus +
+                 m_tiledStatus + m_exportStatus);
+}
+
+void RayTracerFboItem::onWorkerFinished() {
+    // A session ended by stopRender() has already been detached.
+    if (sender() != m_worker) {
+        return;
+    }
     setRendering(false);
     m_worker = nullptr;
     m_thread = nullptr;
@@ -761,6 +1660,13 @@ QSGNode *RayTracerFboItem::updatePaintNode(QSGNode *oldNode, QQuickItem::UpdateP
     return node;
 }
 
+void RayTracerFboItem::geometryChange(const QRectF &newGeometry, const QRectF &oldGeometry) {
+    QQuickItem::geometryChange(newGeometry, oldGeometry);
+    if (newGeometry.size() != oldGeometry.size()) {
+        emit imageRectChanged();
+    }
+}
+
 void RayTracerFboItem::releaseResources() {
     QQuickItem::releaseResources();
 }
@@ -790,6 +1696,47 @@ void RayTracerFboItem::setStatsText(const QString &value) {
     emit statsTextChanged();
 }
 
+CameraParams RayTracerFboItem::cameraParams() const {
+    CameraParams params;
+    params.lookfrom = Point3(m_cameraPosition.x(), m_cameraPosition.y(), m_cameraPosition.z());
+    params.lookat = Point3(m_cameraTarget.x(), m_cameraTarget.y(), m_cameraTarget.z());
+    params.vfov = m_fieldOfView;
+    params.aperture = m_aperture;
+    params.focus_dist = m_focusDistance;
+    return params;
+}
+
+RenderRegion RayTracerFboItem::renderRegion() const {
+    RenderRegion region;
+    region.x0 = static_cast<int>(std::floor(m_regionOfInterest.left() * m_renderWidth));
+    region.y0 = static_cast<int>(std::floor(m_regionOfInterest.top() * m_renderHeight));
+    region.x1 = static_cast<int>(std::ceil(m_regionOfInterest.right() * m_renderWidth));
+    region.y1 = static_cast<int>(std::ceil(m_regionOfInterest.bottom() * m_renderHeight));
+    if (m_regionMode == QStringLiteral("focus")) {
+        region.mode = RegionMode::Focus;
+    } else if (m_regionMode == QStringLiteral("crop")) {
+        region.mode = RegionMode::Crop;
+    }
+    return region;
+}
+
+void RayTracerFboItem::applyCamera() {
+    emit cameraChanged();
+    if (!m_worker) {
+        return;
+    }
+    // The session keeps its scene and BVH; only accumulation restarts.
+    m_worker->setCamera(cameraParams());
+    m_renderTimer.restart();
+    m_repaintRequests = 0;
+    m_gpuUploadCalls.store(0, std::memory_order_relaxed);
+    m_gpuUploadPixels.store(0, std::memory_order_relaxed);
+    m_gpuUploadFrames.store(0, std::memory_order_relaxed);
+    m_denoiseMs = -1.0;
+    setProgress(0);
+    setStatsText(QStringLiteral("Rendering..."));
+}
+
 int RayTracerFboItem::chooseTileSize(QSGRendererInterface::GraphicsApi api, int width, int height) const {
     const int pixels = width * height;
     int tileSize = 16;
@@ -5,17 +5,85 @@
 #include <QImage>
 #include <QMutex>
 #include <QQuickItem>
+#include <QRectF>
+#include <QSize>
 #include <QSGRendererInterface>
+#include <QStringList>
 #include <QThread>
+#include <QVector3D>
 #include <QVector>
 #include <atomic>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
 
+#include "raytracer/Aov.h"
+#include "raytracer/FilmResolve.h"
+#include "raytracer/ImageExport.h"
+#include "raytracer/LightBVH.h"
+#include "raytracer/Progressive.h"
+
+// Where a CPU session saves checkpoints of its film (empty: never) and how
+// often, and the checkpoint it starts from (empty: a new render).
+struct CheckpointOptions {
+    QString path;
+    int intervalSeconds = 30;
+    QString resumePath;
+};
+
+// Renders the frame once at `size` into a tiled image file (empty path:
+// off), holding at most `memoryBudgetMiB` of tiles in memory; the item shows
+// a downsampled preview at its render size.
+struct TiledOutputOptions {
+    QString path;
+    QSize size;
+    int memoryBudgetMiB = 512;
+};
+
+// Everything a CPU render session starts with; the camera is only the
+// initial view.
+struct RenderSessionSettings {
+    int width = 800;
+    int height = 450;
+    int samples = 10;
+    int maxDepth = 10;
+    int tileSize = 16;
+    bool denoise = false;
+    // Path guiding trained on the session's first passes.
+    bool guiding = false;
+    // HDR environment map (.pfm, .hdr or .exr) lighting the scene; empty: the sky.
+    QString environment;
+    LightSelection lightSelection = LightSelection::Uniform;
+    // May be empty; AOVs are then neither gathered nor exported.
+    AovSet aovChannels;
+    QString aovOutput;
+    CameraParams camera;
+    CheckpointOptions checkpoint;
+    TiledOutputOptions tiledOutput;
+    QString exportPath;
+    // How tiles are resolved for the item and for PNG export.
+    DisplaySettings display;
+};
+
+// Persistent CPU render session. render() builds the scene once and then
+// refines the image one sample per pixel per pass until `samples` passes are
+// done, after which it finishes the frame (denoise, AOV export) and waits.
+// setCamera() restarts accumulation from any thread without rebuilding the
+// scene; stop() ends the session. With a checkpoint path, the film is saved
+// every `intervalSeconds` of rendering and when a frame completes. With a
+// tiled output path the session renders that file instead and ends. With an
+// export path every finished frame, or the tiled output tile by tile, is
+// handed to an ImageExporter that encodes the file on its own thread.
 class RenderWorker : public QObject {
     Q_OBJECT
 public:
-    RenderWorker(int width, int height, int samples, int depth, int tileSize, QObject *parent = nullptr);
+    explicit RenderWorker(const RenderSessionSettings &settings, QObject *parent = nullptr);
     void stop();
+    // Thread safe; the pass in flight is abandoned within one sample.
+    void setCamera(const CameraParams &camera);
+    // Thread safe; keeps the accumulated samples. A finished frame is
+    // refined for another `samples` passes under the new region.
+    void setRegion(const RenderRegion &region);
 
 public slots:
     void render();
@@ -23,15 +91,63 @@ public slots:
 signals:
     void tileRendered(int yStart, int xStart, int tileWidth, int tileHeight, const QVector<unsigned int> &pixelData);
     void progressUpdated(int percentage);
+    // Time from the last camera edit (or session start) to the first finished
+    // tile and to the first image covering the frame, and the fraction of the
+    // lazily built BVH that rendering has built so far.
+    void sceneStatsReady(qint64 firstTileMs, qint64 previewMs, double bvhBuiltFraction);
+    // The coarsest preview stage covers the frame.
+    void previewReady(qint64 previewMs);
+    // Emitted once the denoised frame has replaced the tiles.
+    void denoiseFinished(double denoiseMs);
+    // Result of writing the AOV files of a finished frame; `error` is empty on
+    // success.
+    void aovsExported(int fileCount, const QString &error);
+    // A resumed session continues the checkpoint's view instead of the one
+    // it was started with.
+    void cameraRestored(const QVector3D &position, const QVector3D &target, double fieldOfView, double aperture,
+                        double focusDistance);
+    // Checkpoints written so far and the last error (empty if none).
+    void checkpointStatus(int written, int passes, const QString &error);
+    // Result of a tiled output render: peak and budgeted tile memory and
+    // tiles written; `error` is empty on success.
+    void tiledOutputWritten(qint64 peakBytes, qint64 budgetBytes, int tiles, const QString &error);
+    // The exported image is complete: file size and the time from the last
+    // pixel handed over to the finished file; `error` is empty on success.
+    // Emitted from the exporter's thread.
+    void imageExported(const QString &path, qint64 bytes, double tailMs, const QString &error);
+    // The path guide finished a training iteration: iterations so far, tree
+    // size, time since training started, and whether it is still training.
+    void guidingUpdated(int iterations, qint64 memoryBytes, qint64 trainingMs, bool training);
+    // Result of loading the environment map; `error` is empty on success.
+    void environmentLoaded(int width, int height, qint64 memoryBytes, const QString &error);
+    // All passes of the current view are done.
+    void frameCompleted();
+    // The session ended after stop().
     void finished();
 
 private:
-    int m_width;
-    int m_height;
-    int m_samples;
-    int m_depth;
-    int m_tileSize;
+    void finishFrame(const ProgressiveRenderer &renderer, const AovIds &aovIds);
+    // Waits for the previous export, then starts one to the export path;
+    // null (with imageExported() emitted) if the file cannot be created.
+    ImageExporter *startExport(int width, int height);
+    void exportFrame(const std::vector<PixelAccumulator> &film, const std::vector<Color> &filtered,
+                     const AovIds &aovIds);
+    void renderTiledOutput(const Hitable &world, const LightSampler &lights, const PathTracerSettings &pathSettings,
+                           const AovIds &aovIds, uint64_t seed);
+
+    RenderSessionSettings m_settings;
+    std::unique_ptr<ImageExporter> m_exporter;
     std::atomic<bool> m_stop{false};
+
+    // Guards the camera hand-off between setCamera() and the render loop.
+    std::mutex m_cameraMutex;
+    std::condition_variable m_wake;
+    CameraParams m_camera;
+    bool m_cameraChanged = false;
+    RenderRegion m_region;
+    bool m_regionChanged = false;
+    QElapsedTimer m_viewTimer;  // since the last edit
+    ProgressiveRenderer *m_renderer = nullptr;
 };
 
 class QSGNode;
@@ -46,6 +162,52 @@ class RayTracerFboItem : public QQuickItem {
     Q_PROPERTY(int samples READ samples WRITE setSamples NOTIFY samplesChanged)
     Q_PROPERTY(int maxDepth READ maxDepth WRITE setMaxDepth NOTIFY maxDepthChanged)
     Q_PROPERTY(QString computeBackend READ computeBackend WRITE setComputeBackend NOTIFY computeBackendChanged)
+    Q_PROPERTY(bool denoise READ denoise WRITE setDenoise NOTIFY denoiseChanged)
+    // Path guiding of CPU renders, trained on the first passes of a session.
+    Q_PROPERTY(bool guiding READ guiding WRITE setGuiding NOTIFY guidingChanged)
+    // HDR environment map (.pfm, .hdr or .exr; empty: the sky) of CPU renders.
+    // Takes effect at the next startRender().
+    Q_PROPERTY(QString environment READ environment WRITE setEnvironment NOTIFY environmentChanged)
+    // How shadow rays pick a light: "uniform" or "bvh" (see LightBVH.h);
+    // other names are ignored. Takes effect at the next startRender().
+    Q_PROPERTY(QString lightSelection READ lightSelection WRITE setLightSelection NOTIFY lightSelectionChanged)
+    // AOV channel names (see aov_name()) filled during CPU renders, and the
+    // path prefix they are exported to when a render completes.
+    Q_PROPERTY(QStringList aovChannels READ aovChannels WRITE setAovChannels NOTIFY aovChannelsChanged)
+    Q_PROPERTY(QString aovOutput READ aovOutput WRITE setAovOutput NOTIFY aovOutputChanged)
+    // Camera of CPU renders; edits restart accumulation of a running render.
+    Q_PROPERTY(QVector3D cameraPosition READ cameraPosition WRITE setCameraPosition NOTIFY cameraChanged)
+    Q_PROPERTY(QVector3D cameraTarget READ cameraTarget WRITE setCameraTarget NOTIFY cameraChanged)
+    Q_PROPERTY(double fieldOfView READ fieldOfView WRITE setFieldOfView NOTIFY cameraChanged)
+    Q_PROPERTY(double aperture READ aperture WRITE setAperture NOTIFY cameraChanged)
+    Q_PROPERTY(double focusDistance READ focusDistance WRITE setFocusDistance NOTIFY cameraChanged)
+    // Region of interest in normalized image coordinates (origin top left)
+    // and how CPU renders schedule it: "off", "focus" or "crop".
+    Q_PROPERTY(QRectF regionOfInterest READ regionOfInterest WRITE setRegionOfInterest NOTIFY regionChanged)
+    Q_PROPERTY(QString regionMode READ regionMode WRITE setRegionMode NOTIFY regionChanged)
+    // Checkpoint file of CPU renders (empty: none) and the seconds between
+    // saves. With resumePath set, startRender() continues that checkpoint
+    // and keeps saving to it unless checkpointPath names another file.
+    Q_PROPERTY(QString checkpointPath READ checkpointPath WRITE setCheckpointPath NOTIFY checkpointChanged)
+    Q_PROPERTY(int checkpointInterval READ checkpointInterval WRITE setCheckpointInterval NOTIFY checkpointChanged)
+    Q_PROPERTY(QString resumePath READ resumePath WRITE setResumePath NOTIFY checkpointChanged)
+    // Tiled output of CPU renders: file (empty: off), full output size and
+    // the cap on tile memory in MiB. The item shows a preview at its render
+    // size.
+    Q_PROPERTY(QString tiledOutput READ tiledOutput WRITE setTiledOutput NOTIFY tiledOutputChanged)
+    Q_PROPERTY(QSize tiledSize READ tiledSize WRITE setTiledSize NOTIFY tiledOutputChanged)
+    Q_PROPERTY(int memoryBudget READ memoryBudget WRITE setMemoryBudget NOTIFY tiledOutputChanged)
+    // Image file (.png, .pfm or .exr; empty: none) each completed CPU render
+    // is encoded to in the background. EXR files carry the AOV channels.
+    Q_PROPERTY(QString exportPath READ exportPath WRITE setExportPath NOTIFY exportPathChanged)
+    // Film resolve of CPU renders, for the view and PNG export: tonemap
+    // ("clamp", "reinhard" or "aces"), exposure in stops, and the sRGB
+    // curve instead of gamma 2. Takes effect at the next startRender().
+    Q_PROPERTY(QString tonemap READ tonemap WRITE setTonemap NOTIFY displayChanged)
+    Q_PROPERTY(double exposure READ exposure WRITE setExposure NOTIFY displayChanged)
+    Q_PROPERTY(bool srgb READ srgb WRITE setSrgb NOTIFY displayChanged)
+    // Where the image is drawn inside the item, for mapping pointer input.
+    Q_PROPERTY(QRectF imageRect READ imageRect NOTIFY imageRectChanged)
     Q_PROPERTY(int progress READ progress NOTIFY progressChanged)
     Q_PROPERTY(bool rendering READ rendering NOTIFY renderingChanged)
     Q_PROPERTY(QString statsText READ statsText NOTIFY statsTextChanged)
@@ -59,6 +221,30 @@ public:
     int samples() const;
     int maxDepth() const;
     QString computeBackend() const;
+    bool denoise() const;
+    bool guiding() const;
+    QString environment() const;
+    QString lightSelection() const;
+    QStringList aovChannels() const;
+    QString aovOutput() const;
+    QVector3D cameraPosition() const;
+    QVector3D cameraTarget() const;
+    double fieldOfView() const;
+    double aperture() const;
+    double focusDistance() const;
+    QRectF regionOfInterest() const;
+    QString regionMode() const;
+    QString checkpointPath() const;
+    int checkpointInterval() const;
+    QString resumePath() const;
+    QString tiledOutput() const;
+    QSize tiledSize() const;
+    int memoryBudget() const;
+    QString exportPath() const;
+    QString tonemap() const;
+    double exposure() const;
+    bool srgb() const;
+    QRectF imageRect() const;
     int progress() const;
     bool rendering() const;
     QString statsText() const;
@@ -68,6 +254,36 @@ public:
     void setSamples(int value);
     void setMaxDepth(int value);
     void setComputeBackend(const QString &value);
+    void setDenoise(bool value);
+    void setGuiding(bool value);
+    void setEnvironment(const QString &value);
+    void setLightSelection(const QString &value);
+    void setAovChannels(const QStringList &value);
+    void setAovOutput(const QString &value);
+    void setCameraPosition(const QVector3D &value);
+    void setCameraTarget(const QVector3D &value);
+    void setFieldOfView(double value);
+    void setAperture(double value);
+    void setFocusDistance(double value);
+    void setRegionOfInterest(const QRectF &value);
+    void setRegionMode(const QString &value);
+    void setCheckpointPath(const QString &value);
+    void setCheckpointInterval(int value);
+    void setResumePath(const QString &value);
+    void setTiledOutput(const QString &value);
+    void setTiledSize(const QSize &value);
+    void setMemoryBudget(int value);
+    void setExportPath(const QString &value);
+    void setTonemap(const QString &value);
+    void setExposure(double value);
+    void setSrgb(bool value);
+
+    // Navigation helpers for the view: orbit the position around the target
+    // (degrees), scale the distance to the target, and move both along the
+    // camera's forward/right/up axes (scene units).
+    Q_INVOKABLE void orbit(double yawDegrees, double pitchDegrees);
+    Q_INVOKABLE void dolly(double factor);
+    Q_INVOKABLE void moveCamera(double forward, double right, double up);
 
     Q_INVOKABLE void startRender();
     Q_INVOKABLE void stopRender();
@@ -78,6 +294,19 @@ signals:
     void samplesChanged();
     void maxDepthChanged();
     void computeBackendChanged();
+    void denoiseChanged();
+    void guidingChanged();
+    void environmentChanged();
+    void lightSelectionChanged();
+    void aovChannelsChanged();
+    void aovOutputChanged();
+    void cameraChanged();
+    void regionChanged();
+    void checkpointChanged();
+    void tiledOutputChanged();
+    void exportPathChanged();
+    void displayChanged();
+    void imageRectChanged();
     void progressChanged();
     void renderingChanged();
     void statsTextChanged();
@@ -85,10 +314,23 @@ signals:
 private slots:
     void onTileRendered(int yStart, int xStart, int tileWidth, int tileHeight, const QVector<unsigned int> &pixelData);
     void onWorkerProgressUpdated(int value);
+    void onWorkerSceneStats(qint64 firstTileMs, qint64 previewMs, double bvhBuiltFraction);
+    void onWorkerPreviewReady(qint64 previewMs);
+    void onWorkerDenoised(double denoiseMs);
+    void onWorkerAovsExported(int fileCount, const QString &error);
+    void onWorkerCameraRestored(const QVector3D &position, const QVector3D &target, double fieldOfView,
+                                double aperture, double focusDistance);
+    void onWorkerCheckpointStatus(int written, int passes, const QString &error);
+    void onWorkerTiledOutputWritten(qint64 peakBytes, qint64 budgetBytes, int tiles, const QString &error);
+    void onWorkerImageExported(const QString &path, qint64 bytes, double tailMs, const QString &error);
+    void onWorkerGuidingUpdated(int iterations, qint64 memoryBytes, qint64 trainingMs, bool training);
+    void onWorkerEnvironmentLoaded(int width, int height, qint64 memoryBytes, const QString &error);
+    void onWorkerFrameCompleted();
     void onWorkerFinished();
 
 protected:
     QSGNode *updatePaintNode(QSGNode *oldNode, QQuickItem::UpdatePaintNodeData *data) override;
+    void geometryChange(const QRectF &newGeometry, const QRectF &oldGeometry) override;
     void releaseResources() override;
 
 private:
@@ -103,14 +345,43 @@ private:
     void setRendering(bool value);
     void setProgress(int value);
     void setStatsText(const QString &value);
+    // The last frame's statistics followed by the status of the outputs.
+    void refreshStatsText();
     int chooseTileSize(QSGRendererInterface::GraphicsApi api, int width, int height) const;
     int chooseMaxUploadsPerFrame(QSGRendererInterface::GraphicsApi api, int width, int height) const;
+    CameraParams cameraParams() const;
+    // Emits cameraChanged() and hands the new camera to a running render.
+    void applyCamera();
+    RenderRegion renderRegion() const;
 
     int m_renderWidth = 800;
     int m_renderHeight = 450;
     int m_samples = 10;
     int m_maxDepth = 10;
     QString m_computeBackend = QStringLiteral("auto");
+    bool m_denoise = false;
+    bool m_guiding = false;
+    QString m_environment;
+    QString m_lightSelection = QStringLiteral("uniform");
+    QStringList m_aovChannels;
+    QString m_aovOutput;
+    QVector3D m_cameraPosition{13.0f, 2.0f, 3.0f};
+    QVector3D m_cameraTarget{0.0f, 0.0f, 0.0f};
+    double m_fieldOfView = 20.0;
+    double m_aperture = 0.1;
+    double m_focusDistance = 10.0;
+    QRectF m_regionOfInterest{0.375, 0.375, 0.25, 0.25};
+    QString m_regionMode = QStringLiteral("off");
+    QString m_checkpointPath;
+    int m_checkpointInterval = 30;
+    QString m_resumePath;
+    QString m_tiledOutput;
+    QSize m_tiledSize{8192, 4608};
+    int m_memoryBudget = 512;
+    QString m_exportPath;
+    QString m_tonemap = QStringLiteral("clamp");
+    double m_exposure = 0.0;
+    bool m_srgb = false;
     int m_progress = 0;
     bool m_rendering = false;
     QString m_statsText = QStringLiteral("Last render: N/A");
@@ -124,6 +395,17 @@ private:
     RenderWorker *m_worker = nullptr;
     QElapsedTimer m_renderTimer;
     int m_repaintRequests = 0;
+    qint64 m_firstTileMs = -1;
+    qint64 m_previewMs = -1;
+    double m_bvhBuiltFraction = 1.0;
+    double m_denoiseMs = -1.0;
+    QString m_aovStatus;
+    QString m_checkpointStatus;
+    QString m_tiledStatus;
+    QString m_exportStatus;
+    QString m_guidingStatus;
+    QString m_environmentStatus;
+    QString m_frameStatsText;
     int m_tileSize = 16;
     int m_maxUploadsPerFrame = 32;
     std::atomic<quint64> m_gpuUploadCalls{0};
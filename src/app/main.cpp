@@ -2,11 +2,13 @@
 #include <QCommandLineParser>
 #include <QGuiApplication>
 #include <QProcess>
+#include <QSize>
 #include <QSurfaceFormat>
 #include <QtCore/QObject>
 #include <QtQml/QQmlContext>
 #include <QtQuick/QQuickView>
 #include <QtQuick/QQuickWindow>
+#include <algorithm>
 
 #include "app/RayTracerFboItem.h"
 
@@ -30,6 +32,15 @@ static QSGRendererInterface::GraphicsApi parseGraphicsApi(const QString &name) {
     return QSGRendererInterface::OpenGL;
 }
 
+// "WxH"; an invalid size when the text does not parse.
+static QSize parseSize(const QString &text) {
+    const QStringList parts = text.trimmed().toLower().split(QLatin1Char('x'));
+    if (parts.size() != 2) {
+        return QSize();
+    }
+    return QSize(parts[0].toInt(), parts[1].toInt());
+}
+
 static QString graphicsApiToString(QSGRendererInterface::GraphicsApi api) {
     switch (api) {
     case QSGRendererInterface::OpenGL:
@@ -115,6 +126,91 @@ int main(int argc, char *argv[]) {
         "graphics-api",
         "opengl");
     parser.addOption(graphicsApiOption);
+    QCommandLineOption denoiseOption(
+        QStringList() << "denoise",
+        "Denoise each finished CPU render using first-hit albedo, normal and depth");
+    parser.addOption(denoiseOption);
+    QCommandLineOption guideOption(
+        QStringList() << "guide",
+        "Path guiding for CPU renders, trained on the first half of each render's passes");
+    parser.addOption(guideOption);
+    QCommandLineOption environmentOption(
+        QStringList() << "environment",
+        "HDR environment map (.pfm, .hdr or .exr) lighting CPU renders instead of the sky",
+        "file");
+    parser.addOption(environmentOption);
+    QCommandLineOption lightsOption(
+        QStringList() << "lights",
+        "Light selection of CPU renders: uniform, or bvh for scenes with many lights",
+        "name",
+        "uniform");
+    parser.addOption(lightsOption);
+    QCommandLineOption aovsOption(
+        QStringList() << "aovs",
+        "Comma-separated AOV channels to fill during CPU renders: "
+        "depth,normal,albedo,material_id,primitive_id,sample_count,variance",
+        "channels");
+    parser.addOption(aovsOption);
+    QCommandLineOption aovOutputOption(
+        QStringList() << "aov-output",
+        "Path prefix for the AOV files (<prefix>.<channel>.pfm) written after each completed render",
+        "prefix",
+        "aov");
+    parser.addOption(aovOutputOption);
+    QCommandLineOption checkpointOption(
+        QStringList() << "checkpoint",
+        "Save the film of CPU renders to this file periodically and when a render completes",
+        "file");
+    parser.addOption(checkpointOption);
+    QCommandLineOption checkpointIntervalOption(
+        QStringList() << "checkpoint-interval",
+        "Seconds of rendering between checkpoints",
+        "seconds",
+        "30");
+    parser.addOption(checkpointIntervalOption);
+    QCommandLineOption resumeOption(
+        QStringList() << "resume",
+        "Continue the render saved in this checkpoint file (and keep saving to it unless --checkpoint is given)",
+        "file");
+    parser.addOption(resumeOption);
+    QCommandLineOption tiledOutputOption(
+        QStringList() << "tiled-output",
+        "Render the frame once at --tiled-size into this tiled image file, keeping only in-flight tiles in memory",
+        "file");
+    parser.addOption(tiledOutputOption);
+    QCommandLineOption tiledSizeOption(
+        QStringList() << "tiled-size",
+        "Output size of --tiled-output renders",
+        "WxH",
+        "8192x4608");
+    parser.addOption(tiledSizeOption);
+    QCommandLineOption memoryBudgetOption(
+        QStringList() << "memory-budget",
+        "Cap on tile memory of --tiled-output renders, in MiB",
+        "MiB",
+        "512");
+    parser.addOption(memoryBudgetOption);
+    QCommandLineOption exportOption(
+        QStringList() << "export",
+        "Encode each completed CPU render to this image file (.png, .pfm or .exr with AOV channels) in the background",
+        "file");
+    parser.addOption(exportOption);
+    QCommandLineOption tonemapOption(
+        QStringList() << "tonemap",
+        "Tonemap of CPU renders for the view and PNG export: clamp, reinhard or aces",
+        "name",
+        "clamp");
+    parser.addOption(tonemapOption);
+    QCommandLineOption exposureOption(
+        QStringList() << "exposure",
+        "Exposure of CPU renders in stops",
+        "stops",
+        "0");
+    parser.addOption(exposureOption);
+    QCommandLineOption srgbOption(
+        QStringList() << "srgb",
+        "Encode CPU renders with the sRGB curve instead of gamma 2");
+    parser.addOption(srgbOption);
     parser.process(app);
 
     const auto requestedApi = parseGraphicsApi(parser.value(graphicsApiOption));
@@ -127,6 +223,30 @@ int main(int argc, char *argv[]) {
     QQuickView view;
     GraphicsBackendController backendController(requestedApiName);
     view.rootContext()->setContextProperty(QStringLiteral("backendController"), &backendController);
+    view.rootContext()->setContextProperty(QStringLiteral("denoiseByDefault"), parser.isSet(denoiseOption));
+    view.rootContext()->setContextProperty(QStringLiteral("guidingByDefault"), parser.isSet(guideOption));
+    view.rootContext()->setContextProperty(QStringLiteral("environmentByDefault"), parser.value(environmentOption));
+    view.rootContext()->setContextProperty(QStringLiteral("lightSelectionByDefault"), parser.value(lightsOption));
+    view.rootContext()->setContextProperty(
+        QStringLiteral("aovChannelsByDefault"),
+        parser.value(aovsOption).split(QLatin1Char(','), Qt::SkipEmptyParts));
+    view.rootContext()->setContextProperty(QStringLiteral("aovOutputByDefault"), parser.value(aovOutputOption));
+    view.rootContext()->setContextProperty(QStringLiteral("checkpointByDefault"), parser.value(checkpointOption));
+    view.rootContext()->setContextProperty(
+        QStringLiteral("checkpointIntervalByDefault"), std::max(1, parser.value(checkpointIntervalOption).toInt()));
+    view.rootContext()->setContextProperty(QStringLiteral("resumeByDefault"), parser.value(resumeOption));
+    QSize tiledSize = parseSize(parser.value(tiledSizeOption));
+    if (!tiledSize.isValid() || tiledSize.isEmpty()) {
+        tiledSize = QSize(8192, 4608);
+    }
+    view.rootContext()->setContextProperty(QStringLiteral("tiledOutputByDefault"), parser.value(tiledOutputOption));
+    view.rootContext()->setContextProperty(QStringLiteral("tiledSizeByDefault"), tiledSize);
+    view.rootContext()->setContextProperty(
+        QStringLiteral("memoryBudgetByDefault"), std::max(1, parser.value(memoryBudgetOption).toInt()));
+    view.rootContext()->setContextProperty(QStringLiteral("exportByDefault"), parser.value(exportOption));
+    view.rootContext()->setContextProperty(QStringLiteral("tonemapByDefault"), parser.value(tonemapOption));
+    view.rootContext()->setContextProperty(QStringLiteral("exposureByDefault"), parser.value(exposureOption).toDouble());
+    view.rootContext()->setContextProperty(QStringLiteral("srgbByDefault"), parser.isSet(srgbOption));
     view.setResizeMode(QQuickView::SizeRootObjectToView);
     view.setSource(QUrl(QStringLiteral("qrc:/resources/qml/Main.qml")));
     if (view.status() == QQuickView::Error) {
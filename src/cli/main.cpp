@@ -0,0 +1,374 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <spawn.h>
+#include <sys/wait.h>
+#endif
+
+#include "raytracer/Distributed.h"
+#include "raytracer/ImageExport.h"
+#include "raytracer/LightBVH.h"
+#include "raytracer/TiledImage.h"
+
+// Headless renderer: traces the app's default scene tile by tile and streams
+// every finished tile to the image exporter, so the image is encoded while
+// the render runs and only in-flight tiles and bands are held in memory.
+//
+// With --listen the tiles are traced by worker processes instead (this
+// program with --worker, here or on other machines) and only received here;
+// --spawn-workers starts local ones.
+
+#ifndef _WIN32
+extern char **environ;
+#endif
+
+static void printUsage() {
+    std::printf(
+        "Usage: raytracer_cli --output <file.png|file.pfm|file.exr> [options]\n"
+        "  --size WxH              output size (default 1920x1080)\n"
+        "  --samples N             samples per pixel (default 16)\n"
+        "  --depth N               maximum path depth (default 10)\n"
+        "  --tile N                tile size in pixels (default 64)\n"
+        "  --aovs a,b,...          AOV channels written as EXR channels: depth,normal,albedo,\n"
+        "                          material_id,primitive_id,sample_count,variance\n"
+        "  --exr-compression C     zip|none (default zip)\n"
+        "  --tonemap T             clamp|reinhard|aces for PNG (default clamp)\n"
+        "  --exposure EV           exposure in stops for PNG (default 0)\n"
+        "  --srgb                  sRGB curve instead of gamma 2 for PNG\n"
+        "  --environment <file>    HDR environment map (.pfm, .hdr or .exr) instead of the sky\n"
+        "  --lights S              light selection: uniform|bvh (default uniform)\n"
+        "  --guide                 path guiding, trained on discarded passes before the frame\n"
+        "  --denoise               denoise the frame before export (holds the whole frame)\n"
+        "  --memory-budget MiB     cap on tile memory (default 512)\n"
+        "  --tiled-output <file>   also keep the tiles in a tiled image file\n"
+        "  --seed N                sample seed (default 24301)\n"
+        "  --scene-seed N          seed of the random scene (default 1)\n"
+        "Distributed rendering:\n"
+        "  --listen ADDR           hand tiles to workers connecting to unix:<path> or <host>:<port>\n"
+        "  --spawn-workers N       with --listen, start N local worker processes\n"
+        "  --worker ADDR           trace tiles for the coordinator at ADDR (no --output)\n"
+        "  --threads N             tile threads of a worker (default: all cores, split among\n"
+        "                          spawned workers)\n");
+}
+
+static HitableList loadScene(const std::string &name) {
+    if (name != "random") {
+        throw std::invalid_argument("Unknown scene: " + name);
+    }
+    return random_scene();
+}
+
+#ifndef _WIN32
+// Starts `count` copies of this program as workers of `address`.
+static std::vector<pid_t> spawnWorkers(const char *program, const std::string &address, int count, int threads) {
+    std::vector<pid_t> workers;
+    const std::string threadText = std::to_string(threads);
+    for (int i = 0; i < count; ++i) {
+        std::vector<char *> args = {const_cast<char *>(program), const_cast<char *>("--worker"),
+                                    const_cast<char *>(address.c_str()), const_cast<char *>("--threads"),
+                                    const_cast<char *>(threadText.c_str()), nullptr};
+        pid_t pid = 0;
+        if (posix_spawnp(&pid, program, nullptr, nullptr, args.data(), environ) != 0) {
+            throw std::runtime_error(std::string("Cannot start worker process ") + program);
+        }
+        workers.push_back(pid);
+    }
+    return workers;
+}
+
+static void waitForWorkers(const std::vector<pid_t> &workers) {
+    for (const pid_t pid : workers) {
+        int status = 0;
+        waitpid(pid, &status, 0);
+    }
+}
+#endif
+
+// "WxH"; false when the text does not parse.
+static bool parseSize(const std::string &text, int &width, int &height) {
+    const size_t x = text.find_first_of("xX");
+    if (x == std::string::npos) {
+        return false;
+    }
+    width = std::atoi(text.substr(0, x).c_str());
+    height = std::atoi(text.substr(x + 1).c_str());
+    return width > 0 && height > 0;
+}
+
+static AovSet parseAovs(const std::string &list) {
+    AovSet aovs;
+    size_t start = 0;
+    while (start < list.size()) {
+        size_t end = list.find(',', start);
+        if (end == std::string::npos) {
+            end = list.size();
+        }
+        if (end > start) {
+            aovs.add(aov_channel(list.substr(start, end - start)));
+        }
+        start = end + 1;
+    }
+    return aovs;
+}
+
+int main(int argc, char *argv[]) {
+    TiledRenderSettings settings;
+    settings.width = 1920;
+    settings.height = 1080;
+    settings.memory_budget = size_t{512} << 20;
+    PathTracerSettings pathSettings;
+    pathSettings.max_depth = 10;
+    ExportOptions exportOptions;
+    std::string output;
+    std::string tiledOutput;
+    std::string listenAddress;
+    std::string workerAddress;
+    int spawnCount = 0;
+    int threads = 0;
+    uint64_t sceneSeed = 1;
+    bool guide = false;
+    bool denoise = false;
+    std::string environment;
+    LightSelection lightSelection = LightSelection::Uniform;
+
+    try {
+        for (int i = 1; i < argc; ++i) {
+            const std::string flag = argv[i];
+            if (flag == "--help" || flag == "-h") {
+                printUsage();
+                return 0;
+            }
+            if (flag == "--srgb") {
+                exportOptions.display.transfer = DisplayTransfer::Srgb;
+                continue;
+            }
+            if (flag == "--guide") {
+                guide = true;
+                continue;
+            }
+            if (flag == "--denoise") {
+                denoise = true;
+                continue;
+            }
+            if (i + 1 >= argc) {
+                throw std::invalid_argument("Missing value for " + flag);
+            }
+            const std::string value = argv[++i];
+            if (flag == "--output") {
+                output = value;
+            } else if (flag == "--size") {
+                if (!parseSize(value, settings.width, settings.height)) {
+                    throw std::invalid_argument("Invalid size: " + value);
+                }
+            } else if (flag == "--samples") {
+                settings.samples = std::max(1, std::atoi(value.c_str()));
+            } else if (flag == "--depth") {
+                pathSettings.max_depth = std::max(1, std::atoi(value.c_str()));
+            } else if (flag == "--tile") {
+                settings.tile_size = std::max(8, std::atoi(value.c_str()));
+            } else if (flag == "--aovs") {
+                settings.aovs = parseAovs(value);
+            } else if (flag == "--exr-compression") {
+                if (value != "zip" && value != "none") {
+                    throw std::invalid_argument("Unknown EXR compression: " + value);
+                }
+                exportOptions.exr_compression = value == "zip" ? ExrCompression::Zip : ExrCompression::None;
+            } else if (flag == "--tonemap") {
+                exportOptions.display.tonemap = tonemap_from_name(value);
+            } else if (flag == "--exposure") {
+                exportOptions.display.exposure = static_cast<float>(std::atof(value.c_str()));
+            } else if (flag == "--memory-budget") {
+                settings.memory_budget = static_cast<size_t>(std::max(1, std::atoi(value.c_str()))) << 20;
+            } else if (flag == "--tiled-output") {
+                tiledOutput = value;
+            } else if (flag == "--seed") {
+                settings.seed = std::strtoull(value.c_str(), nullptr, 10);
+            } else if (flag == "--scene-seed") {
+                sceneSeed = std::strtoull(value.c_str(), nullptr, 10);
+            } else if (flag == "--environment") {
+                environment = value;
+            } else if (flag == "--lights") {
+                lightSelection = light_selection(value);
+            } else if (flag == "--listen") {
+                listenAddress = value;
+            } else if (flag == "--spawn-workers") {
+                spawnCount = std::max(0, std::atoi(value.c_str()));
+            } else if (flag == "--worker") {
+                workerAddress = value;
+            } else if (flag == "--threads") {
+                threads = std::max(0, std::atoi(value.c_str()));
+            } else {
+                throw std::invalid_argument("Unknown option: " + flag);
+            }
+        }
+        if (!workerAddress.empty()) {
+            distributed_detail::parse_address(workerAddress);
+        } else {
+            if (output.empty()) {
+                throw std::invalid_argument("--output is required");
+            }
+            image_format(output);
+            if (spawnCount > 0 && listenAddress.empty()) {
+                throw std::invalid_argument("--spawn-workers needs --listen");
+            }
+            if (guide && !listenAddress.empty()) {
+                throw std::invalid_argument("--guide is not supported with --listen");
+            }
+        }
+    } catch (const std::exception &error) {
+        std::fprintf(stderr, "%s\n\n", error.what());
+        printUsage();
+        return 2;
+    }
+
+    if (!workerAddress.empty()) {
+        try {
+            WorkerOptions options;
+            options.threads = threads;
+            const size_t tiles = run_render_worker(workerAddress, loadScene, options);
+            std::printf("Traced %zu tiles for %s\n", tiles, workerAddress.c_str());
+        } catch (const std::exception &error) {
+            std::fprintf(stderr, "%s\n", error.what());
+            return 1;
+        }
+        return 0;
+    }
+
+    try {
+        // With --denoise the tiles also carry the denoiser's guides and are
+        // gathered into the whole frame; the export gets the denoised frame
+        // with the requested channels once every tile is in.
+        const AovSet outputAovs = settings.aovs;
+        std::unique_ptr<TiledFrameDenoiser> denoiser;
+        if (denoise) {
+            settings.aovs = TiledFrameDenoiser::with_denoise_guides(settings.aovs);
+            denoiser = std::make_unique<TiledFrameDenoiser>(settings.width, settings.height, settings.tile_size,
+                                                            settings.aovs);
+        }
+        ImageExporter exporter(output, settings.width, settings.height, outputAovs, exportOptions);
+        const size_t tileArea = static_cast<size_t>(settings.tile_size) * settings.tile_size;
+        const auto submit = [&](int x0, int y0, int x1, int y1, const float *planes) {
+            if (denoiser) {
+                denoiser->add_tile(x0, y0, x1, y1, planes);
+            } else {
+                exporter.submit(x0, y0, x1, y1, planes, static_cast<size_t>(settings.tile_size), tileArea);
+            }
+        };
+        const auto start = std::chrono::steady_clock::now();
+        if (listenAddress.empty()) {
+            seed_thread_rng(sceneSeed);
+            const HitableList objects = loadScene("random");
+            const Scene world(objects);
+            const std::unique_ptr<LightSampler> lights = make_light_sampler(objects, lightSelection);
+            const AovIds aovIds = settings.aovs.empty() ? AovIds() : AovIds(objects);
+            if (!environment.empty()) {
+                pathSettings.environment = std::make_shared<EnvironmentMap>(load_hdr_image(environment));
+            }
+            if (guide) {
+                AABB bounds;
+                objects.bounding_box(bounds);
+                pathSettings.guide = std::make_shared<SDTree>(bounds);
+                const int iterations = train_guide(world, *lights, CameraParams(), pathSettings, settings);
+                const double trainMs =
+                    std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                std::printf("Trained the path guide in %d iterations, %.0f ms (%.1f MiB)\n", iterations, trainMs,
+                            pathSettings.guide->memory_bytes() / 1048576.0);
+            }
+            const TiledRenderStats stats =
+                render_tiled(world, *lights, CameraParams(), pathSettings, settings, aovIds, tiledOutput, submit);
+            const double renderMs =
+                std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            std::printf("Rendered %dx%d at %d spp in %.0f ms (peak tile memory %.1f MiB)\n", settings.width,
+                        settings.height, settings.samples, renderMs, stats.peak_resident_bytes / 1048576.0);
+        } else {
+            RenderCoordinator coordinator(listenAddress);
+            DistributedJob job;
+            job.tiles = settings;
+            job.max_depth = pathSettings.max_depth;
+            job.scene = "random";
+            job.scene_seed = sceneSeed;
+            job.environment = environment;
+            job.light_selection = lightSelection;
+            std::unique_ptr<TiledImageWriter> writer;
+            if (!tiledOutput.empty()) {
+                writer = std::make_unique<TiledImageWriter>(tiledOutput, settings.width, settings.height,
+                                                            settings.tile_size, settings.aovs);
+            }
+#ifndef _WIN32
+            const int coreShare =
+                std::max(1, static_cast<int>(std::thread::hardware_concurrency()) / std::max(1, spawnCount));
+            const std::vector<pid_t> workers =
+                spawnWorkers(argv[0], coordinator.address(), spawnCount, threads > 0 ? threads : coreShare);
+#else
+            if (spawnCount > 0) {
+                throw std::runtime_error("--spawn-workers is not supported on this platform");
+            }
+#endif
+            std::printf("Waiting for workers on %s\n", coordinator.address().c_str());
+            std::fflush(stdout);
+            // on_tile runs on the coordinator's receive thread, which must not
+            // wait for the export window: the tiles that would open it can
+            // only arrive through that same thread.
+            DeferredExport deferred(exporter);
+            DistributedStats stats;
+            try {
+                stats = coordinator.render(job, [&](int x0, int y0, int x1, int y1, const float *planes) {
+                    if (denoiser) {
+                        denoiser->add_tile(x0, y0, x1, y1, planes);
+                    } else {
+                        deferred.submit(x0, y0, x1, y1, planes, static_cast<size_t>(settings.tile_size), tileArea);
+                    }
+                    if (writer) {
+                        writer->write_tile(x0 / settings.tile_size, y0 / settings.tile_size, planes);
+                    }
+                });
+            } catch (...) {
+#ifndef _WIN32
+                waitForWorkers(workers);
+#endif
+                throw;
+            }
+#ifndef _WIN32
+            waitForWorkers(workers);
+#endif
+            deferred.flush();
+            const double renderMs =
+                std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            std::printf("Rendered %dx%d at %d spp in %.0f ms on %d workers (%d lost, %zu tiles reassigned, "
+                        "%zu duplicated)\n",
+                        settings.width, settings.height, settings.samples, renderMs, stats.workers,
+                        stats.workers_lost, stats.reassigned_tiles, stats.duplicated_tiles);
+            for (size_t i = 0; i < stats.tiles_per_worker.size(); ++i) {
+                std::printf("  worker %zu: %zu tiles\n", i + 1, stats.tiles_per_worker[i]);
+            }
+            std::printf("Tile data %.1f MiB, %.1f MiB on the wire, at most %.1f MiB held for the export\n",
+                        stats.raw_bytes / 1048576.0, stats.wire_bytes / 1048576.0,
+                        deferred.peak_bytes() / 1048576.0);
+        }
+        if (denoiser) {
+            const auto denoiseStart = std::chrono::steady_clock::now();
+            const std::vector<float> frame = denoiser->finish(outputAovs);
+            const double denoiseMs =
+                std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - denoiseStart).count();
+            std::printf("Denoised in %.0f ms (frame %.1f MiB)\n", denoiseMs, denoiser->memory_bytes() / 1048576.0);
+            exporter.submit(0, 0, settings.width, settings.height, frame.data(), static_cast<size_t>(settings.width),
+                            static_cast<size_t>(settings.width) * settings.height);
+        }
+        const ExportResult result = exporter.wait();
+        std::printf("Wrote %s (%.1f MiB), finished %.0f ms after the last tile\n", output.c_str(),
+                    result.bytes / 1048576.0, result.tail_ms);
+    } catch (const std::exception &error) {
+        std::fprintf(stderr, "%s\n", error.what());
+        return 1;
+    }
+    return 0;
+}
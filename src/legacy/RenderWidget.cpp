@@ -29,9 +29,7 @@ void RenderWorker::render() {
     auto aperture = 0.1;
 
     Camera cam(lookfrom, lookat, vup, 20, aspect_ratio, aperture, dist_to_focus);
-    HitableList world_list = random_scene();
-    std::vector<std::shared_ptr<Hitable>> world_objects = world_list.objects;
-    BVHNode world(world_objects, 0, world_objects.size());
+    Scene world(random_scene());
 
     const int widthDenom = std::max(1, m_width - 1);
     const int heightDenom = std::max(1, m_height - 1);
@@ -0,0 +1,75 @@
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "bench/BenchHarness.h"
+#include "raytracer/Aov.h"
+
+namespace {
+
+constexpr int kWidth = 160;
+constexpr int kHeight = 90;
+
+const Camera& AovCamera() {
+    static const Camera cam(Point3(13, 2, 3), Point3(0, 0, 0), Vec3(0, 1, 0), 20, double(kWidth) / kHeight, 0.0, 10.0);
+    return cam;
+}
+
+// Beauty pass; with `aovs`, the same samples also fill every AOV channel.
+void Render(const Hitable& world, const LightList& lights, const AovIds& ids, int samples, AovBuffers* aovs) {
+    PathTracerSettings settings;
+    settings.max_depth = 8;
+    std::vector<Color> beauty(static_cast<size_t>(kWidth) * kHeight);
+    for (int line = 0; line < kHeight; ++line) {
+        const int j = kHeight - 1 - line;
+        for (int i = 0; i < kWidth; ++i) {
+            PixelAccumulator pixel;
+            for (int s = 0; s < samples; ++s) {
+                const Ray ray = AovCamera().get_ray((i + random_double()) / kWidth, (j + random_double()) / kHeight);
+                HitFeatures hit;
+                pixel.add(trace_path(ray, world, lights, settings, aovs ? &hit : nullptr), hit);
+            }
+            const size_t index = static_cast<size_t>(line) * kWidth + i;
+            beauty[index] = pixel.mean();
+            if (aovs) {
+                aovs->resolve(index, pixel, ids);
+            }
+        }
+    }
+}
+
+}
+
+// Cost of filling all seven AOV channels during the beauty pass, against the
+// beauty pass alone and against the one extra render per channel group that
+// compositing needed before.
+BENCH_CASE(aov_single_pass) {
+    const bool quick = bench_quick_mode();
+    const int samples = quick ? 2 : 16;
+    const HitableList objects = random_scene();
+    const Scene world(objects);
+    const LightList lights(objects);
+    const AovIds ids(objects);
+
+    const double beauty_ms = best_time_ms(quick ? 1 : 3, [&] { Render(world, lights, ids, samples, nullptr); });
+    AovBuffers aovs(kWidth, kHeight, AovSet::all());
+    const double aov_ms = best_time_ms(quick ? 1 : 3, [&] { Render(world, lights, ids, samples, &aovs); });
+
+    const std::string prefix = "aov_bench";
+    std::vector<std::string> paths;
+    const double export_ms = best_time_ms(quick ? 1 : 3, [&] { paths = export_aovs(aovs, prefix); });
+    for (const std::string& path : paths) {
+        std::remove(path.c_str());
+    }
+
+    bench_report("aov_single_pass", "beauty only", beauty_ms, "ms");
+    bench_report("aov_single_pass", "beauty + 7 AOVs", aov_ms, "ms");
+    bench_report("aov_single_pass", "AOV overhead", 100.0 * (aov_ms / beauty_ms - 1.0), "%");
+    // Before, depth, normal, albedo and the IDs each took a re-render.
+    bench_report("aov_single_pass", "speed-up vs 1 + 4 renders", 5.0 * beauty_ms / aov_ms, "x");
+    bench_report("aov_single_pass", "export (7 PFMs)", export_ms, "ms");
+    bench_report("aov_single_pass", "AOV memory", static_cast<double>(aovs.size()) * 11 * sizeof(float) / 1048576.0,
+                 "MiB");
+}
@@ -0,0 +1,64 @@
+#ifndef BENCH_HARNESS_H
+#define BENCH_HARNESS_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Minimal benchmark registry. Each case prints its own result lines so that
+// cases can report domain metrics (node visits, Mrays/s, RMSE) next to timings.
+
+struct BenchCase {
+    std::string name;
+    std::function<void()> run;
+};
+
+inline std::vector<BenchCase>& bench_registry() {
+    static std::vector<BenchCase> cases;
+    return cases;
+}
+
+struct BenchRegistrar {
+    BenchRegistrar(const char* name, void (*fn)()) {
+        bench_registry().push_back(BenchCase{name, fn});
+    }
+};
+
+#define BENCH_CASE(name)                                         \
+    static void name();                                          \
+    static const BenchRegistrar name##_registrar(#name, &name); \
+    static void name()
+
+// When set (via --quick) cases should shrink their problem sizes so the whole
+// suite finishes in seconds; used to smoke-test the benchmarks themselves.
+inline bool& bench_quick_mode() {
+    static bool quick = false;
+    return quick;
+}
+
+inline double elapsed_ms(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Runs `fn` `repeats` times and returns the fastest wall time in milliseconds.
+template <typename Fn>
+double best_time_ms(int repeats, Fn&& fn) {
+    double best = 1e300;
+    for (int i = 0; i < std::max(1, repeats); ++i) {
+        const auto start = std::chrono::steady_clock::now();
+        fn();
+        best = std::min(best, elapsed_ms(start));
+    }
+    return best;
+}
+
+inline void bench_report(const std::string& case_name, const std::string& metric, double value,
+                         const char* unit) {
+    std::printf("%-28s %-36s %14.4f %s\n", case_name.c_str(), metric.c_str(), value, unit);
+    std::fflush(stdout);
+}
+
+#endif // BENCH_HARNESS_H
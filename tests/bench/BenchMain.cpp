@@ -0,0 +1,44 @@
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "bench/BenchHarness.h"
+
+// Usage: raytracer_bench [--quick] [--list] [filter...]
+// A case runs when its name contains any of the filters (or no filter is given).
+int main(int argc, char** argv) {
+    std::vector<std::string> filters;
+    bool list_only = false;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--quick") == 0) {
+            bench_quick_mode() = true;
+        } else if (std::strcmp(argv[i], "--list") == 0) {
+            list_only = true;
+        } else {
+            filters.emplace_back(argv[i]);
+        }
+    }
+
+    int ran = 0;
+    for (const BenchCase& bench : bench_registry()) {
+        bool selected = filters.empty();
+        for (const std::string& filter : filters) {
+            selected = selected || bench.name.find(filter) != std::string::npos;
+        }
+        if (!selected) {
+            continue;
+        }
+        if (list_only) {
+            std::printf("%s\n", bench.name.c_str());
+            continue;
+        }
+        bench.run();
+        ++ran;
+    }
+
+    if (!list_only && ran == 0) {
+        std::fprintf(stderr, "No benchmark matched.\n");
+        return 1;
+    }
+    return 0;
+}
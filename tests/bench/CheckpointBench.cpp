@@ -0,0 +1,75 @@
+#include <cstdio>
+#include <string>
+
+#include "bench/BenchHarness.h"
+#include "raytracer/Checkpoint.h"
+
+// Cost of checkpointing every pass of a progressive render: pass time with
+// and without a checkpoint offered after each pass, the snapshot copy that
+// runs on the render thread, and the background write of one checkpoint.
+BENCH_CASE(checkpoint_async) {
+    const bool quick = bench_quick_mode();
+    const int width = quick ? 160 : 400;
+    const int height = quick ? 90 : 225;
+    const int passes = quick ? 3 : 8;
+    const HitableList objects = random_scene();
+    const Scene world(objects);
+    const LightList lights(objects);
+    PathTracerSettings settings;
+    settings.max_depth = 10;
+    const auto ignore = [](int, int, int, int) {};
+
+    ProgressiveRenderer renderer(world, lights, width, height, settings);
+    const double plain_ms = best_time_ms(1, [&] {
+        renderer.restart();
+        for (int pass = 0; pass < passes; ++pass) {
+            renderer.render_pass(ignore);
+        }
+    });
+
+    CheckpointSettings checkpoint;
+    checkpoint.width = width;
+    checkpoint.height = height;
+    checkpoint.max_depth = settings.max_depth;
+    checkpoint.samples = passes;
+    checkpoint.sample_seed = renderer.seed();
+    const std::string path = "checkpoint_bench.rtck";
+    double submit_ms = 0.0;
+    int submitted = 0;
+    double checkpointed_ms = 0.0;
+    {
+        CheckpointWriter writer(path, checkpoint, objects);
+        checkpointed_ms = best_time_ms(1, [&] {
+            renderer.restart();
+            for (int pass = 0; pass < passes; ++pass) {
+                renderer.render_pass(ignore);
+                const auto start = std::chrono::steady_clock::now();
+                if (writer.submit(renderer)) {
+                    submit_ms += elapsed_ms(start);
+                    ++submitted;
+                }
+            }
+        });
+        writer.wait();
+    }
+
+    // One write on its own, through a fresh writer on the same file.
+    double write_ms = 0.0;
+    {
+        CheckpointWriter writer(path, checkpoint, objects);
+        write_ms = best_time_ms(quick ? 1 : 3, [&] {
+            writer.submit(renderer);
+            writer.wait();
+        });
+    }
+    std::remove(path.c_str());
+
+    bench_report("checkpoint_async", "passes, no checkpoints", plain_ms, "ms");
+    bench_report("checkpoint_async", "passes, checkpoint per pass", checkpointed_ms, "ms");
+    bench_report("checkpoint_async", "render overhead", 100.0 * (checkpointed_ms / plain_ms - 1.0), "%");
+    bench_report("checkpoint_async", "snapshot on render thread", submitted > 0 ? submit_ms / submitted : 0.0, "ms");
+    bench_report("checkpoint_async", "checkpoints written", submitted, "");
+    bench_report("checkpoint_async", "write + flush (background)", write_ms, "ms");
+    bench_report("checkpoint_async", "file size",
+                 static_cast<double>(256 + 2 * (256 + static_cast<size_t>(width) * height * 112)) / 1048576.0, "MiB");
+}
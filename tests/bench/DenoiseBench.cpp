@@ -0,0 +1,97 @@
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "bench/BenchHarness.h"
+#include "raytracer/Denoiser.h"
+
+namespace {
+
+constexpr int kWidth = 96;
+constexpr int kHeight = 64;
+
+// A diffuse, a glass and a metal ball behind a row of small spheres of
+// alternating albedo, under a large sphere light and the sky gradient.
+HitableList DenoiseScene() {
+    HitableList world;
+    world.add(std::make_shared<Plane>(Point3(0, 0, 0), Vec3(0, 1, 0), std::make_shared<Lambertian>(Color(0.5, 0.5, 0.5))));
+    world.add(std::make_shared<Sphere>(Point3(-2.2, 1, 0), 1.0, std::make_shared<Lambertian>(Color(0.7, 0.3, 0.2))));
+    world.add(std::make_shared<Sphere>(Point3(0, 1, 0), 1.0, std::make_shared<Dielectric>(1.5)));
+    world.add(std::make_shared<Sphere>(Point3(2.2, 1, 0), 1.0, std::make_shared<Metal>(Color(0.8, 0.8, 0.7), 0.2)));
+    for (int i = 0; i < 9; ++i) {
+        const Color albedo = i % 2 ? Color(0.9, 0.9, 0.9) : Color(0.1, 0.2, 0.5);
+        world.add(std::make_shared<Sphere>(Point3(-4.0 + i, 0.3, 2.0), 0.3, std::make_shared<Lambertian>(albedo)));
+    }
+    world.add(std::make_shared<Sphere>(Point3(0, 6, 3), 2.0, std::make_shared<DiffuseLight>(Color(2, 2, 2))));
+    return world;
+}
+
+struct Frame {
+    std::vector<Color> color;
+    DenoiseFeatures features;
+};
+
+Frame Render(const Hitable& world, const LightList& lights, int samples) {
+    const Camera cam(Point3(0, 2.5, 9), Point3(0, 0.8, 0), Vec3(0, 1, 0), 40, double(kWidth) / kHeight, 0.0, 9.0);
+    PathTracerSettings settings;
+    settings.max_depth = 8;
+    Frame frame{std::vector<Color>(kWidth * kHeight), DenoiseFeatures(kWidth, kHeight)};
+    for (int j = 0; j < kHeight; ++j) {
+        for (int i = 0; i < kWidth; ++i) {
+            PixelAccumulator pixel;
+            for (int s = 0; s < samples; ++s) {
+                const Ray ray = cam.get_ray((i + random_double()) / kWidth, (j + random_double()) / kHeight);
+                HitFeatures hit;
+                const Color radiance = trace_path(ray, world, lights, settings, &hit);
+                pixel.add(radiance, hit);
+            }
+            const size_t index = static_cast<size_t>(j) * kWidth + i;
+            frame.color[index] = pixel.mean();
+            pixel.resolve(frame.features, index);
+        }
+    }
+    return frame;
+}
+
+// Relative MSE, the usual denoising metric: squared error over the squared
+// reference value, so dark and bright regions count alike.
+double RelativeMse(const std::vector<Color>& image, const std::vector<Color>& reference) {
+    double sum = 0.0;
+    for (size_t i = 0; i < image.size(); ++i) {
+        for (int c = 0; c < 3; ++c) {
+            const double d = image[i][c] - reference[i][c];
+            sum += d * d / (reference[i][c] * reference[i][c] + 0.01) / 3.0;
+        }
+    }
+    return sum / image.size();
+}
+
+}
+
+// Noisy vs denoised error at 4, 16 and 64 spp against a converged render, and
+// the filter's cost.
+BENCH_CASE(denoise) {
+    const bool quick = bench_quick_mode();
+    const HitableList objects = DenoiseScene();
+    const Scene world(objects);
+    const LightList lights(objects);
+    const Frame reference = Render(world, lights, quick ? 128 : 2048);
+
+    for (int samples : {4, 16, 64}) {
+        const std::string metric = std::to_string(samples) + " spp ";
+        const Frame frame = Render(world, lights, samples);
+        std::vector<Color> filtered;
+        const double ms = best_time_ms(3, [&] { filtered = denoise(frame.color, frame.features); });
+        const double noisy_error = RelativeMse(frame.color, reference.color);
+        const double filtered_error = RelativeMse(filtered, reference.color);
+        bench_report("denoise", metric + "noisy relMSE", noisy_error, "");
+        bench_report("denoise", metric + "denoised relMSE", filtered_error, "");
+        // Without the filter the error falls as 1/spp.
+        bench_report("denoise", metric + "equal-error spp without filter", samples * noisy_error / filtered_error,
+                     "spp");
+        bench_report("denoise", metric + "denoise time", ms, "ms");
+    }
+    bench_report("denoise", "threads", ThreadPool::global().size(), "");
+}
@@ -0,0 +1,85 @@
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench/BenchHarness.h"
+#include "raytracer/Distributed.h"
+
+// Distributed tiles: the app's default scene at 1 spp with all AOVs traced
+// by two in-process workers over a Unix socket, against render_tiled() on
+// the same threads, plus the size and speed of the tile packing on the
+// tiles of that frame.
+BENCH_CASE(distributed_tiles) {
+#ifndef _WIN32
+    const bool quick = bench_quick_mode();
+    DistributedJob job;
+    job.tiles.width = quick ? 320 : 960;
+    job.tiles.height = quick ? 180 : 540;
+    job.tiles.samples = 1;
+    job.tiles.aovs = AovSet::all();
+    job.scene = "random";
+    job.scene_seed = 1;
+    const auto load_scene = [](const std::string&) { return random_scene(); };
+
+    seed_thread_rng(job.scene_seed);
+    const HitableList objects = random_scene();
+    const Scene world(objects);
+    const LightList lights(objects);
+    const AovIds ids(objects);
+    PathTracerSettings path_settings;
+    path_settings.max_depth = job.max_depth;
+    std::vector<std::vector<float>> tiles;
+    const size_t floats = tiled_detail::tile_floats(job.tiles.tile_size, tiled_planes(job.tiles.aovs));
+    const double local_ms = best_time_ms(1, [&] {
+        tiles.clear();
+        render_tiled(world, lights, job.view, path_settings, job.tiles, ids, "",
+                     [&](int, int, int, int, const float* data) { tiles.emplace_back(data, data + floats); });
+    });
+
+    const int threads = std::max(2u, std::thread::hardware_concurrency());
+    DistributedStats stats;
+    const std::string socket_path = "distributed_bench.sock";
+    const double distributed_ms = best_time_ms(1, [&] {
+        RenderCoordinator coordinator("unix:" + socket_path);
+        std::vector<std::thread> workers;
+        for (int i = 0; i < 2; ++i) {
+            workers.emplace_back([&] {
+                WorkerOptions options;
+                options.threads = threads / 2;
+                run_render_worker(coordinator.address(), load_scene, options);
+            });
+        }
+        stats = coordinator.render(job, [](int, int, int, int, const float*) {});
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+    });
+
+    std::vector<std::vector<unsigned char>> packed(tiles.size());
+    size_t packed_bytes = 0;
+    const double pack_ms = best_time_ms(3, [&] {
+        packed_bytes = 0;
+        for (size_t i = 0; i < tiles.size(); ++i) {
+            packed[i].clear();
+            distributed_detail::pack_floats(tiles[i].data(), tiles[i].size(), packed[i]);
+            packed_bytes += packed[i].size();
+        }
+    });
+    std::vector<float> unpacked(floats);
+    const double unpack_ms = best_time_ms(3, [&] {
+        for (const std::vector<unsigned char>& tile : packed) {
+            distributed_detail::unpack_floats(tile.data(), tile.size(), unpacked.data(), unpacked.size());
+        }
+    });
+    const double raw_mib = tiles.size() * floats * sizeof(float) / 1048576.0;
+
+    bench_report("distributed_tiles", "render_tiled", local_ms, "ms");
+    bench_report("distributed_tiles", "coordinator + 2 workers", distributed_ms, "ms");
+    bench_report("distributed_tiles", "tiles duplicated at the end", static_cast<double>(stats.duplicated_tiles), "");
+    bench_report("distributed_tiles", "wire / raw", static_cast<double>(stats.wire_bytes) / stats.raw_bytes, "x");
+    bench_report("distributed_tiles", "packed / raw, all tiles", packed_bytes / (raw_mib * 1048576.0), "x");
+    bench_report("distributed_tiles", "pack", raw_mib / (pack_ms / 1000.0), "MiB/s");
+    bench_report("distributed_tiles", "unpack", raw_mib / (unpack_ms / 1000.0), "MiB/s");
+#endif
+}
@@ -0,0 +1,136 @@
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include "bench/BenchHarness.h"
+#include "raytracer/Integrator.h"
+
+namespace {
+
+constexpr int kWidth = 64;
+constexpr int kHeight = 48;
+
+// Blue sky over a dark horizon with a sun about 1.5 degrees across, 40
+// degrees above the horizon.
+HdrImage SunSky(int width, int height) {
+    HdrImage image;
+    image.width = width;
+    image.height = height;
+    image.pixels.resize(static_cast<size_t>(width) * height);
+    const Vec3 sun = EnvironmentMap::direction_of(0.3, 50.0 / 180.0);
+    const double sun_cos = std::cos(degrees_to_radians(0.75));
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            const Vec3 d = EnvironmentMap::direction_of((x + 0.5) / width, (y + 0.5) / height);
+            Color c = d.y() > 0.0 ? Color(0.3, 0.5, 1.0) * (0.4 + 0.6 * d.y()) : Color(0.1, 0.1, 0.1);
+            if (dot(d, sun) > sun_cos) {
+                c = Color(50000, 45000, 40000);
+            }
+            image.pixels[static_cast<size_t>(y) * width + x] = c;
+        }
+    }
+    return image;
+}
+
+struct Image {
+    std::vector<Color> sum = std::vector<Color>(kWidth * kHeight, Color(0, 0, 0));
+    int samples = 0;
+
+    Color pixel(size_t index) const { return sum[index] / std::max(1, samples); }
+};
+
+void Render(Image& image, const Hitable& world, const LightList& lights, const PathTracerSettings& settings,
+            double budget_ms) {
+    const Camera cam(Point3(0, 2, 8), Point3(0, 0.5, 0), Vec3(0, 1, 0), 40, double(kWidth) / kHeight, 0.0, 10.0);
+    const auto start = std::chrono::steady_clock::now();
+    while (elapsed_ms(start) < budget_ms) {
+        for (int j = 0; j < kHeight; ++j) {
+            for (int i = 0; i < kWidth; ++i) {
+                const Ray ray = cam.get_ray((i + random_double()) / kWidth, (j + random_double()) / kHeight);
+                image.sum[static_cast<size_t>(j) * kWidth + i] += trace_path(ray, world, lights, settings);
+            }
+        }
+        ++image.samples;
+    }
+}
+
+// Error after the exposure the scene is displayed with, clamped as on screen.
+double Rmse(const Image& image, const Image& reference, double exposure) {
+    double sum = 0.0;
+    for (size_t i = 0; i < image.sum.size(); ++i) {
+        const Color a = image.pixel(i);
+        const Color b = reference.pixel(i);
+        for (int c = 0; c < 3; ++c) {
+            const double d = clamp(exposure * a[c], 0.0, 1.0) - clamp(exposure * b[c], 0.0, 1.0);
+            sum += d * d / 3.0;
+        }
+    }
+    return std::sqrt(sum / image.sum.size());
+}
+
+}
+
+// Outdoor scene lit by a sun in an HDR map: BSDF sampling vs environment
+// importance sampling at equal time, plus lookup cost and storage.
+BENCH_CASE(environment_sun) {
+    const bool quick = bench_quick_mode();
+    const HdrImage sky = SunSky(1024, 512);
+    const auto full = std::make_shared<EnvironmentMap>(sky, TexelFormat::Float32);
+    const auto half = std::make_shared<EnvironmentMap>(sky, TexelFormat::Float16);
+    bench_report("environment_sun", "float32 map + tables", full->memory_bytes() / 1048576.0, "MiB");
+    bench_report("environment_sun", "float16 map + tables", half->memory_bytes() / 1048576.0, "MiB");
+
+    const int lookups = quick ? 100000 : 2000000;
+    double pdf_sum = 0.0;
+    const double sample_ms = best_time_ms(3, [&] {
+        pdf_sum = 0.0;
+        for (int i = 0; i < lookups; ++i) {
+            double pdf = 0.0;
+            half->sample(pdf);
+            pdf_sum += pdf;
+        }
+    });
+    double radiance_sum = 0.0;
+    const double eval_ms = best_time_ms(3, [&] {
+        radiance_sum = 0.0;
+        for (int i = 0; i < lookups; ++i) {
+            radiance_sum += half->eval(EnvironmentMap::direction_of(random_double(), random_double())).y();
+        }
+    });
+    bench_report("environment_sun", "sample() time", 1e6 * sample_ms / lookups, "ns");
+    bench_report("environment_sun", "eval() time (incl. direction)", 1e6 * eval_ms / lookups, "ns");
+    bench_report("environment_sun", "mean pdf of samples", pdf_sum / lookups, "1/sr");
+    bench_report("environment_sun", "mean radiance over (u, v)", radiance_sum / lookups, "");
+
+    HitableList objects;
+    objects.add(std::make_shared<Plane>(Point3(0, 0, 0), Vec3(0, 1, 0), std::make_shared<Lambertian>(Color(0.5, 0.5, 0.5))));
+    objects.add(std::make_shared<Sphere>(Point3(-1.2, 1, 0), 1.0, std::make_shared<Lambertian>(Color(0.7, 0.3, 0.3))));
+    objects.add(std::make_shared<Sphere>(Point3(1.2, 1, 0), 1.0, std::make_shared<Metal>(Color(0.8, 0.8, 0.8), 0.3)));
+    const Scene world(objects);
+    const LightList lights(objects);
+
+    PathTracerSettings settings;
+    settings.max_depth = 6;
+    settings.environment = half;
+    // Sunlit diffuse surfaces come out around 3; map that to display white.
+    const double exposure = 1.0 / 3.0;
+
+    const double budget_ms = quick ? 200.0 : 2000.0;
+    Image reference;
+    Render(reference, world, lights, settings, 15.0 * budget_ms);
+    Image sampled;
+    Render(sampled, world, lights, settings, budget_ms);
+    settings.sample_lights = false;
+    Image bsdf;
+    Render(bsdf, world, lights, settings, budget_ms);
+
+    const double bsdf_rmse = Rmse(bsdf, reference, exposure);
+    const double sampled_rmse = Rmse(sampled, reference, exposure);
+    bench_report("environment_sun", "BSDF sampling spp", bsdf.samples, "spp");
+    bench_report("environment_sun", "environment sampling spp", sampled.samples, "spp");
+    bench_report("environment_sun", "BSDF sampling RMSE", bsdf_rmse, "");
+    bench_report("environment_sun", "environment sampling RMSE", sampled_rmse, "");
+    bench_report("environment_sun", "equal-noise sample factor", (bsdf_rmse / sampled_rmse) * (bsdf_rmse / sampled_rmse),
+                 "x");
+}
@@ -0,0 +1,82 @@
+#include <cstdio>
+#include <string>
+
+#include "bench/BenchHarness.h"
+#include "raytracer/ImageExport.h"
+#include "raytracer/TiledImage.h"
+
+// Image export: how long after the last tile the file is done when tiles
+// stream into the exporter during the render, against encoding the finished
+// frame afterwards (the naive path), for PNG and ZIP EXR with all AOVs.
+// Uses the app's default scene at 1 spp.
+BENCH_CASE(image_export) {
+    const bool quick = bench_quick_mode();
+    TiledRenderSettings settings;
+    settings.width = quick ? 320 : 1200;
+    settings.height = quick ? 180 : 675;
+    settings.samples = 1;
+    settings.aovs = AovSet::all();
+    const HitableList objects = random_scene();
+    const Scene world(objects);
+    const LightList lights(objects);
+    const AovIds ids(objects);
+    PathTracerSettings path_settings;
+    path_settings.max_depth = 10;
+    const int planes = tiled_planes(settings.aovs);
+    const size_t tile = static_cast<size_t>(settings.tile_size);
+    const size_t pixels = static_cast<size_t>(settings.width) * settings.height;
+
+    struct Output {
+        const char* path;
+        const char* name;
+        double raw_pixel_bytes;  // before compression
+    };
+    const Output outputs[] = {{"export_bench.png", "image_export png", 3.0},
+                              {"export_bench.exr", "image_export exr", 4.0 * planes}};
+    for (const Output& output : outputs) {
+        const char* path = output.path;
+        const std::string name = output.name;
+
+        ExportResult streamed;
+        const double streamed_ms = best_time_ms(1, [&] {
+            ImageExporter exporter(path, settings.width, settings.height, settings.aovs);
+            render_tiled(world, lights, CameraParams(), path_settings, settings, ids, "",
+                         [&](int x0, int y0, int x1, int y1, const float* data) {
+                             exporter.submit(x0, y0, x1, y1, data, tile, tile * tile);
+                         });
+            streamed = exporter.wait();
+        });
+
+        // The whole frame first, then one submit and the encode.
+        std::vector<float> frame(pixels * planes);
+        double render_ms = 0.0;
+        double encode_ms = 0.0;
+        const double synchronous_ms = best_time_ms(1, [&] {
+            const auto start = std::chrono::steady_clock::now();
+            render_tiled(world, lights, CameraParams(), path_settings, settings, ids, "",
+                         [&](int x0, int y0, int x1, int y1, const float* data) {
+                             for (int p = 0; p < planes; ++p) {
+                                 for (int y = y0; y < y1; ++y) {
+                                     const float* row = data + p * tile * tile + (y - y0) * tile;
+                                     std::copy(row, row + (x1 - x0), frame.data() + p * pixels + y * settings.width + x0);
+                                 }
+                             }
+                         });
+            render_ms = elapsed_ms(start);
+            const auto encode_start = std::chrono::steady_clock::now();
+            ImageExporter exporter(path, settings.width, settings.height, settings.aovs);
+            exporter.submit(0, 0, settings.width, settings.height, frame.data(), settings.width, pixels);
+            exporter.wait();
+            encode_ms = elapsed_ms(encode_start);
+        });
+        std::remove(path);
+
+        const double raw_bytes = pixels * output.raw_pixel_bytes;
+        bench_report(name, "render + export, streamed", streamed_ms, "ms");
+        bench_report(name, "render + export, after render", synchronous_ms, "ms");
+        bench_report(name, "file done after last tile, streamed", streamed.tail_ms, "ms");
+        bench_report(name, "file done after last tile, after render", encode_ms, "ms");
+        bench_report(name, "render alone", render_ms, "ms");
+        bench_report(name, "file size / raw", streamed.bytes / raw_bytes, "x");
+    }
+}
@@ -0,0 +1,55 @@
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "bench/BenchHarness.h"
+#include "raytracer/FilmResolve.h"
+
+// Film resolve: a 4K frame of float radiance to ARGB32, the old per-pixel
+// double sqrt/clamp packing against the lane kernel with the default look
+// and with ACES plus sRGB.
+BENCH_CASE(film_resolve) {
+    const bool quick = bench_quick_mode();
+    const size_t width = quick ? 960 : 3840;
+    const size_t height = quick ? 540 : 2160;
+    const size_t pixels = width * height;
+    std::vector<float> red(pixels);
+    std::vector<float> green(pixels);
+    std::vector<float> blue(pixels);
+    // Uniform in [0, 2): some of every frame is over white.
+    const auto value = [](uint64_t i) { return static_cast<float>(splitmix64(i) >> 40) / (1 << 23); };
+    for (size_t i = 0; i < pixels; ++i) {
+        red[i] = value(3 * i);
+        green[i] = value(3 * i + 1);
+        blue[i] = value(3 * i + 2);
+    }
+    std::vector<uint32_t> out(pixels);
+    const int runs = quick ? 2 : 5;
+    const double mpix = pixels / 1e6;
+
+    const double legacy_ms = best_time_ms(runs, [&] {
+        for (size_t i = 0; i < pixels; ++i) {
+            const int ir = static_cast<int>(256 * clamp(std::sqrt(static_cast<double>(red[i])), 0.0, 0.999));
+            const int ig = static_cast<int>(256 * clamp(std::sqrt(static_cast<double>(green[i])), 0.0, 0.999));
+            const int ib = static_cast<int>(256 * clamp(std::sqrt(static_cast<double>(blue[i])), 0.0, 0.999));
+            out[i] = (255u << 24) | (static_cast<uint32_t>(ir) << 16) | (static_cast<uint32_t>(ig) << 8) |
+                     static_cast<uint32_t>(ib);
+        }
+    });
+
+    const double kernel_ms = best_time_ms(runs, [&] {
+        resolve_argb(red.data(), green.data(), blue.data(), pixels, out.data());
+    });
+
+    DisplaySettings filmic;
+    filmic.tonemap = Tonemap::Aces;
+    filmic.transfer = DisplayTransfer::Srgb;
+    const double filmic_ms = best_time_ms(runs, [&] {
+        resolve_argb(red.data(), green.data(), blue.data(), pixels, out.data(), filmic);
+    });
+
+    bench_report("film_resolve", "legacy scalar gamma 2", mpix / (legacy_ms / 1000.0), "Mpix/s");
+    bench_report("film_resolve", "kernel gamma 2", mpix / (kernel_ms / 1000.0), "Mpix/s");
+    bench_report("film_resolve", "kernel aces + srgb", mpix / (filmic_ms / 1000.0), "Mpix/s");
+    bench_report("film_resolve", "speedup gamma 2", legacy_ms / kernel_ms, "x");
+}
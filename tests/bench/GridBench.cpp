@@ -0,0 +1,84 @@
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "bench/BenchHarness.h"
+#include "raytracer/UniformGrid.h"
+
+namespace {
+
+// Same-size spheres at random_scene() density: one 0.2-radius sphere per unit cell.
+std::vector<std::shared_ptr<Hitable>> MakeSphereField(size_t count) {
+    const auto material = std::make_shared<Lambertian>(Color(0.5, 0.5, 0.5));
+    const double half = 0.5 * std::cbrt(static_cast<double>(count));
+    std::vector<std::shared_ptr<Hitable>> objects;
+    objects.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        objects.push_back(std::make_shared<Sphere>(Point3::random(-half, half), 0.2, material));
+    }
+    return objects;
+}
+
+// Rays from a point outside the field towards random points inside it.
+std::vector<Ray> FieldRays(size_t object_count, size_t count) {
+    const double half = 0.5 * std::cbrt(static_cast<double>(object_count));
+    const Point3 eye(3.0 * half, 2.0 * half, 2.5 * half);
+    std::vector<Ray> rays;
+    rays.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        rays.emplace_back(eye, Point3::random(-half, half) - eye);
+    }
+    return rays;
+}
+
+void Report(const std::string& name, const std::string& label, double build_ms, const Hitable& accel,
+            const std::vector<Ray>& rays) {
+    HitRecord rec;
+    const double ms = best_time_ms(bench_quick_mode() ? 1 : 3, [&]() {
+        for (const Ray& ray : rays) {
+            accel.hit(ray, 0.001, infinity, rec);
+        }
+    });
+    bench_report(name, label + " build", build_ms, "ms");
+    bench_report(name, label + " rays", static_cast<double>(rays.size()) / (ms * 1e-3) / 1e6, "Mrays/s");
+}
+
+void Run(size_t count) {
+    const std::string name = "grid_vs_bvh_" + std::to_string(count);
+    auto objects = MakeSphereField(count);
+    const auto rays = FieldRays(count, bench_quick_mode() ? 5000 : 50000);
+
+    auto start = std::chrono::steady_clock::now();
+    const UniformGrid grid(objects);
+    Report(name, "UniformGrid", elapsed_ms(start), grid, rays);
+    const auto& res = grid.resolution();
+    bench_report(name, "UniformGrid cells", static_cast<double>(res[0]) * res[1] * res[2], "cells");
+    bench_report(name, "UniformGrid refs/primitive",
+                 static_cast<double>(grid.reference_count()) / static_cast<double>(count), "refs");
+
+    start = std::chrono::steady_clock::now();
+    const LinearBVH linear(objects, BVHBuildMethod::SAH);
+    Report(name, "LinearBVH (SAH)", elapsed_ms(start), linear, rays);
+
+    start = std::chrono::steady_clock::now();
+    const BVHNode tree(objects, 0, objects.size());
+    Report(name, "BVHNode", elapsed_ms(start), tree, rays);
+}
+
+}
+
+BENCH_CASE(grid_vs_bvh) {
+    const size_t quick_sizes[] = {500, 50000};
+    const size_t full_sizes[] = {500, 5000, 50000, 500000, 5000000};
+    if (bench_quick_mode()) {
+        for (size_t count : quick_sizes) {
+            Run(count);
+        }
+        return;
+    }
+    for (size_t count : full_sizes) {
+        Run(count);
+    }
+}
@@ -0,0 +1,129 @@
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include "bench/BenchHarness.h"
+#include "raytracer/Integrator.h"
+
+namespace {
+
+constexpr int kWidth = 48;
+constexpr int kHeight = 36;
+
+// Grey floor with a glass ball under a small lamp. The bright caustic below
+// the ball is reachable only through two refractions, which next-event
+// estimation cannot connect, so unguided paths find it by chance.
+HitableList CausticScene() {
+    HitableList world;
+    world.add(std::make_shared<Plane>(Point3(0, 0, 0), Vec3(0, 1, 0), std::make_shared<Lambertian>(Color(0.7, 0.7, 0.7))));
+    world.add(std::make_shared<Sphere>(Point3(0, 1, 0), 1.0, std::make_shared<Dielectric>(1.5)));
+    world.add(std::make_shared<Sphere>(Point3(1, 5, 0), 0.1, std::make_shared<DiffuseLight>(Color(2000, 2000, 2000))));
+    return world;
+}
+
+// Per-pixel luminance moments; both estimators are unbiased, so the variance
+// of the pixel means is their expected squared error and no reference image
+// is needed.
+struct Image {
+    std::vector<double> sum = std::vector<double>(kWidth * kHeight, 0.0);
+    std::vector<double> sum_squares = std::vector<double>(kWidth * kHeight, 0.0);
+    int samples = 0;
+
+    double rmse() const {
+        double total = 0.0;
+        for (size_t i = 0; i < sum.size(); ++i) {
+            const double mean = sum[i] / samples;
+            total += (sum_squares[i] / samples - mean * mean) / samples;
+        }
+        return std::sqrt(total / sum.size());
+    }
+};
+
+const Camera& RoomCamera() {
+    static const Camera cam(Point3(-3, 4, 5), Point3(-0.25, 0, 0), Vec3(0, 1, 0), 4, double(kWidth) / kHeight,
+                            0.0, 5.0);
+    return cam;
+}
+
+void RenderPass(Image& image, const Hitable& world, const LightList& lights, const PathTracerSettings& settings) {
+    for (int j = 0; j < kHeight; ++j) {
+        for (int i = 0; i < kWidth; ++i) {
+            const Ray ray = RoomCamera().get_ray((i + random_double()) / kWidth, (j + random_double()) / kHeight);
+            const double value = luminance(trace_path(ray, world, lights, settings));
+            const size_t index = static_cast<size_t>(j) * kWidth + i;
+            image.sum[index] += value;
+            image.sum_squares[index] += value * value;
+        }
+    }
+    ++image.samples;
+}
+
+void Render(Image& image, const Hitable& world, const LightList& lights, const PathTracerSettings& settings,
+            double budget_ms) {
+    const auto start = std::chrono::steady_clock::now();
+    while (elapsed_ms(start) < budget_ms) {
+        RenderPass(image, world, lights, settings);
+    }
+}
+
+}
+
+// Close-up of a caustic: next-event estimation alone vs NEE plus an SD-tree
+// trained in passes of doubling sample counts, at equal total time. The
+// narrow view concentrates the training paths the way a large final image
+// does.
+BENCH_CASE(path_guiding) {
+    const bool quick = bench_quick_mode();
+    HitableList objects = CausticScene();
+    const Scene world(objects);
+    const LightList lights(objects);
+    PathTracerSettings settings;
+    settings.max_depth = 6;
+    settings.sky = false;
+
+    const double budget_ms = quick ? 300.0 : 10000.0;
+    Image plain;
+    Render(plain, world, lights, settings, budget_ms);
+    const double plain_ms_per_pass = budget_ms / plain.samples;
+
+    // Training gets about a third of the budget: passes of 1, 2, 4, ... spp
+    // whose images are discarded, stopping before a pass would overrun it.
+    GuidingSettings guiding;
+    guiding.spatial_threshold = 500.0;
+    settings.guide = std::make_shared<SDTree>(AABB(Point3(-4, 0, -4), Point3(4, 2, 4)), guiding);
+    const auto start = std::chrono::steady_clock::now();
+    double end_pass_ms = 0.0;
+    double pass_ms = 0.0;
+    for (int spp = 1; elapsed_ms(start) + 2.0 * pass_ms < budget_ms / 3.0; spp *= 2) {
+        const auto pass_start = std::chrono::steady_clock::now();
+        Image scratch;
+        for (int s = 0; s < spp; ++s) {
+            RenderPass(scratch, world, lights, settings);
+        }
+        const auto end_start = std::chrono::steady_clock::now();
+        settings.guide->end_pass();
+        end_pass_ms += elapsed_ms(end_start);
+        pass_ms = elapsed_ms(pass_start);
+    }
+    const double training_ms = elapsed_ms(start);
+    settings.guide->set_training(false);
+    Image guided;
+    Render(guided, world, lights, settings, budget_ms - training_ms);
+    const double guided_ms_per_pass = (budget_ms - training_ms) / guided.samples;
+
+    const double plain_rmse = plain.rmse();
+    const double guided_rmse = guided.rmse();
+    bench_report("path_guiding", "training passes", settings.guide->passes(), "");
+    bench_report("path_guiding", "training time", training_ms, "ms");
+    bench_report("path_guiding", "end_pass() time (total)", end_pass_ms, "ms");
+    bench_report("path_guiding", "spatial leaves", static_cast<double>(settings.guide->spatial_leaves()), "");
+    bench_report("path_guiding", "directional nodes", static_cast<double>(settings.guide->directional_nodes()), "");
+    bench_report("path_guiding", "SD-tree memory", settings.guide->memory_bytes() / 1048576.0, "MiB");
+    bench_report("path_guiding", "guided / NEE time per sample", guided_ms_per_pass / plain_ms_per_pass, "x");
+    bench_report("path_guiding", "NEE spp", plain.samples, "spp");
+    bench_report("path_guiding", "guided spp (after training)", guided.samples, "spp");
+    bench_report("path_guiding", "NEE RMSE (luminance)", plain_rmse, "");
+    bench_report("path_guiding", "guided RMSE (luminance)", guided_rmse, "");
+    bench_report("path_guiding", "equal-time MSE ratio", (plain_rmse / guided_rmse) * (plain_rmse / guided_rmse), "x");
+}
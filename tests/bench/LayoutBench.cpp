@@ -0,0 +1,94 @@
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "bench/BenchHarness.h"
+#include "raytracer/LinearBVH.h"
+
+namespace {
+
+std::vector<std::shared_ptr<Hitable>> MakeSpheres(size_t count) {
+    const auto material = std::make_shared<Lambertian>(Color(0.5, 0.5, 0.5));
+    const double extent = std::cbrt(static_cast<double>(count));
+    std::vector<std::shared_ptr<Hitable>> objects;
+    objects.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        objects.push_back(std::make_shared<Sphere>(Point3::random(-extent, extent), 0.2, material));
+    }
+    return objects;
+}
+
+// Scanline-ordered rays from one eye point across the scene bounds, so
+// consecutive rays share the upper levels of the tree as camera rays do.
+std::vector<Ray> ScanlineRays(const LinearBVH& bvh, int side) {
+    AABB bounds;
+    bvh.bounding_box(bounds);
+    const Point3 eye = bounds.max() * 1.5;
+    std::vector<Ray> rays;
+    rays.reserve(static_cast<size_t>(side) * side);
+    for (int j = 0; j < side; ++j) {
+        for (int i = 0; i < side; ++i) {
+            const double u = (i + 0.5) / side;
+            const double v = (j + 0.5) / side;
+            const Point3 target(bounds.min().x() + u * (bounds.max().x() - bounds.min().x()),
+                                bounds.min().y() + v * (bounds.max().y() - bounds.min().y()),
+                                bounds.min().z() + 0.5 * (bounds.max().z() - bounds.min().z()));
+            rays.emplace_back(eye, target - eye);
+        }
+    }
+    return rays;
+}
+
+void Report(const std::string& name, const std::string& label, LinearBVH& bvh, BVHLayout layout,
+            const std::vector<Ray>& rays) {
+    const auto start = std::chrono::steady_clock::now();
+    bvh.set_layout(layout);
+    const double reorder_ms = elapsed_ms(start);
+
+    // A 1 MiB L2 and a 64-entry data TLB (pages modelled as 4 KiB lines).
+    CacheSimulator l2(1024 * 1024, 64, 16);
+    CacheSimulator tlb(64 * 4096, 4096, 64);
+    BVHTraversalStats l2_stats;
+    BVHTraversalStats tlb_stats;
+    l2_stats.cache = &l2;
+    tlb_stats.cache = &tlb;
+    HitRecord rec;
+    for (const Ray& ray : rays) {
+        bvh.hit(ray, 0.001, infinity, rec, l2_stats);
+        bvh.hit(ray, 0.001, infinity, rec, tlb_stats);
+    }
+
+    const double ms = best_time_ms(3, [&]() {
+        for (const Ray& ray : rays) {
+            bvh.hit(ray, 0.001, infinity, rec);
+        }
+    });
+    const double count = static_cast<double>(rays.size());
+    bench_report(name, label + " reorder", reorder_ms, "ms");
+    bench_report(name, label + " L2 misses/ray", l2_stats.cache_misses / count, "lines");
+    bench_report(name, label + " TLB misses/ray", tlb_stats.cache_misses / count, "pages");
+    bench_report(name, label + " rays", count / (ms * 1e-3) / 1e6, "Mrays/s");
+}
+
+void RunLayouts(size_t count, int side) {
+    const std::string name = "bvh_layout_" + std::to_string(count / 1000) + "k";
+    LinearBVH bvh(MakeSpheres(count), BVHBuildMethod::SAH);
+    bench_report(name, "node array", bvh.node_count() * sizeof(LinearBVHNode) / 1048576.0, "MiB");
+    const auto rays = ScanlineRays(bvh, side);
+
+    Report(name, "depth-first", bvh, BVHLayout::DepthFirst, rays);
+    Report(name, "treelet", bvh, BVHLayout::Treelet, rays);
+    Report(name, "van Emde Boas", bvh, BVHLayout::VanEmdeBoas, rays);
+}
+
+}
+
+BENCH_CASE(bvh_layout) {
+    if (bench_quick_mode()) {
+        RunLayouts(20000, 64);
+        return;
+    }
+    RunLayouts(1000000, 256);
+}
@@ -0,0 +1,82 @@
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "bench/BenchHarness.h"
+#include "raytracer/LazyBVH.h"
+
+namespace {
+
+std::vector<std::shared_ptr<Hitable>> MakeSpheres(size_t count, double half) {
+    const auto material = std::make_shared<Lambertian>(Color(0.5, 0.5, 0.5));
+    std::vector<std::shared_ptr<Hitable>> objects;
+    objects.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        objects.push_back(std::make_shared<Sphere>(Point3::random(-half, half), 0.2, material));
+    }
+    return objects;
+}
+
+// Narrow view into one corner of the field: most of the scene is never seen.
+std::vector<Ray> ViewRays(double half, int width, int height) {
+    const Camera cam(Point3(1.2 * half, 1.2 * half, 1.2 * half), Point3(0.8 * half, 0.8 * half, 0.8 * half),
+                     Vec3(0, 1, 0), 30, static_cast<double>(width) / height, 0.0, 1.0);
+    std::vector<Ray> rays;
+    rays.reserve(static_cast<size_t>(width) * height);
+    for (int j = 0; j < height; ++j) {
+        for (int i = 0; i < width; ++i) {
+            rays.push_back(cam.get_ray((i + 0.5) / width, (j + 0.5) / height));
+        }
+    }
+    return rays;
+}
+
+void Trace(const Hitable& accel, const std::vector<Ray>& rays, size_t first, size_t last) {
+    HitRecord rec;
+    for (size_t i = first; i < last; ++i) {
+        accel.hit(rays[i], 0.001, infinity, rec);
+    }
+}
+
+void Run(size_t count) {
+    const std::string name = "lazy_bvh_" + std::to_string(count / 1000) + "k";
+    const double half = 0.5 * std::cbrt(static_cast<double>(count));
+    const auto objects = MakeSpheres(count, half);
+    const auto rays = ViewRays(half, 320, 180);
+    // The first 16x16 tile of the frame.
+    const size_t first_tile = 16 * 16;
+
+    auto start = std::chrono::steady_clock::now();
+    const LinearBVH full(objects, BVHBuildMethod::SAH);
+    const double full_build_ms = elapsed_ms(start);
+    Trace(full, rays, 0, first_tile);
+    const double full_first_ms = elapsed_ms(start);
+    Trace(full, rays, first_tile, rays.size());
+    const double full_frame_ms = elapsed_ms(start);
+
+    start = std::chrono::steady_clock::now();
+    const LazyBVH lazy(objects);
+    const double lazy_build_ms = elapsed_ms(start);
+    Trace(lazy, rays, 0, first_tile);
+    const double lazy_first_ms = elapsed_ms(start);
+    const double first_fraction = lazy.built_fraction();
+    Trace(lazy, rays, first_tile, rays.size());
+    const double lazy_frame_ms = elapsed_ms(start);
+
+    bench_report(name, "LinearBVH build", full_build_ms, "ms");
+    bench_report(name, "LinearBVH time to first tile", full_first_ms, "ms");
+    bench_report(name, "LinearBVH first frame", full_frame_ms, "ms");
+    bench_report(name, "LazyBVH eager build", lazy_build_ms, "ms");
+    bench_report(name, "LazyBVH time to first tile", lazy_first_ms, "ms");
+    bench_report(name, "LazyBVH first frame", lazy_frame_ms, "ms");
+    bench_report(name, "LazyBVH built after first tile", 100.0 * first_fraction, "%");
+    bench_report(name, "LazyBVH built after frame", 100.0 * lazy.built_fraction(), "%");
+}
+
+}
+
+BENCH_CASE(lazy_bvh) {
+    Run(bench_quick_mode() ? 50000 : 1000000);
+}
@@ -0,0 +1,73 @@
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "bench/BenchHarness.h"
+#include "raytracer/LinearBVH.h"
+
+namespace {
+
+std::vector<std::shared_ptr<Hitable>> MakeSpheres(size_t count) {
+    const auto material = std::make_shared<Lambertian>(Color(0.5, 0.5, 0.5));
+    const double extent = std::cbrt(static_cast<double>(count));
+    std::vector<std::shared_ptr<Hitable>> objects;
+    objects.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        objects.push_back(std::make_shared<Sphere>(Point3::random(-extent, extent), 0.2, material));
+    }
+    return objects;
+}
+
+BVHTraversalStats TraceRays(const LinearBVH& bvh, int rays) {
+    AABB bounds;
+    bvh.bounding_box(bounds);
+    BVHTraversalStats stats;
+    for (int i = 0; i < rays; ++i) {
+        const Point3 origin = bounds.max() * 1.5;
+        const Point3 target(random_double(bounds.min().x(), bounds.max().x()),
+                            random_double(bounds.min().y(), bounds.max().y()),
+                            random_double(bounds.min().z(), bounds.max().z()));
+        HitRecord rec;
+        bvh.hit(Ray(origin, target - origin), 0.001, infinity, rec, stats);
+    }
+    return stats;
+}
+
+void RunBuilders(size_t count) {
+    const std::string name = "bvh_build_" + std::to_string(count / 1000) + "k";
+    const auto objects = MakeSpheres(count);
+    const int repeats = bench_quick_mode() ? 1 : 3;
+
+    struct Builder {
+        const char* label;
+        BVHBuildMethod method;
+    };
+    const Builder builders[] = {
+        {"SAH", BVHBuildMethod::SAH},
+        {"median", BVHBuildMethod::Median},
+        {"LBVH", BVHBuildMethod::LBVH},
+    };
+
+    for (const Builder& builder : builders) {
+        LinearBVH bvh(objects, builder.method);
+        const double ms = best_time_ms(repeats, [&]() { bvh.rebuild(builder.method); });
+        bench_report(name, std::string(builder.label) + " build", ms, "ms");
+        bench_report(name, std::string(builder.label) + " throughput",
+                     static_cast<double>(count) / (ms * 1e-3) / 1e6, "Mprims/s");
+        const int rays = bench_quick_mode() ? 1000 : 20000;
+        const BVHTraversalStats stats = TraceRays(bvh, rays);
+        bench_report(name, std::string(builder.label) + " node visits/ray",
+                     static_cast<double>(stats.node_visits) / rays, "nodes");
+        bench_report(name, std::string(builder.label) + " primitive tests/ray",
+                     static_cast<double>(stats.primitive_tests) / rays, "prims");
+    }
+}
+
+}
+
+BENCH_CASE(bvh_build_throughput) {
+    RunBuilders(bench_quick_mode() ? 10000 : 100000);
+    if (!bench_quick_mode()) {
+        RunBuilders(1000000);
+    }
+}
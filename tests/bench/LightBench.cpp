@@ -0,0 +1,108 @@
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "bench/BenchHarness.h"
+#include "raytracer/LightBVH.h"
+
+namespace {
+
+// `count` small sphere lights scattered over a square floor 1000 units wide,
+// with heavy-tailed (Pareto) brightness so a few lights dominate.
+HitableList ManyLights(int count) {
+    HitableList world;
+    for (int i = 0; i < count; ++i) {
+        const double brightness = 5.0 / std::pow(1.0 - 0.999 * random_double(), 1.5);
+        const Point3 center(1000.0 * random_double() - 500.0, 2.0 + 20.0 * random_double(),
+                            1000.0 * random_double() - 500.0);
+        world.add(std::make_shared<Sphere>(center, 0.5,
+                                           std::make_shared<DiffuseLight>(Color(brightness, brightness, brightness))));
+    }
+    return world;
+}
+
+struct DirectLightStats {
+    double relative_variance = 0.0;  // mean over shading points of variance / mean^2
+    double ns_per_sample = 0.0;
+};
+
+// Unshadowed direct light on a white diffuse floor: one light choice and one
+// direction sample per estimate, so only the light selection differs.
+DirectLightStats EstimateDirectLight(const LightSampler& lights, const std::vector<Point3>& points, int samples) {
+    const Vec3 normal(0, 1, 0);
+    DirectLightStats stats;
+    double relative_variance = 0.0;
+    int lit_points = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (const Point3& p : points) {
+        double sum = 0.0;
+        double sum_squares = 0.0;
+        for (int s = 0; s < samples; ++s) {
+            double value = 0.0;
+            size_t index = 0;
+            double pmf = 0.0;
+            if (lights.pick(p, normal, index, pmf)) {
+                const Hitable& light = lights.light(index);
+                const Vec3 direction = light.sample_direction(p);
+                const double pdf = pmf * light.direction_pdf(p, direction);
+                const Ray ray(p, direction);
+                HitRecord rec;
+                if (pdf > 0.0 && light.hit(ray, 0.001, infinity, rec)) {
+                    const double cosine = std::fmax(0.0, dot(unit_vector(direction), normal));
+                    value = rec.mat_ptr->emitted(ray, rec).y() * cosine / pi / pdf;
+                }
+            }
+            sum += value;
+            sum_squares += value * value;
+        }
+        const double mean = sum / samples;
+        if (mean > 0.0) {
+            relative_variance += (sum_squares / samples - mean * mean) / (mean * mean);
+            ++lit_points;
+        }
+    }
+    stats.ns_per_sample = 1e6 * elapsed_ms(start) / (static_cast<double>(points.size()) * samples);
+    stats.relative_variance = relative_variance / std::max(1, lit_points);
+    return stats;
+}
+
+void CompareSelection(int light_count, int point_count, int samples) {
+    const std::string name = "light_bvh_" + std::to_string(light_count);
+    const HitableList objects = ManyLights(light_count);
+
+    const auto build_start = std::chrono::steady_clock::now();
+    const LightBVH tree(objects);
+    const double build_ms = elapsed_ms(build_start);
+    const LightList uniform(objects);
+
+    std::vector<Point3> points;
+    for (int i = 0; i < point_count; ++i) {
+        points.emplace_back(900.0 * random_double() - 450.0, 0.0, 900.0 * random_double() - 450.0);
+    }
+
+    const DirectLightStats uniform_stats = EstimateDirectLight(uniform, points, samples);
+    const DirectLightStats tree_stats = EstimateDirectLight(tree, points, samples);
+
+    bench_report(name, "LightBVH build", build_ms, "ms");
+    bench_report(name, "uniform relative variance", uniform_stats.relative_variance, "");
+    bench_report(name, "LightBVH relative variance", tree_stats.relative_variance, "");
+    bench_report(name, "uniform time per sample", uniform_stats.ns_per_sample, "ns");
+    bench_report(name, "LightBVH time per sample", tree_stats.ns_per_sample, "ns");
+    // Inverse of variance x time: how much longer uniform selection needs for
+    // the same noise.
+    bench_report(name, "efficiency gain",
+                 uniform_stats.relative_variance * uniform_stats.ns_per_sample /
+                     (tree_stats.relative_variance * tree_stats.ns_per_sample),
+                 "x");
+}
+
+}
+
+// Direct lighting noise and cost of uniform vs light BVH selection.
+BENCH_CASE(light_bvh) {
+    const bool quick = bench_quick_mode();
+    CompareSelection(1000, quick ? 16 : 64, quick ? 256 : 4096);
+    CompareSelection(quick ? 10000 : 100000, quick ? 16 : 64, quick ? 256 : 4096);
+}
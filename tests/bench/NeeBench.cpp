@@ -0,0 +1,87 @@
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include "bench/BenchHarness.h"
+#include "raytracer/Integrator.h"
+#include "raytracer/LinearBVH.h"
+
+namespace {
+
+constexpr int kWidth = 64;
+constexpr int kHeight = 64;
+
+struct Image {
+    std::vector<Color> sum = std::vector<Color>(kWidth * kHeight, Color(0, 0, 0));
+    int samples = 0;
+
+    Color pixel(size_t index) const { return sum[index] / std::max(1, samples); }
+};
+
+// Adds whole passes of one sample per pixel until `budget_ms` is spent.
+void Render(Image& image, const Hitable& world, const LightList& lights, const PathTracerSettings& settings,
+            double budget_ms) {
+    const Camera cam(Point3(278, 278, -800), Point3(278, 278, 0), Vec3(0, 1, 0), 40, 1.0, 0.0, 10.0);
+    const auto start = std::chrono::steady_clock::now();
+    while (elapsed_ms(start) < budget_ms) {
+        for (int j = 0; j < kHeight; ++j) {
+            for (int i = 0; i < kWidth; ++i) {
+                const Ray ray = cam.get_ray((i + random_double()) / kWidth, (j + random_double()) / kHeight);
+                image.sum[static_cast<size_t>(j) * kWidth + i] += trace_path(ray, world, lights, settings);
+            }
+        }
+        ++image.samples;
+    }
+}
+
+// Error of displayed values: the light itself is far brighter than white, and
+// its anti-aliased edges would otherwise dominate the error of both methods.
+double Rmse(const Image& image, const Image& reference) {
+    double sum = 0.0;
+    for (size_t i = 0; i < image.sum.size(); ++i) {
+        const Color a = image.pixel(i);
+        const Color b = reference.pixel(i);
+        for (int c = 0; c < 3; ++c) {
+            const double d = clamp(a[c], 0.0, 1.0) - clamp(b[c], 0.0, 1.0);
+            sum += d * d / 3.0;
+        }
+    }
+    return std::sqrt(sum / image.sum.size());
+}
+
+}
+
+// Equal-time noise of BSDF-only sampling and NEE + MIS in the Cornell room.
+BENCH_CASE(nee_vs_bsdf) {
+    const HitableList objects = cornell_scene();
+    std::vector<std::shared_ptr<Hitable>> bounded = objects.objects;
+    HitableList planes;
+    split_unbounded(bounded, planes);
+    const Scene world(std::make_shared<LinearBVH>(bounded), planes);
+    const LightList lights(objects);
+
+    PathTracerSettings settings;
+    settings.sky = false;
+    settings.max_depth = 8;
+
+    const double budget_ms = bench_quick_mode() ? 200.0 : 2000.0;
+    Image reference;
+    Render(reference, world, lights, settings, 15.0 * budget_ms);
+
+    Image nee;
+    Render(nee, world, lights, settings, budget_ms);
+    settings.sample_lights = false;
+    Image bsdf;
+    Render(bsdf, world, lights, settings, budget_ms);
+
+    bench_report("nee_vs_bsdf", "reference spp (NEE + MIS)", reference.samples, "spp");
+    bench_report("nee_vs_bsdf", "BSDF sampling spp", bsdf.samples, "spp");
+    bench_report("nee_vs_bsdf", "NEE + MIS spp", nee.samples, "spp");
+    bench_report("nee_vs_bsdf", "BSDF sampling RMSE", Rmse(bsdf, reference), "");
+    bench_report("nee_vs_bsdf", "NEE + MIS RMSE", Rmse(nee, reference), "");
+    // Variance falls as 1/spp, so the RMSE ratio squared is the sample-count
+    // factor BSDF sampling would need to match.
+    const double ratio = Rmse(bsdf, reference) / Rmse(nee, reference);
+    bench_report("nee_vs_bsdf", "equal-noise sample factor", ratio * ratio, "x");
+}
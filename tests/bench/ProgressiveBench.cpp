@@ -0,0 +1,152 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+#include "bench/BenchHarness.h"
+#include "raytracer/Progressive.h"
+
+// Input-to-first-pixels latency of a camera edit while the progressive
+// renderer is busy: set_camera() from this thread while another drives
+// passes, timed until that thread reports a tile of the new view. Uses the
+// app's default scene at 400x225.
+BENCH_CASE(progressive_restart) {
+    const bool quick = bench_quick_mode();
+    const int width = quick ? 160 : 400;
+    const int height = quick ? 90 : 225;
+    const int edits = quick ? 5 : 40;
+    const HitableList objects = random_scene();
+    const Scene world(objects);
+    const LightList lights(objects);
+    PathTracerSettings settings;
+    settings.max_depth = 10;
+    ProgressiveRenderer renderer(world, lights, width, height, settings);
+    const double pass_ms = best_time_ms(1, [&] { renderer.render_pass([](int, int, int, int) {}); });
+
+    using Clock = std::chrono::steady_clock;
+    std::atomic<uint64_t> awaited{0};
+    std::atomic<bool> seen{false};
+    std::atomic<bool> stop{false};
+    Clock::time_point first_tile;
+    std::thread driver([&]() {
+        while (!stop.load()) {
+            renderer.render_pass([&](int, int, int, int) {
+                if (!seen.load(std::memory_order_acquire) && renderer.film_generation() == awaited.load()) {
+                    first_tile = Clock::now();
+                    seen.store(true, std::memory_order_release);
+                }
+            });
+        }
+    });
+
+    std::vector<double> latencies;
+    CameraParams params;
+    for (int edit = 0; edit < edits; ++edit) {
+        // Let the edit land at an arbitrary point of a pass.
+        std::this_thread::sleep_for(std::chrono::milliseconds(15 + 7 * (edit % 5)));
+        const double angle = 0.05 * (edit + 1);
+        params.lookfrom = Point3(13 * std::cos(angle) - 3 * std::sin(angle), 2, 13 * std::sin(angle) + 3 * std::cos(angle));
+        awaited.store(~uint64_t{0});
+        seen.store(false);
+        const auto start = Clock::now();
+        awaited.store(renderer.set_camera(params));
+        while (!seen.load(std::memory_order_acquire)) {
+            std::this_thread::yield();
+        }
+        latencies.push_back(std::chrono::duration<double, std::milli>(first_tile - start).count());
+    }
+    stop.store(true);
+    renderer.restart();
+    driver.join();
+
+    std::sort(latencies.begin(), latencies.end());
+    bench_report("progressive_restart", "1 spp pass", pass_ms, "ms");
+    bench_report("progressive_restart", "edit to first tile (median)", latencies[latencies.size() / 2], "ms");
+    bench_report("progressive_restart", "edit to first tile (max)", latencies.back(), "ms");
+    bench_report("progressive_restart", "threads", ThreadPool::global().size(), "");
+}
+
+// Time from a restart to the first image covering the whole frame: the 1/8
+// preview stage against the first full 1 spp pass, and the cost of the
+// complete coarse-to-fine sequence up to 1 spp against that pass.
+BENCH_CASE(progressive_preview) {
+    const bool quick = bench_quick_mode();
+    const int width = quick ? 160 : 400;
+    const int height = quick ? 90 : 225;
+    const int runs = quick ? 1 : 3;
+    const HitableList objects = random_scene();
+    const Scene world(objects);
+    const LightList lights(objects);
+    PathTracerSettings settings;
+    settings.max_depth = 10;
+    const auto ignore = [](int, int, int, int) {};
+
+    ProgressiveRenderer plain(world, lights, width, height, settings);
+    const double full_pass_ms = best_time_ms(runs, [&] {
+        plain.restart();
+        plain.render_pass(ignore);
+    });
+
+    ProgressiveRenderer preview(world, lights, width, height, settings, 16, 3);
+    double first_stage_ms = infinity;
+    const double to_full_res_ms = best_time_ms(runs, [&] {
+        preview.restart();
+        const auto start = std::chrono::steady_clock::now();
+        preview.render_pass(ignore);
+        first_stage_ms = std::min(first_stage_ms, elapsed_ms(start));
+        while (preview.passes() == 0) {
+            preview.render_pass(ignore);
+        }
+    });
+
+    bench_report("progressive_preview", "first full frame, 1/8 preview", first_stage_ms, "ms");
+    bench_report("progressive_preview", "first full frame, no preview", full_pass_ms, "ms");
+    bench_report("progressive_preview", "speed-up to first frame", full_pass_ms / first_stage_ms, "x");
+    bench_report("progressive_preview", "1/8 -> 1/4 -> 1/2 -> 1 spp", to_full_res_ms, "ms");
+    bench_report("progressive_preview", "preview overhead", 100.0 * (to_full_res_ms / full_pass_ms - 1.0), "%");
+}
+
+// Time until a 96x96 region of interest holds 16 spp with the whole frame
+// scheduled evenly, with Focus (rest of the frame every 4th pass) and with
+// Crop.
+BENCH_CASE(progressive_region) {
+    const bool quick = bench_quick_mode();
+    const int width = quick ? 160 : 400;
+    const int height = quick ? 90 : 225;
+    const int size = quick ? 32 : 96;
+    const int samples = quick ? 4 : 16;
+    const HitableList objects = random_scene();
+    const Scene world(objects);
+    const LightList lights(objects);
+    PathTracerSettings settings;
+    settings.max_depth = 10;
+
+    ProgressiveRenderer renderer(world, lights, width, height, settings);
+    const auto time_to_budget = [&](RegionMode mode) {
+        RenderRegion region;
+        region.x0 = (width - size) / 2;
+        region.y0 = (height - size) / 2;
+        region.x1 = region.x0 + size;
+        region.y1 = region.y0 + size;
+        region.mode = mode;
+        renderer.set_region(region);
+        return best_time_ms(1, [&] {
+            // passes() drops to 0 with the first pass after the restart.
+            renderer.restart();
+            do {
+                renderer.render_pass([](int, int, int, int) {});
+            } while (renderer.passes() < samples);
+        });
+    };
+
+    const double even_ms = time_to_budget(RegionMode::Off);
+    const double focus_ms = time_to_budget(RegionMode::Focus);
+    const double crop_ms = time_to_budget(RegionMode::Crop);
+    bench_report("progressive_region", "region at budget, whole frame", even_ms, "ms");
+    bench_report("progressive_region", "region at budget, focus", focus_ms, "ms");
+    bench_report("progressive_region", "region at budget, crop", crop_ms, "ms");
+    bench_report("progressive_region", "focus speed-up", even_ms / focus_ms, "x");
+    bench_report("progressive_region", "crop speed-up", even_ms / crop_ms, "x");
+}
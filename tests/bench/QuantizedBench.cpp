@@ -0,0 +1,82 @@
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "bench/BenchHarness.h"
+#include "raytracer/QuantizedBVH.h"
+
+namespace {
+
+std::vector<std::shared_ptr<Hitable>> MakeSpheres(size_t count) {
+    const auto material = std::make_shared<Lambertian>(Color(0.5, 0.5, 0.5));
+    const double extent = std::cbrt(static_cast<double>(count));
+    std::vector<std::shared_ptr<Hitable>> objects;
+    objects.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        objects.push_back(std::make_shared<Sphere>(Point3::random(-extent, extent), 0.2, material));
+    }
+    return objects;
+}
+
+std::vector<Ray> RandomRays(const AABB& bounds, size_t count) {
+    std::vector<Ray> rays;
+    rays.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        const Point3 origin(random_double(bounds.min().x(), bounds.max().x()),
+                            random_double(bounds.min().y(), bounds.max().y()),
+                            random_double(bounds.min().z(), bounds.max().z()));
+        rays.emplace_back(origin, Vec3::random(-1.0, 1.0));
+    }
+    return rays;
+}
+
+template <typename Accel>
+void Report(const std::string& name, const std::string& label, const Accel& accel, size_t node_bytes,
+            const std::vector<Ray>& rays) {
+    // A 1 MiB L2; each miss is 64 bytes of traffic from memory.
+    CacheSimulator l2(1024 * 1024, 64, 16);
+    BVHTraversalStats stats;
+    stats.cache = &l2;
+    HitRecord rec;
+    for (const Ray& ray : rays) {
+        accel.hit(ray, 0.001, infinity, rec, stats);
+    }
+
+    const double ms = best_time_ms(3, [&]() {
+        for (const Ray& ray : rays) {
+            accel.hit(ray, 0.001, infinity, rec);
+        }
+    });
+    const double count = static_cast<double>(rays.size());
+    bench_report(name, label + " node array", node_bytes / 1048576.0, "MiB");
+    bench_report(name, label + " total", accel.memory_bytes() / 1048576.0, "MiB");
+    bench_report(name, label + " L2 misses/ray", stats.cache_misses / count, "lines");
+    bench_report(name, label + " rays", count / (ms * 1e-3) / 1e6, "Mrays/s");
+}
+
+void Run(size_t count, size_t ray_count) {
+    const std::string name = "bvh_quantized_" + std::to_string(count / 1000) + "k";
+    const LinearBVH bvh(MakeSpheres(count), BVHBuildMethod::SAH);
+
+    const auto start = std::chrono::steady_clock::now();
+    const QuantizedBVH quantized(bvh);
+    bench_report(name, "quantize", elapsed_ms(start), "ms");
+
+    AABB bounds;
+    bvh.bounding_box(bounds);
+    const auto rays = RandomRays(bounds, ray_count);
+    Report(name, "LinearBVH", bvh, bvh.node_count() * sizeof(LinearBVHNode), rays);
+    Report(name, "QuantizedBVH", quantized, quantized.node_count() * sizeof(QuantizedBVHNode), rays);
+}
+
+}
+
+BENCH_CASE(bvh_quantized) {
+    if (bench_quick_mode()) {
+        Run(20000, 5000);
+        return;
+    }
+    Run(1000000, 100000);
+}
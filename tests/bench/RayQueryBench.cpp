@@ -0,0 +1,61 @@
+#include <memory>
+#include <vector>
+
+#include "bench/BenchHarness.h"
+#include "raytracer/RayQuery.h"
+
+// Incoherent batch of segments between random points in a dense sphere field,
+// the shape of a visibility-matrix job.
+BENCH_CASE(ray_query_batch) {
+    const size_t sphere_count = bench_quick_mode() ? 20000 : 100000;
+    const size_t ray_count = bench_quick_mode() ? 100000 : 1000000;
+
+    const auto material = std::make_shared<Lambertian>(Color(0.5, 0.5, 0.5));
+    std::vector<std::shared_ptr<Hitable>> objects;
+    objects.reserve(sphere_count);
+    for (size_t i = 0; i < sphere_count; ++i) {
+        objects.push_back(std::make_shared<Sphere>(Point3::random(-50.0, 50.0), random_double(0.05, 0.4), material));
+    }
+    const auto bvh = std::make_shared<LinearBVH>(objects);
+
+    RayBatch rays;
+    rays.resize(ray_count);
+    for (size_t i = 0; i < ray_count; ++i) {
+        const Point3 from = Point3::random(-50.0, 50.0);
+        rays.set(i, Ray(from, Point3::random(-50.0, 50.0) - from), 0.001, infinity);
+    }
+
+    HitBatch hits;
+    std::vector<uint8_t> blocked;
+    const double count = static_cast<double>(ray_count);
+
+    BVHTraversalStats stats;
+    HitRecord probe;
+    for (size_t i = 0; i < ray_count; i += 16) {
+        bvh->hit(rays.ray(i), rays.t_min[i], rays.t_max[i], probe, stats);
+    }
+    bench_report("ray_query_batch", "node visits/ray", stats.node_visits * 16.0 / count, "nodes");
+
+    const double single_ms = best_time_ms(2, [&]() {
+        HitRecord rec;
+        uint32_t prim = 0;
+        for (size_t i = 0; i < ray_count; ++i) {
+            bvh->hit(rays.ray(i), rays.t_min[i], rays.t_max[i], rec, prim);
+        }
+    });
+    bench_report("ray_query_batch", "per-ray loop, 1 thread", count / (single_ms * 1e-3) / 1e6, "Mrays/s");
+
+    RayQuerySettings unsorted;
+    unsorted.sort_threshold = ray_count + 1;
+    const RayQuery unsorted_query(bvh, {material}, unsorted);
+    const double unsorted_ms = best_time_ms(2, [&]() { unsorted_query.intersect(rays, hits); });
+    bench_report("ray_query_batch", "batch closest-hit, unsorted", count / (unsorted_ms * 1e-3) / 1e6, "Mrays/s");
+
+    const RayQuery query(bvh, {material});
+    const double sort_ms = best_time_ms(2, [&]() { query.trace_order(rays); });
+    const double sorted_ms = best_time_ms(2, [&]() { query.intersect(rays, hits); });
+    const double occluded_ms = best_time_ms(2, [&]() { query.occluded(rays, blocked); });
+    bench_report("ray_query_batch", "coherence sort", sort_ms, "ms");
+    bench_report("ray_query_batch", "batch closest-hit, sorted", count / (sorted_ms * 1e-3) / 1e6, "Mrays/s");
+    bench_report("ray_query_batch", "batch any-hit, sorted", count / (occluded_ms * 1e-3) / 1e6, "Mrays/s");
+}
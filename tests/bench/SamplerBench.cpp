@@ -0,0 +1,80 @@
+#include <chrono>
+#include <cmath>
+#include <string>
+
+#include "bench/BenchHarness.h"
+#include "raytracer/RayTracer.h"
+
+namespace {
+
+// The rejection samplers the closed-form ones replaced.
+Vec3 RejectionInUnitSphere() {
+    while (true) {
+        const Vec3 p = Vec3::random(-1, 1);
+        if (p.length_squared() < 1) {
+            return p;
+        }
+    }
+}
+
+Vec3 RejectionInUnitDisk() {
+    while (true) {
+        const Vec3 p(random_double(-1, 1), random_double(-1, 1), 0);
+        if (p.length_squared() < 1) {
+            return p;
+        }
+    }
+}
+
+Vec3 RejectionCosineDirection(const Vec3& normal) {
+    const Vec3 d = normal + unit_vector(RejectionInUnitSphere());
+    return d.length_squared() < 1e-8 ? normal : d;
+}
+
+volatile double g_sink = 0.0;
+
+// Reports ns per call of `sample`; the summed result keeps the work alive.
+template <typename Sample>
+void ReportCost(const std::string& metric, int count, Sample&& sample) {
+    const double ms = best_time_ms(3, [&] {
+        Vec3 sum(0, 0, 0);
+        for (int i = 0; i < count; ++i) {
+            sum += sample();
+        }
+        g_sink = sum.x();
+    });
+    bench_report("sampler_cost", metric, 1e6 * ms / count, "ns");
+}
+
+}
+
+// Per-sample cost of rejection loops vs closed-form warps.
+BENCH_CASE(sampler_cost) {
+    const int count = bench_quick_mode() ? 200000 : 5000000;
+    const Vec3 normal = unit_vector(Vec3(0.3, 1.0, -0.2));
+    const ONB basis(normal);
+
+    ReportCost("unit sphere, rejection", count, [] { return RejectionInUnitSphere(); });
+    ReportCost("unit sphere, closed form", count, [] { return random_in_unit_sphere(); });
+    ReportCost("unit vector, rejection + normalize", count, [] { return unit_vector(RejectionInUnitSphere()); });
+    ReportCost("unit vector, closed form", count, [] { return random_unit_vector(); });
+    ReportCost("unit disk, rejection", count, [] { return RejectionInUnitDisk(); });
+    ReportCost("unit disk, concentric", count, [] { return random_in_unit_disk(); });
+    ReportCost("cosine direction, rejection", count, [&] { return RejectionCosineDirection(normal); });
+    ReportCost("cosine direction, concentric", count,
+               [&] { return basis.local(sample_cosine_hemisphere(random_double(), random_double())); });
+
+    // Lambertian::scatter end to end, including the basis and the pdf.
+    const Lambertian material(Color(0.5, 0.5, 0.5));
+    HitRecord rec;
+    rec.normal = normal;
+    rec.front_face = true;
+    const Ray incoming(Point3(0, 1, 0), Vec3(0, -1, 0));
+    ReportCost("Lambertian::scatter with pdf", count, [&] {
+        Color attenuation;
+        Ray scattered;
+        double pdf = 0.0;
+        material.scatter(incoming, rec, attenuation, scattered, pdf);
+        return scattered.direction() * pdf;
+    });
+}
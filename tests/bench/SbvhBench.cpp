@@ -0,0 +1,92 @@
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "bench/BenchHarness.h"
+#include "raytracer/LinearBVH.h"
+
+namespace {
+
+// Primary rays of the application camera (RenderWorker::render()).
+std::vector<Ray> CameraRays(int width, int height) {
+    const Camera cam(Point3(13, 2, 3), Point3(0, 0, 0), Vec3(0, 1, 0), 20,
+                     static_cast<double>(width) / height, 0.1, 10.0);
+    std::vector<Ray> rays;
+    rays.reserve(static_cast<size_t>(width) * height);
+    for (int j = 0; j < height; ++j) {
+        for (int i = 0; i < width; ++i) {
+            rays.push_back(cam.get_ray((i + random_double()) / (width - 1), (j + random_double()) / (height - 1)));
+        }
+    }
+    return rays;
+}
+
+// Random rays through a cube of small spheres mixed with large ones, the case
+// object partitioning handles worst.
+std::vector<Ray> CubeRays(size_t count) {
+    std::vector<Ray> rays;
+    rays.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        rays.emplace_back(Point3::random(-60.0, 60.0), Vec3::random(-1.0, 1.0));
+    }
+    return rays;
+}
+
+std::vector<std::shared_ptr<Hitable>> MixedSizeSpheres(int small_count, int large_count) {
+    const auto material = std::make_shared<Lambertian>(Color(0.5, 0.5, 0.5));
+    std::vector<std::shared_ptr<Hitable>> objects;
+    for (int i = 0; i < small_count; ++i) {
+        objects.push_back(std::make_shared<Sphere>(Point3::random(-50.0, 50.0), 0.2, material));
+    }
+    for (int i = 0; i < large_count; ++i) {
+        objects.push_back(std::make_shared<Sphere>(Point3::random(-50.0, 50.0), random_double(5.0, 15.0), material));
+    }
+    return objects;
+}
+
+void Report(const std::string& label, const std::vector<std::shared_ptr<Hitable>>& objects,
+            BVHBuildMethod method, const std::vector<Ray>& rays) {
+    const auto start = std::chrono::steady_clock::now();
+    const LinearBVH bvh(objects, method);
+    const double build_ms = elapsed_ms(start);
+
+    BVHTraversalStats stats;
+    HitRecord rec;
+    const double ms = best_time_ms(3, [&]() {
+        stats = BVHTraversalStats();
+        for (const Ray& ray : rays) {
+            bvh.hit(ray, 0.001, infinity, rec, stats);
+        }
+    });
+    const double count = static_cast<double>(rays.size());
+    bench_report("sbvh_vs_sah", label + " build", build_ms, "ms");
+    bench_report("sbvh_vs_sah", label + " references/primitive",
+                 static_cast<double>(bvh.reference_count()) / bvh.primitive_count(), "refs");
+    bench_report("sbvh_vs_sah", label + " node visits/ray", stats.node_visits / count, "nodes");
+    bench_report("sbvh_vs_sah", label + " primitive tests/ray", stats.primitive_tests / count, "tests");
+    bench_report("sbvh_vs_sah", label + " primary rays", count / (ms * 1e-3) / 1e6, "Mrays/s");
+}
+
+}
+
+// random_scene() with its original radius-1000 ground sphere inside the BVH,
+// then a field of small spheres overlapped by large ones.
+BENCH_CASE(sbvh_vs_sah) {
+    const HitableList scene = random_scene();
+    std::vector<std::shared_ptr<Hitable>> objects = scene.objects;
+    HitableList planes;
+    split_unbounded(objects, planes);
+    objects.push_back(std::make_shared<Sphere>(
+        Point3(0, -1000, 0), 1000, std::make_shared<Lambertian>(Color(0.5, 0.5, 0.5))));
+
+    const auto rays = bench_quick_mode() ? CameraRays(160, 90) : CameraRays(800, 450);
+    Report("random_scene SAH", objects, BVHBuildMethod::SAH, rays);
+    Report("random_scene SBVH", objects, BVHBuildMethod::SBVH, rays);
+
+    const bool quick = bench_quick_mode();
+    const auto mixed = MixedSizeSpheres(quick ? 5000 : 50000, quick ? 50 : 500);
+    const auto cube_rays = CubeRays(quick ? 20000 : 200000);
+    Report("mixed sizes SAH", mixed, BVHBuildMethod::SAH, cube_rays);
+    Report("mixed sizes SBVH", mixed, BVHBuildMethod::SBVH, cube_rays);
+}
@@ -0,0 +1,55 @@
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "bench/BenchHarness.h"
+#include "raytracer/LinearBVH.h"
+
+namespace {
+
+// Primary rays of the application camera (RenderWorker::render()).
+std::vector<Ray> CameraRays(int width, int height) {
+    const Camera cam(Point3(13, 2, 3), Point3(0, 0, 0), Vec3(0, 1, 0), 20,
+                     static_cast<double>(width) / height, 0.1, 10.0);
+    std::vector<Ray> rays;
+    rays.reserve(static_cast<size_t>(width) * height);
+    for (int j = 0; j < height; ++j) {
+        for (int i = 0; i < width; ++i) {
+            rays.push_back(cam.get_ray((i + random_double()) / (width - 1), (j + random_double()) / (height - 1)));
+        }
+    }
+    return rays;
+}
+
+void Report(const std::string& label, const HitableList& unbounded, const LinearBVH& bvh,
+            const std::vector<Ray>& rays) {
+    BVHTraversalStats stats;
+    HitRecord rec;
+    const double ms = best_time_ms(3, [&]() {
+        stats = BVHTraversalStats();
+        for (const Ray& ray : rays) {
+            const bool ground = unbounded.hit(ray, 0.001, infinity, rec);
+            bvh.hit(ray, 0.001, ground ? rec.t : infinity, rec, stats);
+        }
+    });
+    const double count = static_cast<double>(rays.size());
+    bench_report("ground_plane", label + " node visits/ray", stats.node_visits / count, "nodes");
+    bench_report("ground_plane", label + " primary rays", count / (ms * 1e-3) / 1e6, "Mrays/s");
+}
+
+}
+
+BENCH_CASE(ground_plane) {
+    const HitableList scene = random_scene();
+    std::vector<std::shared_ptr<Hitable>> bounded = scene.objects;
+    HitableList planes;
+    split_unbounded(bounded, planes);
+
+    std::vector<std::shared_ptr<Hitable>> with_ground_sphere = bounded;
+    with_ground_sphere.push_back(std::make_shared<Sphere>(
+        Point3(0, -1000, 0), 1000, std::make_shared<Lambertian>(Color(0.5, 0.5, 0.5))));
+
+    const auto rays = bench_quick_mode() ? CameraRays(160, 90) : CameraRays(800, 450);
+    Report("sphere in BVH", HitableList(), LinearBVH(with_ground_sphere), rays);
+    Report("plane outside BVH", planes, LinearBVH(bounded), rays);
+}
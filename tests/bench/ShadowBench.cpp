@@ -0,0 +1,73 @@
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "bench/BenchHarness.h"
+#include "raytracer/LinearBVH.h"
+
+namespace {
+
+// Shadow segments from the first visible surface of camera rays towards an
+// area light above the scene; each segment ends just short of the light.
+std::vector<Ray> ShadowRays(const Hitable& world, int width, int height) {
+    const Camera cam(Point3(13, 2, 3), Point3(0, 0, 0), Vec3(0, 1, 0), 20,
+                     static_cast<double>(width) / height, 0.1, 10.0);
+    std::vector<Ray> rays;
+    HitRecord rec;
+    for (int j = 0; j < height; ++j) {
+        for (int i = 0; i < width; ++i) {
+            const Ray primary = cam.get_ray((i + random_double()) / (width - 1), (j + random_double()) / (height - 1));
+            if (world.hit(primary, 0.001, infinity, rec)) {
+                const Point3 light(random_double(-4.0, 4.0), 10.0, random_double(-4.0, 4.0));
+                rays.emplace_back(rec.p, light - rec.p);
+            }
+        }
+    }
+    return rays;
+}
+
+}
+
+BENCH_CASE(shadow_rays) {
+    const HitableList scene = random_scene();
+    std::vector<std::shared_ptr<Hitable>> bounded = scene.objects;
+    HitableList planes;
+    split_unbounded(bounded, planes);
+    const LinearBVH bvh(bounded);
+
+    const Scene world(std::make_shared<LinearBVH>(bounded), planes);
+    const auto rays = bench_quick_mode() ? ShadowRays(world, 160, 90) : ShadowRays(world, 800, 450);
+    const double count = static_cast<double>(rays.size());
+
+    BVHTraversalStats closest_stats;
+    size_t closest_blocked = 0;
+    const double closest_ms = best_time_ms(3, [&]() {
+        closest_stats = BVHTraversalStats();
+        closest_blocked = 0;
+        HitRecord rec;
+        for (const Ray& ray : rays) {
+            closest_blocked += bvh.hit(ray, 0.001, 0.999, rec, closest_stats) ? 1 : 0;
+        }
+    });
+
+    BVHTraversalStats any_stats;
+    size_t any_blocked = 0;
+    const double any_ms = best_time_ms(3, [&]() {
+        any_stats = BVHTraversalStats();
+        any_blocked = 0;
+        for (const Ray& ray : rays) {
+            any_blocked += bvh.occluded(ray, 0.001, 0.999, any_stats) ? 1 : 0;
+        }
+    });
+
+    bench_report("shadow_rays", "occluded fraction", closest_blocked / count, "");
+    bench_report("shadow_rays", "closest-hit node visits/ray", closest_stats.node_visits / count, "nodes");
+    bench_report("shadow_rays", "any-hit node visits/ray", any_stats.node_visits / count, "nodes");
+    bench_report("shadow_rays", "closest-hit prim tests/ray", closest_stats.primitive_tests / count, "tests");
+    bench_report("shadow_rays", "any-hit prim tests/ray", any_stats.primitive_tests / count, "tests");
+    bench_report("shadow_rays", "closest-hit", count / (closest_ms * 1e-3) / 1e6, "Mrays/s");
+    bench_report("shadow_rays", "any-hit", count / (any_ms * 1e-3) / 1e6, "Mrays/s");
+    if (any_blocked != closest_blocked) {
+        bench_report("shadow_rays", "MISMATCHED visibility results", static_cast<double>(any_blocked), "");
+    }
+}
@@ -0,0 +1,49 @@
+#include <cstdio>
+#include <string>
+
+#include "bench/BenchHarness.h"
+#include "raytracer/TiledImage.h"
+
+// Tiled out-of-core output: wall time and peak tile memory with a generous
+// and a tight budget, against the memory an in-core film of the same frame
+// (accumulators plus float output) would take. Uses the app's default scene
+// with all AOVs at 1 spp.
+BENCH_CASE(tiled_output) {
+    const bool quick = bench_quick_mode();
+    TiledRenderSettings settings;
+    settings.width = quick ? 320 : 1200;
+    settings.height = quick ? 180 : 675;
+    settings.samples = 1;
+    settings.aovs = AovSet::all();
+    const HitableList objects = random_scene();
+    const Scene world(objects);
+    const LightList lights(objects);
+    const AovIds ids(objects);
+    PathTracerSettings path_settings;
+    path_settings.max_depth = 10;
+    const std::string path = "tiled_bench.rttile";
+
+    TiledRenderStats roomy;
+    settings.memory_budget = size_t{1} << 30;
+    const double roomy_ms = best_time_ms(1, [&] {
+        roomy = render_tiled(world, lights, CameraParams(), path_settings, settings, ids, path);
+    });
+    TiledRenderStats tight;
+    settings.memory_budget = 4 * roomy.tile_bytes;
+    const double tight_ms = best_time_ms(1, [&] {
+        tight = render_tiled(world, lights, CameraParams(), path_settings, settings, ids, path);
+    });
+    std::remove(path.c_str());
+
+    const auto film_bytes = [&](double width, double height) {
+        return width * height * (sizeof(PixelAccumulator) + tiled_planes(settings.aovs) * sizeof(float));
+    };
+    const double mib = 1048576.0;
+    bench_report("tiled_output", "render, 1 GiB budget", roomy_ms, "ms");
+    bench_report("tiled_output", "render, 4-tile budget", tight_ms, "ms");
+    bench_report("tiled_output", "peak tiles, 1 GiB budget", roomy.peak_resident_bytes / mib, "MiB");
+    bench_report("tiled_output", "peak tiles, 4-tile budget", tight.peak_resident_bytes / mib, "MiB");
+    bench_report("tiled_output", "in-core film, same frame", film_bytes(settings.width, settings.height) / mib, "MiB");
+    bench_report("tiled_output", "in-core film, 32768x16384", film_bytes(32768, 16384) / (1024 * mib), "GiB");
+    bench_report("tiled_output", "writer time, 4-tile budget", tight.write_ms, "ms");
+}
@@ -0,0 +1,58 @@
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "bench/BenchHarness.h"
+#include "raytracer/Tlas.h"
+
+namespace {
+
+std::vector<std::shared_ptr<Instance>> MakeInstances(size_t count) {
+    const auto material = std::make_shared<Lambertian>(Color(0.5, 0.5, 0.5));
+    const auto blas = std::make_shared<Sphere>(Point3(0.0, 0.0, 0.0), 0.2, material);
+    const double extent = std::cbrt(static_cast<double>(count)) * 2.0;
+    std::vector<std::shared_ptr<Instance>> instances;
+    instances.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        instances.push_back(std::make_shared<Instance>(blas, Vec3::random(-extent, extent)));
+    }
+    return instances;
+}
+
+void RunRebuildVsRefit(size_t count) {
+    const std::string name = "tlas_" + std::to_string(count / 1000) + "k";
+    const int repeats = bench_quick_mode() ? 1 : 5;
+    auto instances = MakeInstances(count);
+
+    TLAS tlas(instances);
+    const double rebuild_ms = best_time_ms(repeats, [&]() { tlas.rebuild(); });
+
+    const double refit_all_ms = best_time_ms(repeats, [&]() {
+        for (size_t i = 0; i < count; ++i) {
+            instances[i]->set_offset(instances[i]->offset() + Vec3(0.01, 0.0, 0.0));
+        }
+        tlas.refit();
+    });
+
+    const int moves = bench_quick_mode() ? 1000 : 100000;
+    std::vector<size_t> targets(static_cast<size_t>(moves));
+    for (size_t& target : targets) {
+        target = static_cast<size_t>(random_double() * static_cast<double>(count)) % count;
+    }
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t target : targets) {
+        tlas.set_instance_offset(target, instances[target]->offset() + Vec3(0.0, 0.01, 0.0));
+    }
+    const double single_move_us = elapsed_ms(start) * 1000.0 / static_cast<double>(moves);
+
+    bench_report(name, "full rebuild (SAH)", rebuild_ms, "ms");
+    bench_report(name, "refit after moving all", refit_all_ms, "ms");
+    bench_report(name, "move one + path refit", single_move_us, "us");
+}
+
+}
+
+BENCH_CASE(tlas_rebuild_vs_refit) {
+    RunRebuildVsRefit(10000);
+    RunRebuildVsRefit(100000);
+}
@@ -0,0 +1,116 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <memory>
+#include <string>
+
+#include "TestScenes.h"
+#include "raytracer/Aov.h"
+
+namespace {
+constexpr double kEpsilon = 1e-9;
+
+// Floor and a ball sharing one material, and a second ball with its own.
+HitableList IdScene() {
+    HitableList objects;
+    const auto grey = std::make_shared<Lambertian>(Color(0.5, 0.5, 0.5));
+    objects.add(std::make_shared<Plane>(Point3(0, 0, 0), Vec3(0, 1, 0), grey));
+    objects.add(std::make_shared<Sphere>(Point3(0, 1, 0), 1.0, grey));
+    objects.add(std::make_shared<Sphere>(Point3(3, 1, 0), 1.0, std::make_shared<Metal>(Color(0.9, 0.8, 0.1), 0.0)));
+    return objects;
+}
+}
+
+TEST(AovTests, ChannelNamesRoundTrip) {
+    for (int i = 0; i < kAovChannelCount; ++i) {
+        const AovChannel channel = static_cast<AovChannel>(i);
+        EXPECT_EQ(aov_channel(aov_name(channel)), channel);
+    }
+    EXPECT_THROW(aov_channel("beauty"), std::invalid_argument);
+    EXPECT_EQ(aov_components(AovChannel::Normal), 3);
+    EXPECT_EQ(aov_components(AovChannel::PrimitiveId), 1);
+
+    const AovSet set{AovChannel::Depth, AovChannel::Variance};
+    EXPECT_TRUE(set.contains(AovChannel::Depth));
+    EXPECT_FALSE(set.contains(AovChannel::Albedo));
+    EXPECT_TRUE(AovSet().empty());
+    EXPECT_TRUE(AovSet::all().contains(AovChannel::SampleCount));
+}
+
+TEST(AovTests, IdsFollowListOrderAndSharedMaterials) {
+    const HitableList objects = IdScene();
+    const AovIds ids(objects);
+    EXPECT_EQ(ids.primitive(objects.objects[2].get()), 2);
+    EXPECT_EQ(ids.material(objects.objects[0].get()), 0);
+    EXPECT_EQ(ids.material(objects.objects[1].get()), 0);
+    EXPECT_EQ(ids.material(objects.objects[2].get()), 1);
+    EXPECT_EQ(ids.primitive(nullptr), -1);
+    EXPECT_EQ(ids.material(&objects), -1);
+}
+
+TEST(AovTests, ResolveWritesPlanarChannelsFromPrimaryHits) {
+    const HitableList objects = IdScene();
+    const Scene world(objects);
+    const LightList lights(objects);
+    const AovIds ids(objects);
+    AovBuffers buffers(2, 1, AovSet::all());
+
+    // Pixel 0 looks down at the metal ball, pixel 1 up into the sky.
+    const Ray rays[2] = {Ray(Point3(3, 4, 0), Vec3(0, -1, 0)), Ray(Point3(3, 4, 0), Vec3(0, 1, 0))};
+    for (size_t index = 0; index < 2; ++index) {
+        PixelAccumulator pixel;
+        for (int s = 0; s < 4; ++s) {
+            HitFeatures hit;
+            pixel.add(trace_path(rays[index], world, lights, PathTracerSettings(), &hit), hit);
+        }
+        buffers.resolve(index, pixel, ids);
+    }
+
+    EXPECT_NEAR(buffers.plane(AovChannel::Depth)[0], 2.0, 1e-6);
+    EXPECT_EQ(buffers.plane(AovChannel::Depth)[1], std::numeric_limits<float>::infinity());
+    // Components are separate planes of width * height floats.
+    EXPECT_NEAR(buffers.plane(AovChannel::Normal, 1)[0], 1.0, 1e-6);
+    EXPECT_NEAR(buffers.plane(AovChannel::Normal, 0)[0], 0.0, 1e-6);
+    EXPECT_NEAR(buffers.plane(AovChannel::Albedo, 2)[0], 0.1, 1e-6);
+    EXPECT_NEAR(buffers.plane(AovChannel::Albedo, 0)[1], 1.0, kEpsilon);
+    EXPECT_EQ(buffers.plane(AovChannel::MaterialId)[0], 1.0f);
+    EXPECT_EQ(buffers.plane(AovChannel::PrimitiveId)[0], 2.0f);
+    EXPECT_EQ(buffers.plane(AovChannel::PrimitiveId)[1], -1.0f);
+    EXPECT_EQ(buffers.plane(AovChannel::SampleCount)[1], 4.0f);
+    EXPECT_GE(buffers.plane(AovChannel::Variance)[0], 0.0f);
+
+    const AovBuffers depth_only(2, 1, AovSet{AovChannel::Depth});
+    EXPECT_THROW(depth_only.plane(AovChannel::Normal), std::invalid_argument);
+    EXPECT_THROW(depth_only.plane(AovChannel::Depth, 1), std::invalid_argument);
+    EXPECT_THROW(AovBuffers(0, 1, AovSet::all()), std::invalid_argument);
+}
+
+TEST(AovTests, ExportWritesOnePfmPerChannel) {
+    AovBuffers buffers(3, 2, AovSet{AovChannel::Depth, AovChannel::Normal});
+    for (size_t i = 0; i < buffers.size(); ++i) {
+        buffers.plane(AovChannel::Depth)[i] = static_cast<float>(i);
+        buffers.plane(AovChannel::Normal, 0)[i] = 0.5f;
+        buffers.plane(AovChannel::Normal, 2)[i] = static_cast<float>(i) * 0.25f;
+    }
+
+    const std::vector<std::string> paths = export_aovs(buffers, TempPath("aov_test"));
+    ASSERT_EQ(paths.size(), 2u);
+    EXPECT_EQ(paths[0], TempPath("aov_test") + ".depth.pfm");
+
+    // load_pfm() flips rows back to top-down order.
+    const HdrImage depth = load_pfm(paths[0]);
+    EXPECT_EQ(depth.width, 3);
+    EXPECT_EQ(depth.height, 2);
+    EXPECT_NEAR(depth.at(1, 0).x(), 1.0, kEpsilon);
+    EXPECT_NEAR(depth.at(2, 1).x(), 5.0, kEpsilon);
+    const HdrImage normal = load_pfm(paths[1]);
+    EXPECT_NEAR(normal.at(2, 1).x(), 0.5, kEpsilon);
+    EXPECT_NEAR(normal.at(2, 1).z(), 1.25, kEpsilon);
+    for (const std::string& path : paths) {
+        std::remove(path.c_str());
+    }
+
+    EXPECT_THROW(export_aovs(buffers, TempPath("missing_dir/aov")), std::runtime_error);
+}
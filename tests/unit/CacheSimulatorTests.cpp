@@ -0,0 +1,55 @@
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+
+#include "raytracer/CacheSimulator.h"
+
+TEST(CacheSimulatorTests, RepeatedAccessHitsAfterFirstMiss) {
+    CacheSimulator cache(1024, 64, 2);
+    alignas(64) char data[64] = {};
+
+    cache.access(data, 8);
+    cache.access(data + 8, 8);
+    EXPECT_EQ(cache.accesses, 2u);
+    EXPECT_EQ(cache.misses, 1u);
+}
+
+TEST(CacheSimulatorTests, AccessSpanningLinesTouchesEach) {
+    CacheSimulator cache(1024, 64, 2);
+    alignas(64) char data[256] = {};
+
+    cache.access(data + 32, 64);
+    EXPECT_EQ(cache.accesses, 2u);
+    EXPECT_EQ(cache.misses, 2u);
+}
+
+TEST(CacheSimulatorTests, EvictsLeastRecentlyUsedWay) {
+    // One set with two ways: a third line evicts whichever was used longest ago.
+    CacheSimulator cache(128, 64, 2);
+    alignas(64) char data[192] = {};
+
+    cache.access(data, 1);
+    cache.access(data + 64, 1);
+    cache.access(data, 1);
+    cache.access(data + 128, 1);
+    EXPECT_EQ(cache.misses, 3u);
+
+    cache.access(data, 1);
+    EXPECT_EQ(cache.misses, 3u);
+    cache.access(data + 64, 1);
+    EXPECT_EQ(cache.misses, 4u);
+}
+
+TEST(CacheSimulatorTests, ResetForgetsContents) {
+    CacheSimulator cache(1024, 64, 2);
+    alignas(64) char data[64] = {};
+    cache.access(data, 1);
+    cache.reset();
+    EXPECT_EQ(cache.misses, 0u);
+    cache.access(data, 1);
+    EXPECT_EQ(cache.misses, 1u);
+}
+
+TEST(CacheSimulatorTests, RejectsCapacityBelowOneSet) {
+    EXPECT_THROW(CacheSimulator(64, 64, 2), std::invalid_argument);
+}
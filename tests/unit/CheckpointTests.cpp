@@ -0,0 +1,126 @@
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <string>
+
+#include "TestScenes.h"
+#include "raytracer/Checkpoint.h"
+
+namespace {
+CheckpointSettings SettingsFor(const ProgressiveRenderer& renderer) {
+    CheckpointSettings settings;
+    settings.width = renderer.width();
+    settings.height = renderer.height();
+    settings.max_depth = 3;
+    settings.samples = 4;
+    settings.scene_seed = 7;
+    settings.sample_seed = renderer.seed();
+    return settings;
+}
+
+CameraParams LowView() {
+    CameraParams view;
+    view.lookfrom = Point3(6, 1.5, 2);
+    view.lookat = Point3(0, 1, 0);
+    return view;
+}
+
+void RenderPasses(ProgressiveRenderer& renderer, int passes) {
+    for (int pass = 0; pass < passes; ++pass) {
+        renderer.render_pass([](int, int, int, int) {});
+    }
+}
+}
+
+TEST(CheckpointTests, ResumedFilmMatchesUninterruptedRender) {
+    const TestScene scene;
+    const std::string path = TempPath("checkpoint_resume.rtck");
+
+    ProgressiveRenderer uninterrupted(scene.world, scene.lights, 24, 16, ShallowSettings(), 8, 2);
+    uninterrupted.set_camera(LowView());
+    RenderPasses(uninterrupted, 2 + 4);  // two preview stages, then four passes
+
+    ProgressiveRenderer first(scene.world, scene.lights, 24, 16, ShallowSettings(), 8, 2);
+    first.set_camera(LowView());
+    RenderPasses(first, 2 + 2);
+    {
+        CheckpointWriter writer(path, SettingsFor(first), scene.objects);
+        // Nothing to save before the first full pass.
+        const ProgressiveRenderer fresh(scene.world, scene.lights, 24, 16);
+        EXPECT_FALSE(writer.submit(fresh));
+        ASSERT_TRUE(writer.submit(first));
+        writer.wait();
+        EXPECT_EQ(writer.written(), 1u);
+        EXPECT_TRUE(writer.error().empty());
+    }
+
+    EXPECT_EQ(read_checkpoint_settings(path).scene_seed, 7u);
+    Checkpoint checkpoint = load_checkpoint(path, scene.objects);
+    EXPECT_EQ(checkpoint.passes, 2);
+    EXPECT_EQ(checkpoint.settings.width, 24);
+    EXPECT_EQ(checkpoint.view.lookfrom.x(), 6.0);
+    ProgressiveRenderer resumed(scene.world, scene.lights, 24, 16, ShallowSettings(), 8, 2);
+    resumed.set_seed(checkpoint.settings.sample_seed);
+    resumed.resume(checkpoint.view, checkpoint.passes, std::move(checkpoint.film));
+    RenderPasses(resumed, 2);
+
+    ASSERT_EQ(resumed.passes(), uninterrupted.passes());
+    for (int y = 0; y < 16; ++y) {
+        for (int x = 0; x < 24; ++x) {
+            const PixelAccumulator& a = uninterrupted.pixel(x, y);
+            const PixelAccumulator& b = resumed.pixel(x, y);
+            ASSERT_EQ(a.samples(), b.samples());
+            // Bit for bit: the same samples were added in the same order.
+            EXPECT_EQ(a.mean().x(), b.mean().x());
+            EXPECT_EQ(a.mean().z(), b.mean().z());
+            EXPECT_EQ(a.depth(), b.depth());
+            EXPECT_EQ(a.object(), b.object());
+        }
+    }
+    std::remove(path.c_str());
+}
+
+TEST(CheckpointTests, TornSlotFallsBackToPreviousCheckpoint) {
+    const TestScene scene;
+    const std::string path = TempPath("checkpoint_torn.rtck");
+    ProgressiveRenderer renderer(scene.world, scene.lights, 8, 8, ShallowSettings());
+    {
+        CheckpointWriter writer(path, SettingsFor(renderer), scene.objects);
+        RenderPasses(renderer, 1);
+        ASSERT_TRUE(writer.submit(renderer));
+        writer.wait();
+        RenderPasses(renderer, 1);
+        ASSERT_TRUE(writer.submit(renderer));
+        writer.wait();
+    }
+    EXPECT_EQ(load_checkpoint(path, scene.objects).passes, 2);
+
+    // A writer for the same render continues the sequence.
+    {
+        CheckpointWriter writer(path, SettingsFor(renderer), scene.objects);
+        RenderPasses(renderer, 1);
+        ASSERT_TRUE(writer.submit(renderer));
+        writer.wait();
+    }
+    const Checkpoint latest = load_checkpoint(path, scene.objects);
+    EXPECT_EQ(latest.passes, 3);
+    EXPECT_EQ(latest.sequence, 3u);
+
+    // Corrupt the sample count of a record in the newest slot (sequence 3
+    // lives in slot 1; header and slot headers take 256 bytes, records 112).
+    {
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        const std::streamoff slot = 256 + 256 + 64 * 112;
+        file.seekp(slot + 256 + 5 * 112 + 96);
+        file.put('\xff');
+    }
+    const Checkpoint fallback = load_checkpoint(path, scene.objects);
+    EXPECT_EQ(fallback.passes, 2);
+    EXPECT_EQ(fallback.film[0].samples(), 2);
+
+    std::remove(path.c_str());
+    EXPECT_THROW(load_checkpoint(path, scene.objects), std::runtime_error);
+    EXPECT_THROW(renderer.resume(CameraParams(), 1, std::vector<PixelAccumulator>(3)), std::invalid_argument);
+}
@@ -0,0 +1,122 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "raytracer/Denoiser.h"
+
+namespace {
+constexpr double kEpsilon = 1e-9;
+
+// Flat floor seen head-on: every pixel at the same depth, facing the camera.
+DenoiseFeatures FlatFeatures(int width, int height) {
+    DenoiseFeatures features(width, height);
+    for (size_t i = 0; i < features.size(); ++i) {
+        features.normal[i] = Vec3(0, 0, 1);
+        features.depth[i] = 5.0f;
+    }
+    return features;
+}
+
+double Rmse(const std::vector<Color>& image, const std::vector<Color>& truth) {
+    double sum = 0.0;
+    for (size_t i = 0; i < image.size(); ++i) {
+        sum += (image[i] - truth[i]).length_squared() / 3.0;
+    }
+    return std::sqrt(sum / image.size());
+}
+}
+
+TEST(DenoiserTests, AccumulatorAveragesFeaturesAndEstimatesVariance) {
+    PixelAccumulator pixel;
+    HitFeatures hit;
+    hit.albedo = Color(0.5, 0.5, 0.5);
+    hit.normal = Vec3(0, 1, 0);
+    hit.depth = 2.0;
+    pixel.add(Color(1, 1, 1), hit);
+    pixel.add(Color(3, 3, 3), hit);
+    pixel.add(Color(2, 2, 2), HitFeatures());
+
+    DenoiseFeatures features(1, 1);
+    pixel.resolve(features, 0);
+    EXPECT_EQ(pixel.samples(), 3);
+    EXPECT_NEAR(pixel.mean().y(), 2.0, kEpsilon);
+    EXPECT_NEAR(features.albedo[0].x(), 2.0 / 3.0, kEpsilon);
+    EXPECT_NEAR(features.normal[0].y(), 1.0, kEpsilon);
+    EXPECT_NEAR(features.depth[0], 2.0, 1e-6);
+    // Sample variance 1, so the mean of three samples has variance 1/3.
+    EXPECT_NEAR(features.variance[0], 1.0 / 3.0, 1e-6);
+
+    EXPECT_THROW(DenoiseFeatures(0, 4), std::invalid_argument);
+}
+
+TEST(DenoiserTests, TracePathReportsFirstHit) {
+    HitableList objects;
+    objects.add(std::make_shared<Plane>(Point3(0, 0, 0), Vec3(0, 1, 0), std::make_shared<Lambertian>(Color(0.2, 0.4, 0.6))));
+    const Scene world(objects);
+    const LightList lights(objects);
+
+    HitFeatures hit;
+    trace_path(Ray(Point3(0, 2, 0), Vec3(0, -2, 0)), world, lights, PathTracerSettings(), &hit);
+    EXPECT_NEAR(hit.albedo.z(), 0.6, kEpsilon);
+    EXPECT_NEAR(hit.normal.y(), 1.0, kEpsilon);
+    EXPECT_NEAR(hit.depth, 2.0, 1e-6);
+
+    HitFeatures escaped;
+    trace_path(Ray(Point3(0, 2, 0), Vec3(0, 1, 0)), world, lights, PathTracerSettings(), &escaped);
+    EXPECT_EQ(escaped.depth, infinity);
+    EXPECT_NEAR(escaped.albedo.x(), 1.0, kEpsilon);
+}
+
+TEST(DenoiserTests, SmoothsNoiseOnFlatSurfaces) {
+    const int width = 64;
+    const int height = 48;
+    DenoiseFeatures features = FlatFeatures(width, height);
+    std::mt19937 rng(7);
+    std::normal_distribution<double> noise(0.0, 0.2);
+    const std::vector<Color> truth(features.size(), Color(0.5, 0.5, 0.5));
+    std::vector<Color> noisy(features.size());
+    for (size_t i = 0; i < noisy.size(); ++i) {
+        const double n = noise(rng);
+        noisy[i] = truth[i] + Color(n, n, n);
+        features.variance[i] = 0.04f;
+    }
+
+    const std::vector<Color> filtered = denoise(noisy, features);
+    EXPECT_LT(Rmse(filtered, truth), 0.2 * Rmse(noisy, truth));
+    EXPECT_EQ(denoise(noisy, features, DenoiseSettings{0}).size(), noisy.size());
+}
+
+TEST(DenoiserTests, KeepsGeometricEdgesAndAlbedoTexture) {
+    const int width = 32;
+    const int height = 32;
+    DenoiseFeatures features = FlatFeatures(width, height);
+    std::vector<Color> color(features.size());
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            const size_t i = static_cast<size_t>(y) * width + x;
+            // Left half faces the camera and is dark, right half faces sideways
+            // and is bright; a 1-pixel albedo checkerboard on top.
+            const bool right = x >= width / 2;
+            features.normal[i] = right ? Vec3(1, 0, 0) : Vec3(0, 0, 1);
+            features.albedo[i] = (x + y) % 2 ? Color(0.2, 0.2, 0.2) : Color(0.8, 0.8, 0.8);
+            features.variance[i] = 0.01f;
+            color[i] = features.albedo[i] * (right ? 2.0 : 0.5);
+        }
+    }
+
+    const std::vector<Color> filtered = denoise(color, features);
+    for (size_t i = 0; i < color.size(); ++i) {
+        EXPECT_NEAR(filtered[i].x(), color[i].x(), 1e-9) << i;
+    }
+}
+
+TEST(DenoiserTests, RejectsMismatchedBuffers) {
+    const DenoiseFeatures features = FlatFeatures(8, 8);
+    EXPECT_THROW(denoise(std::vector<Color>(10), features), std::invalid_argument);
+    DenoiseSettings settings;
+    settings.iterations = -1;
+    EXPECT_THROW(denoise(std::vector<Color>(64), features, settings), std::invalid_argument);
+}
@@ -0,0 +1,395 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "TestScenes.h"
+#include "raytracer/Distributed.h"
+#include "raytracer/Environment.h"
+#include "raytracer/ImageExport.h"
+
+namespace {
+HitableList LoadScene(const std::string& name) {
+    if (name != "floor") {
+        throw std::invalid_argument("unknown scene " + name);
+    }
+    return FloorAndBall();
+}
+
+DistributedJob SmallJob() {
+    DistributedJob job;
+    job.tiles.width = 45;
+    job.tiles.height = 30;
+    job.tiles.tile_size = 16;
+    job.tiles.samples = 2;
+    job.tiles.aovs = AovSet{AovChannel::Depth, AovChannel::Normal};
+    job.view.lookfrom = Point3(0, 2, 6);
+    job.view.lookat = Point3(0, 1, 0);
+    job.view.aperture = 0.0;
+    job.max_depth = 4;
+    job.scene = "floor";
+    return job;
+}
+
+// Every tile of `job` as render_tiled() makes it, by tile index.
+std::vector<std::vector<float>> ReferenceTiles(const DistributedJob& job) {
+    const HitableList objects = FloorAndBall();
+    const Scene world(objects);
+    const std::unique_ptr<LightSampler> lights = make_light_sampler(objects, job.light_selection);
+    const AovIds ids(objects);
+    PathTracerSettings path_settings;
+    path_settings.max_depth = job.max_depth;
+    if (!job.environment.empty()) {
+        path_settings.environment = std::make_shared<EnvironmentMap>(load_hdr_image(job.environment));
+    }
+    const int tile = job.tiles.tile_size;
+    const int tiles_x = (job.tiles.width + tile - 1) / tile;
+    const int tiles_y = (job.tiles.height + tile - 1) / tile;
+    const size_t floats = static_cast<size_t>(tile) * tile * tiled_planes(job.tiles.aovs);
+    std::vector<std::vector<float>> tiles(static_cast<size_t>(tiles_x) * tiles_y);
+    render_tiled(world, *lights, job.view, path_settings, job.tiles, ids, "",
+                 [&](int x0, int y0, int, int, const float* data) {
+                     tiles[static_cast<size_t>(y0 / tile) * tiles_x + x0 / tile].assign(data, data + floats);
+                 });
+    return tiles;
+}
+
+// Tiles of a distributed render, checked against the reference as they come.
+struct Collector {
+    explicit Collector(const DistributedJob& job) : job(job), reference(ReferenceTiles(job)), seen(reference.size()) {}
+
+    void operator()(int x0, int y0, int x1, int y1, const float* data) {
+        const int tile = job.tiles.tile_size;
+        const int tiles_x = (job.tiles.width + tile - 1) / tile;
+        const size_t index = static_cast<size_t>(y0 / tile) * tiles_x + x0 / tile;
+        EXPECT_EQ(x1, std::min(x0 + tile, job.tiles.width));
+        EXPECT_EQ(y1, std::min(y0 + tile, job.tiles.height));
+        ASSERT_LT(index, reference.size());
+        EXPECT_FALSE(seen[index]) << index;
+        seen[index] = true;
+        EXPECT_EQ(std::memcmp(data, reference[index].data(), reference[index].size() * sizeof(float)), 0) << index;
+    }
+
+    bool complete() const {
+        return std::all_of(seen.begin(), seen.end(), [](bool tile) { return tile; });
+    }
+
+    DistributedJob job;
+    std::vector<std::vector<float>> reference;
+    std::vector<bool> seen;
+};
+}
+
+TEST(DistributedTests, PackedFloatsRoundTrip) {
+    std::vector<float> values;
+    for (int i = 0; i < 1000; ++i) {
+        values.push_back(0.5f);  // runs
+    }
+    uint64_t state = 7;
+    for (int i = 0; i < 3001; ++i) {
+        state = splitmix64(state);
+        values.push_back(static_cast<float>(state >> 40) / (1 << 20));
+    }
+    values.push_back(std::numeric_limits<float>::infinity());
+    values.push_back(-0.0f);
+    values.push_back(std::numeric_limits<float>::quiet_NaN());
+    values.push_back(std::numeric_limits<float>::denorm_min());
+
+    std::vector<unsigned char> packed;
+    distributed_detail::pack_floats(values.data(), values.size(), packed);
+    std::vector<float> unpacked(values.size());
+    distributed_detail::unpack_floats(packed.data(), packed.size(), unpacked.data(), unpacked.size());
+    EXPECT_EQ(std::memcmp(values.data(), unpacked.data(), values.size() * sizeof(float)), 0);
+
+    std::vector<unsigned char> constant;
+    distributed_detail::pack_floats(values.data(), 1000, constant);
+    EXPECT_LT(constant.size(), 100u);
+    EXPECT_THROW(distributed_detail::unpack_floats(packed.data(), packed.size() - 1, unpacked.data(), unpacked.size()),
+                 std::runtime_error);
+    EXPECT_THROW(distributed_detail::unpack_floats(packed.data(), packed.size(), unpacked.data(), unpacked.size() - 1),
+                 std::runtime_error);
+}
+
+TEST(DistributedTests, JobRoundTrip) {
+    DistributedJob job = SmallJob();
+    job.tiles.seed = 99;
+    job.view.vfov = 35.0;
+    job.scene_seed = 12;
+    job.environment = "sky.hdr";
+    job.light_selection = LightSelection::Bvh;
+    const DistributedJob decoded = distributed_detail::decode_job(distributed_detail::encode_job(job));
+    EXPECT_EQ(decoded.tiles.width, job.tiles.width);
+    EXPECT_EQ(decoded.tiles.seed, job.tiles.seed);
+    EXPECT_TRUE(decoded.tiles.aovs.contains(AovChannel::Normal));
+    EXPECT_FALSE(decoded.tiles.aovs.contains(AovChannel::Albedo));
+    EXPECT_EQ(decoded.view.vfov, job.view.vfov);
+    EXPECT_EQ(decoded.max_depth, job.max_depth);
+    EXPECT_EQ(decoded.scene, job.scene);
+    EXPECT_EQ(decoded.scene_seed, job.scene_seed);
+    EXPECT_EQ(decoded.environment, job.environment);
+    EXPECT_EQ(decoded.light_selection, LightSelection::Bvh);
+
+    std::vector<unsigned char> payload = distributed_detail::encode_job(job);
+    payload.back() = 7;  // light selection, last little-endian u32
+    payload[payload.size() - 4] = 0;
+    EXPECT_THROW(distributed_detail::decode_job(payload), std::runtime_error);
+}
+
+TEST(DistributedTests, WorkersReproduceRenderTiled) {
+#ifdef _WIN32
+    GTEST_SKIP() << "POSIX sockets only";
+#endif
+    const DistributedJob job = SmallJob();
+    const std::string socket_path = TempPath("distributed_test.sock");
+    for (const std::string& address : {"unix:" + socket_path, std::string("127.0.0.1:0")}) {
+        RenderCoordinator coordinator(address);
+        std::vector<std::thread> workers;
+        std::vector<size_t> traced(3, 0);
+        for (size_t i = 0; i < traced.size(); ++i) {
+            workers.emplace_back([&, i] {
+                WorkerOptions options;
+                options.threads = 1 + static_cast<int>(i);
+                traced[i] = run_render_worker(coordinator.address(), LoadScene, options);
+            });
+        }
+        Collector collector(job);
+        const DistributedStats stats = coordinator.render(job, std::ref(collector));
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+        EXPECT_TRUE(collector.complete()) << address;
+        EXPECT_EQ(stats.tiles, collector.reference.size());
+        EXPECT_EQ(stats.workers, 3);
+        EXPECT_EQ(stats.workers_lost, 0);
+        size_t received = 0;
+        for (size_t tiles : stats.tiles_per_worker) {
+            received += tiles;
+        }
+        EXPECT_EQ(received, stats.tiles);
+        EXPECT_GE(traced[0] + traced[1] + traced[2], stats.tiles);
+        EXPECT_LT(stats.wire_bytes, stats.raw_bytes);
+    }
+}
+
+TEST(DistributedTests, StreamsIntoAnExporterPastItsWindow) {
+#ifdef _WIN32
+    GTEST_SKIP() << "POSIX sockets only";
+#endif
+    // A tall strip of small tiles: with four workers of four threads, many
+    // more tiles are in flight than the one-band export window holds.
+    DistributedJob job = SmallJob();
+    job.tiles.width = 8;
+    job.tiles.height = 320;
+    job.tiles.tile_size = 8;
+    job.tiles.samples = 1;
+    job.tiles.aovs = AovSet();
+    const std::string path = TempPath("distributed_export.pfm");
+    ExportOptions export_options;
+    export_options.max_pending_bands = 1;
+    {
+        ImageExporter exporter(path, job.tiles.width, job.tiles.height, AovSet(), export_options);
+        DeferredExport deferred(exporter);
+        RenderCoordinator coordinator("unix:" + TempPath("distributed_export.sock"));
+        std::vector<std::thread> workers;
+        for (int i = 0; i < 4; ++i) {
+            workers.emplace_back([&] {
+                WorkerOptions options;
+                options.threads = 4;
+                run_render_worker(coordinator.address(), LoadScene, options);
+            });
+        }
+        coordinator.render(job, [&](int x0, int y0, int x1, int y1, const float* planes) {
+            deferred.submit(x0, y0, x1, y1, planes, 8, 64);
+        });
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+        deferred.flush();
+        exporter.wait();
+    }
+
+    const std::vector<std::vector<float>> reference = ReferenceTiles(job);
+    const HdrImage image = load_pfm(path);
+    ASSERT_EQ(image.width, 8);
+    ASSERT_EQ(image.height, 320);
+    for (int y = 0; y < 320; ++y) {
+        for (int x = 0; x < 8; ++x) {
+            for (int c = 0; c < 3; ++c) {
+                ASSERT_EQ(static_cast<float>(image.at(x, y)[c]), reference[y / 8][c * 64 + (y % 8) * 8 + x])
+                    << x << ", " << y;
+            }
+        }
+    }
+    std::remove(path.c_str());
+}
+
+TEST(DistributedTests, WorkersLoadTheEnvironment) {
+#ifdef _WIN32
+    GTEST_SKIP() << "POSIX sockets only";
+#endif
+    DistributedJob job = SmallJob();
+    job.environment = TempPath("distributed_sky.pfm");
+    {
+        std::ofstream out(job.environment, std::ios::binary);
+        out << "PF\n4 2\n-1.0\n";
+        // A bright upper half over a dim lower one.
+        const float raster[24] = {0.1f, 0.1f, 0.1f, 0.1f, 0.1f, 0.1f, 0.1f, 0.1f, 0.1f, 0.1f, 0.1f, 0.1f,
+                                  4.0f, 3.0f, 2.0f, 4.0f, 3.0f, 2.0f, 8.0f, 6.0f, 4.0f, 4.0f, 3.0f, 2.0f};
+        out.write(reinterpret_cast<const char*>(raster), sizeof(raster));
+    }
+    {
+        RenderCoordinator coordinator("unix:" + TempPath("distributed_sky.sock"));
+        std::thread worker([&] { run_render_worker(coordinator.address(), LoadScene); });
+        Collector collector(job);
+        coordinator.render(job, std::ref(collector));
+        worker.join();
+        EXPECT_TRUE(collector.complete());
+        EXPECT_NE(collector.reference, ReferenceTiles(SmallJob()));
+    }
+    std::remove(job.environment.c_str());
+
+    // A worker that cannot load the map tells the coordinator and leaves.
+    RenderCoordinator coordinator("unix:" + TempPath("distributed_sky.sock"));
+    std::thread worker([&] {
+        try {
+            run_render_worker(coordinator.address(), LoadScene);
+            ADD_FAILURE() << "the worker rendered without its environment";
+        } catch (const std::runtime_error& error) {
+            EXPECT_NE(std::string(error.what()).find("environment"), std::string::npos) << error.what();
+        }
+    });
+    CoordinatorOptions options;
+    options.connect_timeout_seconds = 0.5;
+    EXPECT_THROW(coordinator.render(job, [](int, int, int, int, const float*) {}, options), std::runtime_error);
+    worker.join();
+}
+
+TEST(DistributedTests, ReassignsTilesOfLostWorkers) {
+#ifdef _WIN32
+    GTEST_SKIP() << "POSIX sockets only";
+#endif
+    using namespace distributed_detail;
+    const DistributedJob job = SmallJob();
+    RenderCoordinator coordinator("unix:" + TempPath("distributed_lost.sock"));
+    const auto join = [&](uint32_t threads) {
+        Socket socket = connect_socket(parse_address(coordinator.address()));
+        Writer hello;
+        hello.u32(kMagic);
+        hello.u32(kVersion);
+        hello.u32(threads);
+        send_message(socket.fd(), kHello, hello.bytes);
+        return socket;
+    };
+    // Takes five tiles and disconnects without a result.
+    Socket quitter = join(4);
+    ASSERT_GE(quitter.fd(), 0);
+    std::thread quitting([&] {
+        std::vector<unsigned char> input;
+        Message message;
+        int tiles = 0;
+        while (tiles < 5 && read_message(quitter.fd(), input, message)) {
+            tiles += message.type == kTile ? 1 : 0;
+        }
+        EXPECT_EQ(tiles, 5);
+        quitter.reset();
+    });
+    // Takes two tiles and goes silent.
+    const Socket silent = join(1);
+    // A worker whose scene fails tells the coordinator before it leaves;
+    // then one that renders everything.
+    std::thread workers([&] {
+        EXPECT_THROW(run_render_worker(coordinator.address(),
+                                       [](const std::string&) -> HitableList { throw std::runtime_error("disk on fire"); }),
+                     std::runtime_error);
+        WorkerOptions options;
+        options.threads = 2;
+        run_render_worker(coordinator.address(), LoadScene, options);
+    });
+
+    CoordinatorOptions options;
+    options.worker_timeout_seconds = 0.5;
+    options.duplicate_stragglers = false;
+    Collector collector(job);
+    const DistributedStats stats = coordinator.render(job, std::ref(collector), options);
+    quitting.join();
+    workers.join();
+    EXPECT_TRUE(collector.complete());
+    EXPECT_EQ(stats.tiles, collector.reference.size());
+    EXPECT_EQ(stats.workers, 4);
+    EXPECT_EQ(stats.workers_lost, 3);
+    EXPECT_GE(stats.reassigned_tiles, 7u);
+    EXPECT_EQ(stats.duplicated_tiles, 0u);
+    EXPECT_NE(stats.last_worker_error.find("disk on fire"), std::string::npos);
+    EXPECT_EQ(stats.tiles_per_worker.back(), stats.tiles);
+}
+
+TEST(DistributedTests, ReassignsTilesOfCorruptResults) {
+#ifdef _WIN32
+    GTEST_SKIP() << "POSIX sockets only";
+#endif
+    using namespace distributed_detail;
+    const DistributedJob job = SmallJob();
+    RenderCoordinator coordinator("unix:" + TempPath("distributed_corrupt.sock"));
+    // Answers its first tile with data that does not unpack, then renders
+    // the frame as a real worker.
+    std::thread workers([&] {
+        Socket socket = connect_socket(parse_address(coordinator.address()));
+        Writer hello;
+        hello.u32(kMagic);
+        hello.u32(kVersion);
+        hello.u32(1);
+        send_message(socket.fd(), kHello, hello.bytes);
+        std::vector<unsigned char> input;
+        Message message;
+        while (read_message(socket.fd(), input, message) && message.type != kTile) {
+        }
+        ASSERT_EQ(message.type, kTile);
+        const uint32_t tile = Reader(message.payload.data(), message.payload.size()).u32();
+        Writer result;
+        result.u32(tile);
+        result.u32(static_cast<uint32_t>(tiled_detail::tile_floats(job.tiles.tile_size, tiled_planes(job.tiles.aovs))));
+        result.bytes.push_back(0x7f);  // a literal run with no bytes after it
+        send_message(socket.fd(), kResult, result.bytes);
+        while (read_message(socket.fd(), input, message)) {
+        }
+        run_render_worker(coordinator.address(), LoadScene);
+    });
+
+    CoordinatorOptions options;
+    options.duplicate_stragglers = false;
+    Collector collector(job);
+    const DistributedStats stats = coordinator.render(job, std::ref(collector), options);
+    workers.join();
+    EXPECT_TRUE(collector.complete());
+    EXPECT_EQ(stats.workers, 2);
+    EXPECT_EQ(stats.workers_lost, 1);
+    EXPECT_GE(stats.reassigned_tiles, 1u);
+    EXPECT_EQ(stats.tiles_per_worker.back(), stats.tiles);
+}
+
+TEST(DistributedTests, Errors) {
+    EXPECT_THROW(RenderCoordinator("nowhere"), std::invalid_argument);
+    EXPECT_THROW(RenderCoordinator("unix:"), std::invalid_argument);
+    EXPECT_THROW(RenderCoordinator("localhost:http"), std::invalid_argument);
+#ifndef _WIN32
+    WorkerOptions options;
+    options.connect_timeout_seconds = 0.1;
+    EXPECT_THROW(run_render_worker("unix:" + TempPath("distributed_nobody.sock"), LoadScene, options),
+                 std::runtime_error);
+
+    RenderCoordinator coordinator("127.0.0.1:0");
+    DistributedJob job = SmallJob();
+    CoordinatorOptions coordinator_options;
+    coordinator_options.connect_timeout_seconds = 0.1;
+    EXPECT_THROW(coordinator.render(job, {}, coordinator_options), std::runtime_error);
+    job.tiles.samples = 0;
+    EXPECT_THROW(coordinator.render(job, {}), std::invalid_argument);
+#endif
+}
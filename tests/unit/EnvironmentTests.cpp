@@ -0,0 +1,304 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "TestScenes.h"
+#include "raytracer/ImageExport.h"
+#include "raytracer/Integrator.h"
+
+namespace {
+constexpr double kEpsilon = 1e-9;
+
+// Dim sky with one bright texel standing in for the sun.
+HdrImage SunSky(int width, int height) {
+    HdrImage image;
+    image.width = width;
+    image.height = height;
+    image.pixels.assign(static_cast<size_t>(width) * height, Color(0.2, 0.3, 0.5));
+    image.pixels[static_cast<size_t>(height / 4) * width + width / 3] = Color(5000, 4000, 3000);
+    return image;
+}
+
+void PutLe32(std::string& out, uint32_t value) {
+    for (int shift = 0; shift < 32; shift += 8) {
+        out.push_back(static_cast<char>(value >> shift));
+    }
+}
+
+// Uncompressed scanline EXR with one HALF channel Y over the data window
+// (x0, y0) - (x0 + width - 1, y0 + height - 1).
+std::string HalfLuminanceExr(int x0, int y0, int width, int height, const std::vector<float>& values) {
+    std::string file("\x76\x2f\x31\x01\x02\x00\x00\x00", 8);
+    const auto attribute = [&](const std::string& name, const std::string& type, const std::string& value) {
+        file += name + '\0' + type + '\0';
+        PutLe32(file, static_cast<uint32_t>(value.size()));
+        file += value;
+    };
+    std::string channels("Y\0", 2);
+    PutLe32(channels, 1);  // HALF
+    PutLe32(channels, 0);  // pLinear, reserved
+    PutLe32(channels, 1);
+    PutLe32(channels, 1);
+    channels.push_back('\0');
+    attribute("channels", "chlist", channels);
+    attribute("compression", "compression", std::string(1, '\0'));
+    std::string window;
+    for (int v : {x0, y0, x0 + width - 1, y0 + height - 1}) {
+        PutLe32(window, static_cast<uint32_t>(v));
+    }
+    attribute("dataWindow", "box2i", window);
+    file.push_back('\0');
+
+    const size_t line_bytes = 8 + static_cast<size_t>(width) * 2;
+    const size_t first_line = file.size() + 8 * static_cast<size_t>(height);
+    for (int y = 0; y < height; ++y) {
+        const uint64_t offset = first_line + y * line_bytes;
+        PutLe32(file, static_cast<uint32_t>(offset));
+        PutLe32(file, static_cast<uint32_t>(offset >> 32));
+    }
+    for (int y = 0; y < height; ++y) {
+        PutLe32(file, static_cast<uint32_t>(y0 + y));
+        PutLe32(file, static_cast<uint32_t>(width * 2));
+        for (int x = 0; x < width; ++x) {
+            const uint16_t half = float_to_half(values[static_cast<size_t>(y) * width + x]);
+            file.push_back(static_cast<char>(half & 0xff));
+            file.push_back(static_cast<char>(half >> 8));
+        }
+    }
+    return file;
+}
+}
+
+TEST(EnvironmentTests, HalfRoundTripKeepsElevenSignificantBits) {
+    for (float value : {0.0f, 1.0f, -2.5f, 0.1f, 1234.5f, 6.1e-5f, 65504.0f}) {
+        const float restored = half_to_float(float_to_half(value));
+        EXPECT_NEAR(restored, value, std::fabs(value) / 2048.0 + 1e-7) << value;
+    }
+    EXPECT_EQ(half_to_float(float_to_half(1e6f)), 65504.0f);
+    EXPECT_EQ(float_to_half(1.0f), 0x3c00);
+    EXPECT_EQ(half_to_float(0x0001), std::ldexp(1.0f, -24));
+}
+
+TEST(EnvironmentTests, AliasTableSamplesProportionally) {
+    const std::vector<double> weights = {1.0, 0.0, 3.0, 6.0};
+    const AliasTable table(weights);
+    EXPECT_NEAR(table.pmf(2), 0.3, 1e-7);
+    EXPECT_EQ(table.pmf(1), 0.0);
+
+    std::vector<int> counts(weights.size(), 0);
+    const int samples = 100000;
+    for (int s = 0; s < samples; ++s) {
+        ++counts[table.sample((s + 0.5) / samples)];
+    }
+    for (size_t i = 0; i < weights.size(); ++i) {
+        EXPECT_NEAR(static_cast<double>(counts[i]) / samples, table.pmf(i), 1e-4) << i;
+    }
+
+    const AliasTable uniform(std::vector<double>{0.0, 0.0});
+    EXPECT_NEAR(uniform.pmf(0), 0.5, kEpsilon);
+    EXPECT_THROW(AliasTable(std::vector<double>{}), std::invalid_argument);
+    EXPECT_THROW(AliasTable(std::vector<double>{1.0, -1.0}), std::invalid_argument);
+}
+
+TEST(EnvironmentTests, DirectionAndTexelMappingAgree) {
+    double u = 0.0;
+    double v = 0.0;
+    EnvironmentMap::uv_of(Vec3(0, 1, 0), u, v);
+    EXPECT_NEAR(v, 0.0, kEpsilon);
+    EnvironmentMap::uv_of(Vec3(0, 0, 1), u, v);
+    EXPECT_NEAR(u, 0.25, kEpsilon);
+    EXPECT_NEAR(v, 0.5, kEpsilon);
+
+    const Vec3 d = EnvironmentMap::direction_of(0.7, 0.3);
+    EnvironmentMap::uv_of(d, u, v);
+    EXPECT_NEAR(u, 0.7, kEpsilon);
+    EXPECT_NEAR(v, 0.3, kEpsilon);
+
+    const EnvironmentMap map(SunSky(64, 32));
+    EXPECT_NEAR(map.eval(EnvironmentMap::direction_of((64 / 3 + 0.5) / 64.0, (32 / 4 + 0.5) / 32.0)).x(), 5000.0,
+                kEpsilon);
+}
+
+TEST(EnvironmentTests, PdfIntegratesToOneAndMatchesSampling) {
+    const EnvironmentMap map(SunSky(64, 32));
+
+    // Midpoint rule over (u, v); dw = 2 pi^2 sin(theta) du dv.
+    const int steps_u = 512;
+    const int steps_v = 256;
+    double integral = 0.0;
+    for (int j = 0; j < steps_v; ++j) {
+        for (int i = 0; i < steps_u; ++i) {
+            const double u = (i + 0.5) / steps_u;
+            const double v = (j + 0.5) / steps_v;
+            integral += map.pdf(EnvironmentMap::direction_of(u, v)) * 2.0 * pi * pi * std::sin(pi * v);
+        }
+    }
+    EXPECT_NEAR(integral / (steps_u * steps_v), 1.0, 1e-6);
+
+    // sample() reports the density pdf() gives; most samples land on the sun.
+    int sun = 0;
+    for (int s = 0; s < 10000; ++s) {
+        double pdf = 0.0;
+        const Vec3 direction = map.sample(pdf);
+        EXPECT_NEAR(direction.length(), 1.0, 1e-9);
+        EXPECT_NEAR(pdf, map.pdf(direction), 1e-6 * pdf);
+        if (map.eval(direction).x() > 1000.0) {
+            ++sun;
+        }
+    }
+    EXPECT_GT(sun, 8500);  // about 89% of the weighted luminance
+}
+
+TEST(EnvironmentTests, HalfStorageHalvesTexelMemory) {
+    const EnvironmentMap full(SunSky(64, 32), TexelFormat::Float32);
+    const EnvironmentMap half(SunSky(64, 32), TexelFormat::Float16);
+    EXPECT_EQ(full.memory_bytes() - half.memory_bytes(), 64u * 32u * 3u * 2u);
+    EXPECT_NEAR(half.texel(5, 5).y(), 0.3, 0.3 / 1024.0);
+    const Vec3 d = EnvironmentMap::direction_of(0.51, 0.66);
+    EXPECT_NEAR(half.pdf(d), full.pdf(d), 1e-3 * full.pdf(d));
+}
+
+TEST(EnvironmentTests, LoadsPfmBottomUp) {
+    const std::string path = TempPath("environment_test.pfm");
+    {
+        std::ofstream out(path, std::ios::binary);
+        out << "PF\n2 2\n-1.0\n";
+        // Little-endian rows, bottom row first.
+        const float raster[12] = {1, 0, 0, 0, 1, 0, 0, 0, 1, 4, 5, 6};
+        out.write(reinterpret_cast<const char*>(raster), sizeof(raster));
+    }
+    const HdrImage image = load_hdr_image(path);
+    std::remove(path.c_str());
+    ASSERT_EQ(image.width, 2);
+    ASSERT_EQ(image.height, 2);
+    EXPECT_NEAR(image.at(0, 1).x(), 1.0, kEpsilon);
+    EXPECT_NEAR(image.at(1, 1).y(), 1.0, kEpsilon);
+    EXPECT_NEAR(image.at(0, 0).z(), 1.0, kEpsilon);
+    EXPECT_NEAR(image.at(1, 0).z(), 6.0, kEpsilon);
+}
+
+TEST(EnvironmentTests, LoadsFlatAndRunLengthRgbe) {
+    const std::string path = TempPath("environment_test.hdr");
+    {
+        std::ofstream out(path, std::ios::binary);
+        out << "#?RADIANCE\nFORMAT=32-bit_rle_rgbe\n\n-Y 2 +X 8\n";
+        // Row 0 run-length encoded: every pixel (128, 64, 32) * 2^(129 - 136).
+        const unsigned char rle[] = {2, 2, 0, 8, 136, 128, 136, 64, 136, 32, 136, 129};
+        out.write(reinterpret_cast<const char*>(rle), sizeof(rle));
+        // Row 1 flat: black except pixel 3.
+        for (int x = 0; x < 8; ++x) {
+            const unsigned char pixel[4] = {static_cast<unsigned char>(x == 3 ? 200 : 0), 0, 0,
+                                            static_cast<unsigned char>(x == 3 ? 136 : 0)};
+            out.write(reinterpret_cast<const char*>(pixel), 4);
+        }
+    }
+    const HdrImage image = load_hdr_image(path);
+    std::remove(path.c_str());
+    ASSERT_EQ(image.width, 8);
+    ASSERT_EQ(image.height, 2);
+    EXPECT_NEAR(image.at(5, 0).x(), 128.5 / 128.0, kEpsilon);
+    EXPECT_NEAR(image.at(5, 0).z(), 32.5 / 128.0, kEpsilon);
+    EXPECT_NEAR(image.at(3, 1).x(), 200.5, kEpsilon);
+    EXPECT_NEAR(image.at(2, 1).x(), 0.0, kEpsilon);
+
+    EXPECT_THROW(load_hdr_image(TempPath("missing.hdr")), std::runtime_error);
+}
+
+TEST(EnvironmentTests, LoadsExrWrittenByTheExporter) {
+    constexpr int kWidth = 37;
+    constexpr int kHeight = 21;
+    std::vector<float> planes(static_cast<size_t>(4) * kWidth * kHeight);
+    for (size_t i = 0; i < planes.size(); ++i) {
+        planes[i] = 0.01f * static_cast<float>(i % 997) + (i % 5 == 0 ? 300.0f : 0.0f);
+    }
+    for (const ExrCompression compression : {ExrCompression::Zip, ExrCompression::None}) {
+        const std::string path = TempPath("environment_test.exr");
+        {
+            ExportOptions options;
+            options.exr_compression = compression;
+            // Stored as channels B, G, R, depth: the loader finds them by name.
+            ImageExporter exporter(path, kWidth, kHeight, AovSet{AovChannel::Depth}, options);
+            exporter.submit(0, 0, kWidth, kHeight, planes.data(), kWidth, static_cast<size_t>(kWidth) * kHeight);
+            exporter.wait();
+        }
+        const HdrImage image = load_hdr_image(path);
+        std::remove(path.c_str());
+        ASSERT_EQ(image.width, kWidth);
+        ASSERT_EQ(image.height, kHeight);
+        for (int y = 0; y < kHeight; ++y) {
+            for (int x = 0; x < kWidth; ++x) {
+                const size_t i = static_cast<size_t>(y) * kWidth + x;
+                const Color& pixel = image.at(x, y);
+                ASSERT_EQ(pixel.x(), planes[i]) << x << "," << y;
+                ASSERT_EQ(pixel.y(), planes[i + kWidth * kHeight]) << x << "," << y;
+                ASSERT_EQ(pixel.z(), planes[i + 2 * kWidth * kHeight]) << x << "," << y;
+            }
+        }
+    }
+}
+
+TEST(EnvironmentTests, LoadsHalfLuminanceExrAndRejectsTiles) {
+    const std::vector<float> values = {0.5f, 1.0f, 2.0f, 4.0f, 0.25f, 65504.0f};
+    std::string file = HalfLuminanceExr(2, -3, 3, 2, values);
+    const std::string path = TempPath("environment_half.exr");
+    std::ofstream(path, std::ios::binary) << file;
+    const HdrImage image = load_exr(path);
+    ASSERT_EQ(image.width, 3);
+    ASSERT_EQ(image.height, 2);
+    for (int i = 0; i < 6; ++i) {
+        const Color& pixel = image.at(i % 3, i / 3);
+        EXPECT_EQ(pixel.x(), values[i]);
+        EXPECT_EQ(pixel.y(), values[i]);
+        EXPECT_EQ(pixel.z(), values[i]);
+    }
+
+    file[5] = 0x02;  // tiled
+    std::ofstream(path, std::ios::binary) << file;
+    EXPECT_THROW(load_exr(path), std::runtime_error);
+    file[5] = 0;
+    std::ofstream(path, std::ios::binary) << file.substr(0, file.size() - 3);
+    EXPECT_THROW(load_exr(path), std::runtime_error);
+    std::remove(path.c_str());
+    EXPECT_THROW(load_hdr_image(TempPath("missing.exr")), std::runtime_error);
+}
+
+TEST(EnvironmentTests, SamplingMatchesBsdfOnlyWithLessVariance) {
+    HitableList objects;
+    objects.add(std::make_shared<Plane>(Point3(0, 0, 0), Vec3(0, 1, 0), std::make_shared<Lambertian>(Color(0.5, 0.5, 0.5))));
+    const Scene world(objects);
+    const LightList lights(objects);
+    PathTracerSettings settings;
+    settings.max_depth = 2;
+    settings.environment = std::make_shared<EnvironmentMap>(SunSky(32, 16));
+    const Ray ray(Point3(0, 1, 0), Vec3(0.3, -1, 0.1));
+
+    const auto estimate = [&](int samples, double& mean, double& variance) {
+        double sum = 0.0;
+        double sum_squares = 0.0;
+        for (int s = 0; s < samples; ++s) {
+            const double value = trace_path(ray, world, lights, settings).y();
+            sum += value;
+            sum_squares += value * value;
+        }
+        mean = sum / samples;
+        variance = sum_squares / samples - mean * mean;
+    };
+    double sampled_mean = 0.0;
+    double sampled_variance = 0.0;
+    double bsdf_mean = 0.0;
+    double bsdf_variance = 0.0;
+    const int sampled_samples = 20000;
+    const int bsdf_samples = 400000;
+    estimate(sampled_samples, sampled_mean, sampled_variance);
+    settings.sample_lights = false;
+    estimate(bsdf_samples, bsdf_mean, bsdf_variance);
+
+    const double standard_error = std::sqrt(sampled_variance / sampled_samples + bsdf_variance / bsdf_samples);
+    EXPECT_NEAR(sampled_mean, bsdf_mean, 5.0 * standard_error);
+    EXPECT_LT(sampled_variance * 20.0, bsdf_variance);
+}
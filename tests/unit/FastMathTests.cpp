@@ -0,0 +1,27 @@
+#include <gtest/gtest.h>
+
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+// Input checks as the app and CLI compile them: this executable gets their
+// release flags (-ffast-math among them), under which NaN and infinity
+// tests written as float comparisons may be folded away.
+#include "raytracer/Environment.h"
+
+namespace {
+// From memory, so the compiler cannot see the values at the checks.
+std::vector<double> Weights(double bad) {
+    volatile double stored = bad;
+    return {1.0, stored, 2.0};
+}
+}
+
+TEST(FastMathTests, AliasTableRejectsNanInfinityAndNegativeWeights) {
+    EXPECT_THROW(AliasTable(Weights(std::numeric_limits<double>::quiet_NaN())), std::invalid_argument);
+    EXPECT_THROW(AliasTable(Weights(std::numeric_limits<double>::infinity())), std::invalid_argument);
+    EXPECT_THROW(AliasTable(Weights(-std::numeric_limits<double>::infinity())), std::invalid_argument);
+    EXPECT_THROW(AliasTable(Weights(-1e-300)), std::invalid_argument);
+    EXPECT_NO_THROW(AliasTable(Weights(-0.0)));
+    EXPECT_NO_THROW(AliasTable(Weights(std::numeric_limits<double>::max() / 4)));
+}
@@ -0,0 +1,113 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <vector>
+
+#include "raytracer/FilmResolve.h"
+
+namespace {
+// The viewport's packing before the film resolve existed.
+uint32_t LegacyPack(const Color& color) {
+    const int ir = static_cast<int>(256 * clamp(std::sqrt(color.x()), 0.0, 0.999));
+    const int ig = static_cast<int>(256 * clamp(std::sqrt(color.y()), 0.0, 0.999));
+    const int ib = static_cast<int>(256 * clamp(std::sqrt(color.z()), 0.0, 0.999));
+    return (255u << 24) | (static_cast<uint32_t>(ir) << 16) | (static_cast<uint32_t>(ig) << 8) | static_cast<uint32_t>(ib);
+}
+
+int Code(float linear, const DisplaySettings& settings) {
+    return static_cast<int>(256 * std::min(display_value(linear, settings), 0.999f));
+}
+
+// Linear values from black to well past white, dense near zero.
+std::vector<float> Ramp(size_t count) {
+    std::vector<float> values(count);
+    for (size_t i = 0; i < count; ++i) {
+        const float t = static_cast<float>(i) / static_cast<float>(count - 1);
+        values[i] = 8.0f * t * t * t;
+    }
+    return values;
+}
+}
+
+TEST(FilmResolveTests, KernelMatchesReference) {
+    // Odd length so the lane tail runs too.
+    const std::vector<float> red = Ramp(4099);
+    std::vector<float> green(red.rbegin(), red.rend());
+    std::vector<float> blue(red.size());
+    for (size_t i = 0; i < blue.size(); ++i) {
+        blue[i] = red[(i * 7) % red.size()];
+    }
+    std::vector<uint32_t> argb(red.size());
+    std::vector<unsigned char> rgb(3 * red.size());
+    for (Tonemap tonemap : {Tonemap::Clamp, Tonemap::Reinhard, Tonemap::Aces}) {
+        for (DisplayTransfer transfer : {DisplayTransfer::Gamma2, DisplayTransfer::Srgb}) {
+            for (float exposure : {-1.0f, 0.0f, 1.5f}) {
+                DisplaySettings settings;
+                settings.tonemap = tonemap;
+                settings.transfer = transfer;
+                settings.exposure = exposure;
+                resolve_argb(red.data(), green.data(), blue.data(), red.size(), argb.data(), settings);
+                resolve_rgb8(red.data(), green.data(), blue.data(), red.size(), rgb.data(), settings);
+                for (size_t i = 0; i < red.size(); ++i) {
+                    const int codes[3] = {Code(red[i], settings), Code(green[i], settings), Code(blue[i], settings)};
+                    EXPECT_EQ(argb[i] >> 24, 255u);
+                    for (int c = 0; c < 3; ++c) {
+                        const int resolved = static_cast<int>((argb[i] >> (16 - 8 * c)) & 0xff);
+                        ASSERT_LE(std::abs(resolved - codes[c]), 1)
+                            << tonemap_name(tonemap) << " " << static_cast<int>(transfer) << " " << exposure << " "
+                            << i << ":" << c;
+                        ASSERT_EQ(rgb[3 * i + c], resolved);
+                    }
+                }
+            }
+        }
+    }
+}
+
+TEST(FilmResolveTests, DefaultsMatchLegacyPacking) {
+    const std::vector<float> ramp = Ramp(1001);
+    for (size_t i = 0; i < ramp.size(); ++i) {
+        const Color color(ramp[i], ramp[(i * 3) % ramp.size()], 0.5 * ramp[(i * 11) % ramp.size()]);
+        const uint32_t legacy = LegacyPack(color);
+        const uint32_t resolved = resolve_pixel(color);
+        for (int shift : {0, 8, 16, 24}) {
+            ASSERT_LE(std::abs(static_cast<int>((legacy >> shift) & 0xff) - static_cast<int>((resolved >> shift) & 0xff)), 1)
+                << i;
+        }
+    }
+    // Whole frames of Colors go through the same planar kernel.
+    std::vector<Color> colors;
+    for (size_t i = 0; i < 150; ++i) {
+        colors.emplace_back(ramp[i * 6], ramp[i], ramp[i * 2]);
+    }
+    std::vector<uint32_t> frame(colors.size());
+    resolve_argb(colors.data(), colors.size(), frame.data());
+    for (size_t i = 0; i < colors.size(); ++i) {
+        EXPECT_EQ(frame[i], resolve_pixel(colors[i]));
+    }
+}
+
+TEST(FilmResolveTests, OutOfRangeInputs) {
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    const float inf = std::numeric_limits<float>::infinity();
+    const float red[5] = {nan, -1.0f, inf, 1e30f, 0.0f};
+    const float green[5] = {0.0f, 0.0f, 0.0f, 0.0f, nan};
+    const float blue[5] = {0.0f, -inf, 0.0f, 0.0f, 0.0f};
+    uint32_t out[5];
+    resolve_argb(red, green, blue, 5, out);
+    EXPECT_EQ(out[0], 0xff000000u);
+    EXPECT_EQ(out[1], 0xff000000u);
+    EXPECT_EQ(out[2], 0xffff0000u);
+    EXPECT_EQ(out[3], 0xffff0000u);
+    EXPECT_EQ(out[4], 0xff000000u);
+}
+
+TEST(FilmResolveTests, TonemapNames) {
+    for (Tonemap tonemap : {Tonemap::Clamp, Tonemap::Reinhard, Tonemap::Aces}) {
+        EXPECT_EQ(tonemap_from_name(tonemap_name(tonemap)), tonemap);
+    }
+    EXPECT_THROW(tonemap_from_name("filmic"), std::invalid_argument);
+}
@@ -0,0 +1,372 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <string>
+
+#include "TestScenes.h"
+#include "raytracer/ImageExport.h"
+#include "raytracer/TiledImage.h"
+
+namespace {
+std::vector<unsigned char> ReadFile(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    return std::vector<unsigned char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+uint32_t Be32(const unsigned char* bytes) {
+    return (uint32_t{bytes[0]} << 24) | (uint32_t{bytes[1]} << 16) | (uint32_t{bytes[2]} << 8) | bytes[3];
+}
+
+uint32_t Le32(const unsigned char* bytes) {
+    return (uint32_t{bytes[3]} << 24) | (uint32_t{bytes[2]} << 16) | (uint32_t{bytes[1]} << 8) | bytes[0];
+}
+
+// Inflates a zlib stream; the decoder checks its header and Adler-32.
+std::vector<unsigned char> Unzlib(const std::vector<unsigned char>& stream) {
+    EXPECT_EQ(stream[0], 0x78);
+    return deflate_detail::zlib_decompress(stream.data(), stream.size(), SIZE_MAX);
+}
+
+// Plane p of pixel (x, y) in the test images.
+float Sample(int p, int x, int y) {
+    return p < 3 ? 0.01f * static_cast<float>((x * (p + 1) + y) % 97) : 100.0f * p + y + 0.5f * x;
+}
+
+// Submits a width x height image in tiles, last tile first.
+void SubmitTiles(ImageExporter& exporter, int tile) {
+    const int width = exporter.width();
+    const int height = exporter.height();
+    std::vector<float> planes(static_cast<size_t>(exporter.planes()) * tile * tile);
+    for (int y0 = (height - 1) / tile * tile; y0 >= 0; y0 -= tile) {
+        for (int x0 = (width - 1) / tile * tile; x0 >= 0; x0 -= tile) {
+            const int x1 = std::min(width, x0 + tile);
+            const int y1 = std::min(height, y0 + tile);
+            for (int p = 0; p < exporter.planes(); ++p) {
+                for (int y = y0; y < y1; ++y) {
+                    for (int x = x0; x < x1; ++x) {
+                        planes[(static_cast<size_t>(p) * tile + (y - y0)) * tile + (x - x0)] = Sample(p, x, y);
+                    }
+                }
+            }
+            exporter.submit(x0, y0, x1, y1, planes.data(), tile, static_cast<size_t>(tile) * tile);
+        }
+    }
+}
+
+// Channel name -> rows of floats of a scanline EXR written by ImageExporter.
+std::map<std::string, std::vector<float>> ReadExr(const std::vector<unsigned char>& file, int width, int height) {
+    EXPECT_EQ(Le32(file.data()), 20000630u);
+    size_t pos = 8;
+    std::vector<std::string> channels;
+    int lines = 0;
+    while (file[pos] != 0) {
+        const std::string name(reinterpret_cast<const char*>(&file[pos]));
+        pos += name.size() + 1;
+        pos += std::strlen(reinterpret_cast<const char*>(&file[pos])) + 1;
+        const uint32_t size = Le32(&file[pos]);
+        const unsigned char* value = &file[pos + 4];
+        if (name == "channels") {
+            for (size_t c = 0; value[c] != 0;) {
+                channels.emplace_back(reinterpret_cast<const char*>(value + c));
+                c += channels.back().size() + 1;
+                EXPECT_EQ(Le32(value + c), 2u);  // FLOAT
+                c += 16;
+            }
+        } else if (name == "compression") {
+            lines = value[0] == 3 ? 16 : 1;
+        } else if (name == "dataWindow") {
+            EXPECT_EQ(Le32(value + 8), static_cast<uint32_t>(width - 1));
+            EXPECT_EQ(Le32(value + 12), static_cast<uint32_t>(height - 1));
+        }
+        pos += 4 + size;
+    }
+    ++pos;
+    std::map<std::string, std::vector<float>> planes;
+    for (const std::string& name : channels) {
+        planes[name].assign(static_cast<size_t>(width) * height, -1.0f);
+    }
+    const size_t row_bytes = channels.size() * width * sizeof(float);
+    for (int block = 0; block < (height + lines - 1) / lines; ++block) {
+        const size_t offset = Le32(&file[pos + 8 * block]);
+        const int y0 = static_cast<int>(Le32(&file[offset]));
+        EXPECT_EQ(y0, block * lines);
+        const uint32_t size = Le32(&file[offset + 4]);
+        const int rows = std::min(lines, height - y0);
+        std::vector<unsigned char> raw(&file[offset + 8], &file[offset + 8] + size);
+        if (size < rows * row_bytes) {
+            raw = Unzlib(raw);
+            environment_detail::exr_unpredict(raw);
+        }
+        EXPECT_EQ(raw.size(), rows * row_bytes);
+        for (int r = 0; r < rows; ++r) {
+            for (size_t c = 0; c < channels.size(); ++c) {
+                std::memcpy(&planes[channels[c]][static_cast<size_t>(y0 + r) * width],
+                            &raw[r * row_bytes + c * width * sizeof(float)], width * sizeof(float));
+            }
+        }
+    }
+    return planes;
+}
+}
+
+TEST(ImageExportTests, DeflateChunksJoinIntoOneStream) {
+    const unsigned char check[] = "123456789";
+    EXPECT_EQ(export_detail::crc32(0, check, 9), 0xcbf43926u);
+    EXPECT_EQ(deflate_detail::adler32(1, check, 9), 0x091e01deu);
+
+    // Runs, repeats further back than a chunk and noise.
+    std::vector<unsigned char> data(200000);
+    uint64_t state = 1;
+    for (size_t i = 0; i < data.size(); ++i) {
+        state = splitmix64(state);
+        data[i] = i % 3000 < 1000 ? static_cast<unsigned char>(i / 7) : i % 3000 < 2000 ? 'a' : static_cast<unsigned char>(state);
+    }
+    std::vector<unsigned char> stream = {0x78, 0x01};
+    const size_t cuts[] = {0, 70001, 140002, data.size()};
+    uint32_t adler = 1;
+    for (int c = 0; c < 3; ++c) {
+        deflate_detail::deflate_chunk(data.data() + cuts[c], cuts[c + 1] - cuts[c], c == 2, stream);
+        adler = deflate_detail::adler32_combine(adler, deflate_detail::adler32(1, data.data() + cuts[c], cuts[c + 1] - cuts[c]),
+                                               cuts[c + 1] - cuts[c]);
+    }
+    export_detail::append_be32(stream, adler);
+    EXPECT_EQ(Unzlib(stream), data);
+    EXPECT_LT(stream.size(), data.size() / 2);
+    EXPECT_EQ(Unzlib(deflate_detail::zlib_compress(data.data(), 0)).size(), 0u);
+}
+
+TEST(ImageExportTests, InflatesZlibStreamsOfOtherEncoders) {
+    // zlib.compress(text, 9): one dynamic Huffman block.
+    const std::vector<unsigned char> stream = {
+        0x78, 0xda, 0xed, 0x94, 0x4b, 0x0a, 0x80, 0x30, 0x0c, 0x44, 0xaf, 0x92, 0x03, 0xb8, 0x68, 0x1b,
+        0xbf, 0xc7, 0x51, 0xa8, 0xb8, 0x28, 0x16, 0xb4, 0xe0, 0xf5, 0xbd, 0x41, 0xde, 0x22, 0x3b, 0x71,
+        0xfd, 0xe8, 0x34, 0x4c, 0x26, 0x13, 0x64, 0xab, 0xad, 0x95, 0x7c, 0x4b, 0xdd, 0x65, 0xcb, 0xf9,
+        0x92, 0x7a, 0x4a, 0x3b, 0xb2, 0x3c, 0x6b, 0x29, 0x9d, 0x44, 0x1b, 0xf7, 0x36, 0x5e, 0x40, 0x7c,
+        0xb4, 0x79, 0x1a, 0x6c, 0xae, 0xf0, 0x3e, 0x26, 0xd0, 0x9f, 0x6c, 0x0e, 0x38, 0xd1, 0xf7, 0x01,
+        0xc6, 0x57, 0xd0, 0x07, 0xf3, 0x23, 0x70, 0x90, 0x57, 0x58, 0x9e, 0xc2, 0xf8, 0x69, 0xf6, 0x71,
+        0xd2, 0xc7, 0xf9, 0x7c, 0xee, 0x90, 0xbb, 0xb4, 0x1d, 0xda, 0x2e, 0xa5, 0x63, 0xf2, 0x65, 0x93,
+        0xb2, 0xad, 0xce, 0xdb, 0xa2, 0xdb, 0x5c, 0x5c, 0xc5, 0x00, 0xde, 0x87, 0xbf, 0x94, 0xfe, 0x52,
+        0xfa, 0x62, 0x29, 0xbd, 0xb7, 0x2b, 0x7d, 0xd7,
+    };
+    std::string text;
+    for (int i = 0; i < 60; ++i) {
+        text += std::to_string(i * i % 37) + " bottles of beer on the wall, ";
+    }
+    const std::vector<unsigned char> out = Unzlib(stream);
+    EXPECT_EQ(std::string(out.begin(), out.end()), text);
+
+    EXPECT_THROW(deflate_detail::zlib_decompress(stream.data(), stream.size(), text.size() - 1), std::runtime_error);
+    std::vector<unsigned char> corrupt = stream;
+    corrupt[60] ^= 0x10;
+    EXPECT_THROW(deflate_detail::zlib_decompress(corrupt.data(), corrupt.size(), SIZE_MAX), std::runtime_error);
+    EXPECT_THROW(deflate_detail::zlib_decompress(stream.data(), 40, SIZE_MAX), std::runtime_error);
+}
+
+TEST(ImageExportTests, PngMatchesSubmittedTiles) {
+    const std::string path = TempPath("export_tiles.png");
+    ExportOptions options;
+    options.display.tonemap = Tonemap::Reinhard;
+    options.display.exposure = 1.0f;
+    options.display.transfer = DisplayTransfer::Srgb;
+    {
+        ImageExporter exporter(path, 37, 40, AovSet{AovChannel::Depth}, options);
+        SubmitTiles(exporter, 16);
+        const ExportResult result = exporter.wait();
+        EXPECT_GT(result.bytes, 0u);
+        EXPECT_GE(result.tail_ms, 0.0);
+    }
+    const std::vector<unsigned char> file = ReadFile(path);
+    ASSERT_GT(file.size(), 8u);
+    EXPECT_EQ(file[1], 'P');
+    std::vector<unsigned char> idat;
+    size_t pos = 8;
+    std::string last;
+    while (pos + 12 <= file.size()) {
+        const uint32_t length = Be32(&file[pos]);
+        const std::string type(reinterpret_cast<const char*>(&file[pos + 4]), 4);
+        EXPECT_EQ(Be32(&file[pos + 8 + length]), export_detail::crc32(0, &file[pos + 4], length + 4)) << type;
+        if (type == "IHDR") {
+            EXPECT_EQ(Be32(&file[pos + 8]), 37u);
+            EXPECT_EQ(Be32(&file[pos + 12]), 40u);
+        } else if (type == "IDAT") {
+            idat.insert(idat.end(), &file[pos + 8], &file[pos + 8] + length);
+        }
+        last = type;
+        pos += 12 + length;
+    }
+    EXPECT_EQ(last, "IEND");
+    EXPECT_EQ(pos, file.size());
+
+    const std::vector<unsigned char> raw = Unzlib(idat);
+    const size_t stride = 1 + 3 * 37;
+    ASSERT_EQ(raw.size(), 40 * stride);
+    for (int y = 0; y < 40; ++y) {
+        EXPECT_EQ(raw[y * stride], 1);  // Sub filter
+        unsigned char left[3] = {0, 0, 0};
+        for (int x = 0; x < 37; ++x) {
+            const uint32_t expected = resolve_pixel(Color(Sample(0, x, y), Sample(1, x, y), Sample(2, x, y)), options.display);
+            for (int c = 0; c < 3; ++c) {
+                left[c] = static_cast<unsigned char>(left[c] + raw[y * stride + 1 + 3 * x + c]);
+                ASSERT_EQ(left[c], (expected >> (16 - 8 * c)) & 0xff) << x << "," << y;
+            }
+        }
+    }
+    std::remove(path.c_str());
+}
+
+TEST(ImageExportTests, ExrKeepsEveryPlane) {
+    for (const ExrCompression compression : {ExrCompression::Zip, ExrCompression::None}) {
+        const std::string path = TempPath("export_planes.exr");
+        {
+            ExportOptions options;
+            options.exr_compression = compression;
+            options.max_pending_bands = 4;
+            ImageExporter exporter(path, 21, 35, AovSet{AovChannel::Depth, AovChannel::Normal}, options);
+            EXPECT_EQ(exporter.planes(), 7);
+            SubmitTiles(exporter, 8);
+            exporter.wait();
+        }
+        const auto planes = ReadExr(ReadFile(path), 21, 35);
+        const std::vector<std::string> names = {"R", "G", "B", "depth", "normal.X", "normal.Y", "normal.Z"};
+        ASSERT_EQ(planes.size(), names.size());
+        for (int p = 0; p < 7; ++p) {
+            const std::vector<float>& plane = planes.at(names[p]);
+            for (int y = 0; y < 35; ++y) {
+                for (int x = 0; x < 21; ++x) {
+                    ASSERT_EQ(plane[y * 21 + x], Sample(p, x, y)) << names[p] << " " << x << "," << y;
+                }
+            }
+        }
+        std::remove(path.c_str());
+    }
+}
+
+TEST(ImageExportTests, PfmRowsAndErrors) {
+    const std::string path = TempPath("export_rows.PFM");
+    {
+        ImageExporter exporter(path, 5, 18);
+        const std::vector<float> row(3 * 5 * 18, 0.25f);
+        // The top band only; close() fills the rest with zeros.
+        exporter.submit(0, 0, 5, 16, row.data(), 5, 5 * 18);
+        EXPECT_THROW(exporter.submit(0, 17, 6, 18, row.data(), 5, 5 * 18), std::invalid_argument);
+        exporter.wait();
+    }
+    const std::vector<unsigned char> file = ReadFile(path);
+    const std::string header = "PF\n5 18\n-1.0\n";
+    ASSERT_EQ(file.size(), header.size() + 5 * 18 * 3 * sizeof(float));
+    EXPECT_EQ(std::string(file.begin(), file.begin() + header.size()), header);
+    const auto value = [&](int x, int y) {
+        float v = 0.0f;
+        std::memcpy(&v, &file[header.size() + ((17 - y) * 5 + x) * 3 * sizeof(float)], sizeof(v));
+        return v;
+    };
+    EXPECT_EQ(value(0, 0), 0.25f);
+    EXPECT_EQ(value(4, 15), 0.25f);
+    EXPECT_EQ(value(4, 16), 0.0f);
+    std::remove(path.c_str());
+
+    EXPECT_THROW(image_format("frame.tiff"), std::invalid_argument);
+    EXPECT_EQ(image_format("frame.Exr"), ImageFormat::Exr);
+    EXPECT_THROW(ImageExporter(TempPath("missing/dir/frame.png"), 4, 4), std::runtime_error);
+    EXPECT_THROW(ImageExporter(TempPath("empty.png"), 0, 4), std::invalid_argument);
+}
+
+TEST(ImageExportTests, DeferredExportHoldsRegionsPastTheWindow) {
+    const std::string path = TempPath("export_deferred.pfm");
+    ExportOptions options;
+    options.max_pending_bands = 1;
+    {
+        ImageExporter exporter(path, 4, 64, AovSet(), options);
+        std::vector<float> band(3 * 4 * 16);
+        const auto fill = [&](int y0) {
+            for (int p = 0; p < 3; ++p) {
+                for (int i = 0; i < 4 * 16; ++i) {
+                    band[p * 4 * 16 + i] = Sample(p, i % 4, y0 + i / 4);
+                }
+            }
+        };
+        fill(48);
+        EXPECT_FALSE(exporter.try_submit(0, 48, 4, 64, band.data(), 4, 4 * 16));
+
+        // Bottom band first: a blocking submit() would wait here for good.
+        DeferredExport deferred(exporter);
+        for (int y0 = 48; y0 >= 0; y0 -= 16) {
+            fill(y0);
+            deferred.submit(0, y0, 4, y0 + 16, band.data(), 4, 4 * 16);
+        }
+        EXPECT_GE(deferred.peak_bytes(), 2 * band.size() * sizeof(float));
+        deferred.flush();
+        exporter.wait();
+    }
+    const std::vector<unsigned char> file = ReadFile(path);
+    const size_t header = std::string("PF\n4 64\n-1.0\n").size();
+    ASSERT_EQ(file.size(), header + 4 * 64 * 3 * sizeof(float));
+    for (int y = 0; y < 64; ++y) {
+        for (int x = 0; x < 4; ++x) {
+            float v = 0.0f;
+            std::memcpy(&v, &file[header + ((63 - y) * 4 + x) * 3 * sizeof(float)], sizeof(v));
+            ASSERT_EQ(v, Sample(0, x, y)) << x << ", " << y;
+        }
+    }
+    std::remove(path.c_str());
+}
+
+TEST(ImageExportTests, StreamsTilesFromRenderTiled) {
+    HitableList objects;
+    objects.add(std::make_shared<Plane>(Point3(0, 0, 0), Vec3(0, 1, 0), std::make_shared<Lambertian>(Color(0.5, 0.5, 0.5))));
+    objects.add(std::make_shared<Sphere>(Point3(0, 1, 0), 1.0, std::make_shared<Lambertian>(Color(0.8, 0.2, 0.2))));
+    const Scene world(objects);
+    const LightList lights(objects);
+    const AovIds ids(objects);
+    PathTracerSettings path_settings;
+    path_settings.max_depth = 3;
+    CameraParams view;
+    view.lookfrom = Point3(6, 1.5, 2);
+    view.lookat = Point3(0, 1, 0);
+    TiledRenderSettings settings;
+    settings.width = 40;
+    settings.height = 50;
+    settings.tile_size = 16;
+    settings.samples = 2;
+    settings.aovs = AovSet{AovChannel::Depth};
+
+    const std::string tiled_path = TempPath("export_stream.rttile");
+    const std::string exr_path = TempPath("export_stream.exr");
+    const size_t area = 16 * 16;
+    {
+        // One band of slack: workers ahead of the encoder wait for it.
+        ExportOptions options;
+        options.max_pending_bands = 1;
+        ImageExporter exporter(exr_path, 40, 50, settings.aovs, options);
+        render_tiled(world, lights, view, path_settings, settings, ids, tiled_path,
+                     [&](int x0, int y0, int x1, int y1, const float* planes) {
+                         exporter.submit(x0, y0, x1, y1, planes, 16, area);
+                     });
+        exporter.wait();
+    }
+    const TiledImage tiled(tiled_path);
+    const auto planes = ReadExr(ReadFile(exr_path), 40, 50);
+    for (int y = 0; y < 50; ++y) {
+        for (int x = 0; x < 40; ++x) {
+            const Color expected = tiled.pixel(x, y);
+            ASSERT_EQ(planes.at("R")[y * 40 + x], static_cast<float>(expected.x()));
+            ASSERT_EQ(planes.at("B")[y * 40 + x], static_cast<float>(expected.z()));
+            ASSERT_EQ(planes.at("depth")[y * 40 + x], tiled.read_tile(x / 16, y / 16)[3 * area + (y % 16) * 16 + x % 16]);
+        }
+    }
+
+    // Without a path only the callback sees the tiles.
+    std::remove(tiled_path.c_str());
+    int reported = 0;
+    const TiledRenderStats stats = render_tiled(world, lights, view, path_settings, settings, ids, "",
+                                                [&](int, int, int, int, const float*) { ++reported; });
+    EXPECT_EQ(stats.tiles, 12u);
+    EXPECT_EQ(reported, 12);
+    EXPECT_FALSE(std::ifstream(tiled_path).good());
+    std::remove(exr_path.c_str());
+}
@@ -0,0 +1,143 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <memory>
+
+#include "raytracer/Integrator.h"
+#include "raytracer/LinearBVH.h"
+
+namespace {
+constexpr double kEpsilon = 1e-9;
+
+struct Estimate {
+    double mean = 0.0;
+    double variance = 0.0;
+};
+
+// Luminance-free estimate: the green channel of `samples` paths along `ray`.
+Estimate EstimateRadiance(const Ray& ray, const Hitable& world, const LightSampler& lights,
+                          const PathTracerSettings& settings, int samples) {
+    double sum = 0.0;
+    double sum_squares = 0.0;
+    for (int s = 0; s < samples; ++s) {
+        const double value = trace_path(ray, world, lights, settings).y();
+        sum += value;
+        sum_squares += value * value;
+    }
+    Estimate estimate;
+    estimate.mean = sum / samples;
+    estimate.variance = sum_squares / samples - estimate.mean * estimate.mean;
+    return estimate;
+}
+
+// Grey floor lit by one small sphere light, seen from above.
+HitableList LitFloor() {
+    HitableList world;
+    world.add(std::make_shared<Plane>(Point3(0, 0, 0), Vec3(0, 1, 0), std::make_shared<Lambertian>(Color(0.5, 0.5, 0.5))));
+    world.add(std::make_shared<Sphere>(Point3(1, 3, 0), 0.5, std::make_shared<DiffuseLight>(Color(10, 10, 10))));
+    return world;
+}
+}
+
+TEST(IntegratorTests, DiffuseLightEmitsFromFrontFaceOnly) {
+    const DiffuseLight light(Color(2, 3, 4));
+    HitRecord rec;
+    rec.front_face = true;
+    const Ray ray(Point3(0, 0, 0), Vec3(0, 0, -1));
+    EXPECT_NEAR(light.emitted(ray, rec).z(), 4.0, kEpsilon);
+    rec.front_face = false;
+    EXPECT_NEAR(light.emitted(ray, rec).length(), 0.0, kEpsilon);
+
+    Color attenuation;
+    Ray scattered;
+    EXPECT_FALSE(light.scatter(ray, rec, attenuation, scattered));
+    EXPECT_TRUE(light.is_emissive());
+}
+
+TEST(IntegratorTests, LambertianPdfIsCosineOverPiAndMatchesEval) {
+    const Lambertian material(Color(0.5, 0.25, 1.0));
+    HitRecord rec;
+    rec.normal = Vec3(0, 1, 0);
+    const Ray incoming(Point3(0, 1, 0), Vec3(0, -1, 0));
+
+    const Vec3 direction = unit_vector(Vec3(1, 1, 0));
+    EXPECT_NEAR(material.scatter_pdf(incoming, rec, direction), std::sqrt(0.5) / pi, kEpsilon);
+    EXPECT_NEAR(material.scatter_pdf(incoming, rec, Vec3(0, -1, 0)), 0.0, kEpsilon);
+    EXPECT_NEAR(material.eval(incoming, rec, direction).y(), 0.25 * std::sqrt(0.5) / pi, kEpsilon);
+    EXPECT_FALSE(material.is_specular());
+    EXPECT_TRUE(Metal(Color(1, 1, 1), 0.0).is_specular());
+}
+
+TEST(IntegratorTests, SphereDirectionSamplingHitsSphereAndPdfIntegratesToOne) {
+    const Sphere sphere(Point3(0, 0, -2), 1.0, std::make_shared<DiffuseLight>(Color(1, 1, 1)));
+    const Point3 origin(0, 0, 0);
+    for (int i = 0; i < 1000; ++i) {
+        const Vec3 direction = sphere.sample_direction(origin);
+        EXPECT_TRUE(sphere.occluded(Ray(origin, direction), 0.0, infinity));
+        EXPECT_GT(sphere.direction_pdf(origin, direction), 0.0);
+    }
+
+    // Integral of the density over the sphere of directions, by uniform sampling.
+    double sum = 0.0;
+    const int samples = 400000;
+    for (int i = 0; i < samples; ++i) {
+        sum += sphere.direction_pdf(origin, random_unit_vector());
+    }
+    EXPECT_NEAR(4.0 * pi * sum / samples, 1.0, 0.03);
+}
+
+TEST(IntegratorTests, LightListCollectsBoundedEmitters) {
+    const HitableList world = cornell_scene();
+    const LightList lights(world);
+    ASSERT_EQ(lights.size(), 1u);
+    EXPECT_TRUE(lights.light(0).material()->is_emissive());
+
+    const Point3 origin(278, 100, 278);
+    const Vec3 normal(0, 1, 0);
+    size_t index = 99;
+    double pmf = 0.0;
+    ASSERT_TRUE(lights.pick(origin, normal, index, pmf));
+    EXPECT_EQ(index, 0u);
+    EXPECT_NEAR(pmf, 1.0, kEpsilon);
+    const Vec3 direction = lights.light(index).sample_direction(origin);
+    EXPECT_GT(lights.direction_pdf(&lights.light(0), origin, normal, direction), 0.0);
+    EXPECT_EQ(lights.direction_pdf(world.objects[0].get(), origin, normal, direction), 0.0);
+}
+
+TEST(IntegratorTests, LightSamplingMatchesBsdfSamplingWithLessVariance) {
+    const HitableList objects = LitFloor();
+    const Scene world(objects);
+    const LightList lights(objects);
+    const Ray ray(Point3(0, 2, 2), Vec3(0, -2, -2));
+
+    PathTracerSettings settings;
+    settings.sky = false;
+    settings.max_depth = 4;
+    const int nee_samples = 20000;
+    const int bsdf_samples = 400000;
+    const Estimate nee = EstimateRadiance(ray, world, lights, settings, nee_samples);
+    settings.sample_lights = false;
+    const Estimate bsdf = EstimateRadiance(ray, world, lights, settings, bsdf_samples);
+
+    // Both are unbiased; allow five standard errors of the difference.
+    const double standard_error = std::sqrt(nee.variance / nee_samples + bsdf.variance / bsdf_samples);
+    EXPECT_GT(nee.mean, 0.0);
+    EXPECT_NEAR(nee.mean, bsdf.mean, 5.0 * standard_error);
+    EXPECT_LT(nee.variance * 20.0, bsdf.variance);
+}
+
+TEST(IntegratorTests, WithoutLightsMatchesRayColorSky) {
+    const HitableList objects = random_scene();
+    const Scene world(objects);
+    const LightList lights(objects);
+    EXPECT_TRUE(lights.empty());
+
+    const Ray ray(Point3(13, 2, 3), Vec3(-13, 5, -3));
+    PathTracerSettings settings;
+    settings.max_depth = 10;
+    const Color traced = trace_path(ray, world, lights, settings);
+    const Color reference = ray_color(ray, world, 10);
+    // The ray sees only sky, so both are deterministic.
+    EXPECT_NEAR(traced.x(), reference.x(), kEpsilon);
+    EXPECT_NEAR(traced.z(), reference.z(), kEpsilon);
+}
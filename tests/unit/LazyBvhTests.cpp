@@ -0,0 +1,115 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "TestScenes.h"
+#include "raytracer/LazyBVH.h"
+
+namespace {
+constexpr double kEpsilon = 1e-9;
+
+std::vector<Ray> MakeRays(int count) {
+    std::vector<Ray> rays;
+    for (int i = 0; i < count; ++i) {
+        rays.emplace_back(Point3::random(-12.0, 12.0), Vec3::random(-1.0, 1.0));
+    }
+    return rays;
+}
+
+LazyBVHSettings ShallowBuild() {
+    LazyBVHSettings settings;
+    settings.eager_levels = 2;
+    settings.treelet_levels = 2;
+    settings.direct_test_limit = 16;
+    return settings;
+}
+}
+
+TEST(LazyBvhTests, MatchesBruteForce) {
+    const auto objects = MakeSphereField(500);
+    HitableList reference;
+    reference.objects = objects;
+    const LazyBVH bvh(objects, ShallowBuild());
+
+    for (const Ray& ray : MakeRays(1024)) {
+        HitRecord expected;
+        HitRecord actual;
+        const bool expected_hit = reference.hit(ray, 0.001, infinity, expected);
+        ASSERT_EQ(bvh.hit(ray, 0.001, infinity, actual), expected_hit);
+        if (expected_hit) {
+            EXPECT_NEAR(actual.t, expected.t, kEpsilon);
+        }
+    }
+}
+
+TEST(LazyBvhTests, BuildsOnlyTheSubtreesRaysEnter) {
+    const auto objects = MakeSphereField(2000);
+    const LazyBVH bvh(objects, ShallowBuild());
+    EXPECT_EQ(bvh.built_fraction(), 0.0);
+    EXPECT_EQ(bvh.expansion_count(), 0u);
+
+    // One ray along the z axis through the middle of the field.
+    HitRecord rec;
+    bvh.hit(Ray(Point3(0.0, 0.0, -20.0), Vec3(0.0, 0.0, 1.0)), 0.001, infinity, rec);
+    const double after_one_ray = bvh.built_fraction();
+    EXPECT_GT(bvh.expansion_count(), 0u);
+    EXPECT_LT(after_one_ray, 0.5);
+
+    for (const Ray& ray : MakeRays(20000)) {
+        bvh.hit(ray, 0.001, infinity, rec);
+    }
+    EXPECT_GT(bvh.built_fraction(), after_one_ray);
+    EXPECT_LE(bvh.built_fraction(), 1.0);
+}
+
+TEST(LazyBvhTests, ConcurrentTraversalMatchesBruteForce) {
+    const auto objects = MakeSphereField(3000);
+    HitableList reference;
+    reference.objects = objects;
+    const LazyBVH bvh(objects, ShallowBuild());
+
+    const auto rays = MakeRays(4000);
+    std::vector<double> expected(rays.size(), -1.0);
+    for (size_t i = 0; i < rays.size(); ++i) {
+        HitRecord rec;
+        if (reference.hit(rays[i], 0.001, infinity, rec)) {
+            expected[i] = rec.t;
+        }
+    }
+
+    std::atomic<int> mismatches{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&]() {
+            for (size_t i = 0; i < rays.size(); ++i) {
+                HitRecord rec;
+                const double t_hit = bvh.hit(rays[i], 0.001, infinity, rec) ? rec.t : -1.0;
+                if (std::fabs(t_hit - expected[i]) > kEpsilon) {
+                    mismatches.fetch_add(1);
+                }
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(mismatches.load(), 0);
+}
+
+TEST(LazyBvhTests, LazySceneKeepsUnboundedObjectsOutside) {
+    HitableList objects;
+    const auto material = std::make_shared<Lambertian>(Color(0.5, 0.5, 0.5));
+    objects.add(std::make_shared<Plane>(Point3(0.0, 0.0, 0.0), Vec3(0.0, 1.0, 0.0), material));
+    objects.add(std::make_shared<Sphere>(Point3(0.0, 1.0, 0.0), 0.5, material));
+
+    const Scene scene = make_lazy_scene(objects);
+    EXPECT_EQ(scene.unbounded.objects.size(), 1u);
+    ASSERT_NE(std::dynamic_pointer_cast<LazyBVH>(scene.bounded), nullptr);
+
+    HitRecord rec;
+    ASSERT_TRUE(scene.hit(Ray(Point3(0.0, 5.0, 0.0), Vec3(0.0, -1.0, 0.0)), 0.001, infinity, rec));
+    EXPECT_NEAR(rec.t, 3.5, kEpsilon);
+}
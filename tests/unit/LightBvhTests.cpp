@@ -0,0 +1,187 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include "raytracer/LightBVH.h"
+
+namespace {
+constexpr double kEpsilon = 1e-9;
+
+// Grid of small sphere lights of varying brightness above the y = 0 plane.
+HitableList LightGrid(int count_per_side) {
+    HitableList world;
+    world.add(std::make_shared<Plane>(Point3(0, 0, 0), Vec3(0, 1, 0), std::make_shared<Lambertian>(Color(0.5, 0.5, 0.5))));
+    for (int i = 0; i < count_per_side; ++i) {
+        for (int k = 0; k < count_per_side; ++k) {
+            const double brightness = 1.0 + (i * 7 + k * 3) % 5;
+            world.add(std::make_shared<Sphere>(Point3(2.0 * i, 1.0 + 0.5 * ((i + k) % 3), 2.0 * k), 0.2,
+                                               std::make_shared<DiffuseLight>(Color(brightness, brightness, brightness))));
+        }
+    }
+    return world;
+}
+}
+
+TEST(LightBvhTests, BuildsOneLeafPerLight) {
+    const LightBVH lights(LightGrid(5));
+    EXPECT_EQ(lights.size(), 25u);
+    EXPECT_EQ(lights.node_count(), 49u);
+
+    // Diffuse emitters: pi * radiance * area, summed at the root.
+    double power = 0.0;
+    for (int i = 0; i < 5; ++i) {
+        for (int k = 0; k < 5; ++k) {
+            power += pi * (1.0 + (i * 7 + k * 3) % 5) * 4.0 * pi * 0.2 * 0.2;
+        }
+    }
+    EXPECT_NEAR(lights.bounds(0).power, power, 1e-9 * power);
+    EXPECT_EQ(lights.bounds(0).cos_theta_o, -1.0);
+    EXPECT_LE(lights.bounds(0).box.min().x(), -0.2);
+    EXPECT_GE(lights.bounds(0).box.max().z(), 8.2);
+}
+
+TEST(LightBvhTests, MakesTheSelectedSampler) {
+    const HitableList world = LightGrid(3);
+    EXPECT_NE(dynamic_cast<LightList*>(make_light_sampler(world, light_selection("uniform")).get()), nullptr);
+    const std::unique_ptr<LightSampler> bvh = make_light_sampler(world, light_selection("bvh"));
+    ASSERT_NE(dynamic_cast<LightBVH*>(bvh.get()), nullptr);
+    EXPECT_EQ(bvh->size(), 9u);
+    EXPECT_STREQ(light_selection_name(LightSelection::Bvh), "bvh");
+    EXPECT_STREQ(light_selection_name(LightSelection::Uniform), "uniform");
+    EXPECT_THROW(light_selection("power"), std::invalid_argument);
+}
+
+TEST(LightBvhTests, PmfSumsToOneOverAllLights) {
+    const LightBVH lights(LightGrid(6));
+    const Point3 p(3.3, 0.0, 4.1);
+    const Vec3 n(0, 1, 0);
+    double total = 0.0;
+    for (size_t i = 0; i < lights.size(); ++i) {
+        total += lights.pmf(p, n, i);
+    }
+    EXPECT_NEAR(total, 1.0, 1e-9);
+    EXPECT_EQ(lights.pmf(p, n, lights.size()), 0.0);
+}
+
+TEST(LightBvhTests, PickFrequenciesMatchPmf) {
+    const LightBVH lights(LightGrid(4));
+    const Point3 p(1.0, 0.0, 5.0);
+    const Vec3 n(0, 1, 0);
+    const int samples = 200000;
+    std::vector<int> counts(lights.size(), 0);
+    for (int s = 0; s < samples; ++s) {
+        size_t index = 0;
+        double pmf = 0.0;
+        ASSERT_TRUE(lights.pick(p, n, index, pmf));
+        ASSERT_LT(index, lights.size());
+        EXPECT_NEAR(pmf, lights.pmf(p, n, index), 1e-12);
+        ++counts[index];
+    }
+    for (size_t i = 0; i < lights.size(); ++i) {
+        const double expected = lights.pmf(p, n, i);
+        const double standard_error = std::sqrt(expected * (1.0 - expected) / samples);
+        EXPECT_NEAR(static_cast<double>(counts[i]) / samples, expected, 5.0 * standard_error + 1e-6) << i;
+    }
+}
+
+TEST(LightBvhTests, PrefersNearbyLights) {
+    const LightBVH lights(LightGrid(8));
+    const Point3 p(0.0, 0.0, 0.0);
+    const Vec3 n(0, 1, 0);
+    size_t nearest = lights.size();
+    size_t farthest = lights.size();
+    double nearest_distance = infinity;
+    double farthest_distance = 0.0;
+    for (size_t i = 0; i < lights.size(); ++i) {
+        AABB box;
+        lights.light(i).bounding_box(box);
+        const double distance = (box.centroid() - p).length();
+        if (distance < nearest_distance) {
+            nearest_distance = distance;
+            nearest = i;
+        }
+        if (distance > farthest_distance) {
+            farthest_distance = distance;
+            farthest = i;
+        }
+    }
+    EXPECT_GT(lights.pmf(p, n, nearest), 10.0 * lights.pmf(p, n, farthest));
+}
+
+TEST(LightBvhTests, LightsBehindTheReceiverAreNeverPicked) {
+    LightBounds bounds;
+    bounds.box = AABB(Point3(-1, 2, -1), Point3(1, 3, 1));
+    bounds.power = 1.0;
+    EXPECT_GT(bounds.importance(Point3(0, 0, 0), Vec3(0, 1, 0)), 0.0);
+    EXPECT_EQ(bounds.importance(Point3(0, 0, 0), Vec3(0, -1, 0)), 0.0);
+    // Without a normal every direction counts.
+    EXPECT_GT(bounds.importance(Point3(0, 0, 0), Vec3(0, 0, 0)), 0.0);
+
+    // Emitters facing away from the point.
+    bounds.axis = Vec3(0, 1, 0);
+    bounds.cos_theta_o = 1.0;
+    EXPECT_EQ(bounds.importance(Point3(0, 0, 0), Vec3(0, 0, 0)), 0.0);
+    EXPECT_GT(bounds.importance(Point3(0, 10, 0), Vec3(0, 0, 0)), 0.0);
+
+    const LightBVH lights(LightGrid(3));
+    size_t index = 0;
+    double pmf = 0.0;
+    EXPECT_FALSE(lights.pick(Point3(2, 0, 2), Vec3(0, -1, 0), index, pmf));
+    EXPECT_EQ(lights.pmf(Point3(2, 0, 2), Vec3(0, -1, 0), 0), 0.0);
+}
+
+TEST(LightBvhTests, MergedConeContainsBothCones) {
+    LightBounds a;
+    a.box = AABB(Point3(0, 0, 0), Point3(1, 1, 1));
+    a.power = 1.0;
+    a.axis = Vec3(1, 0, 0);
+    a.cos_theta_o = std::cos(0.2);
+    LightBounds b = a;
+    b.axis = Vec3(0, 1, 0);
+    b.cos_theta_o = std::cos(0.3);
+
+    const LightBounds merged = merge_light_bounds(a, b);
+    EXPECT_NEAR(merged.power, 2.0, kEpsilon);
+    const double theta = std::acos(merged.cos_theta_o);
+    EXPECT_NEAR(theta, 0.5 * (0.2 + 0.5 * pi + 0.3), 1e-9);
+    EXPECT_LE(std::acos(clamp(dot(merged.axis, a.axis), -1.0, 1.0)) + 0.2, theta + 1e-9);
+    EXPECT_LE(std::acos(clamp(dot(merged.axis, b.axis), -1.0, 1.0)) + 0.3, theta + 1e-9);
+
+    b.axis = Vec3(-1, 0, 0);
+    EXPECT_EQ(merge_light_bounds(a, b).cos_theta_o, -1.0);
+}
+
+TEST(LightBvhTests, DirectLightingMatchesUniformSelection) {
+    const HitableList objects = LightGrid(4);
+    const Scene world(objects);
+    const LightList uniform(objects);
+    const LightBVH tree(objects);
+    const Ray ray(Point3(3, 0.5, 3), Vec3(0.1, -1, 0.2));
+
+    PathTracerSettings settings;
+    settings.sky = false;
+    settings.max_depth = 2;
+    const int samples = 100000;
+    double sums[2] = {0.0, 0.0};
+    double squares[2] = {0.0, 0.0};
+    for (int s = 0; s < samples; ++s) {
+        const double a = trace_path(ray, world, uniform, settings).y();
+        const double b = trace_path(ray, world, tree, settings).y();
+        sums[0] += a;
+        squares[0] += a * a;
+        sums[1] += b;
+        squares[1] += b * b;
+    }
+    double means[2];
+    double variances[2];
+    for (int i = 0; i < 2; ++i) {
+        means[i] = sums[i] / samples;
+        variances[i] = squares[i] / samples - means[i] * means[i];
+    }
+    const double standard_error = std::sqrt((variances[0] + variances[1]) / samples);
+    EXPECT_GT(means[1], 0.0);
+    EXPECT_NEAR(means[0], means[1], 5.0 * standard_error);
+    EXPECT_LT(variances[1], variances[0]);
+}
@@ -0,0 +1,214 @@
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <vector>
+
+#include "TestScenes.h"
+#include "raytracer/LinearBVH.h"
+
+namespace {
+constexpr double kEpsilon = 1e-9;
+
+void ExpectMatchesBruteForce(const Hitable& accel, const HitableList& reference) {
+    for (int i = 0; i < 512; ++i) {
+        const Ray ray(Point3::random(-12.0, 12.0), Vec3::random(-1.0, 1.0));
+        HitRecord expected;
+        HitRecord actual;
+        const bool expected_hit = reference.hit(ray, 0.001, infinity, expected);
+        ASSERT_EQ(accel.hit(ray, 0.001, infinity, actual), expected_hit);
+        if (expected_hit) {
+            EXPECT_NEAR(actual.t, expected.t, kEpsilon);
+        }
+    }
+}
+}
+
+TEST(LinearBvhTests, SahBuildMatchesBruteForce) {
+    const auto objects = MakeSphereField(300);
+    HitableList reference;
+    reference.objects = objects;
+
+    const LinearBVH bvh(objects, BVHBuildMethod::SAH);
+    ExpectMatchesBruteForce(bvh, reference);
+}
+
+TEST(LinearBvhTests, MedianBuildMatchesBruteForce) {
+    const auto objects = MakeSphereField(300);
+    HitableList reference;
+    reference.objects = objects;
+
+    const LinearBVH bvh(objects, BVHBuildMethod::Median, 1);
+    ExpectMatchesBruteForce(bvh, reference);
+}
+
+TEST(LinearBvhTests, RefitOfMovedPrimitiveUpdatesRootBounds) {
+    const auto material = std::make_shared<Lambertian>(Color(0.5, 0.5, 0.5));
+    std::vector<std::shared_ptr<Hitable>> objects;
+    for (int i = 0; i < 16; ++i) {
+        objects.push_back(std::make_shared<Sphere>(Point3(i, 0.0, 0.0), 0.25, material));
+    }
+    LinearBVH bvh(objects);
+
+    std::static_pointer_cast<Sphere>(objects[3])->center = Point3(3.0, 20.0, 0.0);
+    bvh.refit(3);
+
+    AABB box;
+    ASSERT_TRUE(bvh.bounding_box(box));
+    EXPECT_NEAR(box.max().y(), 20.25, kEpsilon);
+
+    const Ray ray(Point3(3.0, 30.0, 0.0), Vec3(0.0, -1.0, 0.0));
+    HitRecord rec;
+    ASSERT_TRUE(bvh.hit(ray, 0.001, infinity, rec));
+    EXPECT_NEAR(rec.t, 9.75, kEpsilon);
+}
+
+TEST(LinearBvhTests, StatsCountVisitedNodes) {
+    const auto objects = MakeSphereField(64);
+    const LinearBVH bvh(objects);
+
+    const Ray ray(Point3(0.0, 0.0, -30.0), Vec3(0.0, 0.0, 1.0));
+    HitRecord rec;
+    BVHTraversalStats stats;
+    bvh.hit(ray, 0.001, infinity, rec, stats);
+
+    EXPECT_GE(stats.node_visits, 1u);
+    EXPECT_LE(stats.primitive_tests, objects.size());
+}
+
+TEST(LinearBvhTests, ConstructingWithNoObjectsThrows) {
+    std::vector<std::shared_ptr<Hitable>> objects;
+    EXPECT_THROW(LinearBVH bvh(objects), std::invalid_argument);
+}
+
+TEST(LinearBvhTests, LbvhBuildMatchesBruteForce) {
+    const auto objects = MakeSphereField(5000);
+    HitableList reference;
+    reference.objects = objects;
+
+    const LinearBVH bvh(objects, BVHBuildMethod::LBVH);
+    ExpectMatchesBruteForce(bvh, reference);
+}
+
+TEST(LinearBvhTests, LbvhHandlesCoincidentCentroids) {
+    const auto material = std::make_shared<Lambertian>(Color(0.5, 0.5, 0.5));
+    std::vector<std::shared_ptr<Hitable>> objects;
+    for (int i = 0; i < 40; ++i) {
+        objects.push_back(std::make_shared<Sphere>(Point3(0.0, 0.0, -5.0), 0.1 + 0.01 * i, material));
+    }
+    HitableList reference;
+    reference.objects = objects;
+
+    const LinearBVH bvh(objects, BVHBuildMethod::LBVH, 1);
+    ExpectMatchesBruteForce(bvh, reference);
+}
+
+TEST(LinearBvhTests, UpdatePolicyPicksByMovedFraction) {
+    EXPECT_EQ(choose_bvh_update(0, 1000), BVHUpdate::None);
+    EXPECT_EQ(choose_bvh_update(10, 1000), BVHUpdate::Refit);
+    EXPECT_EQ(choose_bvh_update(100, 1000), BVHUpdate::FullRebuild);
+    EXPECT_EQ(choose_bvh_update(900, 1000), BVHUpdate::FastRebuild);
+}
+
+TEST(LinearBvhTests, SbvhBuildMatchesBruteForce) {
+    auto objects = MakeSphereField(300);
+    objects.push_back(std::make_shared<Sphere>(Point3(0.0, -1000.0, 0.0), 995.0,
+                                               std::make_shared<Lambertian>(Color(0.5, 0.5, 0.5))));
+    HitableList reference;
+    reference.objects = objects;
+
+    const LinearBVH bvh(objects, BVHBuildMethod::SBVH);
+    ExpectMatchesBruteForce(bvh, reference);
+}
+
+TEST(LinearBvhTests, SbvhDuplicationStaysWithinBudget) {
+    // Large spheres overlapping the field leave object splits no clean cut.
+    auto objects = MakeSphereField(200);
+    const auto material = std::make_shared<Lambertian>(Color(0.5, 0.5, 0.5));
+    for (int i = 0; i < 8; ++i) {
+        objects.push_back(std::make_shared<Sphere>(Point3::random(-6.0, 6.0), 6.0, material));
+    }
+
+    SpatialSplitSettings settings;
+    settings.duplication_budget = 0.1;
+    const LinearBVH bvh(objects, BVHBuildMethod::SBVH, 4, settings);
+    EXPECT_GT(bvh.reference_count(), bvh.primitive_count());
+    EXPECT_LE(bvh.reference_count(), bvh.primitive_count() + 20);
+
+    settings.duplication_budget = 0.0;
+    const LinearBVH no_splits(objects, BVHBuildMethod::SBVH, 4, settings);
+    EXPECT_EQ(no_splits.reference_count(), no_splits.primitive_count());
+}
+
+TEST(LinearBvhTests, SbvhRefitOfDuplicatedPrimitiveRefitsWholeTree) {
+    auto objects = MakeSphereField(100);
+    auto ground = std::make_shared<Sphere>(Point3(0.0, -1000.0, 0.0), 995.0,
+                                           std::make_shared<Lambertian>(Color(0.5, 0.5, 0.5)));
+    objects.push_back(ground);
+    LinearBVH bvh(objects, BVHBuildMethod::SBVH);
+
+    ground->center = Point3(0.0, -2000.0, 0.0);
+    bvh.refit(objects.size() - 1);
+
+    HitableList reference;
+    reference.objects = objects;
+    ExpectMatchesBruteForce(bvh, reference);
+}
+
+TEST(LinearBvhTests, LayoutsPreserveTraversalResults) {
+    const auto objects = MakeSphereField(500);
+    HitableList reference;
+    reference.objects = objects;
+
+    for (BVHBuildMethod method : {BVHBuildMethod::SAH, BVHBuildMethod::LBVH}) {
+        LinearBVH bvh(objects, method, 1);
+        for (BVHLayout layout : {BVHLayout::Treelet, BVHLayout::VanEmdeBoas, BVHLayout::DepthFirst}) {
+            bvh.set_layout(layout);
+            EXPECT_EQ(bvh.layout(), layout);
+            for (size_t i = 1; i < bvh.node_count(); ++i) {
+                const LinearBVHNode& node = bvh.node(i);
+                if (node.count == 0) {
+                    EXPECT_GT(node.offset, i);
+                    EXPECT_EQ(node.offset % 2, 1u);
+                }
+            }
+            ExpectMatchesBruteForce(bvh, reference);
+        }
+    }
+}
+
+TEST(LinearBvhTests, RefitAfterReorderFollowsRemappedLeaves) {
+    const auto material = std::make_shared<Lambertian>(Color(0.5, 0.5, 0.5));
+    std::vector<std::shared_ptr<Hitable>> objects;
+    for (int i = 0; i < 64; ++i) {
+        objects.push_back(std::make_shared<Sphere>(Point3(i, 0.0, 0.0), 0.25, material));
+    }
+    LinearBVH bvh(objects, BVHBuildMethod::SAH, 1);
+    bvh.set_layout(BVHLayout::VanEmdeBoas);
+
+    std::static_pointer_cast<Sphere>(objects[40])->center = Point3(40.0, 20.0, 0.0);
+    bvh.refit(40);
+
+    const Ray ray(Point3(40.0, 30.0, 0.0), Vec3(0.0, -1.0, 0.0));
+    HitRecord rec;
+    ASSERT_TRUE(bvh.hit(ray, 0.001, infinity, rec));
+    EXPECT_NEAR(rec.t, 9.75, kEpsilon);
+}
+
+TEST(LinearBvhTests, StatsCountSimulatedCacheMisses) {
+    const auto objects = MakeSphereField(64);
+    const LinearBVH bvh(objects);
+    CacheSimulator cache(64 * 1024, 64, 4);
+
+    const Ray ray(Point3(0.0, 0.0, -30.0), Vec3(0.0, 0.0, 1.0));
+    HitRecord rec;
+    BVHTraversalStats cold;
+    cold.cache = &cache;
+    bvh.hit(ray, 0.001, infinity, rec, cold);
+    EXPECT_GT(cold.cache_misses, 0u);
+
+    BVHTraversalStats warm;
+    warm.cache = &cache;
+    bvh.hit(ray, 0.001, infinity, rec, warm);
+    EXPECT_EQ(warm.cache_misses, 0u);
+    EXPECT_EQ(warm.node_visits, cold.node_visits);
+}
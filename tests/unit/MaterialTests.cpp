@@ -28,6 +28,42 @@ TEST(MaterialTests, LambertianScatterSetsAlbedoAndHitOrigin) {
     EXPECT_GT(scattered.direction().length_squared(), 0.0);
 }
 
+TEST(MaterialTests, LambertianScatterReportsCosinePdf) {
+    const Lambertian material(Color(0.5, 0.5, 0.5));
+
+    HitRecord rec;
+    rec.p = Point3(0.0, 0.0, 0.0);
+    rec.normal = unit_vector(Vec3(1.0, 2.0, -0.5));
+    rec.front_face = true;
+
+    const Ray incoming(Point3(1.0, 1.0, 1.0), Vec3(-1.0, -1.0, -1.0));
+    for (int i = 0; i < 64; ++i) {
+        Color attenuation;
+        Ray scattered;
+        double pdf = 0.0;
+        ASSERT_TRUE(material.scatter(incoming, rec, attenuation, scattered, pdf));
+        EXPECT_NEAR(scattered.direction().length(), 1.0, 1e-9);
+        EXPECT_GE(dot(scattered.direction(), rec.normal), 0.0);
+        EXPECT_NEAR(pdf, material.scatter_pdf(incoming, rec, scattered.direction()), 1e-9);
+    }
+}
+
+TEST(MaterialTests, SpecularScatterReportsZeroPdf) {
+    const Metal material(Color(0.9, 0.9, 0.9), 0.2);
+
+    HitRecord rec;
+    rec.p = Point3(0.0, 0.0, 0.0);
+    rec.normal = Vec3(0.0, 1.0, 0.0);
+    rec.front_face = true;
+
+    const Ray incoming(Point3(0.0, 1.0, 1.0), Vec3(0.0, -1.0, -1.0));
+    Color attenuation;
+    Ray scattered;
+    double pdf = 1.0;
+    ASSERT_TRUE(material.scatter(incoming, rec, attenuation, scattered, pdf));
+    EXPECT_EQ(pdf, 0.0);
+}
+
 TEST(MaterialTests, MetalWithZeroFuzzReflectsPerfectly) {
     const Metal material(Color(0.9, 0.9, 0.9), 0.0);
 
@@ -32,3 +32,66 @@ TEST(MathUtilsTests, RandomInUnitDiskStaysInsideDiskPlane) {
         EXPECT_NEAR(p.z(), 0.0, kEpsilon);
     }
 }
+
+TEST(MathUtilsTests, ConcentricDiskMapsSquareOntoDisk) {
+    EXPECT_NEAR(sample_concentric_disk(0.5, 0.5).length(), 0.0, kEpsilon);
+    // Square edges land on the unit circle.
+    EXPECT_NEAR(sample_concentric_disk(1.0, 0.5).x(), 1.0, kEpsilon);
+    EXPECT_NEAR(sample_concentric_disk(0.5, 0.0).y(), -1.0, kEpsilon);
+    EXPECT_NEAR(sample_concentric_disk(0.0, 0.0).length(), 1.0, kEpsilon);
+    for (int i = 0; i < 16; ++i) {
+        for (int j = 0; j < 16; ++j) {
+            const Vec3 p = sample_concentric_disk((i + 0.5) / 16, (j + 0.5) / 16);
+            EXPECT_LT(p.length_squared(), 1.0);
+            EXPECT_NEAR(p.z(), 0.0, kEpsilon);
+        }
+    }
+}
+
+TEST(MathUtilsTests, CosineHemisphereSamplesMatchTheirDensity) {
+    // E[cos] under cos/pi is 2/3; midpoint grid keeps the check deterministic.
+    const int n = 256;
+    double mean_z = 0.0;
+    for (int i = 0; i < n; ++i) {
+        for (int j = 0; j < n; ++j) {
+            const Vec3 d = sample_cosine_hemisphere((i + 0.5) / n, (j + 0.5) / n);
+            EXPECT_NEAR(d.length(), 1.0, 1e-12);
+            EXPECT_GE(d.z(), 0.0);
+            mean_z += d.z();
+        }
+    }
+    EXPECT_NEAR(mean_z / (n * n), 2.0 / 3.0, 1e-3);
+    EXPECT_NEAR(cosine_hemisphere_pdf(1.0), 1.0 / pi, kEpsilon);
+    EXPECT_EQ(cosine_hemisphere_pdf(-0.5), 0.0);
+}
+
+TEST(MathUtilsTests, UniformSphereSamplesAreUnitAndBalanced) {
+    const int n = 128;
+    Vec3 mean(0, 0, 0);
+    for (int i = 0; i < n; ++i) {
+        for (int j = 0; j < n; ++j) {
+            const Vec3 d = sample_uniform_sphere((i + 0.5) / n, (j + 0.5) / n);
+            EXPECT_NEAR(d.length(), 1.0, 1e-12);
+            mean += d;
+        }
+    }
+    EXPECT_NEAR((mean / (n * n)).length(), 0.0, 1e-9);
+    for (int i = 0; i < 256; ++i) {
+        EXPECT_NEAR(random_unit_vector().length(), 1.0, 1e-12);
+    }
+}
+
+TEST(MathUtilsTests, PolynomialSinCosMatchLibm) {
+    for (int i = 0; i <= 1000; ++i) {
+        const double u = i / 1000.0 * 0.999999;
+        double s = 0.0;
+        double c = 0.0;
+        sin_cos_turn(u, s, c);
+        EXPECT_NEAR(s, std::sin(2.0 * pi * u), 1e-15) << u;
+        EXPECT_NEAR(c, std::cos(2.0 * pi * u), 1e-15) << u;
+    }
+    for (int i = 0; i <= 1000; ++i) {
+        const double x = i / 1000.0;
+        EXPECT_NEAR(cbrt_unit(x), std::cbrt(x), 1e-14) << x;
+    }
+}
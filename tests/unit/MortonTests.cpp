@@ -0,0 +1,58 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "raytracer/Morton.h"
+#include "raytracer/RayTracer.h"
+
+namespace {
+uint64_t InterleaveNaive(uint64_t x, uint64_t y, uint64_t z, int bits) {
+    uint64_t code = 0;
+    for (int b = 0; b < bits; ++b) {
+        code |= ((x >> b) & 1u) << (3 * b + 2);
+        code |= ((y >> b) & 1u) << (3 * b + 1);
+        code |= ((z >> b) & 1u) << (3 * b);
+    }
+    return code;
+}
+}
+
+TEST(MortonTests, CodesInterleaveQuantizedAxes) {
+    EXPECT_EQ(morton3d_30(0.0, 0.0, 0.0), 0u);
+    EXPECT_EQ(morton3d_30(1.0, 1.0, 1.0), 0x3fffffffu);
+    EXPECT_EQ(morton3d_63(1.0, 1.0, 1.0), 0x7fffffffffffffffULL);
+
+    const double x = 0.3;
+    const double y = 0.71;
+    const double z = 0.05;
+    EXPECT_EQ(morton3d_30(x, y, z), InterleaveNaive(307, 727, 51, 10));
+    EXPECT_EQ(morton3d_63(x, y, z),
+              InterleaveNaive(static_cast<uint64_t>(x * 2097152.0), static_cast<uint64_t>(y * 2097152.0),
+                              static_cast<uint64_t>(z * 2097152.0), 21));
+}
+
+TEST(MortonTests, RadixSortMatchesStableSort) {
+    const size_t count = 200000;
+    std::vector<uint64_t> keys(count);
+    std::vector<uint32_t> values(count);
+    for (size_t i = 0; i < count; ++i) {
+        keys[i] = static_cast<uint64_t>(random_double() * 4096.0) << 40 | static_cast<uint64_t>(i % 7);
+        values[i] = static_cast<uint32_t>(i);
+    }
+
+    std::vector<uint32_t> expected = values;
+    std::stable_sort(expected.begin(), expected.end(),
+                     [&](uint32_t a, uint32_t b) { return keys[a] < keys[b]; });
+
+    radix_sort_pairs(keys, values, 63);
+
+    EXPECT_TRUE(std::is_sorted(keys.begin(), keys.end()));
+    EXPECT_EQ(values, expected);
+}
+
+TEST(MortonTests, CountLeadingZeros) {
+    EXPECT_EQ(count_leading_zeros64(0), 64);
+    EXPECT_EQ(count_leading_zeros64(1), 63);
+    EXPECT_EQ(count_leading_zeros64(0x8000000000000000ULL), 0);
+}
@@ -0,0 +1,110 @@
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <vector>
+
+#include "TestHelpers.h"
+#include "TestScenes.h"
+#include "raytracer/LazyBVH.h"
+#include "raytracer/QuantizedBVH.h"
+#include "raytracer/Tlas.h"
+#include "raytracer/UniformGrid.h"
+
+namespace {
+// Segments between random points, so that many are unoccluded and t_max
+// matters as much as the geometry.
+void ExpectOcclusionMatchesHit(const Hitable& accel, const HitableList& reference) {
+    int blocked = 0;
+    for (int i = 0; i < 2048; ++i) {
+        const Point3 from = Point3::random(-12.0, 12.0);
+        const Point3 to = Point3::random(-12.0, 12.0);
+        const Ray ray(from, to - from);
+        HitRecord rec;
+        const bool expected = reference.hit(ray, 0.001, 0.999, rec);
+        ASSERT_EQ(accel.occluded(ray, 0.001, 0.999), expected);
+        blocked += expected ? 1 : 0;
+    }
+    EXPECT_GT(blocked, 0);
+    EXPECT_LT(blocked, 2048);
+}
+}
+
+TEST(OcclusionTests, SphereRespectsInterval) {
+    const Sphere sphere(Point3(0, 0, -5), 1.0, std::make_shared<TestMaterial>());
+    const Ray ray(Point3(0, 0, 0), Vec3(0, 0, -1));
+
+    EXPECT_TRUE(sphere.occluded(ray, 0.001, infinity));
+    EXPECT_FALSE(sphere.occluded(ray, 0.001, 3.9));
+    EXPECT_TRUE(sphere.occluded(ray, 4.5, 6.5));  // far root only
+    EXPECT_FALSE(sphere.occluded(ray, 4.5, 5.5)); // inside, no surface crossed
+    EXPECT_FALSE(sphere.occluded(ray, 6.1, infinity));
+}
+
+TEST(OcclusionTests, PlaneRespectsInterval) {
+    const Plane plane(Point3(0, 0, 0), Vec3(0, 1, 0), std::make_shared<TestMaterial>());
+    const Ray ray(Point3(0, 2, 0), Vec3(0, -1, 0));
+
+    EXPECT_TRUE(plane.occluded(ray, 0.001, infinity));
+    EXPECT_FALSE(plane.occluded(ray, 0.001, 1.5));
+    EXPECT_FALSE(plane.occluded(Ray(Point3(0, 2, 0), Vec3(1, 0, 0)), 0.001, infinity));
+}
+
+TEST(OcclusionTests, AcceleratorsMatchClosestHit) {
+    const auto objects = MakeSphereField(600);
+    HitableList reference;
+    reference.objects = objects;
+
+    std::vector<std::shared_ptr<Hitable>> bvh_objects = objects;
+    const BVHNode tree(bvh_objects, 0, bvh_objects.size());
+    const LinearBVH sah(objects, BVHBuildMethod::SAH);
+    const LinearBVH sbvh(objects, BVHBuildMethod::SBVH);
+    const QuantizedBVH quantized(sah);
+    const UniformGrid grid(objects);
+    const LazyBVH lazy(objects);
+
+    ExpectOcclusionMatchesHit(reference, reference);
+    ExpectOcclusionMatchesHit(tree, reference);
+    ExpectOcclusionMatchesHit(sah, reference);
+    ExpectOcclusionMatchesHit(sbvh, reference);
+    ExpectOcclusionMatchesHit(quantized, reference);
+    ExpectOcclusionMatchesHit(grid, reference);
+    ExpectOcclusionMatchesHit(lazy, reference);
+}
+
+TEST(OcclusionTests, SceneAndTlasMatchClosestHit) {
+    HitableList world;
+    world.objects = MakeSphereField(300);
+    world.add(std::make_shared<Plane>(Point3(0, -6, 0), Vec3(0, 1, 0), std::make_shared<TestMaterial>()));
+    const Scene scene = make_lazy_scene(world);
+    ExpectOcclusionMatchesHit(scene, world);
+
+    const auto blas = std::make_shared<LinearBVH>(MakeSphereField(200));
+    std::vector<std::shared_ptr<Instance>> instances = {
+        std::make_shared<Instance>(blas, Vec3(0, 0, 0)),
+        std::make_shared<Instance>(blas, Vec3(3, 1, -2)),
+    };
+    HitableList instanced;
+    instanced.objects.assign(instances.begin(), instances.end());
+    const TLAS tlas(instances);
+    ExpectOcclusionMatchesHit(tlas, instanced);
+}
+
+// Coincident spheres cannot cull each other in a closest-hit search; an any-hit
+// search is done after the first one.
+TEST(OcclusionTests, AnyHitStopsAtFirstBlocker) {
+    const auto material = std::make_shared<TestMaterial>();
+    std::vector<std::shared_ptr<Hitable>> objects;
+    for (int i = 0; i < 16; ++i) {
+        objects.push_back(std::make_shared<Sphere>(Point3(0, 0, 0), 1.0, material));
+    }
+    const LinearBVH bvh(objects, BVHBuildMethod::SAH, 1);
+    const Ray ray(Point3(0, 0, 5), Vec3(0, 0, -1));
+
+    BVHTraversalStats closest;
+    BVHTraversalStats any;
+    HitRecord rec;
+    EXPECT_TRUE(bvh.hit(ray, 0.001, infinity, rec, closest));
+    EXPECT_TRUE(bvh.occluded(ray, 0.001, infinity, any));
+    EXPECT_EQ(closest.primitive_tests, 16u);
+    EXPECT_EQ(any.primitive_tests, 1u);
+}
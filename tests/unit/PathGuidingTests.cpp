@@ -0,0 +1,158 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <memory>
+
+#include "raytracer/Integrator.h"
+
+namespace {
+constexpr double kEpsilon = 1e-9;
+
+// Midpoint rule over the square; equal areas there are equal solid angles.
+double IntegratePdf(const DirectionalTree& tree) {
+    const int steps = 256;
+    double integral = 0.0;
+    for (int j = 0; j < steps; ++j) {
+        for (int i = 0; i < steps; ++i) {
+            integral += tree.pdf(DirectionalTree::direction_of((i + 0.5) / steps, (j + 0.5) / steps));
+        }
+    }
+    return integral * 4.0 * pi / (steps * steps);
+}
+
+// A tree trained on light arriving from around `toward`.
+DirectionalTree TrainedTowards(const Vec3& toward) {
+    DirectionalTree tree;
+    for (int pass = 0; pass < 4; ++pass) {
+        for (int s = 0; s < 20000; ++s) {
+            const Vec3 d = random_unit_vector();
+            tree.record(d, dot(d, toward) > 0.95 ? 10.0 : 0.1);
+        }
+        tree = tree.refined(0.01, 20);
+    }
+    return tree;
+}
+}
+
+TEST(PathGuidingTests, SquareMappingRoundTrips) {
+    for (const Vec3& d : {Vec3(0, 0, 1), Vec3(0.3, -0.4, 0.5), Vec3(-1, 0.2, -0.1), Vec3(0.2, -1, 0)}) {
+        double u = 0.0;
+        double v = 0.0;
+        DirectionalTree::square_of(d, u, v);
+        const Vec3 back = DirectionalTree::direction_of(u, v);
+        EXPECT_NEAR((back - unit_vector(d)).length(), 0.0, 1e-9);
+    }
+}
+
+TEST(PathGuidingTests, UntrainedTreeIsUniform) {
+    const DirectionalTree tree;
+    EXPECT_NEAR(tree.pdf(Vec3(0.2, 0.5, -0.3)), 1.0 / (4.0 * pi), kEpsilon);
+    EXPECT_NEAR(tree.sample().length(), 1.0, 1e-9);
+    EXPECT_EQ(tree.node_count(), 1u);
+}
+
+TEST(PathGuidingTests, RefinedTreeConcentratesOnRecordedLight) {
+    const Vec3 toward = unit_vector(Vec3(0.3, 0.8, 0.2));
+    const DirectionalTree tree = TrainedTowards(toward);
+    EXPECT_GT(tree.node_count(), 1u);
+    EXPECT_NEAR(IntegratePdf(tree), 1.0, 1e-6);
+    EXPECT_GT(tree.pdf(toward), 20.0 * tree.pdf(-toward));
+
+    // The cone covers 2.5% of the sphere and holds ~72% of the energy; cells
+    // straddling its rim spread some of that share outside.
+    int inside = 0;
+    const int samples = 20000;
+    for (int s = 0; s < samples; ++s) {
+        const Vec3 d = tree.sample();
+        EXPECT_NEAR(d.length(), 1.0, 1e-9);
+        inside += dot(d, toward) > 0.95 ? 1 : 0;
+    }
+    EXPECT_GT(inside, samples / 3);
+}
+
+TEST(PathGuidingTests, SampleDensityMatchesPdf) {
+    const DirectionalTree tree = TrainedTowards(Vec3(0, 0, 1));
+    // Estimate E[1 / pdf(sample)] = 4 pi, the measure of the sphere.
+    double sum = 0.0;
+    const int samples = 200000;
+    for (int s = 0; s < samples; ++s) {
+        sum += 1.0 / tree.pdf(tree.sample());
+    }
+    EXPECT_NEAR(sum / samples, 4.0 * pi, 0.05 * 4.0 * pi);
+}
+
+TEST(PathGuidingTests, SpatialTreeSplitsBusyLeavesWithinBudget) {
+    GuidingSettings settings;
+    settings.spatial_threshold = 100.0;
+    SDTree tree(AABB(Point3(0, 0, 0), Point3(1, 2, 1)), settings);
+    EXPECT_FALSE(tree.trained());
+    for (int s = 0; s < 10000; ++s) {
+        tree.record(Point3(random_double(), 2.0 * random_double(), random_double()), random_unit_vector(), 1.0);
+    }
+    tree.end_pass();
+    EXPECT_TRUE(tree.trained());
+    EXPECT_EQ(tree.passes(), 1);
+    EXPECT_GT(tree.spatial_leaves(), 16u);
+    EXPECT_GT(tree.pdf(Point3(0.5, 0.5, 0.5), Vec3(0, 1, 0)), 0.0);
+
+    settings.memory_budget = 1;
+    SDTree capped(AABB(Point3(0, 0, 0), Point3(1, 1, 1)), settings);
+    for (int s = 0; s < 10000; ++s) {
+        capped.record(Point3(random_double(), random_double(), random_double()), random_unit_vector(), 1.0);
+    }
+    capped.end_pass();
+    EXPECT_EQ(capped.spatial_leaves(), 1u);
+
+    EXPECT_THROW(SDTree(AABB::empty()), std::invalid_argument);
+    settings.bsdf_fraction = 1.5;
+    EXPECT_THROW(SDTree(AABB(Point3(0, 0, 0), Point3(1, 1, 1)), settings), std::invalid_argument);
+}
+
+TEST(PathGuidingTests, GuidedPathsMatchUnguidedMean) {
+    // Floor lit only indirectly: the light faces the ceiling above it.
+    HitableList objects;
+    const auto grey = std::make_shared<Lambertian>(Color(0.5, 0.5, 0.5));
+    objects.add(std::make_shared<Plane>(Point3(0, 0, 0), Vec3(0, 1, 0), grey));
+    objects.add(std::make_shared<Plane>(Point3(0, 3, 0), Vec3(0, -1, 0), grey));
+    objects.add(std::make_shared<Sphere>(Point3(2, 2.8, 0), 0.1, std::make_shared<DiffuseLight>(Color(50, 50, 50))));
+    const Scene world(objects);
+    const LightList lights(objects);
+    PathTracerSettings settings;
+    settings.max_depth = 4;
+    settings.sky = false;
+    const Ray ray(Point3(0, 1, 0), Vec3(0.1, -1, 0.2));
+
+    const auto estimate = [&](int samples, double& mean, double& variance) {
+        double sum = 0.0;
+        double sum_squares = 0.0;
+        for (int s = 0; s < samples; ++s) {
+            const double value = trace_path(ray, world, lights, settings).y();
+            sum += value;
+            sum_squares += value * value;
+        }
+        mean = sum / samples;
+        variance = sum_squares / samples - mean * mean;
+    };
+    double plain_mean = 0.0;
+    double plain_variance = 0.0;
+    const int samples = 40000;
+    estimate(samples, plain_mean, plain_variance);
+
+    GuidingSettings guiding;
+    guiding.spatial_threshold = 1000.0;
+    settings.guide = std::make_shared<SDTree>(AABB(Point3(-20, -0.1, -20), Point3(20, 3.1, 20)), guiding);
+    for (int pass = 0; pass < 3; ++pass) {
+        double mean = 0.0;
+        double variance = 0.0;
+        estimate(5000 << pass, mean, variance);
+        settings.guide->end_pass();
+    }
+    settings.guide->set_training(false);
+    EXPECT_GT(settings.guide->directional_nodes(), settings.guide->spatial_leaves() * 2);
+
+    double guided_mean = 0.0;
+    double guided_variance = 0.0;
+    estimate(samples, guided_mean, guided_variance);
+    const double standard_error = std::sqrt((plain_variance + guided_variance) / samples);
+    EXPECT_NEAR(guided_mean, plain_mean, 5.0 * standard_error);
+}
@@ -0,0 +1,67 @@
+#include <gtest/gtest.h>
+
+#include <memory>
+
+#include "raytracer/RayTracer.h"
+#include "unit/TestHelpers.h"
+
+namespace {
+constexpr double kEpsilon = 1e-9;
+}
+
+TEST(PlaneTests, RayHitsPlaneAtExpectedT) {
+    const Plane plane(Point3(0.0, -1.0, 0.0), Vec3(0.0, 2.0, 0.0), std::make_shared<TestMaterial>());
+
+    const Ray ray(Point3(0.0, 1.0, 0.0), Vec3(0.0, -0.5, 0.0));
+    HitRecord rec;
+
+    ASSERT_TRUE(plane.hit(ray, 0.001, infinity, rec));
+    EXPECT_NEAR(rec.t, 4.0, kEpsilon);
+    EXPECT_TRUE(rec.front_face);
+    EXPECT_NEAR(rec.normal.y(), 1.0, kEpsilon);
+}
+
+TEST(PlaneTests, ParallelRayMissesAndPlaneHasNoBoundingBox) {
+    const Plane plane(Point3(0.0, 0.0, 0.0), Vec3(0.0, 1.0, 0.0), std::make_shared<TestMaterial>());
+
+    const Ray ray(Point3(0.0, 1.0, 0.0), Vec3(1.0, 0.0, 0.0));
+    HitRecord rec;
+    AABB box;
+
+    EXPECT_FALSE(plane.hit(ray, 0.001, infinity, rec));
+    EXPECT_FALSE(plane.bounding_box(box));
+}
+
+TEST(PlaneTests, SceneKeepsPlaneOutsideBvh) {
+    const auto material = std::make_shared<TestMaterial>();
+    HitableList objects;
+    objects.add(std::make_shared<Plane>(Point3(0.0, 0.0, 0.0), Vec3(0.0, 1.0, 0.0), material));
+    objects.add(std::make_shared<Sphere>(Point3(0.0, 1.0, 0.0), 0.5, material));
+    objects.add(std::make_shared<Sphere>(Point3(3.0, 1.0, 0.0), 0.5, material));
+
+    const Scene scene(objects);
+    ASSERT_EQ(scene.unbounded.objects.size(), 1u);
+
+    AABB bounded_box;
+    ASSERT_TRUE(scene.bounded->bounding_box(bounded_box));
+    EXPECT_NEAR(bounded_box.min().y(), 0.5, kEpsilon);
+
+    HitRecord rec;
+    const Ray down_onto_sphere(Point3(0.0, 5.0, 0.0), Vec3(0.0, -1.0, 0.0));
+    ASSERT_TRUE(scene.hit(down_onto_sphere, 0.001, infinity, rec));
+    EXPECT_NEAR(rec.t, 3.5, kEpsilon);
+
+    const Ray down_onto_ground(Point3(1.5, 5.0, 0.0), Vec3(0.0, -1.0, 0.0));
+    ASSERT_TRUE(scene.hit(down_onto_ground, 0.001, infinity, rec));
+    EXPECT_NEAR(rec.t, 5.0, kEpsilon);
+}
+
+TEST(PlaneTests, RandomSceneGroundIsUnbounded) {
+    const Scene scene(random_scene());
+
+    ASSERT_EQ(scene.unbounded.objects.size(), 1u);
+    AABB box;
+    EXPECT_FALSE(scene.bounding_box(box));
+    ASSERT_TRUE(scene.bounded->bounding_box(box));
+    EXPECT_GT(box.min().y(), -1.0);
+}
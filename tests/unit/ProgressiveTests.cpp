@@ -0,0 +1,166 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "TestScenes.h"
+#include "raytracer/Progressive.h"
+
+namespace {
+constexpr double kEpsilon = 1e-9;
+}
+
+TEST(ProgressiveTests, PassesAddOneSampleToEveryPixel) {
+    const TestScene scene;
+    ProgressiveRenderer renderer(scene.world, scene.lights, 20, 12, ShallowSettings(), 8);
+    std::vector<int> covered(20 * 12, 0);
+    for (int pass = 0; pass < 3; ++pass) {
+        EXPECT_TRUE(renderer.render_pass([&](int x0, int y0, int x1, int y1) {
+            for (int y = y0; y < y1; ++y) {
+                for (int x = x0; x < x1; ++x) {
+                    ++covered[static_cast<size_t>(y) * 20 + x];
+                }
+            }
+        }));
+    }
+    EXPECT_EQ(renderer.passes(), 3);
+    for (int count : covered) {
+        EXPECT_EQ(count, 3);
+    }
+    EXPECT_EQ(renderer.pixel(19, 11).samples(), 3);
+    // Bottom rows look down at the floor, top rows over it into the sky.
+    EXPECT_LT(renderer.pixel(10, 11).depth(), infinity);
+}
+
+TEST(ProgressiveTests, CameraChangeRestartsAccumulation) {
+    const TestScene scene;
+    ProgressiveRenderer renderer(scene.world, scene.lights, 9, 9, ShallowSettings());
+    const auto ignore = [](int, int, int, int) {};
+    renderer.render_pass(ignore);
+    renderer.render_pass(ignore);
+    EXPECT_EQ(renderer.passes(), 2);
+
+    CameraParams params;
+    params.lookfrom = Point3(0, 5, 0.01);
+    params.vfov = 10.0;
+    params.aperture = 0.0;
+    const uint64_t view = renderer.set_camera(params);
+    EXPECT_NE(renderer.film_generation(), view);
+    EXPECT_NEAR(renderer.camera().vfov, 10.0, kEpsilon);
+
+    EXPECT_TRUE(renderer.render_pass(ignore));
+    EXPECT_EQ(renderer.film_generation(), view);
+    EXPECT_EQ(renderer.passes(), 1);
+    EXPECT_EQ(renderer.pixel(4, 4).samples(), 1);
+    // Looking straight down from y = 5 at the top of the ball; the centre
+    // pixel stays within 0.11 of the axis.
+    EXPECT_NEAR(renderer.pixel(4, 4).depth(), 3.0, 0.01);
+}
+
+TEST(ProgressiveTests, RestartInterruptsPassInFlight) {
+    const TestScene scene;
+    ProgressiveRenderer renderer(scene.world, scene.lights, 64, 64, ShallowSettings(), 8);
+    int tiles = 0;
+    const bool completed = renderer.render_pass([&](int, int, int, int) {
+        if (++tiles == 1) {
+            renderer.restart();
+        }
+    });
+    EXPECT_FALSE(completed);
+    EXPECT_LT(tiles, 64);
+    EXPECT_EQ(renderer.passes(), 0);
+
+    EXPECT_TRUE(renderer.render_pass([](int, int, int, int) {}));
+    EXPECT_EQ(renderer.passes(), 1);
+    EXPECT_EQ(renderer.pixel(0, 0).samples(), 1);
+
+    EXPECT_THROW(ProgressiveRenderer(scene.world, scene.lights, 0, 4), std::invalid_argument);
+}
+
+TEST(ProgressiveTests, PreviewStagesCoverTheFrameCoarseToFine) {
+    const TestScene scene;
+    ProgressiveRenderer renderer(scene.world, scene.lights, 20, 12, ShallowSettings(), 8, 2);
+    const auto ignore = [](int, int, int, int) {};
+    const auto traced = [&]() {
+        int count = 0;
+        for (const PixelAccumulator& pixel : renderer.film()) {
+            count += pixel.samples();
+        }
+        return count;
+    };
+
+    // Stride 4 from each tile origin: tile columns are 8, 8 and 4 wide, rows
+    // 8 and 4 high.
+    EXPECT_TRUE(renderer.render_pass(ignore));
+    EXPECT_EQ(traced(), (2 + 2 + 1) * (2 + 1));
+    EXPECT_EQ(renderer.stage_stride(), 2);
+    EXPECT_EQ(renderer.passes(), 0);
+    // Untraced pixels show their block's anchor.
+    EXPECT_EQ(renderer.pixel(3, 3).samples(), 0);
+    const Color anchor = renderer.pixel(0, 0).mean();
+    EXPECT_NEAR(renderer.display(3, 3).x(), anchor.x(), kEpsilon);
+    EXPECT_NEAR(renderer.display(9, 10).z(), renderer.pixel(8, 8).mean().z(), kEpsilon);
+
+    EXPECT_TRUE(renderer.render_pass(ignore));
+    EXPECT_EQ(renderer.stage_stride(), 1);
+    EXPECT_EQ(renderer.pixel(2, 2).samples(), 1);
+    EXPECT_EQ(renderer.pixel(0, 0).samples(), 1);
+
+    // The last stage completes 1 spp without tracing any pixel twice.
+    EXPECT_TRUE(renderer.render_pass(ignore));
+    EXPECT_EQ(renderer.passes(), 1);
+    EXPECT_EQ(traced(), 20 * 12);
+    EXPECT_TRUE(renderer.render_pass(ignore));
+    EXPECT_EQ(traced(), 2 * 20 * 12);
+
+    renderer.restart();
+    EXPECT_TRUE(renderer.render_pass(ignore));
+    EXPECT_EQ(renderer.passes(), 0);
+    EXPECT_EQ(renderer.pixel(1, 1).samples(), 0);
+    EXPECT_THROW(ProgressiveRenderer(scene.world, scene.lights, 4, 4, ShallowSettings(), 8, -1), std::invalid_argument);
+}
+
+TEST(ProgressiveTests, RegionSchedulesTilesWithoutRestarting) {
+    const TestScene scene;
+    ProgressiveRenderer renderer(scene.world, scene.lights, 32, 16, ShallowSettings(), 8);
+    RenderRegion region;
+    region.x0 = 17;
+    region.y0 = 9;
+    region.x1 = 40;  // clipped to the image
+    region.y1 = 12;
+    region.mode = RegionMode::Focus;
+    region.outside_interval = 2;
+    renderer.set_region(region);
+    EXPECT_EQ(renderer.region().x1, 32);
+
+    // Passes 0 and 2 cover the whole frame, 1 and 3 only the region's two
+    // tiles.
+    std::vector<int> tiles;
+    for (int pass = 0; pass < 4; ++pass) {
+        std::atomic<int> count{0};
+        EXPECT_TRUE(renderer.render_pass([&](int, int, int, int) { ++count; }));
+        tiles.push_back(count.load());
+    }
+    EXPECT_EQ(tiles, (std::vector<int>{8, 2, 8, 2}));
+    EXPECT_EQ(renderer.passes(), 4);
+    EXPECT_EQ(renderer.pixel(20, 10).samples(), 4);
+    EXPECT_EQ(renderer.pixel(31, 15).samples(), 4);
+    EXPECT_EQ(renderer.pixel(2, 2).samples(), 2);
+    EXPECT_EQ(renderer.pixel(15, 15).samples(), 2);
+
+    // Crop leaves everything outside the region untouched.
+    region.mode = RegionMode::Crop;
+    renderer.set_region(region);
+    renderer.render_pass([](int, int, int, int) {});
+    EXPECT_EQ(renderer.passes(), 5);
+    EXPECT_EQ(renderer.pixel(20, 10).samples(), 5);
+    EXPECT_EQ(renderer.pixel(2, 2).samples(), 2);
+
+    // An empty rectangle turns the region off.
+    region.x0 = region.x1;
+    renderer.set_region(region);
+    EXPECT_EQ(renderer.region().mode, RegionMode::Off);
+    region.outside_interval = 0;
+    EXPECT_THROW(renderer.set_region(region), std::invalid_argument);
+}
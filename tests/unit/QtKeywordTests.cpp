@@ -0,0 +1,52 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <future>
+
+// The app includes the library after Qt, whose keyword macros rewrite any
+// identifier of the same name. This file is its own test executable so that
+// the inline functions below are not merged with the other tests' copies.
+#define signals public
+#define slots
+#define emit
+#define forever for (;;)
+#define foreach(variable, container) for (variable : container)
+
+#include "raytracer/Aov.h"
+#include "raytracer/Checkpoint.h"
+#include "raytracer/Denoiser.h"
+#include "raytracer/Distributed.h"
+#include "raytracer/Environment.h"
+#include "raytracer/FilmResolve.h"
+#include "raytracer/ImageExport.h"
+#include "raytracer/Integrator.h"
+#include "raytracer/LazyBVH.h"
+#include "raytracer/LightBVH.h"
+#include "raytracer/PathGuiding.h"
+#include "raytracer/Progressive.h"
+#include "raytracer/QuantizedBVH.h"
+#include "raytracer/RayQuery.h"
+#include "raytracer/TiledImage.h"
+#include "raytracer/Tlas.h"
+#include "raytracer/UniformGrid.h"
+
+TEST(QtKeywordTests, TileBudgetKeepsItsSlots) {
+    tiled_detail::TileBudget budget(2);
+    auto both = std::async(std::launch::async, [&] {
+        budget.acquire();
+        budget.acquire();
+    });
+    const bool acquired = both.wait_for(std::chrono::seconds(5)) == std::future_status::ready;
+    if (!acquired) {
+        budget.release();
+        budget.release();
+    }
+    EXPECT_TRUE(acquired);
+}
+
+TEST(QtKeywordTests, DiffuseLightRadiance) {
+    const DiffuseLight light(Color(1, 2, 3));
+    HitRecord rec;
+    rec.front_face = true;
+    EXPECT_EQ(light.emitted(Ray(), rec).y(), 2.0);
+}
@@ -0,0 +1,80 @@
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <vector>
+
+#include "TestScenes.h"
+#include "raytracer/QuantizedBVH.h"
+
+namespace {
+constexpr double kEpsilon = 1e-9;
+
+bool Contains(const AABB& outer, const AABB& inner) {
+    for (int axis = 0; axis < 3; ++axis) {
+        if (outer.min()[axis] > inner.min()[axis] || outer.max()[axis] < inner.max()[axis]) {
+            return false;
+        }
+    }
+    return true;
+}
+}
+
+TEST(QuantizedBvhTests, MatchesSourceHierarchy) {
+    const auto objects = MakeSphereField(400);
+    const LinearBVH source(objects, BVHBuildMethod::SAH);
+    const QuantizedBVH quantized(source);
+
+    for (int i = 0; i < 1024; ++i) {
+        const Ray ray(Point3::random(-12.0, 12.0), Vec3::random(-1.0, 1.0));
+        HitRecord expected;
+        HitRecord actual;
+        const bool expected_hit = source.hit(ray, 0.001, infinity, expected);
+        ASSERT_EQ(quantized.hit(ray, 0.001, infinity, actual), expected_hit);
+        if (expected_hit) {
+            EXPECT_NEAR(actual.t, expected.t, kEpsilon);
+        }
+    }
+}
+
+TEST(QuantizedBvhTests, DecodedChildBoxesAreConservative) {
+    const auto objects = MakeSphereField(200);
+    const LinearBVH source(objects, BVHBuildMethod::Median, 1);
+    const QuantizedBVH quantized(source);
+
+    // Walk both hierarchies in lockstep.
+    std::vector<std::pair<uint32_t, uint32_t>> pending = {{0u, 0u}};
+    size_t checked = 0;
+    while (!pending.empty()) {
+        const auto [source_index, target] = pending.back();
+        pending.pop_back();
+        const LinearBVHNode& parent = source.node(source_index);
+        const QuantizedBVHNode& node = quantized.node(target);
+        for (int slot = 0; slot < 2; ++slot) {
+            const LinearBVHNode& child = source.node(parent.offset + slot);
+            EXPECT_TRUE(Contains(QuantizedBVH::child_box(node, slot), child.box));
+            ++checked;
+            if (child.count == 0) {
+                pending.emplace_back(parent.offset + slot, node.child[slot]);
+            }
+        }
+    }
+    EXPECT_EQ(checked, source.node_count() - 1);
+}
+
+TEST(QuantizedBvhTests, SingleLeafTree) {
+    const auto material = std::make_shared<Lambertian>(Color(0.5, 0.5, 0.5));
+    std::vector<std::shared_ptr<Hitable>> objects = {
+        std::make_shared<Sphere>(Point3(0.0, 0.0, -2.0), 0.5, material)};
+    const QuantizedBVH quantized{LinearBVH(objects)};
+
+    HitRecord rec;
+    ASSERT_TRUE(quantized.hit(Ray(Point3(0.0, 0.0, 0.0), Vec3(0.0, 0.0, -1.0)), 0.001, infinity, rec));
+    EXPECT_NEAR(rec.t, 1.5, kEpsilon);
+}
+
+TEST(QuantizedBvhTests, UsesLessMemoryThanSource) {
+    const LinearBVH source(MakeSphereField(1000));
+    const QuantizedBVH quantized(source);
+    EXPECT_EQ(quantized.node_count(), (source.node_count() - 1) / 2);
+    EXPECT_LT(quantized.memory_bytes() * 2, source.memory_bytes());
+}
@@ -0,0 +1,135 @@
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "raytracer/RayQuery.h"
+
+namespace {
+constexpr double kEpsilon = 1e-9;
+
+struct Field {
+    std::vector<std::shared_ptr<Material>> materials;
+    std::vector<std::shared_ptr<Hitable>> objects;
+};
+
+Field MakeSphereField(int count) {
+    Field field;
+    for (int m = 0; m < 4; ++m) {
+        field.materials.push_back(std::make_shared<Lambertian>(Color::random()));
+    }
+    for (int i = 0; i < count; ++i) {
+        const Point3 center(random_double(-10.0, 10.0), random_double(-10.0, 10.0), random_double(-10.0, 10.0));
+        field.objects.push_back(
+            std::make_shared<Sphere>(center, random_double(0.1, 0.8), field.materials[i % field.materials.size()]));
+    }
+    return field;
+}
+
+RayBatch RandomRays(size_t count) {
+    RayBatch rays;
+    rays.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        const Point3 from = Point3::random(-12.0, 12.0);
+        rays.set(i, Ray(from, Point3::random(-12.0, 12.0) - from), 0.001, i % 3 == 0 ? 0.999 : infinity);
+    }
+    return rays;
+}
+}
+
+TEST(RayQueryTests, IntersectMatchesSingleRayQueries) {
+    const Field field = MakeSphereField(800);
+    const auto bvh = std::make_shared<LinearBVH>(field.objects);
+    RayQuerySettings settings;
+    settings.sort_threshold = 256;
+    const RayQuery query(bvh, field.materials, settings);
+
+    const RayBatch rays = RandomRays(5000);
+    HitBatch hits;
+    query.intersect(rays, hits);
+    ASSERT_EQ(hits.size(), rays.size());
+
+    int hit_count = 0;
+    for (size_t i = 0; i < rays.size(); ++i) {
+        HitRecord rec;
+        if (!bvh->hit(rays.ray(i), rays.t_min[i], rays.t_max[i], rec)) {
+            EXPECT_EQ(hits.primitive_id[i], RayQuery::kNoHit);
+            EXPECT_EQ(hits.t[i], infinity);
+            continue;
+        }
+        ++hit_count;
+        EXPECT_NEAR(hits.t[i], rec.t, kEpsilon);
+        ASSERT_LT(hits.primitive_id[i], field.objects.size());
+        EXPECT_EQ(bvh->primitive(hits.primitive_id[i]), field.objects[hits.primitive_id[i]]);
+        EXPECT_EQ(hits.material_id[i], hits.primitive_id[i] % field.materials.size());
+        EXPECT_NEAR(hits.normal_x[i], rec.normal.x(), kEpsilon);
+        EXPECT_NEAR(hits.normal_y[i], rec.normal.y(), kEpsilon);
+        EXPECT_NEAR(hits.normal_z[i], rec.normal.z(), kEpsilon);
+    }
+    EXPECT_GT(hit_count, 0);
+}
+
+TEST(RayQueryTests, OccludedMatchesSingleRayQueries) {
+    const Field field = MakeSphereField(400);
+    const auto bvh = std::make_shared<LinearBVH>(field.objects);
+    const RayQuery query(bvh);
+
+    const RayBatch rays = RandomRays(8192);
+    std::vector<uint8_t> blocked;
+    query.occluded(rays, blocked);
+    ASSERT_EQ(blocked.size(), rays.size());
+    for (size_t i = 0; i < rays.size(); ++i) {
+        EXPECT_EQ(blocked[i] != 0, bvh->occluded(rays.ray(i), rays.t_min[i], rays.t_max[i]));
+    }
+}
+
+TEST(RayQueryTests, TraceOrderIsPermutationGroupedByOctant) {
+    const Field field = MakeSphereField(100);
+    const RayQuery query(std::make_shared<LinearBVH>(field.objects));
+
+    const RayBatch rays = RandomRays(10000);
+    const std::vector<uint32_t> order = query.trace_order(rays);
+    ASSERT_EQ(order.size(), rays.size());
+
+    std::vector<bool> seen(rays.size(), false);
+    int octant_changes = 0;
+    int previous = -1;
+    for (uint32_t i : order) {
+        ASSERT_FALSE(seen[i]);
+        seen[i] = true;
+        const int octant = (rays.direction_x[i] < 0.0 ? 4 : 0) | (rays.direction_y[i] < 0.0 ? 2 : 0) |
+                           (rays.direction_z[i] < 0.0 ? 1 : 0);
+        EXPECT_GE(octant, previous);
+        octant_changes += octant != previous ? 1 : 0;
+        previous = octant;
+    }
+    EXPECT_LE(octant_changes, 8);
+}
+
+TEST(RayQueryTests, UnknownMaterialsReportNoHitId) {
+    const Field field = MakeSphereField(50);
+    const auto bvh = std::make_shared<LinearBVH>(field.objects);
+    const RayQuery query(bvh, {field.materials[0]});
+
+    const RayBatch rays = RandomRays(2000);
+    HitBatch hits;
+    query.intersect(rays, hits);
+    for (size_t i = 0; i < hits.size(); ++i) {
+        if (hits.primitive_id[i] == RayQuery::kNoHit) {
+            continue;
+        }
+        const bool in_palette = hits.primitive_id[i] % field.materials.size() == 0;
+        EXPECT_EQ(hits.material_id[i], in_palette ? 0u : RayQuery::kNoHit);
+    }
+}
+
+TEST(RayQueryTests, RejectsMismatchedArrays) {
+    const Field field = MakeSphereField(10);
+    const RayQuery query(std::make_shared<LinearBVH>(field.objects));
+
+    RayBatch rays = RandomRays(16);
+    rays.t_max.pop_back();
+    HitBatch hits;
+    EXPECT_THROW(query.intersect(rays, hits), std::invalid_argument);
+}
@@ -0,0 +1,54 @@
+#ifndef TEST_SCENES_H
+#define TEST_SCENES_H
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "raytracer/Aov.h"
+#include "raytracer/Integrator.h"
+#include "raytracer/RayTracer.h"
+
+// `name` in gtest's scratch directory.
+inline std::string TempPath(const char* name) {
+    return (std::string(::testing::TempDir()) + name);
+}
+
+// `count` spheres of random radius scattered through [-10, 10]^3, drawn
+// from the thread's generator.
+inline std::vector<std::shared_ptr<Hitable>> MakeSphereField(int count) {
+    const auto material = std::make_shared<Lambertian>(Color(0.5, 0.5, 0.5));
+    std::vector<std::shared_ptr<Hitable>> objects;
+    for (int i = 0; i < count; ++i) {
+        const Point3 center(random_double(-10.0, 10.0), random_double(-10.0, 10.0), random_double(-10.0, 10.0));
+        objects.push_back(std::make_shared<Sphere>(center, random_double(0.05, 0.6), material));
+    }
+    return objects;
+}
+
+// A grey ground plane at y = 0 with a red unit ball resting on it.
+inline HitableList FloorAndBall() {
+    HitableList objects;
+    objects.add(std::make_shared<Plane>(Point3(0, 0, 0), Vec3(0, 1, 0), std::make_shared<Lambertian>(Color(0.5, 0.5, 0.5))));
+    objects.add(std::make_shared<Sphere>(Point3(0, 1, 0), 1.0, std::make_shared<Lambertian>(Color(0.8, 0.2, 0.2))));
+    return objects;
+}
+
+// FloorAndBall() ready to trace: flat scene, light list and AOV ids.
+struct TestScene {
+    HitableList objects = FloorAndBall();
+    Scene world{objects};
+    LightList lights{objects};
+    AovIds ids{objects};
+};
+
+// Short paths keep the renderer tests fast.
+inline PathTracerSettings ShallowSettings() {
+    PathTracerSettings settings;
+    settings.max_depth = 3;
+    return settings;
+}
+
+#endif // TEST_SCENES_H
@@ -0,0 +1,46 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+#include "raytracer/ThreadPool.h"
+
+TEST(ThreadPoolTests, ParallelForVisitsEveryIndexOnce) {
+    ThreadPool pool(3);
+    std::vector<std::atomic<int>> visits(10000);
+
+    pool.parallel_for(visits.size(), 64, [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; ++i) {
+            visits[i].fetch_add(1);
+        }
+    });
+
+    for (const auto& count : visits) {
+        EXPECT_EQ(count.load(), 1);
+    }
+}
+
+TEST(ThreadPoolTests, NestedParallelForRunsInline) {
+    ThreadPool pool(2);
+    std::atomic<size_t> total{0};
+
+    pool.parallel_for(8, 1, [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; ++i) {
+            pool.parallel_for(100, 10, [&](size_t a, size_t b) { total.fetch_add(b - a); });
+        }
+    });
+
+    EXPECT_EQ(total.load(), 800u);
+}
+
+TEST(ThreadPoolTests, ExceptionIsRethrownInCaller) {
+    ThreadPool pool(2);
+    EXPECT_THROW(pool.parallel_for(1000, 10,
+                                   [](size_t first, size_t) {
+                                       if (first == 500) {
+                                           throw std::runtime_error("boom");
+                                       }
+                                   }),
+                 std::runtime_error);
+}
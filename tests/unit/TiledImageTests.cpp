@@ -0,0 +1,175 @@
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "TestScenes.h"
+#include "raytracer/TiledImage.h"
+
+namespace {
+TiledRenderSettings SmallPoster() {
+    TiledRenderSettings settings;
+    settings.width = 40;
+    settings.height = 24;
+    settings.tile_size = 16;
+    settings.samples = 2;
+    settings.aovs = AovSet{AovChannel::Depth, AovChannel::Normal};
+    return settings;
+}
+}
+
+TEST(TiledImageTests, WriterAndReaderAgreeOnLayout) {
+    const std::string path = TempPath("tiled_layout.rttile");
+    {
+        TiledImageWriter writer(path, 20, 10, 8, AovSet{AovChannel::Depth});
+        EXPECT_EQ(writer.tiles_x(), 3);
+        EXPECT_EQ(writer.tiles_y(), 2);
+        std::vector<float> tile(8 * 8 * 4);
+        for (size_t i = 0; i < tile.size(); ++i) {
+            tile[i] = static_cast<float>(i);
+        }
+        writer.write_tile(2, 1, tile.data());
+    }
+    const TiledImage image(path);
+    EXPECT_EQ(image.width(), 20);
+    EXPECT_EQ(image.planes(), 4);
+    EXPECT_TRUE(image.aovs().contains(AovChannel::Depth));
+    // Pixel (17, 9) is (1, 1) inside tile (2, 1): index 9 of each plane.
+    const Color value = image.pixel(17, 9);
+    EXPECT_EQ(value.x(), 9.0);
+    EXPECT_EQ(value.y(), 64.0 + 9.0);
+    EXPECT_EQ(value.z(), 128.0 + 9.0);
+    EXPECT_EQ(image.read_tile(2, 1)[3 * 64 + 9], 192.0f + 9.0f);
+    // Unwritten tiles read back as zeros.
+    EXPECT_EQ(image.pixel(0, 0).x(), 0.0);
+    EXPECT_THROW(image.read_tile(3, 0), std::invalid_argument);
+    std::remove(path.c_str());
+    EXPECT_THROW(TiledImage{path}, std::runtime_error);
+}
+
+TEST(TiledImageTests, OutputDoesNotDependOnTheBudget) {
+    const TestScene scene;
+    const std::string roomy_path = TempPath("tiled_roomy.rttile");
+    const std::string tight_path = TempPath("tiled_tight.rttile");
+    CameraParams view;
+    view.lookfrom = Point3(6, 1.5, 2);
+    view.lookat = Point3(0, 1, 0);
+
+    const TiledRenderSettings roomy = SmallPoster();
+    int reported = 0;
+    const TiledRenderStats roomy_stats =
+        render_tiled(scene.world, scene.lights, view, ShallowSettings(), roomy, scene.ids, roomy_path,
+                     [&](int x0, int y0, int x1, int y1, const float*) {
+                         EXPECT_LE(x1 - x0, 16);
+                         EXPECT_LE(y1, 24);
+                         EXPECT_EQ(x0 % 16 + y0 % 16, 0);
+                         ++reported;
+                     });
+    EXPECT_EQ(roomy_stats.tiles, 6u);
+    EXPECT_EQ(reported, 6);
+
+    // Room for a single tile: rendering and writing alternate.
+    TiledRenderSettings tight = SmallPoster();
+    tight.memory_budget = roomy_stats.tile_bytes;
+    const TiledRenderStats tight_stats =
+        render_tiled(scene.world, scene.lights, view, ShallowSettings(), tight, scene.ids, tight_path);
+    EXPECT_EQ(tight_stats.budget_tiles, 1u);
+    EXPECT_EQ(tight_stats.tiles, 6u);
+    EXPECT_GT(tight_stats.peak_resident_bytes, 0u);
+    EXPECT_LE(tight_stats.peak_resident_bytes, tight.memory_budget);
+
+    const TiledImage a(roomy_path);
+    const TiledImage b(tight_path);
+    ASSERT_EQ(a.planes(), 3 + 1 + 3);
+    for (int ty = 0; ty < 2; ++ty) {
+        for (int tx = 0; tx < 3; ++tx) {
+            EXPECT_EQ(a.read_tile(tx, ty), b.read_tile(tx, ty));
+        }
+    }
+    // The ball is in view and lit.
+    EXPECT_GT(a.pixel(20, 12).x(), 0.0);
+
+    TiledRenderSettings starved = SmallPoster();
+    starved.memory_budget = roomy_stats.tile_bytes - 1;
+    EXPECT_THROW(render_tiled(scene.world, scene.lights, view, ShallowSettings(), starved, scene.ids, tight_path),
+                 std::invalid_argument);
+    const std::atomic<bool> cancel{true};
+    EXPECT_EQ(render_tiled(scene.world, scene.lights, view, ShallowSettings(), roomy, scene.ids, tight_path, {}, &cancel)
+                  .tiles,
+              0u);
+    std::remove(roomy_path.c_str());
+    std::remove(tight_path.c_str());
+}
+
+TEST(TiledImageTests, TrainsTheGuideBeforeTheFrame) {
+    const TestScene scene;
+    CameraParams view;
+    view.lookfrom = Point3(6, 1.5, 2);
+    view.lookat = Point3(0, 1, 0);
+    PathTracerSettings path_settings = ShallowSettings();
+    EXPECT_THROW(train_guide(scene.world, scene.lights, view, path_settings, SmallPoster()), std::invalid_argument);
+
+    path_settings.guide = std::make_shared<SDTree>(AABB(Point3(-4, 0, -4), Point3(4, 4, 4)));
+    TiledRenderSettings settings = SmallPoster();
+    settings.samples = 16;
+    // 1 + 2 samples fit a quarter of 16; 4 more would not.
+    EXPECT_EQ(train_guide(scene.world, scene.lights, view, path_settings, settings), 2);
+    EXPECT_EQ(path_settings.guide->passes(), 2);
+    EXPECT_TRUE(path_settings.guide->trained());
+    EXPECT_FALSE(path_settings.guide->training());
+    EXPECT_GT(path_settings.guide->memory_bytes(), 0u);
+
+    bool finite = true;
+    render_tiled(scene.world, scene.lights, view, path_settings, settings, scene.ids, "",
+                 [&](int, int, int, int, const float* planes) {
+                     for (int i = 0; i < 3 * 16 * 16; ++i) {
+                         finite = finite && planes[i] >= 0.0f && planes[i] < 1e30f;
+                     }
+                 });
+    EXPECT_TRUE(finite);
+    EXPECT_EQ(path_settings.guide->passes(), 2);
+}
+
+TEST(TiledImageTests, DenoisesTheGatheredFrame) {
+    const TestScene scene;
+    TiledRenderSettings settings = SmallPoster();
+    settings.aovs = TiledFrameDenoiser::with_denoise_guides(AovSet{AovChannel::SampleCount});
+    EXPECT_THROW(TiledFrameDenoiser(40, 24, 16, AovSet{AovChannel::Depth}), std::invalid_argument);
+
+    // Reference: the frame as one tile, filtered whole.
+    TiledRenderSettings whole = settings;
+    whole.tile_size = 64;
+    std::vector<float> single;
+    render_tiled(scene.world, scene.lights, CameraParams(), ShallowSettings(), whole, scene.ids, "",
+                 [&](int, int, int, int, const float* planes) {
+                     single.assign(planes, planes + tiled_planes(whole.aovs) * 64 * 64);
+                 });
+    ASSERT_FALSE(single.empty());
+    const auto at = [&](int plane, size_t i) { return single[plane * 64 * 64 + (i / 40) * 64 + i % 40]; };
+    std::vector<Color> radiance(40 * 24);
+    DenoiseFeatures features(40, 24);
+    // Planes: RGB, depth, normal, albedo, sample count, variance.
+    for (size_t i = 0; i < radiance.size(); ++i) {
+        radiance[i] = Color(at(0, i), at(1, i), at(2, i));
+        features.depth[i] = at(3, i);
+        features.normal[i] = Vec3(at(4, i), at(5, i), at(6, i));
+        features.albedo[i] = Color(at(7, i), at(8, i), at(9, i));
+        features.variance[i] = at(11, i);
+    }
+    const std::vector<Color> expected = denoise(radiance, features);
+
+    TiledFrameDenoiser denoiser(40, 24, 16, settings.aovs);
+    render_tiled(scene.world, scene.lights, CameraParams(), ShallowSettings(), settings, scene.ids, "",
+                 [&](int x0, int y0, int x1, int y1, const float* planes) { denoiser.add_tile(x0, y0, x1, y1, planes); });
+    EXPECT_THROW(denoiser.finish(AovSet{AovChannel::PrimitiveId}), std::invalid_argument);
+    const std::vector<float> frame = denoiser.finish(AovSet{AovChannel::SampleCount});
+    ASSERT_EQ(frame.size(), 4u * 40 * 24);
+    for (size_t i = 0; i < expected.size(); ++i) {
+        for (int c = 0; c < 3; ++c) {
+            ASSERT_EQ(frame[c * 40 * 24 + i], static_cast<float>(expected[i][c])) << i;
+        }
+        ASSERT_EQ(frame[3 * 40 * 24 + i], at(10, i)) << i;
+    }
+}
@@ -0,0 +1,71 @@
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <vector>
+
+#include "raytracer/Tlas.h"
+
+namespace {
+constexpr double kEpsilon = 1e-9;
+
+std::vector<std::shared_ptr<Instance>> MakeRowOfInstances(int count) {
+    const auto material = std::make_shared<Lambertian>(Color(0.5, 0.5, 0.5));
+    const auto blas = std::make_shared<Sphere>(Point3(0.0, 0.0, 0.0), 0.5, material);
+    std::vector<std::shared_ptr<Instance>> instances;
+    for (int i = 0; i < count; ++i) {
+        instances.push_back(std::make_shared<Instance>(blas, Vec3(2.0 * i, 0.0, 0.0)));
+    }
+    return instances;
+}
+}
+
+TEST(TlasTests, InstanceHitIsTranslated) {
+    const auto material = std::make_shared<Lambertian>(Color(0.5, 0.5, 0.5));
+    const Instance instance(std::make_shared<Sphere>(Point3(0.0, 0.0, 0.0), 0.5, material),
+                            Vec3(0.0, 0.0, -3.0));
+
+    const Ray ray(Point3(0.0, 0.0, 0.0), Vec3(0.0, 0.0, -1.0));
+    HitRecord rec;
+    ASSERT_TRUE(instance.hit(ray, 0.001, infinity, rec));
+    EXPECT_NEAR(rec.t, 2.5, kEpsilon);
+    EXPECT_NEAR(rec.p.z(), -2.5, kEpsilon);
+    EXPECT_NEAR(rec.normal.z(), 1.0, kEpsilon);
+}
+
+TEST(TlasTests, MovedInstanceIsHitAtNewPosition) {
+    TLAS tlas(MakeRowOfInstances(32));
+
+    tlas.set_instance_offset(5, Vec3(10.0, 8.0, 0.0));
+
+    HitRecord rec;
+    const Ray old_position(Point3(10.0, 0.0, 5.0), Vec3(0.0, 0.0, -1.0));
+    const Ray new_position(Point3(10.0, 8.0, 5.0), Vec3(0.0, 0.0, -1.0));
+    EXPECT_FALSE(tlas.hit(old_position, 0.001, infinity, rec));
+    ASSERT_TRUE(tlas.hit(new_position, 0.001, infinity, rec));
+    EXPECT_NEAR(rec.p.y(), 8.0, kEpsilon);
+}
+
+TEST(TlasTests, FullRefitAfterMovingAllInstancesMatchesRebuild) {
+    TLAS refitted(MakeRowOfInstances(64));
+    for (size_t i = 0; i < refitted.instance_count(); ++i) {
+        refitted.instance(i)->set_offset(Vec3(0.0, 2.0 * static_cast<double>(i), 0.0));
+    }
+    refitted.refit();
+
+    TLAS rebuilt = refitted;
+    rebuilt.rebuild();
+
+    AABB refit_box;
+    AABB rebuild_box;
+    ASSERT_TRUE(refitted.bounding_box(refit_box));
+    ASSERT_TRUE(rebuilt.bounding_box(rebuild_box));
+    EXPECT_NEAR(refit_box.max().y(), rebuild_box.max().y(), kEpsilon);
+    EXPECT_NEAR(refit_box.max().x(), 0.5, kEpsilon);
+
+    const Ray ray(Point3(0.0, 40.0, 5.0), Vec3(0.0, 0.0, -1.0));
+    HitRecord a;
+    HitRecord b;
+    ASSERT_TRUE(refitted.hit(ray, 0.001, infinity, a));
+    ASSERT_TRUE(rebuilt.hit(ray, 0.001, infinity, b));
+    EXPECT_NEAR(a.t, b.t, kEpsilon);
+}
@@ -0,0 +1,97 @@
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <vector>
+
+#include "TestScenes.h"
+#include "raytracer/UniformGrid.h"
+
+namespace {
+constexpr double kEpsilon = 1e-9;
+
+void ExpectMatchesBruteForce(const Hitable& accel, const HitableList& reference) {
+    for (int i = 0; i < 1024; ++i) {
+        const Ray ray(Point3::random(-14.0, 14.0), Vec3::random(-1.0, 1.0));
+        HitRecord expected;
+        HitRecord actual;
+        const bool expected_hit = reference.hit(ray, 0.001, infinity, expected);
+        ASSERT_EQ(accel.hit(ray, 0.001, infinity, actual), expected_hit);
+        if (expected_hit) {
+            EXPECT_NEAR(actual.t, expected.t, kEpsilon);
+        }
+    }
+}
+}
+
+TEST(UniformGridTests, MatchesBruteForce) {
+    const auto objects = MakeSphereField(500);
+    HitableList reference;
+    reference.objects = objects;
+
+    const UniformGrid grid(objects);
+    ExpectMatchesBruteForce(grid, reference);
+}
+
+TEST(UniformGridTests, LargeSpheresSpanningManyCellsMatchBruteForce) {
+    auto objects = MakeSphereField(200);
+    const auto material = std::make_shared<Lambertian>(Color(0.5, 0.5, 0.5));
+    for (int i = 0; i < 4; ++i) {
+        objects.push_back(std::make_shared<Sphere>(Point3::random(-8.0, 8.0), 4.0, material));
+    }
+    HitableList reference;
+    reference.objects = objects;
+
+    GridSettings settings;
+    settings.density = 8.0;
+    const UniformGrid grid(objects, settings);
+    EXPECT_GT(grid.reference_count(), objects.size());
+    ExpectMatchesBruteForce(grid, reference);
+}
+
+TEST(UniformGridTests, ResolutionFollowsDensity) {
+    const auto objects = MakeSphereField(1000);
+    GridSettings settings;
+    settings.density = 1.0;
+    const UniformGrid coarse(objects, settings);
+    settings.density = 8.0;
+    const UniformGrid fine(objects, settings);
+
+    EXPECT_GT(fine.cell_count(), coarse.cell_count());
+    EXPECT_NEAR(static_cast<double>(coarse.cell_count()), 1000.0, 400.0);
+}
+
+TEST(UniformGridTests, MailboxTestsSpanningPrimitiveOnce) {
+    const auto material = std::make_shared<Lambertian>(Color(0.5, 0.5, 0.5));
+    std::vector<std::shared_ptr<Hitable>> objects = {
+        std::make_shared<Sphere>(Point3(0.0, 0.0, 0.0), 5.0, material)};
+    GridSettings settings;
+    settings.density = 1000.0;
+    const UniformGrid grid(objects, settings);
+
+    // Misses the large sphere but crosses many of the cells it overlaps.
+    const Ray ray(Point3(-6.0, 4.5, 4.5), Vec3(1.0, 0.0, 0.0));
+    HitRecord rec;
+    BVHTraversalStats stats;
+    EXPECT_FALSE(grid.hit(ray, 0.001, infinity, rec, stats));
+    EXPECT_GT(stats.node_visits, 2u);
+    EXPECT_EQ(stats.primitive_tests, 1u);
+}
+
+TEST(UniformGridTests, FlatSceneBuilds) {
+    const auto material = std::make_shared<Lambertian>(Color(0.5, 0.5, 0.5));
+    std::vector<std::shared_ptr<Hitable>> objects;
+    for (int i = 0; i < 50; ++i) {
+        objects.push_back(std::make_shared<Sphere>(Point3(i, 0.0, 0.0), 0.0, material));
+    }
+    const UniformGrid grid(objects);
+    EXPECT_GE(grid.cell_count(), 1u);
+
+    HitableList reference;
+    reference.objects = objects;
+    ExpectMatchesBruteForce(grid, reference);
+}
+
+TEST(UniformGridTests, ConstructingWithNoObjectsThrows) {
+    const std::vector<std::shared_ptr<Hitable>> none;
+    EXPECT_THROW(UniformGrid grid(none), std::invalid_argument);
+}